@@ -88,6 +88,16 @@ sub xdr_endian {
     }
 }
 
+sub xdr_zlib {
+    if(exists $defs{'HAVE_LIBZ'} && exists $defs{'HAVE_ZLIB_H'}){
+	print "/* zlib is available */\n";
+	print "#define XDR_HAVE_ZLIB\n";
+    } else {
+	print "/* zlib is not available */\n";
+	print "#undef XDR_HAVE_ZLIB\n";
+    }
+}
+
 while(<>){
     while($_ =~ /@($ident)@/){
 	if(exists $defs{$1}){
@@ -98,6 +108,9 @@ while(<>){
 	} elsif($1 eq "XDR_ENDIAN") {
 	    xdr_endian;
 	    $_ = "";
+	} elsif($1 eq "XDR_ZLIB") {
+	    xdr_zlib;
+	    $_ = "";
 	} else {
 	    print STDERR "Variable @$1@ undefined\n";
 	    $_ =~ s/@$1@//;	    
@@ -0,0 +1,267 @@
+/*
+ *
+ * BER, DER, TLV, ASN.1, ... Trees
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * Throughput benchmark for BerTree
+ *
+ * Generates synthetic corpora and reports parse, write and find
+ * throughput together with the number of heap allocations.
+ * Run by "make bench".
+ *
+ */
+
+#include "BerTree.h"
+#include "BerPath.h"
+#include <wtBufferDump.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <new>
+
+using namespace mgr;
+
+/*
+ * Allocation counting
+ *
+ */
+
+static size_t allocCount = 0;
+static size_t allocBytes = 0;
+
+// Dynamic exception specifications are an error since C++17
+#if __cplusplus >= 201103L
+# define BENCH_THROW_BAD_ALLOC
+# define BENCH_NOTHROW noexcept
+#else
+# define BENCH_THROW_BAD_ALLOC throw(std::bad_alloc)
+# define BENCH_NOTHROW throw()
+#endif
+
+// The replacement allocator is malloc() based, so free() is right
+#if defined(__GNUC__) && (__GNUC__ >= 11) && !defined(__clang__)
+# pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void *operator new(size_t s) BENCH_THROW_BAD_ALLOC {
+  allocCount++;
+  allocBytes += s;
+  void *p = malloc(s ? s : 1);
+  if(!p) throw std::bad_alloc();
+  return p;
+}
+
+void *operator new[](size_t s) BENCH_THROW_BAD_ALLOC {
+  return operator new(s);
+}
+
+void operator delete(void *p) BENCH_NOTHROW { free(p); }
+void operator delete[](void *p) BENCH_NOTHROW { free(p); }
+#if __cplusplus >= 201402L
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+#endif
+
+/*
+ * BerTree::freeNode() only clears nodes, since nodes may be shared
+ * between trees. The benchmark owns all its nodes, so they are
+ * deleted in order not to measure a growing heap.
+ */
+class BenchTree : public BerTree {
+public:
+  virtual ~BenchTree() { clear(); }
+  virtual void freeNode(HTreeNode *n) const {
+    BerTree::freeNode(n);
+    delete static_cast<BerTag *>(n);
+  }
+};
+
+/*
+ * Corpus generation
+ *
+ */
+
+static void putHeader(wtBuffer<unsigned char>& b, size_t number,
+		      BerContentTag::BerTagType ty, BerContentTag::BerTagClass cl,
+		      size_t length){
+  BerContentTag t(number,ty,cl);
+  BerContentLength l;
+  l.value(length);
+  b.append(t.readPtr(),t.byte_size());
+  b.append(l.readPtr(),l.byte_size());
+}
+
+static size_t headerSize(size_t number, size_t length){
+  BerContentTag t(number,BerContentTag::BER_PRIMITIVE,BerContentTag::BER_CONTEXT);
+  BerContentLength l;
+  l.value(length);
+  return t.byte_size() + l.byte_size();
+}
+
+// records of 64 nested constructed tags around an INTEGER
+static void deepCorpus(wtBuffer<unsigned char>& b, size_t total){
+  const size_t depth = 64;
+  size_t len[depth+1];
+  len[depth] = 3;
+  for(size_t i = depth; i; i--) len[i-1] = headerSize(i,len[i]) + len[i];
+  while(b.byte_size() < total){
+    for(size_t i = 0; i < depth; i++)
+      putHeader(b,i+1,BerContentTag::BER_CONSTRUCTED,BerContentTag::BER_CONTEXT,len[i+1]);
+    b.append((const unsigned char *)"\x02\x01\x2a",3);
+  }
+}
+
+// SEQUENCE records of 1000 INTEGER each
+static void wideCorpus(wtBuffer<unsigned char>& b, size_t total){
+  const size_t width = 1000;
+  unsigned char v[6] = { 0x02, 0x04, 0, 0, 0, 0 };
+  while(b.byte_size() < total){
+    putHeader(b,16,BerContentTag::BER_CONSTRUCTED,BerContentTag::BER_UNIVERSAL,width * sizeof(v));
+    for(size_t i = 0; i < width; i++){
+      v[5] = static_cast<unsigned char>(i);
+      b.append(v,sizeof(v));
+    }
+  }
+}
+
+// OCTET STRING records of 256 kByte
+static void largeCorpus(wtBuffer<unsigned char>& b, size_t total){
+  const size_t size = 256 * 1024;
+  unsigned char *d = new unsigned char[size];
+  for(size_t i = 0; i < size; i++) d[i] = static_cast<unsigned char>(i * 7);
+  while(b.byte_size() < total){
+    putHeader(b,4,BerContentTag::BER_PRIMITIVE,BerContentTag::BER_UNIVERSAL,size);
+    b.append(d,size);
+  }
+  delete[] d;
+}
+
+// PRIVATE tags with 4 and 5 byte tag numbers
+static void longTagCorpus(wtBuffer<unsigned char>& b, size_t total){
+  size_t n = 0x10000;
+  while(b.byte_size() < total){
+    putHeader(b,n,BerContentTag::BER_PRIMITIVE,BerContentTag::BER_PRIVATE,2);
+    b.append((const unsigned char *)"ok",2);
+    n = (n * 33 + 7) & 0x0fffffff;
+  }
+}
+
+/*
+ * Measurement
+ *
+ */
+
+static double now(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static size_t countNodes(const HTreeNode *n){
+  size_t c = 0;
+  for(;n;n = n->getNext()){
+    c++;
+    c += countNodes(n->getChild());
+  }
+  return c;
+}
+
+static void report(const char *corpus, const char *op, size_t bytes,
+		   size_t nodes, size_t iter, double t, size_t allocs){
+  printf("%-10s %-14s %10.1f MB/s %12.0f nodes/s %10.1f allocs/iter\n",
+	 corpus, op,
+	 bytes * iter / t / (1024.0 * 1024.0),
+	 nodes * iter / t,
+	 (double)allocs / iter);
+}
+
+// repeat op until MIN_TIME has elapsed
+#define MIN_TIME 0.5
+#define MEASURE(op, ...)					\
+  do {								\
+    size_t iter = 0, a0 = allocCount;				\
+    double t0 = now(), t = 0;					\
+    m_error_t err = ERR_NO_ERROR;				\
+    while((t < MIN_TIME) && (err == ERR_NO_ERROR)){		\
+      __VA_ARGS__;						\
+      iter++;							\
+      t = now() - t0;						\
+    }								\
+    if(err != ERR_NO_ERROR){					\
+      printf("*** Error: %s failed 0x%.4x\n",op,(int)err);	\
+      failed++;							\
+    } else {							\
+      report(name,op,bytes,nodes,iter,t,allocCount - a0);	\
+    }								\
+  } while(0)
+
+static size_t bench(const char *name, const wtBuffer<unsigned char>& in){
+  size_t failed = 0;
+  const unsigned char *d = in.readPtr();
+  const size_t bytes = in.byte_size();
+  BenchTree ber;
+
+  m_error_t res = ber.replace(d,bytes,false);
+  if((res != ERR_NO_ERROR) || ber.trailer()){
+    printf("*** Error: corpus %s does not parse 0x%.4x\n",name,(int)res);
+    return 1;
+  }
+  const size_t nodes = countNodes(ber.root());
+
+  MEASURE("parse", err = ber.replace(d,bytes,false));
+  MEASURE("parse(copy)", err = ber.replace(d,bytes,true));
+  MEASURE("parse(par)", err = ber.replaceParallel(d,bytes,0,false));
+
+  BufferDump out(bytes);
+  MEASURE("write", out.close(); ber.root(); err = ber.write(out,false));
+  if(out.get().byte_size() != bytes){
+    printf("*** Error: wrote %lu bytes of %lu\n",
+	   (unsigned long)out.get().byte_size(),(unsigned long)bytes);
+    failed++;
+  }
+
+  // a tag not contained in any corpus visits all nodes
+  BerContentTag missing(0x1234,BerContentTag::BER_PRIMITIVE,BerContentTag::BER_APPLICATION);
+  MEASURE("find", ber.root(); if(ber.find(missing)) err = ERR_INT_STATE);
+
+  BerPath path("//[APPLICATION 4660]");
+  std::vector<BerPathMatch> hits;
+  MEASURE("path(memory)", err = path.all(d,bytes,hits));
+
+  return failed;
+}
+
+int main(int argc, char *argv[]){
+  size_t total = 4 * 1024 * 1024;
+  size_t failed = 0;
+
+  if(argc > 1) total = strtoul(argv[1],NULL,0) * 1024;
+  printf("BerTree benchmark on corpora of %lu kByte\n\n",(unsigned long)total / 1024);
+
+  struct {
+    const char *name;
+    void (*gen)(wtBuffer<unsigned char>&, size_t);
+  } corpus[] = {
+    { "deep", deepCorpus },
+    { "wide", wideCorpus },
+    { "large", largeCorpus },
+    { "longtag", longTagCorpus }
+  };
+
+  for(size_t i = 0; i < sizeof(corpus)/sizeof(corpus[0]); i++){
+    wtBuffer<unsigned char> b;
+    b.Chunk(total);
+    corpus[i].gen(b,total);
+    failed += bench(corpus[i].name,b);
+    puts("");
+  }
+
+  printf("Used version: %s\n",BerTag().VersionTag());
+
+  return failed ? 1 : 0;
+}
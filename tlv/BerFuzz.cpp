@@ -0,0 +1,183 @@
+/*
+ *
+ * BER, DER, TLV, ASN.1, ... Trees
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * Fuzz harness for BerTag and BerTree
+ *
+ * The harness implements the libFuzzer entry point. Compile with
+ * -DLIBFUZZER and -fsanitize=fuzzer to run libFuzzer. Otherwise
+ * a stand-alone driver is built, which feeds the files given as
+ * arguments, or without arguments runs a fixed number of mutations
+ * of built-in seeds. Run by "make fuzz".
+ *
+ */
+
+#include "BerTree.h"
+#include "BerPath.h"
+#include <wtBufferDump.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+using namespace mgr;
+
+// trees of the harness own their nodes, see BerBench.cpp
+class FuzzTree : public BerTree {
+public:
+  virtual ~FuzzTree() { clear(); }
+  virtual void freeNode(HTreeNode *n) const {
+    BerTree::freeNode(n);
+    delete static_cast<BerTag *>(n);
+  }
+};
+
+static size_t countNodes(const HTreeNode *n){
+  size_t c = 0;
+  for(;n;n = n->getNext()){
+    c++;
+    c += countNodes(n->getChild());
+  }
+  return c;
+}
+
+#define FUZZ_CHECK(c)							\
+  if(!(c)){								\
+    fprintf(stderr,"*** Fuzz check failed: %s (%s:%d)\n",#c,__FILE__,__LINE__); \
+    abort();								\
+  }
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size){
+  if(!size) return 0;
+
+  // single TLV
+  BerTag t;
+  m_error_t res = t.readBer(data,size);
+  if(res == ERR_NO_ERROR){
+    FUZZ_CHECK(t.size() <= size);
+    FUZZ_CHECK(t.c_size() == t.content().byte_size());
+  }
+
+  // entire tree
+  FuzzTree ber;
+  res = ber.replace(data,size,false);
+  if(res != ERR_NO_ERROR) return 0;
+  // the tree normalizes length fields, so fullSize() may be smaller
+  size_t parsed = ber.fullSize();
+  FUZZ_CHECK(parsed <= size);
+  size_t raw = 0;
+  while((raw < size) && (t.readBer(data + raw,size - raw) == ERR_NO_ERROR))
+    raw += t.size();
+  FUZZ_CHECK(ber.trailer() ? (ber.trailer() == data + raw) : (raw == size));
+
+  // the parallel parser produces the same sequence
+  FuzzTree par;
+  res = par.replaceParallel(data,size,2,false);
+  FUZZ_CHECK(res == ERR_NO_ERROR);
+  FUZZ_CHECK(par.fullSize() == parsed);
+  FUZZ_CHECK(countNodes(par.root()) == countNodes(ber.root()));
+
+  // path scan on memory visits the same nodes
+  if(!ber.trailer()){
+    std::vector<BerPathMatch> hits;
+    BerPath all("//*");
+    FUZZ_CHECK(all.all(data,size,hits) == ERR_NO_ERROR);
+    FUZZ_CHECK(hits.size() == countNodes(ber.root()));
+  }
+
+  // re-encoding is stable
+  BufferDump out(parsed + 16), again(parsed + 16);
+  ber.root();
+  FUZZ_CHECK(ber.write(out) == ERR_NO_ERROR);
+  FuzzTree re;
+  const unsigned char *o = (const unsigned char *)out.get().readPtr();
+  FUZZ_CHECK(re.replace(o,out.get().byte_size(),false) == ERR_NO_ERROR);
+  FUZZ_CHECK(!re.trailer());
+  re.root();
+  FUZZ_CHECK(re.write(again) == ERR_NO_ERROR);
+  FUZZ_CHECK(again.get().byte_size() == out.get().byte_size());
+  FUZZ_CHECK(!memcmp(again.get().readPtr(),o,out.get().byte_size()));
+
+  return 0;
+}
+
+#ifndef LIBFUZZER
+
+static const char *seeds[] = {
+  "\x0e\x02\xa5\xff",
+  "\x1f\x0e\x81\x02\xa5\xff",
+  "\x30\x06\x02\x01\x01\x04\x01\x61\x05\x00",
+  "\x64\x0b\xa0\x06\x02\x01\x03\x83\x01\x61\xc1\x01\x63",
+  "\x7f\x81\x8a\x1b\x82\x00\x03\x01\x02\x03"
+};
+static const size_t seedLen[] = { 4, 6, 10, 13, 10 };
+
+static unsigned long rnd = 0x2545f491;
+static unsigned long next(void){
+  rnd = rnd * 1103515245UL + 12345UL;
+  return (rnd >> 16) & 0x7fff;
+}
+
+static int runFile(const char *name){
+  FILE *f = fopen(name,"rb");
+  if(!f){
+    perror(name);
+    return 1;
+  }
+  wtBuffer<unsigned char> b;
+  unsigned char chunk[4096];
+  size_t r;
+  while((r = fread(chunk,1,sizeof(chunk),f)) > 0) b.append(chunk,r);
+  fclose(f);
+  LLVMFuzzerTestOneInput(b.readPtr(),b.byte_size());
+  return 0;
+}
+
+int main(int argc, char *argv[]){
+  if(argc > 1){
+    int failed = 0;
+    for(int i = 1; i < argc; i++) failed += runFile(argv[i]);
+    printf("%d inputs processed\n",argc - 1);
+    return failed;
+  }
+
+  const size_t rounds = 50000;
+  const size_t nseeds = sizeof(seedLen)/sizeof(seedLen[0]);
+  unsigned char buf[64];
+
+  for(size_t i = 0; i < rounds; i++){
+    size_t s = next() % nseeds;
+    size_t l = seedLen[s];
+    memcpy(buf,seeds[s],l);
+    for(size_t m = next() % 4 + 1; m; m--){
+      switch(next() % 4){
+      case 0: // flip bits
+	buf[next() % l] ^= static_cast<unsigned char>(1 << (next() % 8));
+	break;
+      case 1: // random byte
+	buf[next() % l] = static_cast<unsigned char>(next());
+	break;
+      case 2: // truncate
+	if(l > 1) l = next() % l + 1;
+	break;
+      case 3: // append another seed
+	if(l + seedLen[s] <= sizeof(buf)){
+	  memcpy(buf + l,seeds[s],seedLen[s]);
+	  l += seedLen[s];
+	}
+	break;
+      }
+    }
+    LLVMFuzzerTestOneInput(buf,l);
+  }
+  printf("%lu mutations processed\n",(unsigned long)rounds);
+
+  return 0;
+}
+
+#endif // LIBFUZZER
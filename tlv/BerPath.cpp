@@ -0,0 +1,445 @@
+/*
+ *
+ * BER, DER, TLV, ASN.1, ... Trees
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *  BerPath      - compiled path query on BER data
+ *
+ * This defines the values:
+ *
+ */
+
+#include "BerPath.h"
+#include "BerPath.tag"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace mgr;
+
+/*
+ * Query compiler
+ *
+ */
+
+static const char *skipBlank(const char *s){
+  while(*s && isspace(*s)) s++;
+  return s;
+}
+
+/*! \param query Query string
+    \return Error code as defined in mgrError.h
+
+    Compiles the query to a sequence of steps. Syntax errors
+    yield ERR_PARS_STX, too many steps ERR_PARAM_LEN. In both
+    cases the query is left empty.
+*/
+m_error_t BerPath::compile(const char *query){
+  steps.clear();
+  if(!query) return ERR_PARAM_NULL;
+
+  const char *s = skipBlank(query);
+  bool descendant = false;
+  if(!strncmp(s,"//",2)){
+    descendant = true;
+    s += 2;
+  } else if(*s == '/') s++;
+
+  m_error_t err = ERR_NO_ERROR;
+  while(err == ERR_NO_ERROR){
+    Step step;
+    step.anyClass = step.anyNumber = false;
+    step.descendant = descendant;
+    step.cls = BerContentTag::BER_CONTEXT;
+    step.number = step.position = 0;
+
+    s = skipBlank(s);
+    if(*s == '*'){
+      step.anyClass = true;
+      s++;
+    } else if(*s == '['){
+      s = skipBlank(s+1);
+      if(isalpha(*s)){
+	const char *e = s;
+	while(isalpha(*e)) e++;
+	size_t n = e - s;
+	if((n == 9) && !strncmp(s,"UNIVERSAL",n)){
+	  step.cls = BerContentTag::BER_UNIVERSAL;
+	} else if((n == 11) && !strncmp(s,"APPLICATION",n)){
+	  step.cls = BerContentTag::BER_APPLICATION;
+	} else if((n == 7) && !strncmp(s,"CONTEXT",n)){
+	  step.cls = BerContentTag::BER_CONTEXT;
+	} else if((n == 7) && !strncmp(s,"PRIVATE",n)){
+	  step.cls = BerContentTag::BER_PRIVATE;
+	} else {
+	  err = ERR_PARS_STX;
+	  break;
+	}
+	s = skipBlank(e);
+      }
+      if(*s == '*'){
+	step.anyNumber = true;
+	s++;
+      } else if(isdigit(*s)){
+	char *e;
+	step.number = strtoul(s,&e,10);
+	s = e;
+      } else {
+	err = ERR_PARS_STX;
+	break;
+      }
+      s = skipBlank(s);
+      if(*s++ != ']'){
+	err = ERR_PARS_STX;
+	break;
+      }
+    } else {
+      err = ERR_PARS_STX;
+      break;
+    }
+
+    // optional position
+    s = skipBlank(s);
+    if(*s == '['){
+      s = skipBlank(s+1);
+      if(!isdigit(*s)){
+	err = ERR_PARS_STX;
+	break;
+      }
+      char *e;
+      step.position = strtoul(s,&e,10);
+      s = skipBlank(e);
+      if(!step.position || (*s++ != ']')){
+	err = ERR_PARS_STX;
+	break;
+      }
+      s = skipBlank(s);
+    }
+
+    if(steps.size() >= MAX_STEPS){
+      err = ERR_PARAM_LEN;
+      break;
+    }
+    steps.push_back(step);
+
+    if(!*s) break;
+    if(!strncmp(s,"//",2)){
+      descendant = true;
+      s += 2;
+    } else if(*s == '/'){
+      descendant = false;
+      s++;
+    } else err = ERR_PARS_STX;
+  }
+
+  if(err != ERR_NO_ERROR) steps.clear();
+  return err;
+}
+
+/*
+ * Evaluation
+ *
+ * active holds a bit for each step, which may match in
+ * the current sibling sequence. Descendant steps stay
+ * active in all sub-trees, the others are only activated
+ * for the children of a node matching the previous step.
+ *
+ */
+
+bool BerPath::match(BerTag *c, unsigned long active,
+		    std::vector<BerTag *> *hits, BerTag **first) const {
+  size_t count[MAX_STEPS];
+  const size_t last = steps.size() - 1;
+
+  memset(count,0,sizeof(count));
+  for(;c;c = static_cast<BerTag *>(c->getNext())){
+    BerContentTag::BerTagClass cls = c->tag().Class();
+    size_t number = c->tag().Number();
+    unsigned long sub = 0;
+
+    for(size_t i = 0; i <= last; i++){
+      if(!(active & (1UL << i))) continue;
+      const Step& s = steps[i];
+      if(s.descendant) sub |= 1UL << i;
+      if(s.position && (count[i] >= s.position)) continue;
+      if(!test(s,cls,number)) continue;
+      if(s.position && (++count[i] != s.position)) continue;
+      if(i < last){
+	sub |= 1UL << (i+1);
+      } else if(first){
+	*first = c;
+	return true;
+      } else {
+	hits->push_back(c);
+      }
+    }
+
+    // prune sub-trees, in which nothing can match
+    if(sub && c->getChild()){
+      if(match(static_cast<BerTag *>(c->getChild()),sub,hits,first))
+	return true;
+    }
+  }
+
+  return false;
+}
+
+m_error_t BerPath::match(const unsigned char *d, size_t l, unsigned long active,
+			 std::vector<BerPathMatch> *hits, BerPathMatch *first,
+			 bool& done) const {
+  size_t count[MAX_STEPS];
+  const size_t last = steps.size() - 1;
+  BerHeader h;
+  m_error_t err;
+
+  memset(count,0,sizeof(count));
+  while(l){
+    err = BerTag::readHeader(d,l,h);
+    if(err == ERR_CANCEL) return ERR_PARAM_RANG;
+    if(err != ERR_NO_ERROR) return err;
+    const size_t head = h.head();
+    unsigned long sub = 0;
+
+    for(size_t i = 0; i <= last; i++){
+      if(!(active & (1UL << i))) continue;
+      const Step& s = steps[i];
+      if(s.descendant) sub |= 1UL << i;
+      if(s.position && (count[i] >= s.position)) continue;
+      if(!test(s,h.cls,h.number)) continue;
+      if(s.position && (++count[i] != s.position)) continue;
+      if(i < last){
+	sub |= 1UL << (i+1);
+      } else {
+	BerPathMatch m;
+	m.tlv = d;
+	m.size = h.size();
+	m.value = d + head;
+	m.length = h.length;
+	if(first){
+	  *first = m;
+	  done = true;
+	  return ERR_NO_ERROR;
+	}
+	hits->push_back(m);
+      }
+    }
+
+    // prune sub-trees, in which nothing can match
+    if(sub && h.length && (h.type == BerContentTag::BER_CONSTRUCTED)){
+      err = match(d + head,h.length,sub,hits,first,done);
+      if((err != ERR_NO_ERROR) || done) return err;
+    }
+
+    d += h.size();
+    l -= h.size();
+  }
+
+  return ERR_NO_ERROR;
+}
+
+/*! \param t Tree to search
+    \return First matching node in pre-order or NULL
+
+    The query is evaluated on the sequence starting at the
+    current() node of the tree, i.e. with the same scope
+    as BerTree::find().
+*/
+BerTag *BerPath::first(const BerTree& t) const {
+  BerTag *hit = NULL;
+  if(steps.empty() || !t.current()) return NULL;
+  match(t.current(),1,NULL,&hit);
+  return hit;
+}
+
+/*! \param t Tree to search
+    \param hits Vector to append the matching nodes to
+    \return Error code as defined in mgrError.h
+
+    The query is evaluated on the sequence starting at the
+    current() node of the tree. The matches are appended in pre-order.
+*/
+m_error_t BerPath::all(const BerTree& t, std::vector<BerTag *>& hits) const {
+  if(steps.empty()) return ERR_INT_SEQ;
+  if(!t.current()) return ERR_NO_ERROR;
+  match(t.current(),1,&hits,NULL);
+  return ERR_NO_ERROR;
+}
+
+/*! \param d Start of BER coded memory
+    \param l Length of memory
+    \param hit Location of first match, hit.tlv is NULL if there is none
+    \return Error code as defined in mgrError.h
+
+    The memory is scanned without building a BerTree. Only the
+    headers of tags on the way to the match are decoded. Any
+    BER coding error encountered before the first match is returned.
+*/
+m_error_t BerPath::first(const unsigned char *d, size_t l, BerPathMatch& hit) const {
+  bool done = false;
+  memset(&hit,0,sizeof(hit));
+  if(!d) return ERR_PARAM_NULL;
+  if(steps.empty()) return ERR_INT_SEQ;
+  return match(d,l,1,NULL,&hit,done);
+}
+
+/*! \param d Start of BER coded memory
+    \param l Length of memory
+    \param hits Vector to append the matches to
+    \return Error code as defined in mgrError.h
+
+    The memory is scanned without building a BerTree. If a BER coding
+    error is encountered, the matches found so far are kept in hits
+    and the error is returned.
+*/
+m_error_t BerPath::all(const unsigned char *d, size_t l,
+		       std::vector<BerPathMatch>& hits) const {
+  bool done = false;
+  if(!d) return ERR_PARAM_NULL;
+  if(steps.empty()) return ERR_INT_SEQ;
+  return match(d,l,1,&hits,NULL,done);
+}
+
+const char *BerPath::VersionTag(void) const {
+  return _VERSION_;
+}
+
+/*
+ * The testsuite
+ *
+ ********************************************
+ *
+ */
+
+#ifdef TEST
+
+#include <stdio.h>
+
+int main(int argc, char *argv[]){
+  m_error_t res;
+  size_t tests, errors;
+
+  tests = errors = 0;
+
+  // [APPLICATION 4] { INTEGER 1, INTEGER 2, [0] { INTEGER 3, [3] 'a' } }
+  // [APPLICATION 4] { INTEGER 4, [3] 'b' }
+  // [PRIVATE 1] 'c'
+  const unsigned char data[] = {
+    0x64, 0x0e, 0x02, 0x01, 0x01, 0x02, 0x01, 0x02,
+    0xa0, 0x06, 0x02, 0x01, 0x03, 0x83, 0x01, 'a',
+    0x64, 0x06, 0x02, 0x01, 0x04, 0x83, 0x01, 'b',
+    0xc1, 0x01, 'c'
+  };
+
+  struct {
+    const char *query;
+    size_t hits;
+    unsigned char first;
+  } q[] = {
+    { "[APPLICATION 4]/[UNIVERSAL 2]", 3, 0x01 },
+    { "[APPLICATION 4]/[UNIVERSAL 2][2]", 1, 0x02 },
+    { "//[UNIVERSAL 2]", 4, 0x01 },
+    { "[APPLICATION 4]//[3]", 2, 'a' },
+    { "*[2]/[3]", 1, 'b' },
+    { "/[PRIVATE *]", 1, 'c' },
+    { "[APPLICATION 4]/*/[UNIVERSAL 2]", 1, 0x03 },
+    { "[UNIVERSAL 2]", 0, 0 }
+  };
+
+  BerTree ber;
+  res = ber.replace(data,sizeof(data));
+  if(res != ERR_NO_ERROR){
+    printf("*** Error: BerTree::replace() failed 0x%.4x\n",(int)res);
+    return 1;
+  }
+
+  for(size_t i = 0; i < sizeof(q)/sizeof(q[0]); i++){
+    printf("Test %d: Query '%s'\n",++tests,q[i].query);
+    BerPath p;
+    res = p.compile(q[i].query);
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: compile() failed 0x%.4x\n",(int)res);
+      continue;
+    }
+
+    std::vector<BerTag *> th;
+    std::vector<BerPathMatch> mh;
+    BerPathMatch m;
+    ber.root();
+    BerTag *t = p.first(ber);
+    p.all(ber,th);
+    res = p.all(data,sizeof(data),mh);
+    if(res == ERR_NO_ERROR) res = p.first(data,sizeof(data),m);
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: evaluation failed 0x%.4x\n",(int)res);
+      continue;
+    }
+    if((th.size() != q[i].hits) || (mh.size() != q[i].hits)){
+      errors++;
+      printf("*** Error: %u tree and %u memory hits instead of %u\n",
+	     (unsigned int)th.size(),(unsigned int)mh.size(),
+	     (unsigned int)q[i].hits);
+      continue;
+    }
+    if(!q[i].hits){
+      if(t || m.tlv){
+	errors++;
+	puts("*** Error: unexpected first match");
+      } else {
+	puts("+++ No match found OK!");
+      }
+      continue;
+    }
+    if(!t || (t != th[0]) || (m.tlv != mh[0].tlv) ||
+       (t->content().readPtr()[t->c_size()-1] != q[i].first) ||
+       (m.value[m.length-1] != q[i].first)){
+      errors++;
+      puts("*** Error: first match is wrong");
+      continue;
+    }
+    puts("+++ Query finished OK!");
+  }
+
+  printf("Test %d: Syntax errors\n",++tests);
+  const char *bad[] = { "", "[FOO 1]", "[APPLICATION]", "*[0]", "*/", "[1]x" };
+  size_t nbad = 0;
+  for(size_t i = 0; i < sizeof(bad)/sizeof(bad[0]); i++){
+    BerPath p;
+    if(p.compile(bad[i]) != ERR_PARS_STX){
+      printf("*** Error: '%s' accepted\n",bad[i]);
+      nbad++;
+    }
+  }
+  if(nbad){
+    errors++;
+  } else {
+    puts("+++ Syntax errors detected OK!");
+  }
+
+  printf("Test %d: Truncated data\n",++tests);
+  do {
+    BerPath p("//[3]");
+    std::vector<BerPathMatch> mh;
+    res = p.all(data,sizeof(data)-5,mh);
+    if((res != ERR_PARAM_RANG) || (mh.size() != 1)){
+      errors++;
+      printf("*** Error: all() returned 0x%.4x with %u hits\n",
+	     (int)res,(unsigned int)mh.size());
+    } else {
+      puts("+++ Truncation detected OK!");
+    }
+  } while(0);
+
+  printf("\n%d tests completed with %d errors.\n",tests,errors);
+  printf("Used version: %s\n",BerPath().VersionTag());
+
+  return 0;
+}
+
+#endif // TEST
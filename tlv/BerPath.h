@@ -0,0 +1,162 @@
+/*
+ *
+ * BER, DER, TLV, ASN.1, ... Trees
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *  BerPath      - compiled path query on BER data
+ *  BerPathMatch - match of a BerPath in BER coded memory
+ *
+ * This defines the values:
+ *
+ */
+
+#ifndef _TLV_BERPATH_H_
+# define _TLV_BERPATH_H_
+
+#include <BerTree.h>
+#include <vector>
+
+/*! \file BerPath.h
+    \brief Path queries on BER coded data
+
+    A BerPath is a small query language on tag paths. It is compiled
+    once and can then be evaluated against BerTree structures or
+    directly against BER coded memory without building a tree.
+
+    \author Dr. Lars Hanke
+    \date 2006-2008
+*/
+
+namespace mgr {
+
+  /*! \class BerPathMatch
+      \brief Location of a BerPath match in BER coded memory
+
+      Evaluating a BerPath on memory does not produce BerTag nodes.
+      Instead the matches are described by the location of the entire
+      TLV structure and the location of its contents.
+  */
+struct BerPathMatch {
+  const unsigned char *tlv;      //!< Start of the tag field, NULL if no match
+  size_t size;                   //!< Size of the entire TLV structure
+  const unsigned char *value;    //!< Start of the contents
+  size_t length;                 //!< Length of the contents
+};
+
+  /*! \class BerPath
+      \brief Compiled path query on BER data
+
+      The query consists of steps separated by '/', each of which
+      matches one level of the tag hierarchy. The first step applies
+      to the sequence the query is evaluated on, e.g. the top-level
+      sequence of a file. A step preceded by '//' instead matches on
+      any level below the previous step, or the starting
+      sequence for a leading '//'.
+
+      A step is either '*' matching any tag, or a tag in the ASN.1
+      notation '[CLASS number]'. CLASS is one of UNIVERSAL,
+      APPLICATION, CONTEXT or PRIVATE. If it is omitted, CONTEXT is
+      assumed like in ASN.1. The number may be '*' matching any
+      tag of the class. The type (primitive or constructed) is not
+      considered.
+
+      A step may be followed by a position '[n]', which selects only
+      the n-th sibling matching the step. Positions count from 1.
+
+      Examples:
+      - "[APPLICATION 4]/[UNIVERSAL 2][2]" is the second INTEGER
+        in each APPLICATION 4 tag of the starting sequence.
+      - "//[UNIVERSAL 4]" is any OCTET STRING.
+      - "[APPLICATION 4]//[3]" is any CONTEXT 3 at any level
+        below an APPLICATION 4 tag of the starting sequence.
+      - "*[2]/[PRIVATE *]" are the PRIVATE tags inside the second
+        tag of the starting sequence.
+
+      The evaluation is a single pass through the data. Sub-trees
+      are only entered, if a step may still match below them.
+
+      \note A query has at most MAX_STEPS steps.
+  */
+class BerPath {
+public:
+  enum {
+    MAX_STEPS = 8 * sizeof(unsigned long)  //!< Maximum number of steps of a query
+  };
+
+protected:
+  //! Single step of a query
+  struct Step {
+    bool anyClass;                      //!< step matches any tag
+    bool anyNumber;                     //!< step matches any tag number of the class
+    bool descendant;                    //!< step matches on any level
+    BerContentTag::BerTagClass cls;     //!< class to match
+    size_t number;                      //!< number to match
+    size_t position;                    //!< position among siblings, 0 for all
+  };
+
+  std::vector<Step> steps;              //!< compiled query
+
+  //! Check a step against the header information of a tag
+  inline bool test(const Step& s, const BerContentTag::BerTagClass& cls,
+		   const size_t& number) const {
+    if(s.anyClass) return true;
+    if(s.cls != cls) return false;
+    return s.anyNumber || (s.number == number);
+  }
+
+  //! Match a sibling sequence of a BerTree
+  bool match(BerTag *c, unsigned long active,
+	     std::vector<BerTag *> *hits, BerTag **first) const;
+
+  //! Match a sibling sequence in memory
+  m_error_t match(const unsigned char *d, size_t l, unsigned long active,
+		  std::vector<BerPathMatch> *hits, BerPathMatch *first,
+		  bool& done) const;
+
+public:
+  //! Create an empty query
+  /*! An empty query does not match anything. */
+  BerPath() {}
+
+  //! Create a compiled query
+  /*! \param query Query string to compile
+
+      Compiles the query. The CTOR throws, if compile() fails.
+  */
+  BerPath(const char *query){
+    m_error_t err = compile(query);
+    if(err != ERR_NO_ERROR)
+      mgrThrowFormat(err,"Compiling BER path '%s'",query);
+  }
+
+  //! Compile a query
+  m_error_t compile(const char *query);
+
+  //! Number of steps of the compiled query
+  inline size_t size(void) const { return steps.size(); }
+
+  //! Find the first match in a BerTree
+  BerTag *first(const BerTree& t) const;
+
+  //! Find all matches in a BerTree
+  m_error_t all(const BerTree& t, std::vector<BerTag *>& hits) const;
+
+  //! Find the first match in BER coded memory
+  m_error_t first(const unsigned char *d, size_t l, BerPathMatch& hit) const;
+
+  //! Find all matches in BER coded memory
+  m_error_t all(const unsigned char *d, size_t l,
+		std::vector<BerPathMatch>& hits) const;
+
+  //! Version information string
+  const char *VersionTag(void) const;
+};
+
+};
+
+#endif // _TLV_BERPATH_H_
@@ -0,0 +1,300 @@
+/*
+ *
+ * BER, DER, TLV, ASN.1, ... Trees
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *  BerLength      - compile time length field
+ *  BerIntSlot     - fixed size integer slot
+ *  BerRealSlot    - fixed size IEEE double slot
+ *  BerOctetSlot   - fixed size octet string slot
+ *  BerEmpty       - fixed empty tag
+ *  BerFields      - sequence of fields
+ *  _BerList       - size and formatting of a field list
+ *  BerConstructed - constructed tag from fields
+ *  BerSequence    - ASN.1 SEQUENCE from fields
+ *  BerMessage     - preformatted message buffer
+ *
+ * This defines the values:
+ *
+ */
+
+#ifndef _TLV_BERTEMPLATE_H_
+# define _TLV_BERTEMPLATE_H_
+
+#include <BerTree.h>
+#include <mgrMeta.h>
+#include <string.h>
+
+/*! \file BerTemplate.h
+    \brief Compile time layout of fixed size BER messages
+
+    Messages of fixed layout, e.g. telemetry records, need not be
+    built as BerTree for each record. Instead the layout is described
+    as a type composed of slots and constructed tags. All tags and
+    lengths are known at compile time, so a BerMessage formats its
+    buffer once and afterwards only copies the slot values to their
+    fixed offsets.
+
+    \code
+    typedef BerSequence< BerFields< BerIntSlot<4>,
+                                    BerRealSlot<0>,
+                                    BerOctetSlot<8> > > Record;
+    BerMessage<Record> msg;
+    msg.set<0>(42);
+    msg.set<1>(3.1415);
+    msg.set<2>("SENSOR01",8);
+    msg.write(stream);
+    \endcode
+
+    Slots are numbered in the order of appearance in the encoding
+    starting from 0.
+
+    \author Dr. Lars Hanke
+    \date 2006-2008
+*/
+
+namespace mgr {
+
+  //! BER length field of constant value
+  template< size_t L > struct BerLength {
+    enum { SIZE = (L < 0x80) ? 1 : 1 + (meta::NumBits<L>::VALUE + 7) / 8 };
+
+    //! Write the length field
+    static inline void write(unsigned char *p) {
+      if(SIZE == 1){
+	p[0] = static_cast<unsigned char>(L);
+	return;
+      }
+      p[0] = static_cast<unsigned char>(0x80 | (SIZE - 1));
+      for(size_t i = 1; i < (size_t)SIZE; i++)
+	p[i] = static_cast<unsigned char>(L >> (8 * (SIZE - 1 - i)));
+    }
+  };
+
+  //! Common part of primitive fields of fixed length
+  template< size_t T, BerContentTag::BerTagClass CLS, size_t N, size_t S >
+  struct _BerPrimitive {
+    typedef BerContentTag::TagString<T, BerContentTag::BER_PRIMITIVE, CLS> Tag;
+    enum { CONSTRUCTED = 0 };
+    enum { SLOTS = S };                                 //!< number of slots
+    enum { HEAD = Tag::SIZE + BerLength<N>::SIZE };     //!< header size
+    enum { SIZE = HEAD + N };                           //!< total size
+
+    //! Write header and clear contents
+    static inline void format(unsigned char *p) {
+      Tag::write(p);
+      BerLength<N>::write(p + Tag::SIZE);
+      memset(p + HEAD, 0, N);
+    }
+  };
+
+  /*! \class BerIntSlot
+      \brief Integer of fixed size N
+
+      The value is stored as N byte two's complement in network
+      order. This is valid BER, but not DER, if the value could
+      be stored in less octets.
+  */
+  template< size_t N, size_t T = 2,
+	    BerContentTag::BerTagClass CLS = BerContentTag::BER_UNIVERSAL >
+  struct BerIntSlot : public _BerPrimitive<T, CLS, N, 1> {
+    //! Store value to contents at p
+    static inline void set(unsigned char *p, long long v) {
+      for(size_t i = N; i; i--){
+	p[i-1] = static_cast<unsigned char>(v & 0xff);
+	v >>= 8;
+      }
+    }
+  };
+
+  /*! \class BerRealSlot
+      \brief IEEE double stored in network byte order
+
+      The value is stored as 8 octet big endian IEEE 754 double
+      like XDR does. This is not the ASN.1 REAL encoding, which
+      has no fixed size. Therefore there is no default tag.
+  */
+  template< size_t T,
+	    BerContentTag::BerTagClass CLS = BerContentTag::BER_CONTEXT >
+  struct BerRealSlot : public _BerPrimitive<T, CLS, 8, 1> {
+    //! Store value to contents at p
+    static inline void set(unsigned char *p, double v) {
+      unsigned long long b;
+      memcpy(&b, &v, sizeof(b));
+      for(size_t i = 8; i; i--){
+	p[i-1] = static_cast<unsigned char>(b & 0xff);
+	b >>= 8;
+      }
+    }
+  };
+
+  /*! \class BerOctetSlot
+      \brief Octet string of fixed size N
+
+      Shorter values are padded with zero bytes.
+  */
+  template< size_t N, size_t T = 4,
+	    BerContentTag::BerTagClass CLS = BerContentTag::BER_UNIVERSAL >
+  struct BerOctetSlot : public _BerPrimitive<T, CLS, N, 1> {
+    //! Store value to contents at p
+    static inline void set(unsigned char *p, const void *v, size_t l) {
+      if(l > N) l = N;
+      memcpy(p, v, l);
+      if(l < N) memset(p + l, 0, N - l);
+    }
+  };
+
+  //! Empty primitive tag, e.g. NULL, without slot
+  template< size_t T = 5,
+	    BerContentTag::BerTagClass CLS = BerContentTag::BER_UNIVERSAL >
+  struct BerEmpty : public _BerPrimitive<T, CLS, 0, 0> {};
+
+  //! List of up to 10 fields
+  template< class A1, class A2 = meta::NullType, class A3 = meta::NullType,
+	    class A4 = meta::NullType, class A5 = meta::NullType,
+	    class A6 = meta::NullType, class A7 = meta::NullType,
+	    class A8 = meta::NullType, class A9 = meta::NullType,
+	    class A10 = meta::NullType >
+  struct BerFields {
+    typedef typename meta::MakeTypeList< A1, A2, A3, A4, A5, A6, A7,
+					 A8, A9, A10 >::RESULT RESULT;
+  };
+
+  /*! \class _BerList
+      \brief Size and formatting of a field list
+
+      L is a meta::TypeList of fields or a BerFields.
+  */
+  template< class L > struct _BerList;
+
+  template<> struct _BerList< meta::NullType > {
+    typedef meta::NullType List;
+    enum { SIZE = 0, SLOTS = 0 };
+    static inline void format(unsigned char *) {}
+  };
+
+  template< class H, class T > struct _BerList< meta::TypeList< H, T > > {
+    typedef meta::TypeList< H, T > List;
+    enum { SIZE = H::SIZE + _BerList< T >::SIZE };
+    enum { SLOTS = H::SLOTS + _BerList< T >::SLOTS };
+    static inline void format(unsigned char *p) {
+      H::format(p);
+      _BerList< T >::format(p + H::SIZE);
+    }
+  };
+
+  template< class A1, class A2, class A3, class A4, class A5,
+	    class A6, class A7, class A8, class A9, class A10 >
+  struct _BerList< BerFields< A1, A2, A3, A4, A5, A6, A7, A8, A9, A10 > > :
+    public _BerList< typename BerFields< A1, A2, A3, A4, A5,
+					 A6, A7, A8, A9, A10 >::RESULT > {};
+
+  /*! \class BerConstructed
+      \brief Constructed tag containing the fields L
+
+      L is a BerFields or a meta::TypeList of fields.
+  */
+  template< size_t T, BerContentTag::BerTagClass CLS, class L >
+  struct BerConstructed {
+    typedef BerContentTag::TagString<T, BerContentTag::BER_CONSTRUCTED, CLS> Tag;
+    typedef _BerList<L> Fields;
+    enum { CONSTRUCTED = 1 };
+    enum { SLOTS = Fields::SLOTS };
+    enum { HEAD = Tag::SIZE + BerLength<Fields::SIZE>::SIZE };
+    enum { SIZE = HEAD + Fields::SIZE };
+
+    //! Write headers and clear all slots
+    static inline void format(unsigned char *p) {
+      Tag::write(p);
+      BerLength<Fields::SIZE>::write(p + Tag::SIZE);
+      Fields::format(p + HEAD);
+    }
+  };
+
+  //! ASN.1 SEQUENCE containing the fields L
+  template< class L >
+  struct BerSequence : public BerConstructed<16, BerContentTag::BER_UNIVERSAL, L> {};
+
+  // slot lookup
+  template< class E, size_t I, bool C = (E::CONSTRUCTED != 0) > struct BerSlot;
+  template< class L, size_t I, bool H = (I < (size_t)L::HEAD::SLOTS) > struct _BerListSlot;
+
+  template< class E, size_t I > struct BerSlot<E, I, false> {
+    typedef E TYPE;
+    enum { OFFSET = E::HEAD };
+  };
+
+  template< class E, size_t I > struct BerSlot<E, I, true> {
+    typedef _BerListSlot<typename E::Fields::List, I> S;
+    typedef typename S::TYPE TYPE;
+    enum { OFFSET = E::HEAD + S::OFFSET };
+  };
+
+  template< class L, size_t I > struct _BerListSlot<L, I, true> {
+    typedef BerSlot<typename L::HEAD, I> S;
+    typedef typename S::TYPE TYPE;
+    enum { OFFSET = S::OFFSET };
+  };
+
+  template< class L, size_t I > struct _BerListSlot<L, I, false> {
+    typedef _BerListSlot<typename L::TAIL, I - L::HEAD::SLOTS> S;
+    typedef typename S::TYPE TYPE;
+    enum { OFFSET = L::HEAD::SIZE + S::OFFSET };
+  };
+
+  /*! \class BerMessage
+      \brief Preformatted buffer for a message of layout E
+
+      The CTOR writes all tags and lengths and clears the slots.
+      Afterwards set() only copies values into the slots. The
+      buffer can be written as is, or parsed by BerTree::replace().
+  */
+  template< class E > class BerMessage {
+  public:
+    enum { SIZE = E::SIZE };     //!< Size of the encoded message
+    enum { SLOTS = E::SLOTS };   //!< Number of slots
+
+    //! Offset and type of slot I
+    template< size_t I > struct Slot : public BerSlot<E, I> {};
+
+  protected:
+    unsigned char buf[SIZE];     //!< encoded message
+
+  public:
+    //! Create a message with cleared slots
+    BerMessage() { E::format(buf); }
+
+    //! Format external memory of at least SIZE octets
+    static inline void format(unsigned char *p) { E::format(p); }
+
+    //! Set the value of integer or real slot I
+    template< size_t I, class V > inline void set(const V& v) {
+      Slot<I>::TYPE::set(buf + Slot<I>::OFFSET, v);
+    }
+
+    //! Set the value of octet string slot I
+    template< size_t I > inline void set(const void *v, size_t l) {
+      Slot<I>::TYPE::set(buf + Slot<I>::OFFSET, v, l);
+    }
+
+    //! Get the encoded message
+    inline const unsigned char *data(void) const { return buf; }
+
+    //! Get the size of the encoded message
+    inline size_t size(void) const { return SIZE; }
+
+    //! Write message to a StreamDump
+    inline m_error_t write(StreamDump& s) const {
+      size_t l = SIZE;
+      return s.write(buf, &l);
+    }
+  };
+
+};
+
+#endif // _TLV_BERTEMPLATE_H_
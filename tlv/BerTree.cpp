@@ -17,6 +17,9 @@
 
 #include "BerTree.h"
 #include "BerTree.tag"
+#include <vector>
+#include <pthread.h>
+#include <unistd.h>
 
 #define DEBUG_MARK 1
 #define DEBUG_DUMP 2
@@ -114,6 +117,23 @@ BerContentTag::BerTagClass BerContentTag::Class(void) const {
   return static_cast<BerTagClass>((*c >> BER_CLASS_SHIFT) & 3);
 }
 
+/*! \return Tag number
+
+    Decodes the tag number from the first tag byte or the
+    subsequent base 128 digits for long tags. Numbers
+    exceeding the value range of size_t are truncated.
+*/
+size_t BerContentTag::Number(void) const {
+  const unsigned char *c = get_fix();
+  if(!c) mgrThrow(ERR_PARAM_NULL);
+  if((*c & 0x1f) != 0x1f) return *c & 0x1f;
+  size_t n = 0;
+  for(size_t i = 1; i < length; i++){
+    n = (n << 7) | (c[i] & 0x7f);
+  }
+  return n;
+}
+
 m_error_t BerContentTag::replace(const unsigned char * const d, const size_t & l){
   if(!d || !l) return ERR_PARAM_NULL;
     
@@ -184,7 +204,7 @@ m_error_t BerContentTag::replace(const size_t& number, const BerTagType& ty, con
     ERR_PARAM_RANG is returned.
 */
 m_error_t BerContentLength::replace(const unsigned char * const d, const size_t & l){
-  const size_t msb = 0xff << ((sizeof(size_t) - 1) * 8);
+  const size_t msb = (size_t)0xff << ((sizeof(size_t) - 1) * 8);
   if(!d || !l) return ERR_PARAM_NULL;
     
   unsigned char current = *d;    
@@ -234,7 +254,7 @@ m_error_t BerContentLength::value(const size_t& l){
   } else {	    
     int i=0;
     for(size_t q = l;q;q>>=1,i++); 
-    i += 6;     // this is +7 and -1 from the for loop
+    i += 7;     // round up to full octets
     i >>= 3;  // i /= 8
     allocate(i+1);
     unsigned char *d = get_var( err );
@@ -253,37 +273,89 @@ m_error_t BerContentLength::value(const size_t& l){
  *
  */
 
+// short form, or long form with 1 to 4 octets
+const unsigned char BerTag::lengthOctets[256] = {
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  0, 2, 3, 4, 5, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+/*! \param d Start of BER coded memory
+    \param l Length of BER coded memory
+    \param h Decoded header
+    \return Error code as defined in mgrError.h
+
+    This is the slow path of readHeader() for long tags,
+    long lengths and all errors. It follows the grammar of
+    BerContentTag::replace() and BerContentLength::replace()
+    without setting up the regions.
+*/
+m_error_t BerTag::readHeaderGeneric(const unsigned char * const d, const size_t& l,
+				    BerHeader& h){
+  const size_t msb = (size_t)0xff << ((sizeof(size_t) - 1) * 8);
+  if(!d || !l) return ERR_PARAM_NULL;
+
+  h.cls = static_cast<BerContentTag::BerTagClass>(d[0] >> BerContentTag::class_shift);
+  h.type = static_cast<BerContentTag::BerTagType>((d[0] >> BerContentTag::type_shift) & 1);
+  h.number = d[0] & 0x1f;
+  h.tagSize = 1;
+  h.lengthSize = 0;
+  h.length = 0;
+  if(h.number == 0x1f){
+    h.number = 0;
+    do {
+      if(h.tagSize >= l) return ERR_PARAM_RANG;
+      h.number = (h.number << 7) | (d[h.tagSize] & 0x7f);
+    } while(d[h.tagSize++] & 0x80);
+  }
+  if(h.tagSize == l) return ERR_CANCEL;
+
+  const unsigned char *s = d + h.tagSize;
+  h.lengthSize = 1;
+  if(!(*s & 0x80)){
+    h.length = *s;
+  } else {
+    const size_t n = *s & 0x7f;
+    // indefinite length is not supported
+    if(!n) return ERR_PARAM_RANG;
+    if(h.tagSize + 1 + n > l) return ERR_PARAM_LEN;
+    for(size_t i = 1; i <= n; i++){
+      if((i > 1) && (h.length & msb)) return ERR_PARAM_RANG;
+      h.length = (h.length << 8) | s[i];
+    }
+    h.lengthSize += n;
+  }
+  if(h.length > l - h.head()) return ERR_PARAM_RANG;
+
+  return ERR_NO_ERROR;
+}
+
 m_error_t BerTag::readBer(const unsigned char * const d, const size_t & l){
-  const unsigned char * s = d;
-  size_t remain = l;
-    
-  if(!s || !l) return ERR_PARAM_NULL;
-    
+  BerHeader h;
+
   clear();
 
-  xpdbg(MARK,"Start reading Tag from %.2x remain %u\n",(int)*s,(unsigned int)remain);    
-  m_error_t error = Tag.replace(s,remain);
-  if(error != ERR_NO_ERROR) return error;    
-  s += Tag.byte_size();
-  remain -= Tag.byte_size();
-
-  xpdbg(MARK,"Start reading Length from %.2x remain %u\n",(int)*s,(unsigned int)remain);
-  if(!remain) return ERR_CANCEL;
-  error = Length.replace(s,remain);
-  if(error != ERR_NO_ERROR){
-    Tag.free();
-    return error;
-  }    
-  s += Length.byte_size();
-  remain -= Length.byte_size();
-  if(Length.value() > remain){
-    Tag.free();
-    Length.free();
-    return ERR_PARAM_RANG;
-  }
-
-  xpdbg(MARK,"Start reading Value from %.2x remain %u\n",(int)*s,(unsigned int)remain);    
-  Value.replace(s,Length.value());
+  m_error_t error = readHeader(d,l,h);
+  if(error == ERR_CANCEL) Tag.refer(d,h.tagSize);
+  if(error != ERR_NO_ERROR) return error;
+
+  Tag.refer(d,h.tagSize);
+  Length.refer(d + h.tagSize,h.lengthSize,h.length);
+  xpdbg(MARK,"Start reading Value from %p remain %u\n",d + h.head(),(unsigned int)(l - h.head()));
+  Value.replace(d + h.head(),h.length);
 
 #if DEBUG_CHECK(DUMP)
   dump(DEBUG_LOG,"### ");
@@ -346,6 +418,25 @@ m_error_t BerTag::write(StreamDump& s) const {
   return err;
 }
 
+/*! \param v Array of iovec with room for 3 more entries
+    \param n Number of entries used in v
+    \retval n Number of entries used including this tag
+    \return Error code as defined in mgrError.h
+
+    The entries refer to the data of this BerTag, which must
+    not be modified, until v has been written.
+*/
+m_error_t BerTag::gather(struct iovec *v, int& n) const {
+  m_error_t err = Tag.gather(v,n);
+  if(err != ERR_NO_ERROR) return err;
+  err = Length.gather(v,n);
+  if(err != ERR_NO_ERROR) return err;
+  if(Length.value() && Value.readPtr())
+    err = Value.gather(v,n);
+
+  return err;
+}
+
 ssize_t BerTag::dump(FILE *f, const char *prefix) const{
   wtBuffer<char> out;  
 
@@ -449,10 +540,11 @@ m_error_t BerTree::parseContent(BerTag *c) const {
     } else {
       insertNext(p,t);
     }
+    // parseContent() may shorten a non-minimal length field
+    l += t->size();
     err = parseContent(t);
     if(err != ERR_NO_ERROR) break;
     p = t;
-    l += p->size();
   }
   if(err != ERR_NO_ERROR){
     t = static_cast<BerTag *>(c->getChild());
@@ -490,7 +582,12 @@ m_error_t BerTree::replace(const unsigned char *data, size_t l, bool copy){
     initTree(t);
     read = t->size();
     error = parseContent(t);
-    if(error != ERR_NO_ERROR) break;
+    if(error != ERR_NO_ERROR){
+      // t is deleted below, do not keep it as root
+      XTree<BerTag>::clear();
+      break;
+    }
+    t = NULL;
     while(read < l){
       t = new BerTag;
       if(!t){
@@ -504,6 +601,7 @@ m_error_t BerTree::replace(const unsigned char *data, size_t l, bool copy){
 	error = ERR_NO_ERROR;
 	break;
       }
+      read += t->size();
       error = parseContent(t);
       if(error != ERR_NO_ERROR){
 	// oops, this node is rotten
@@ -511,7 +609,6 @@ m_error_t BerTree::replace(const unsigned char *data, size_t l, bool copy){
 	break;
       }
       appendNext(t,true);
-      read += t->size();
       t = NULL;
     }
   } while(0);
@@ -521,6 +618,182 @@ m_error_t BerTree::replace(const unsigned char *data, size_t l, bool copy){
   return error;
 }
 
+/*
+ * Parallel parser
+ *
+ */
+
+//! Work order for one thread of BerTree::replaceParallel()
+struct BerParseJob {
+  const BerTree *tree;           //!< Tree providing parseContent()
+  const unsigned char *base;     //!< Start of input
+  const size_t *offset;          //!< Record offsets, offset[last] is the end
+  size_t first;                  //!< First record to parse
+  size_t last;                   //!< Record behind the last one to parse
+  BerTag *head;                  //!< First node of the parsed sequence
+  BerTag *tail;                  //!< Last node of the parsed sequence
+  m_error_t error;               //!< Result
+};
+
+/*! \param arg Pointer to a BerParseJob
+    \return NULL
+
+    Parses the records of the job into a sequence of nodes, which
+    is not yet linked to the tree. Parsing stops at the first
+    erroneous record.
+*/
+void *BerTree::parseWorker(void *arg){
+  BerParseJob *job = static_cast<BerParseJob *>(arg);
+  BerTag *t;
+
+  job->head = job->tail = NULL;
+  job->error = ERR_NO_ERROR;
+  for(size_t i = job->first; i < job->last; i++){
+    t = new BerTag;
+    if(!t){
+      job->error = ERR_MEM_AVAIL;
+      break;
+    }
+    job->error = t->readBer(job->base + job->offset[i],
+			    job->offset[i+1] - job->offset[i]);
+    if(job->error == ERR_NO_ERROR)
+      job->error = job->tree->parseContent(t);
+    if(job->error != ERR_NO_ERROR){
+      delete t;
+      break;
+    }
+    if(job->tail){
+      job->tree->insertNext(job->tail,t);
+    } else {
+      job->head = t;
+    }
+    job->tail = t;
+  }
+
+  return NULL;
+}
+
+/*! \param data Start of BER coded memory
+    \param l Length of data
+    \param threads Number of threads to use, 0 selects the number of online CPUs
+    \param copy If true the data are copied to the input buffer of the tree
+    \return Error code as defined in mgrError.h
+
+    Produces the same tree as replace(), but decodes the top-level
+    records concurrently. A first pass only reads the tag and length
+    headers of the top-level sequence in order to find the record
+    boundaries. The records are then split into contiguous ranges of
+    about equal byte size, each of which is parsed into a node sequence
+    by a thread of its own. Finally the sequences are linked in input
+    order.
+
+    Trailing data, which cannot be read as BER header, is attached to
+    garbage as with replace(). If parsing a record fails, the records
+    before it are kept in the tree and the error is returned.
+
+    Small inputs are parsed in the calling thread only.
+*/
+m_error_t BerTree::replaceParallel(const unsigned char *data, size_t l,
+				   unsigned int threads, bool copy){
+  enum {
+    MIN_RECORDS = 16,     //!< Minimum number of records per thread
+    MIN_BYTES = 65536     //!< Minimum number of bytes per thread
+  };
+  m_error_t error;
+  std::vector<size_t> offset;
+  size_t read = 0;
+
+  remove(root(), ownNodes);
+  XTree<BerTag>::clear();
+  ownNodes = true;
+  garbage = NULL;
+  error = input.replace(data,l);
+  if(error != ERR_NO_ERROR) return error;
+  if(copy){
+    error = input.branch();
+    if(error != ERR_NO_ERROR) return error;
+  }
+  const unsigned char *in = input.readPtr();
+
+  // header pass: find the record boundaries
+  BerHeader probe;
+  while(read < l){
+    error = BerTag::readHeader(in+read,l-read,probe);
+    if(error != ERR_NO_ERROR){
+      if(offset.empty()) return error;
+      garbage = in+read;
+      break;
+    }
+    offset.push_back(read);
+    read += probe.size();
+  }
+  offset.push_back(read);
+  size_t records = offset.size() - 1;
+  error = ERR_NO_ERROR;
+
+  if(!threads){
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = (cpus > 0) ? static_cast<unsigned int>(cpus) : 1;
+  }
+  if(threads > records / MIN_RECORDS) threads = records / MIN_RECORDS;
+  if(threads > read / MIN_BYTES) threads = read / MIN_BYTES;
+  if(!threads) threads = 1;
+
+  // split by bytes into contiguous ranges
+  std::vector<BerParseJob> job(threads);
+  size_t first = 0;
+  for(unsigned int i = 0; i < threads; i++){
+    size_t end = (read / threads) * (i+1);
+    size_t last = first;
+    if(i + 1 == threads){
+      last = records;
+    } else {
+      while((last < records) && (offset[last] < end)) last++;
+    }
+    job[i].tree = this;
+    job[i].base = in;
+    job[i].offset = &offset[0];
+    job[i].first = first;
+    job[i].last = last;
+    job[i].head = job[i].tail = NULL;
+    job[i].error = ERR_NO_ERROR;
+    first = last;
+  }
+
+  std::vector<pthread_t> tid(threads);
+  std::vector<bool> started(threads,false);
+  for(unsigned int i = 1; i < threads; i++){
+    started[i] = !pthread_create(&tid[i],NULL,parseWorker,&job[i]);
+    // run it here, if no thread is available
+    if(!started[i]) parseWorker(&job[i]);
+  }
+  parseWorker(&job[0]);
+  for(unsigned int i = 1; i < threads; i++){
+    if(started[i]) pthread_join(tid[i],NULL);
+  }
+
+  // link in order up to the first failing record
+  BerTag *tail = NULL;
+  for(unsigned int i = 0; i < threads; i++){
+    if(error != ERR_NO_ERROR){
+      remove(job[i].head,true);
+      continue;
+    }
+    if(job[i].head){
+      if(tail){
+	appendNext(job[i].head,true);
+      } else {
+	initTree(job[i].head);
+      }
+      tail = job[i].tail;
+    }
+    error = job[i].error;
+  }
+  if(tail) path.back() = tail;
+
+  return error;
+}
+
 m_error_t BerTree::write(StreamDump& s, bool calc) {
   BerTag *c = current();
   m_error_t err = ERR_NO_ERROR;
@@ -531,11 +804,25 @@ m_error_t BerTree::write(StreamDump& s, bool calc) {
     err = c->recalcSize(res,true);
     if(err != ERR_NO_ERROR) return err;
   }
+  // Tag, Length and Value of many tags go into a single writev()
+  enum { BATCH = 1024 };
+  struct iovec v[BATCH];
+  int n = 0;
   while(c){
-    err = c->write(s);
-    if(err != ERR_NO_ERROR) return err;
+    err = c->gather(v,n);
+    if(err != ERR_NO_ERROR){
+      // emit the data preceding the failure as write() did
+      if(n) s.writev(v,n);
+      return err;
+    }
+    if(n > BATCH - 3){
+      err = s.writev(v,n);
+      if(err != ERR_NO_ERROR) return err;
+      n = 0;
+    }
     c = iterate(&lvl);
   }
+  if(n) err = s.writev(v,n);
 
   return err;
 }
@@ -602,6 +889,9 @@ BerTag *BerTree::find(const unsigned char *data, const size_t& s, m_error_t *err
 #include <stdio.h>
 #include <HexDump.h>
 #include <wtBufferDump.h>
+#include <stdlib.h>
+#include <string.h>
+#include "BerTemplate.h"
 
 int main(int argc, char *argv[]){
   m_error_t res;
@@ -730,6 +1020,34 @@ int main(int argc, char *argv[]){
     puts("+++ BerTree::write() finished OK!");
   }
   
+  printf("Test %d: Write through writev()\n",++tests);
+  {
+    int pfd[2];
+    res = (::pipe(pfd))? ERR_FILE_OPEN : ERR_NO_ERROR;
+    if(res == ERR_NO_ERROR){
+      // the tree is small enough to fit into the pipe buffer
+      FdDump fStream(pfd[1],true);
+      ber.root();
+      res = ber.write(fStream);
+      fStream.close();
+    }
+    if(res == ERR_NO_ERROR){
+      const size_t bl = bStream.get().byte_size();
+      char *p = (char *)malloc(bl + 1);
+      ssize_t r = ::read(pfd[0],p,bl + 1);
+      if((r != (ssize_t)bl) || memcmp(p,bStream.get().readPtr(),bl))
+	res = ERR_INT_DATA;
+      free(p);
+      ::close(pfd[0]);
+    }
+  }
+  if(ERR_NO_ERROR != res){
+    errors++;
+    printf("*** Error: write() failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ BerTree::write() finished OK!");
+  }
+
   // here we go, bStream.get() contains the serialised BER data
   printf("Test %d: Read from Buffer\n",++tests);  
   res = ber.replace((const unsigned char *)(bStream.get().readPtr()), 
@@ -842,6 +1160,180 @@ int main(int argc, char *argv[]){
   BerTag NTag(ntmp,sizeof(ntmp));
   NTag.dump(stdout,"???");
 
+  printf("Test %d: Parallel parsing of a long record sequence\n",++tests);
+  do {
+    // APPLICATION 4 { INTEGER n, OCTET STRING "record" }, garbage 0x1f
+    wtBuffer<unsigned char> pbuf;
+    for(unsigned int i = 0; i < 20000; i++){
+      unsigned char rec[17] = { 0x64, 0x0f, 0x02, 0x04, 0, 0, 0, 0,
+				0x04, 0x07, 'r', 'e', 'c', 'o', 'r', 'd', 0 };
+      rec[4] = (i >> 24) & 0xff;
+      rec[5] = (i >> 16) & 0xff;
+      rec[6] = (i >> 8) & 0xff;
+      rec[7] = i & 0xff;
+      rec[16] = '0' + (i % 10);
+      res = pbuf.append(rec,sizeof(rec));
+      if(res != ERR_NO_ERROR) break;
+    }
+    if(res != ERR_NO_ERROR) break;
+    size_t plen = pbuf.byte_size();
+    res = pbuf.append((const unsigned char *)"\x1f",1);
+    if(res != ERR_NO_ERROR) break;
+
+    BerTree seq, par;
+    res = seq.replace(pbuf.readPtr(),pbuf.byte_size());
+    if(res != ERR_NO_ERROR) break;
+    res = par.replaceParallel(pbuf.readPtr(),pbuf.byte_size(),4);
+    if(res != ERR_NO_ERROR) break;
+    if(!par.trailer() || (*par.trailer() != 0x1f)){
+      puts("*** Error: garbage not detected");
+      res = ERR_PARS_STX;
+      break;
+    }
+    if(par.fullSize() != plen){
+      printf("*** Error: parsed %u bytes instead of %u\n",
+	     (unsigned int)par.fullSize(),(unsigned int)plen);
+      res = ERR_PARAM_LEN;
+      break;
+    }
+
+    BufferDump sOut(plen), pOut(plen);
+    seq.root();
+    res = seq.write(sOut);
+    if(res != ERR_NO_ERROR) break;
+    par.root();
+    res = par.write(pOut);
+    if(res != ERR_NO_ERROR) break;
+    if((sOut.get().byte_size() != pOut.get().byte_size()) ||
+       memcmp(sOut.get().readPtr(),pOut.get().readPtr(),plen)){
+      puts("*** Error: parallel and sequential trees differ");
+      res = ERR_PARS_STX;
+      break;
+    }
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: replaceParallel() failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ BerTree::replaceParallel() finished OK!");
+  }
+
+  printf("Test %d: BerMessage -- compile time message template\n",++tests);
+  do {
+    typedef BerConstructed< 0x20, BerContentTag::BER_APPLICATION,
+      BerFields< BerIntSlot<4>, BerRealSlot<0>, BerOctetSlot<8>,
+      BerSequence< meta::MakeTypeList< BerIntSlot<2>, BerEmpty<> >::RESULT > > > Record;
+    const unsigned char expect[] = {
+      0x7f, 0x20, 0x22,
+      0x02, 0x04, 0x00, 0x00, 0x00, 0x2a,
+      0x80, 0x08, 0xc0, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x04, 0x08, 'S', 'E', 'N', 'S', 'O', 'R', 0x00, 0x00,
+      0x30, 0x06, 0x02, 0x02, 0xff, 0xfe, 0x05, 0x00
+    };
+
+    BerMessage<Record> msg;
+    msg.set<0>(42);
+    msg.set<1>(-2.5);
+    msg.set<2>("SENSOR",6);
+    msg.set<3>(-2);
+    if((msg.size() != sizeof(expect)) || (BerMessage<Record>::SLOTS != 4) ||
+       memcmp(msg.data(),expect,sizeof(expect))){
+      size_t tlen = 0;
+      xdump.textf(&tlen, "??? ");
+      tlen = msg.size();
+      xdump.write(msg.data(),&tlen);
+      xdump.lineFeed();
+      res = ERR_INT_DATA;
+      break;
+    }
+    BerTree mber;
+    res = mber.replace(msg.data(),msg.size());
+    if(res != ERR_NO_ERROR) break;
+    if((mber.fullSize() != msg.size()) || mber.trailer()){
+      res = ERR_PARAM_LEN;
+      break;
+    }
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: BerMessage failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ BerMessage finished OK!");
+  }
+
+  printf("Test %d: readHeader() against the region parsers\n",++tests);
+  do {
+    unsigned char hbuf[300];
+    memset(hbuf,0,sizeof(hbuf));
+    hbuf[2] = 0x81;
+    hbuf[3] = 0x02;
+    hbuf[4] = 0x01;
+    for(unsigned int tb = 0; (tb < 0x100) && (res == ERR_NO_ERROR); tb++){
+      for(unsigned int lb = 0; lb < 0x100; lb++){
+	for(size_t hl = 1; hl < sizeof(hbuf); hl += 37){
+	  BerHeader fast;
+	  hbuf[0] = static_cast<unsigned char>(tb);
+	  hbuf[1] = static_cast<unsigned char>(lb);
+	  m_error_t ef = BerTag::readHeader(hbuf,hl,fast);
+	  // reference are the region parsers
+	  BerContentTag rtag;
+	  BerContentLength rlen;
+	  m_error_t es = rtag.replace(hbuf,hl);
+	  if((es == ERR_NO_ERROR) && (rtag.byte_size() == hl)) es = ERR_CANCEL;
+	  if(es == ERR_NO_ERROR) es = rlen.replace(hbuf + rtag.byte_size(),hl - rtag.byte_size());
+	  if((es == ERR_NO_ERROR) && (rlen.value() > hl - rtag.byte_size() - rlen.byte_size()))
+	    es = ERR_PARAM_RANG;
+	  if((ef != es) ||
+	     ((ef == ERR_NO_ERROR) &&
+	      ((fast.number != rtag.Number()) || (fast.cls != rtag.Class()) ||
+	       (fast.type != rtag.Type()) || (fast.tagSize != rtag.byte_size()) ||
+	       (fast.lengthSize != rlen.byte_size()) || (fast.length != rlen.value())))){
+	    printf("*** Error: %.2x %.2x (%u) differs\n",tb,lb,(unsigned int)hl);
+	    res = ERR_INT_DATA;
+	    break;
+	  }
+	}
+	if(res != ERR_NO_ERROR) break;
+      }
+    }
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: readHeader() failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ readHeader() finished OK!");
+  }
+
+  printf("Test %d: Non-minimal length fields of constructed tags\n",++tests);
+  do {
+    // [APPLICATION 1] { [APPLICATION 2] {} } with long form lengths, INTEGER 1, garbage
+    const unsigned char nml[] = { 0x61, 0x81, 0x03, 0x62, 0x81, 0x00,
+				  0x61, 0x81, 0x03, 0x62, 0x81, 0x00,
+				  0x02, 0x01, 0x01, 0x1f };
+    BerTree nber;
+    res = nber.replace(nml,sizeof(nml),false);
+    if(res != ERR_NO_ERROR) break;
+    if(nber.trailer() != nml + sizeof(nml) - 1){
+      puts("*** Error: trailer at wrong position");
+      res = ERR_PARAM_LEN;
+      break;
+    }
+    // lengths are normalized: 2 * (2 + 2) + 3
+    res = nber.sanitize();
+    if(res != ERR_NO_ERROR) break;
+    if(nber.fullSize() != 11){
+      printf("*** Error: normalized size %u\n",(unsigned int)nber.fullSize());
+      res = ERR_PARAM_LEN;
+      break;
+    }
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: non-minimal lengths failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ Non-minimal lengths finished OK!");
+  }
+
   printf("\n%d tests completed with %d errors.\n",tests,errors);
   printf("Used version: %s\n",temp.VersionTag());
 
@@ -133,6 +133,25 @@ public:
     return s.write(get_fix(),&tl);
   }
 
+  //! Append region contents to an iovec array
+  /*! \param v Array of iovec for StreamDump::writev()
+      \param n Number of entries used in v
+      \retval n Incremented, if the region is not empty
+      \return Error code as defined in mgrError.h
+
+      v must have room for another entry.
+
+      \note Dummy lengths will return ERR_PARAM_NULL.
+  */
+  inline m_error_t gather(struct iovec *v, int& n) const {
+    if(!length) return ERR_NO_ERROR;
+    if(!get_fix()) return ERR_PARAM_NULL;
+    v[n].iov_base = const_cast<unsigned char *>(get_fix());
+    v[n].iov_len = length;
+    n++;
+    return ERR_NO_ERROR;
+  }
+
   //! Equality operator
   /*! \param r Region to compare
       \return true if region contents are equal
@@ -302,6 +321,17 @@ public:
   //! Return the semantic context of the tag (class)
   BerTagClass Class(void) const;    
 
+  //! Return the tag number without class and type qualifiers
+  size_t Number(void) const;
+
+  //! Refer to a tag field already decoded by BerTag::readHeader()
+  /*! \param d Start of tag in memory
+      \param n Octets of the tag field
+  */
+  inline void refer(const unsigned char * const d, const size_t& n) {
+    wtBuffer<unsigned char>::replace(d,n);
+  }
+
   //! prepend() blocked
   void prepend(void){}
   //! insert() blocked
@@ -412,6 +442,16 @@ public:
       This is just a wrapper for value( const size_t& l).
   */      
   inline m_error_t replace(const size_t& l) { return value(l); }
+
+  //! Refer to a length field already decoded by BerTag::readHeader()
+  /*! \param d Start of length field in memory
+      \param n Octets of the length field
+      \param v Decoded value of the length field
+  */
+  inline void refer(const unsigned char * const d, const size_t& n, const size_t& v) {
+    wtBuffer<unsigned char>::replace(d,n);
+    val = v;
+  }
   
   //! prepend() blocked
   void prepend(void){}
@@ -421,6 +461,26 @@ public:
   void dummyLength(void){}
 };
 
+  /*! \class BerHeader
+      \brief Decoded tag and length field of a TLV structure
+
+      This is the result of BerTag::readHeader(), which decodes
+      the header without setting up any BerContentRegion.
+  */
+struct BerHeader {
+  size_t number;                       //!< Tag number
+  BerContentTag::BerTagClass cls;      //!< Tag class
+  BerContentTag::BerTagType type;      //!< Tag type
+  size_t tagSize;                      //!< Octets of the tag field
+  size_t lengthSize;                   //!< Octets of the length field
+  size_t length;                       //!< Length of the contents
+
+  //! Octets of tag and length field
+  inline size_t head(void) const { return tagSize + lengthSize; }
+  //! Octets of the entire TLV structure
+  inline size_t size(void) const { return tagSize + lengthSize + length; }
+};
+
   /*! \class BerTag
       \brief An entity of BER coded data as node of HTree
 
@@ -433,6 +493,9 @@ protected:
   class BerContentTag Tag;         //!< The Tag
   class BerContentLength Length;   //!< The Length
   class BerContentRegion Value;    //!< The Value
+
+  //! Octets of a length field by its first octet, 0 for the generic parser
+  static const unsigned char lengthOctets[256];
     
 public:    
   //! CTOR for empty BER structure
@@ -548,6 +611,47 @@ public:
   //! Parse BER coded data from memory
   m_error_t readBer(const unsigned char * const d, const size_t & l);
 
+  //! Decode tag and length field from memory
+  /*! \param d Start of BER coded memory
+      \param l Length of BER coded memory
+      \param h Decoded header
+      \return Error code as defined in mgrError.h
+
+      Decodes the header of the TLV structure at d and checks
+      that its contents fit into l. The error codes are the same
+      as for readBer(). On ERR_CANCEL only the tag related
+      fields of h are valid.
+
+      Single byte tags with short or up to 4 octet long lengths
+      are decoded inline. All other headers use the generic
+      parsers of BerContentTag and BerContentLength.
+  */
+  static inline m_error_t readHeader(const unsigned char * const d, const size_t& l,
+				     BerHeader& h) {
+    if(!d || (l < 2) || ((d[0] & 0x1f) == 0x1f) || !lengthOctets[d[1]])
+      return readHeaderGeneric(d,l,h);
+    const unsigned char t = d[0];
+    h.number = t & 0x1f;
+    h.cls = static_cast<BerContentTag::BerTagClass>(t >> BerContentTag::class_shift);
+    h.type = static_cast<BerContentTag::BerTagType>((t >> BerContentTag::type_shift) & 1);
+    h.tagSize = 1;
+    h.lengthSize = lengthOctets[d[1]];
+    if(h.lengthSize == 1){
+      h.length = d[1];
+    } else {
+      if(1 + h.lengthSize > l) return ERR_PARAM_LEN;
+      size_t v = 0;
+      for(size_t i = 2; i <= h.lengthSize; i++) v = (v << 8) | d[i];
+      h.length = v;
+    }
+    if(h.length > l - h.head()) return ERR_PARAM_RANG;
+    return ERR_NO_ERROR;
+  }
+
+  //! Decode any tag and length field from memory
+  static m_error_t readHeaderGeneric(const unsigned char * const d, const size_t& l,
+				     BerHeader& h);
+
   //! Total size
   /*! \return Full length of TLV structure in octets if dumped */
   inline size_t size(void) const {
@@ -691,6 +795,9 @@ public:
   //! Write sub-tree to StreamDump
   m_error_t write(StreamDump& s) const;
 
+  //! Append Tag, Length and Value to an iovec array
+  m_error_t gather(struct iovec *v, int& n) const;
+
   //! Discard node
   void clear(void);
 
@@ -730,6 +837,9 @@ protected:
   const unsigned char *garbage;          //!< pointer to unparsed trailing data
   bool ownNodes;                         //!< flag to indicate whether the nodes can be deleted by the Tree, i.e. are owned
 
+  //! Thread function of replaceParallel()
+  static void *parseWorker(void *job);
+
 public:
   //! Standard CTOR for empty tree and buffer
   BerTree() : XTree<class BerTag>(), garbage( NULL ), ownNodes( false ) {}
@@ -808,6 +918,10 @@ public:
   //! BER memory parser
   m_error_t replace(const unsigned char *data, size_t l, bool copy = true);
 
+  //! BER memory parser decoding top-level records concurrently
+  m_error_t replaceParallel(const unsigned char *data, size_t l,
+			    unsigned int threads = 0, bool copy = true);
+
   //! BER parser for contents of (nested) tags
   m_error_t parseContent(BerTag *c) const;
 
@@ -0,0 +1,337 @@
+/*
+ *
+ * Universal Output Stream - File output by a background thread
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *  AsyncFileDump - StreamDump writing a file in the background
+ *
+ * This defines the values:
+ *
+ */
+
+#include "AsyncFileDump.h"
+#include "AsyncFileDump.tag"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace mgr;
+
+/*! \param name File to create or truncate
+    \param o Combination of Options
+    \param n Number of buffers, at least 2
+    \param s Octets per buffer, rounded up to ALIGN
+
+    If the file cannot be created, valid() returns false.
+*/
+AsyncFileDump::AsyncFileDump(const char *name, unsigned int o, size_t n, size_t s){
+  int fl = O_WRONLY | O_CREAT | O_TRUNC;
+  int f = (name)? ::open(name, fl | ((o & DIRECT)? O_DIRECT : 0), 0666) : -1;
+  // the file system does not support O_DIRECT
+  if(name && (f < 0) && (errno == EINVAL) && (o & DIRECT)){
+    f = ::open(name, fl, 0666);
+    o &= ~DIRECT;
+  }
+  init(f, true, o, n, s);
+}
+
+/*! \param f Open file descriptor
+    \param o Combination of Options
+    \param n Number of buffers, at least 2
+    \param s Octets per buffer, rounded up to ALIGN
+
+    DIRECT is set on f by fcntl() and only honoured, if f is
+    seekable and positioned at a multiple of ALIGN.
+*/
+AsyncFileDump::AsyncFileDump(int f, unsigned int o, size_t n, size_t s){
+  init(f, false, o, n, s);
+}
+
+AsyncFileDump::~AsyncFileDump(){
+  if(fd >= 0) close();
+  for(size_t i = 0; i < bufs.size(); i++) ::free(bufs[i]);
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&lock);
+}
+
+void AsyncFileDump::init(int f, bool own, unsigned int o, size_t n, size_t s){
+  pthread_mutex_init(&lock,NULL);
+  pthread_cond_init(&cond,NULL);
+  fd = f;
+  ownFd = own;
+  opts = o;
+  direct = false;
+  failed = ERR_NO_ERROR;
+  size = (((s)? s : (size_t)DEFAULT_SIZE) + ALIGN - 1) & ~((size_t)ALIGN - 1);
+  head = queued = cur = used = 0;
+  fillAt = 0;
+  background = stop = false;
+  seekable = false;
+  if(fd < 0) return;
+
+  fillAt = ::lseek(fd, 0, SEEK_CUR);
+  // pwrite() ignores the offset for O_APPEND
+  int fl = ::fcntl(fd, F_GETFL);
+  seekable = (fillAt >= 0) && (fl >= 0) && !(fl & O_APPEND);
+  if(!seekable) fillAt = 0;
+  if(!seekable || (fillAt % ALIGN)) opts &= ~DIRECT;
+  if(opts & DIRECT)
+    direct = (fl & O_DIRECT) || !::fcntl(fd, F_SETFL, fl | O_DIRECT);
+  if(!direct) opts &= ~DIRECT;
+  if(opts & SEQUENTIAL) ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  if(n < 2) n = 2;
+  bufs.resize(n, NULL);
+  lens.resize(n, 0);
+  offs.resize(n, 0);
+  for(size_t i = 0; i < n; i++){
+    void *p;
+    if(::posix_memalign(&p, ALIGN, size)){
+      failed = ERR_MEM_AVAIL;
+      if(ownFd) ::close(fd);
+      fd = -1;
+      return;
+    }
+    bufs[i] = static_cast<unsigned char *>(p);
+  }
+  // without a thread the dump stays synchronous
+  background = !pthread_create(&thread, NULL, worker, this);
+}
+
+void *AsyncFileDump::worker(void *arg){
+  static_cast<AsyncFileDump *>(arg)->run();
+  return NULL;
+}
+
+void AsyncFileDump::run(void){
+  pthread_mutex_lock(&lock);
+  for(;;){
+    while(!queued && !stop) pthread_cond_wait(&cond,&lock);
+    if(!queued) break;
+    const size_t b = head;
+    // bufs[b] is not touched by the producer, until it is dequeued
+    pthread_mutex_unlock(&lock);
+    m_error_t res = writeOut(bufs[b], lens[b], offs[b]);
+    pthread_mutex_lock(&lock);
+    if((res != ERR_NO_ERROR) && (failed == ERR_NO_ERROR)) failed = res;
+    head = (head + 1) % bufs.size();
+    queued--;
+    pthread_cond_broadcast(&cond);
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+// write l octets at file offset at, padded for O_DIRECT
+m_error_t AsyncFileDump::writeOut(const unsigned char *d, size_t l, off_t at){
+  const off_t end = at + (off_t)l;
+  size_t n = l, pad = 0;
+  if(direct){
+    n = (l + ALIGN - 1) & ~((size_t)ALIGN - 1);
+    pad = n - l;
+  }
+  while(n){
+    ssize_t w = (seekable)? ::pwrite(fd, d, n, at) : ::write(fd, d, n);
+    if(w < 0){
+      if(errno == EINTR) continue;
+      if((errno == EINVAL) && direct){
+	// O_DIRECT is not supported after all
+	int fl = ::fcntl(fd, F_GETFL);
+	if((fl < 0) || ::fcntl(fd, F_SETFL, fl & ~O_DIRECT)) return ERR_FILE_WRITE;
+	direct = false;
+	n = (n > pad)? n - pad : 0;
+	pad = 0;
+	continue;
+      }
+      return ERR_FILE_WRITE;
+    }
+    d += w;
+    n -= w;
+    at += w;
+  }
+  if(pad && ::ftruncate(fd, end)) return ERR_FILE_WRITE;
+  // dirty pages are dropped, when written back
+  if(opts & DONTNEED) ::posix_fadvise(fd, end - (off_t)l, l, POSIX_FADV_DONTNEED);
+  return ERR_NO_ERROR;
+}
+
+// pass the fill buffer on for writing
+m_error_t AsyncFileDump::handoff(void){
+  if(!used) return failed;
+  // O_DIRECT rewrites the last partial block with the next buffer
+  const size_t keep = (opts & DIRECT)? used % ALIGN : 0;
+  if(keep) memset(bufs[cur] + used, 0, ALIGN - keep);
+  const size_t prev = cur;
+  if(!background){
+    m_error_t res = writeOut(bufs[cur], used, fillAt);
+    if((res != ERR_NO_ERROR) && (failed == ERR_NO_ERROR)) failed = res;
+  } else {
+    const size_t n = bufs.size();
+    pthread_mutex_lock(&lock);
+    lens[cur] = used;
+    offs[cur] = fillAt;
+    queued++;
+    pthread_cond_broadcast(&cond);
+    // only block, if all buffers are in flight
+    while(queued == n) pthread_cond_wait(&cond,&lock);
+    cur = (head + queued) % n;
+    pthread_mutex_unlock(&lock);
+  }
+  // the writer only reads bufs[prev]
+  if(keep) memmove(bufs[cur], bufs[prev] + used - keep, keep);
+  fillAt += used - keep;
+  used = keep;
+  return failed;
+}
+
+/*! \param data Start of data region
+    \param s Length of data in region
+    \retval s Length of data actually copied
+    \return Error code as defined in mgrError.h
+*/
+m_error_t AsyncFileDump::write(const void *data, size_t *s){
+  if((fd < 0) || !data || !s) return ERR_PARAM_NULL;
+  const unsigned char *p = static_cast<const unsigned char *>(data);
+  size_t l = *s;
+  while(l){
+    size_t c = size - used;
+    if(c > l) c = l;
+    memcpy(bufs[cur] + used, p, c);
+    used += c;
+    p += c;
+    l -= c;
+    if(used == size){
+      m_error_t res = handoff();
+      if(res != ERR_NO_ERROR){
+	*s -= l;
+	return res;
+      }
+    }
+  }
+  return failed;
+}
+
+m_error_t AsyncFileDump::flush(void){
+  if(fd < 0) return ERR_PARAM_NULL;
+  handoff();
+  if(!background) return failed;
+  pthread_mutex_lock(&lock);
+  while(queued) pthread_cond_wait(&cond,&lock);
+  m_error_t res = failed;
+  pthread_mutex_unlock(&lock);
+  return res;
+}
+
+m_error_t AsyncFileDump::close(void){
+  if(fd < 0) return ERR_PARAM_NULL;
+  m_error_t res = flush();
+  if(background){
+    pthread_mutex_lock(&lock);
+    stop = true;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&lock);
+    pthread_join(thread,NULL);
+    background = false;
+  }
+  if(ownFd && ::close(fd) && (res == ERR_NO_ERROR)) res = ERR_FILE_CLOSE;
+  fd = -1;
+  return res;
+}
+
+const char * AsyncFileDump::VersionTag(void) const{
+  return _VERSION_;
+}
+
+
+/*
+ * The testsuite
+ *
+ ********************************************
+ *
+ */
+
+#ifdef TEST
+
+#include <stdio.h>
+
+// write n octets of pattern in odd pieces with a flush in between
+static m_error_t writePattern(StreamDump& d, const unsigned char *pat, size_t n){
+  size_t at = 0, k = 0;
+  m_error_t res = ERR_NO_ERROR;
+  while((at < n) && (res == ERR_NO_ERROR)){
+    size_t s = 1 + (k++ * 7919) % 30011;
+    if(s > n - at) s = n - at;
+    res = d.write(pat + at, &s);
+    at += s;
+    if((k == 17) && (res == ERR_NO_ERROR)) res = d.flush();
+  }
+  return res;
+}
+
+static m_error_t checkFile(const char *name, const unsigned char *pat, size_t n){
+  FILE *f = fopen(name,"rb");
+  if(!f) return ERR_FILE_OPEN;
+  unsigned char *b = (unsigned char *)malloc(n + 1);
+  size_t r = fread(b,1,n + 1,f);
+  fclose(f);
+  m_error_t res = ((r != n) || memcmp(b,pat,n))? ERR_INT_DATA : ERR_NO_ERROR;
+  free(b);
+  return res;
+}
+
+int main(int argc, char *argv[]){
+  m_error_t res;
+  size_t tests, errors;
+
+  tests = errors = 0;
+
+  const size_t n = 1000003;
+  unsigned char *pat = (unsigned char *)malloc(n);
+  for(size_t i = 0; i < n; i++) pat[i] = (unsigned char)(i * 131 + (i >> 9));
+  char name[64];
+  snprintf(name,sizeof(name),"/tmp/test-AsyncFileDump-%d",(int)getpid());
+
+  const unsigned int opts[2] = { 0,
+    AsyncFileDump::DIRECT | AsyncFileDump::SEQUENTIAL | AsyncFileDump::DONTNEED };
+  for(int k = 0; k < 2; k++){
+    printf("Test %d: write() with options %u\n",++tests,opts[k]);
+    AsyncFileDump d(name,opts[k],3,65536);
+    res = (d.valid())? writePattern(d,pat,n) : ERR_FILE_OPEN;
+    if(res == ERR_NO_ERROR) res = d.close();
+    if(res == ERR_NO_ERROR) res = checkFile(name,pat,n);
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: AsyncFileDump::write() failed 0x%.4x\n",(int)res);
+    } else {
+      puts("+++ AsyncFileDump::write() finished OK!");
+    }
+  }
+
+  printf("Test %d: write() after close()\n",++tests);
+  {
+    AsyncFileDump d(name);
+    size_t s = 1;
+    d.close();
+    if(d.valid() || (d.write(pat,&s) != ERR_PARAM_NULL)){
+      errors++;
+      puts("*** Error: closed AsyncFileDump accepts data");
+    } else {
+      puts("+++ AsyncFileDump::close() finished OK!");
+    }
+  }
+  unlink(name);
+  free(pat);
+
+  AsyncFileDump d(-1);
+  printf("\n%d tests completed with %d errors.\n",tests,errors);
+  printf("Used version: %s\n",d.VersionTag());
+
+  return 0;
+}
+
+#endif // TEST
@@ -0,0 +1,128 @@
+/*
+ *
+ * Universal Output Stream - File output by a background thread
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *  AsyncFileDump - StreamDump writing a file in the background
+ *
+ * This defines the values:
+ *
+ */
+
+#ifndef _UTIL_ASYNCFILEDUMP_H_
+# define _UTIL_ASYNCFILEDUMP_H_
+
+#include <StreamDump.h>
+#include <sys/types.h>
+#include <pthread.h>
+#include <vector>
+
+/*! \file AsyncFileDump.h
+    \brief File output by a background thread
+
+    AsyncFileDump copies the data written into one of a ring of
+    preallocated buffers. Full buffers are passed to a writer
+    thread, so write() only waits for storage, if all buffers are
+    in flight.
+
+    \author Dr. Lars Hanke
+    \date 2006-2008
+*/
+
+namespace mgr {
+
+  /*! \class AsyncFileDump
+      \brief StreamDump writing a file in the background
+
+      The buffers are aligned, so that the file may be opened with
+      O_DIRECT. Since O_DIRECT requires aligned lengths, a partial
+      buffer passed on by flush() is padded and the file truncated
+      afterwards. Its last block is kept and rewritten together
+      with the data following. If the file system rejects
+      O_DIRECT, it is silently dropped.
+
+      Errors of the writer thread are sticky and returned by any
+      later call.
+  */
+class AsyncFileDump : public StreamDump {
+public:
+  //! Options
+  enum Options {
+    DIRECT = 1,              //!< Bypass the page cache by O_DIRECT
+    SEQUENTIAL = 2,          //!< posix_fadvise() sequential access
+    DONTNEED = 4             //!< Drop pages written from the cache
+  };
+  enum {
+    DEFAULT_BUFFERS = 4,
+    DEFAULT_SIZE = 1 << 20,  //!< Default octets per buffer
+    ALIGN = 4096             //!< Alignment for O_DIRECT
+  };
+
+protected:
+  int fd;                    //!< File descriptor, -1 if closed
+  bool ownFd;                //!< fd is closed by close()
+  bool seekable;             //!< fd supports pwrite()
+  unsigned int opts;         //!< Options requested
+  bool direct;               //!< O_DIRECT active, writer thread only
+  m_error_t failed;          //!< First error of a write, sticky
+
+  size_t size;               //!< Octets per buffer
+  std::vector<unsigned char *> bufs;
+  std::vector<size_t> lens;  //!< Octets of queued buffers
+  std::vector<off_t> offs;   //!< File offsets of queued buffers
+  size_t head;               //!< First queued buffer
+  size_t queued;             //!< Number of queued buffers
+  size_t cur;                //!< Buffer being filled
+  size_t used;               //!< Octets in the fill buffer
+  off_t fillAt;              //!< File offset of the fill buffer
+
+  bool background;           //!< The thread is running
+  bool stop;                 //!< Ask the thread to terminate
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+
+  void init(int f, bool own, unsigned int o, size_t n, size_t s);
+  m_error_t writeOut(const unsigned char *d, size_t l, off_t at);
+  m_error_t handoff(void);
+  static void *worker(void *arg);
+  void run(void);
+
+private:
+  AsyncFileDump(const AsyncFileDump&);
+  AsyncFileDump& operator=(const AsyncFileDump&);
+
+public:
+  //! Create or truncate the file name
+  AsyncFileDump(const char *name, unsigned int o = 0,
+		size_t n = DEFAULT_BUFFERS, size_t s = DEFAULT_SIZE);
+  //! Write to an open file descriptor, which is not closed
+  AsyncFileDump(int f, unsigned int o = 0,
+		size_t n = DEFAULT_BUFFERS, size_t s = DEFAULT_SIZE);
+  //! DTOR closing file
+  virtual ~AsyncFileDump();
+
+  //! Copy into the buffers
+  virtual m_error_t write(const void *data, size_t *s);
+  virtual m_error_t putchar(const void *data){
+    size_t s = 1;
+    return write(data, &s);
+  }
+  //! Wait, until everything written has been passed to the OS
+  virtual m_error_t flush(void);
+  //! Flush, stop the thread and close the file
+  virtual m_error_t close(void);
+  virtual bool valid(void) const { return (fd >= 0); }
+
+  //! Version string
+  const char * VersionTag(void) const;
+};
+
+}; // namespace mgr
+
+#endif // _UTIL_ASYNCFILEDUMP_H_
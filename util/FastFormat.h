@@ -0,0 +1,127 @@
+/*
+ *
+ * Number formatting without printf()
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *
+ * This defines the values:
+ *  FORMAT_INT_MAX - octets required by formatInt()
+ *  FORMAT_FIXED_MAX - octets required by formatFixed() up to 41 digits
+ *
+ */
+
+#ifndef _UTIL_FASTFORMAT_H_
+# define _UTIL_FASTFORMAT_H_
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+/*! \file FastFormat.h
+    \brief Number formatting without printf()
+
+    printf() parses the format string for every number. Dumps of
+    large arrays spend most of their time there. The functions
+    below produce the same text as the printf() conversions noted
+    and return the end of the text written. No terminating zero
+    is appended.
+
+    \author Dr. Lars Hanke
+    \date 2006-2008
+*/
+
+namespace mgr {
+
+enum {
+  FORMAT_INT_MAX = 24,       //!< Octets required by formatInt()
+  FORMAT_FIXED_MAX = 352     //!< Octets required by formatFixed() up to 41 digits
+};
+
+//! Octets required by formatFixed() with prec digits
+/*! Sign, 309 digits of DBL_MAX, and the decimal point precede
+    the digits.
+*/
+inline size_t formatFixedSize(int prec){
+  const size_t l = 311 + ((prec < 0)? 6 : (size_t)prec);
+  return (l < (size_t)FORMAT_FIXED_MAX)? (size_t)FORMAT_FIXED_MAX : l;
+}
+
+//! Same as printf("%llu")
+inline char *formatUInt(char *d, unsigned long long v){
+  static const char digits[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+  char t[FORMAT_INT_MAX];
+  char *e = t + sizeof(t), *q = e;
+  while(v >= 100){
+    const unsigned int r = (unsigned int)(v % 100);
+    v /= 100;
+    q -= 2;
+    memcpy(q, digits + 2 * r, 2);
+  }
+  if(v >= 10){
+    q -= 2;
+    memcpy(q, digits + 2 * v, 2);
+  } else {
+    *--q = (char)('0' + v);
+  }
+  memcpy(d, q, e - q);
+  return d + (e - q);
+}
+
+//! Same as printf("%lld")
+inline char *formatInt(char *d, long long v){
+  if(v >= 0) return formatUInt(d, (unsigned long long)v);
+  *d++ = '-';
+  return formatUInt(d, 0ULL - (unsigned long long)v);
+}
+
+//! Same as printf("%.*f")
+/*! d must hold formatFixedSize(prec) octets. The digits are exact
+    including ties, which are rounded to even like glibc does.
+    Values of 2^53 and above, NaN, infinities, and more than 9
+    digits are passed to snprintf().
+*/
+inline char *formatFixed(char *d, double v, int prec = 6){
+  static const double scale[10] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+  };
+  // like printf() a negative precision is taken as omitted
+  if(prec < 0) prec = 6;
+  const double a = ::fabs(v);
+  if(!(a < 9007199254740992.0) || (prec > 9))
+    return d + ::snprintf(d, formatFixedSize(prec), "%.*f", prec, v);
+
+  if(::copysign(1.0, v) < 0) *d++ = '-';
+  const double ip = ::floor(a);
+  const double fr = a - ip;
+  const double s = scale[prec];
+  unsigned long long i = (unsigned long long)ip;
+  unsigned long long n = (unsigned long long)(fr * s);
+  // fma() gives the sign of the exact fr * s - x
+  if(::fma(fr, s, -(double)n) < 0) n--;
+  const double t = ::fma(fr, s, -((double)n + 0.5));
+  if((t > 0) || ((t == 0) && (((prec)? n : i) & 1))) n++;
+  if(n == (unsigned long long)s){
+    n = 0;
+    i++;
+  }
+  d = formatUInt(d, i);
+  if(prec){
+    *d++ = '.';
+    char *e = d + prec;
+    for(char *q = e; q > d; n /= 10) *--q = (char)('0' + n % 10);
+    d = e;
+  }
+  return d;
+}
+
+}; // namespace mgr
+
+#endif // _UTIL_FASTFORMAT_H_
@@ -110,25 +110,15 @@ m_error_t HexDump::lineFeed(void){
 
 m_error_t HexDump::textf(size_t *os, const char *fmt, ...){
   va_list args;
-  char *buffer = NULL;
-  m_error_t err = ERR_NO_ERROR;
 
   if(!out || !fmt) return ERR_PARAM_NULL;
+  // formatted by the StreamDump written to
   va_start(args,fmt);
-  int written = ::vasprintf(&buffer, fmt, args);
+  m_error_t err = out->vprintf(os, fmt, args);
   va_end(args);
-  if(written < 0) return ERR_MEM_AVAIL;
-
-  if(written){
-    *os = written;
-    err = out->write(buffer,os);
-  }
 
   linepos = 0;
-
-  ::free(buffer);
   return err;
-
 }
 
 /*
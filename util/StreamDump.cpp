@@ -9,6 +9,8 @@
  *
  * This defines the classes:
  *  StreamDump - Interface Class
+ *  FileDump - StreamDump on stdio
+ *  FdDump - StreamDump on a file descriptor
  *
  * This defines the values:
  *
@@ -16,9 +18,14 @@
 
 #include "StreamDump.h"
 #include "StreamDump.tag"
+#include "FastFormat.h"
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 
 #define DEBUG_MARK 1
 #define DEBUG_DUMP 2
@@ -31,24 +38,125 @@
 
 using namespace mgr;
 
+/*! The scratch buffer is only enlarged, so that formatting
+    usually takes no allocation at all.
+*/
+char *StreamDump::reserve(size_t& l){
+  if(l > scratchSize){
+    size_t s = (scratchSize)? scratchSize : 256;
+    while(s < l) s *= 2;
+    char *p = (char *)::realloc(scratch, s);
+    if(!p) return NULL;
+    scratch = p;
+    scratchSize = s;
+  }
+  l = scratchSize;
+  return scratch;
+}
+
 m_error_t StreamDump::printf(size_t *out, const char *fmt, ...){
   va_list args;
-  char *buffer = NULL;
-  m_error_t err = ERR_NO_ERROR;
 
-  if(!out || !fmt) return ERR_PARAM_NULL;
   va_start(args,fmt);
-  int written = ::vasprintf(&buffer, fmt, args);
+  m_error_t err = vprintf(out, fmt, args);
   va_end(args);
-  if(written < 0) return ERR_MEM_AVAIL;
+  return err;
+}
+
+m_error_t StreamDump::vprintf(size_t *out, const char *fmt, va_list args){
+  va_list again;
 
-  if(written){
-    *out = written;
-    err = write(buffer,out);
+  if(!out || !fmt) return ERR_PARAM_NULL;
+  size_t l = 128;
+  char *p = reserve(l);
+  if(!p) return ERR_MEM_AVAIL;
+  va_copy(again, args);
+  int written = ::vsnprintf(p, l, fmt, args);
+  if((written >= 0) && ((size_t)written >= l)){
+    // too long, now we know the size
+    l = written + 1;
+    p = reserve(l);
+    if(p) ::vsnprintf(p, l, fmt, again);
   }
+  va_end(again);
+  if(written < 0 || !p) return ERR_MEM_AVAIL;
 
-  ::free(buffer);
-  return err;
+  *out = written;
+  if(!written) return ERR_NO_ERROR;
+  return commit(p, written);
+}
+
+m_error_t StreamDump::printInt(long long v){
+  size_t l = FORMAT_INT_MAX;
+  char *p = reserve(l);
+  if(!p) return ERR_MEM_AVAIL;
+  return commit(p, formatInt(p, v) - p);
+}
+
+m_error_t StreamDump::printUInt(unsigned long long v){
+  size_t l = FORMAT_INT_MAX;
+  char *p = reserve(l);
+  if(!p) return ERR_MEM_AVAIL;
+  return commit(p, formatUInt(p, v) - p);
+}
+
+m_error_t StreamDump::printFixed(double v, int prec){
+  size_t l = formatFixedSize(prec);
+  char *p = reserve(l);
+  if(!p) return ERR_MEM_AVAIL;
+  return commit(p, formatFixed(p, v, prec) - p);
+}
+
+m_error_t StreamDump::writev(const struct iovec *v, int n){
+  if(!v && n) return ERR_PARAM_NULL;
+  for(int i = 0; i < n; i++){
+    if(!v[i].iov_len) continue;
+    size_t s = v[i].iov_len;
+    m_error_t err = write(v[i].iov_base, &s);
+    if(err != ERR_NO_ERROR) return err;
+  }
+  return ERR_NO_ERROR;
+}
+
+/*
+ * write all regions to fd, continuing partial writes
+ *
+ */
+
+#ifndef IOV_MAX
+# define IOV_MAX 1024
+#endif
+
+static m_error_t writevFd(int fd, const struct iovec *v, int n){
+  enum { CHUNK = 1024 };
+  struct iovec b[CHUNK];
+  const int max = (IOV_MAX < CHUNK)? IOV_MAX : CHUNK;
+
+  while(n > 0){
+    int k = (n < max)? n : max;
+    // the copy is advanced on partial writes
+    memcpy(b, v, k * sizeof(struct iovec));
+    v += k;
+    n -= k;
+    struct iovec *p = b;
+    while(k){
+      ssize_t w = ::writev(fd, p, k);
+      if(w < 0){
+	if(errno == EINTR) continue;
+	return ERR_FILE_WRITE;
+      }
+      while(k && ((size_t)w >= p->iov_len)){
+	w -= p->iov_len;
+	p++;
+	k--;
+      }
+      if(k){
+	p->iov_base = (char *)p->iov_base + w;
+	p->iov_len -= w;
+      }
+    }
+  }
+  return ERR_NO_ERROR;
 }
 
 /*
@@ -76,6 +184,27 @@ m_error_t FileDump::write(const void *data, size_t *s){
   return (1 != ::fwrite(data, *s, 1, f))? ERR_FILE_WRITE : ERR_NO_ERROR;
 }
 
+/*! Batches below WRITEV_MIN octets are collected in the stdio
+    buffer like write() does, since many small tags would cost a
+    system call each. Larger ones are passed to writev() without
+    copying. The stdio buffer is flushed first, so that the order
+    of data written by write() and writev() is kept.
+*/
+m_error_t FileDump::writev(const struct iovec *v, int n){
+  if(!f || (!v && n)) return ERR_PARAM_NULL;
+  size_t total = 0;
+  for(int i = 0; (i < n) && (total < WRITEV_MIN); i++) total += v[i].iov_len;
+  if(total < WRITEV_MIN){
+    for(int i = 0; i < n; i++){
+      if(v[i].iov_len && (1 != ::fwrite(v[i].iov_base, v[i].iov_len, 1, f)))
+	return ERR_FILE_WRITE;
+    }
+    return ERR_NO_ERROR;
+  }
+  if(::fflush(f)) return ERR_FILE_WRITE;
+  return writevFd(::fileno(f), v, n);
+}
+
 m_error_t FileDump::flush(void) {
   if(!f) return ERR_PARAM_NULL;
   if(::fflush(f)) return ERR_FILE_WRITE;
@@ -92,10 +221,15 @@ m_error_t FileDump::close(void) {
 m_error_t FileDump::printf(size_t *out, const char *fmt, ...){
   va_list args;
 
-  if(!f || !out || !fmt) return ERR_PARAM_NULL;
   va_start(args,fmt);
-  int written = ::vfprintf(f, fmt, args);
+  m_error_t err = vprintf(out, fmt, args);
   va_end(args);
+  return err;
+}
+
+m_error_t FileDump::vprintf(size_t *out, const char *fmt, va_list args){
+  if(!f || !out || !fmt) return ERR_PARAM_NULL;
+  int written = ::vfprintf(f, fmt, args);
   if(written < 0){
     *out = 0;
     return ERR_FILE_WRITE;
@@ -108,6 +242,49 @@ const char * FileDump::VersionTag(void) const{
   return _VERSION_;
 }
 
+/*
+ * file descriptor implemenatation
+ *
+ */
+
+FdDump::FdDump(const char *name){
+  fd = (name)? ::open(name, O_WRONLY | O_CREAT | O_TRUNC, 0666) : -1;
+  ownFd = true;
+}
+
+m_error_t FdDump::write(const void *data, size_t *s){
+  if((fd < 0) || !data || !s) return ERR_PARAM_NULL;
+  const char *p = (const char *)data;
+  size_t l = *s;
+  while(l){
+    ssize_t w = ::write(fd, p, l);
+    if(w < 0){
+      if(errno == EINTR) continue;
+      *s -= l;
+      return ERR_FILE_WRITE;
+    }
+    p += w;
+    l -= w;
+  }
+  return ERR_NO_ERROR;
+}
+
+m_error_t FdDump::writev(const struct iovec *v, int n){
+  if((fd < 0) || (!v && n)) return ERR_PARAM_NULL;
+  return writevFd(fd, v, n);
+}
+
+m_error_t FdDump::close(void){
+  if(fd < 0) return ERR_PARAM_NULL;
+  int res = (ownFd)? ::close(fd) : 0;
+  fd = -1;
+  return (res)? ERR_FILE_CLOSE : ERR_NO_ERROR;
+}
+
+const char * FdDump::VersionTag(void) const{
+  return _VERSION_;
+}
+
 
 /*
  * The testsuite
@@ -120,6 +297,40 @@ const char * FileDump::VersionTag(void) const{
 
 #include <errno.h>
 #include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <wtBufferDump.h>
+
+// compare a formatter with snprintf()
+static bool sameFixed(double v, int prec){
+  char a[FORMAT_FIXED_MAX + 1], b[FORMAT_FIXED_MAX + 1];
+  *formatFixed(a,v,prec) = 0;
+  snprintf(b,sizeof(b),"%.*f",prec,v);
+  if(!strcmp(a,b)) return true;
+  printf("*** %.17g with %d digits: %s instead of %s\n",v,prec,a,b);
+  return false;
+}
+
+static bool sameInt(long long v){
+  char a[FORMAT_INT_MAX + 1], b[FORMAT_INT_MAX + 1];
+  *formatInt(a,v) = 0;
+  snprintf(b,sizeof(b),"%lld",v);
+  if(strcmp(a,b)) return false;
+  *formatUInt(a,(unsigned long long)v) = 0;
+  snprintf(b,sizeof(b),"%llu",(unsigned long long)v);
+  return !strcmp(a,b);
+}
+
+// writev() must not overtake data buffered before
+static m_error_t writevFramed(StreamDump& d, const struct iovec *v, int n){
+  size_t s = 1;
+  m_error_t res = (d.valid())? d.write("<",&s) : ERR_FILE_OPEN;
+  if(res == ERR_NO_ERROR) res = d.writev(v,n);
+  if(res == ERR_NO_ERROR) res = d.putchar(">");
+  if(res == ERR_NO_ERROR) res = d.close();
+  return res;
+}
 
 int main(int argc, char *argv[]){
   m_error_t res;
@@ -147,6 +358,163 @@ int main(int argc, char *argv[]){
     printf("+++ FileDump::write() finished OK - %d written!\n",s);
   }
 
+  char name[64];
+  snprintf(name,sizeof(name),"/tmp/test-StreamDump-%d",(int)getpid());
+  // more regions than IOV_MAX and a few empty ones
+  const int n = 3000;
+  struct iovec *v = (struct iovec *)malloc(n * sizeof(struct iovec));
+  char *expect = (char *)malloc(2 * n + 2);
+  size_t el = 0;
+  expect[el++] = '<';
+  for(int i = 0; i < n; i++){
+    v[i].iov_base = (void *)(stag + i % 11);
+    v[i].iov_len = (i % 7)? 2 : 0;
+    memcpy(expect + el, v[i].iov_base, v[i].iov_len);
+    el += v[i].iov_len;
+  }
+  expect[el++] = '>';
+
+  for(int k = 0; k < 2; k++){
+    printf("Test %d: writev() to %s\n",++tests,(k)? "FdDump" : "FileDump");
+    if(k){
+      FdDump d(name);
+      res = writevFramed(d,v,n);
+    } else {
+      FileDump d(name);
+      res = writevFramed(d,v,n);
+    }
+    if(res == ERR_NO_ERROR){
+      char *b = (char *)malloc(el + 1);
+      FILE *f = fopen(name,"rb");
+      size_t r = (f)? fread(b,1,el + 1,f) : 0;
+      if(f) fclose(f);
+      if((r != el) || memcmp(b,expect,el)) res = ERR_INT_DATA;
+      free(b);
+    }
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: writev() failed 0x%.4x\n",(int)res);
+    } else {
+      printf("+++ writev() finished OK - %d written!\n",el);
+    }
+  }
+
+  printf("Test %d: FileDump::writev() of small and large batches\n",++tests);
+  do {
+    FileDump d(name);
+    struct stat st;
+    res = d.writev(v,50);
+    if(res != ERR_NO_ERROR) break;
+    // small batches stay in the stdio buffer
+    if(stat(name,&st) || st.st_size){
+      res = ERR_INT_STATE;
+      break;
+    }
+    const size_t L = 4 * FileDump::WRITEV_MIN;
+    char *big = (char *)malloc(L);
+    for(size_t i = 0; i < L; i++) big[i] = (char)(i * 13);
+    struct iovec w[2];
+    w[0].iov_base = (void *)stag;
+    w[0].iov_len = 5;
+    w[1].iov_base = big;
+    w[1].iov_len = L;
+    res = d.writev(w,2);
+    if(res == ERR_NO_ERROR) res = d.close();
+    if(res == ERR_NO_ERROR){
+      size_t sl = 0;
+      for(int i = 0; i < 50; i++) sl += v[i].iov_len;
+      char *b = (char *)malloc(sl + 5 + L + 1);
+      FILE *f = fopen(name,"rb");
+      size_t r = (f)? fread(b,1,sl + 5 + L + 1,f) : 0;
+      if(f) fclose(f);
+      if((r != sl + 5 + L) || memcmp(b,expect + 1,sl) || memcmp(b + sl,stag,5) ||
+	 memcmp(b + sl + 5,big,L))
+	res = ERR_INT_DATA;
+      free(b);
+    }
+    free(big);
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: FileDump::writev() failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ FileDump::writev() finished OK!");
+  }
+  unlink(name);
+  free(expect);
+  free(v);
+
+  printf("Test %d: formatInt() and formatUInt()\n",++tests);
+  {
+    const long long edge[] = { 0, 1, -1, 9, 10, 99, 100, -100, 101, 999999999,
+			       LLONG_MAX, LLONG_MIN, LLONG_MIN + 1 };
+    size_t bad = 0;
+    for(size_t i = 0; i < sizeof(edge) / sizeof(edge[0]); i++)
+      if(!sameInt(edge[i])) bad++;
+    srand(4711);
+    for(int i = 0; i < 100000; i++){
+      long long r = ((long long)rand() << 33) ^ ((long long)rand() << 12) ^ rand();
+      if(!sameInt(r >> (i % 60))) bad++;
+    }
+    if(bad){
+      errors++;
+      printf("*** Error: %d integers differ from printf()\n",bad);
+    } else {
+      puts("+++ formatInt() finished OK!");
+    }
+  }
+
+  printf("Test %d: formatFixed()\n",++tests);
+  {
+    const double edge[] = { 0.0, -0.0, 0.5, 1.5, 2.5, -2.5, 0.125, 0.375, 1e-7, -1e-9,
+			    0.9999995, 0.0000005, 0.0000015, 123456.5, 4503599627370495.5,
+			    9007199254740991.0, 9007199254740992.0, 1e300, -1e300,
+			    HUGE_VAL, -HUGE_VAL, NAN };
+    size_t bad = 0;
+    for(size_t i = 0; i < sizeof(edge) / sizeof(edge[0]); i++)
+      for(int p = 0; p <= 41; p++)
+	if(!sameFixed(edge[i],p)) bad++;
+    for(int i = 0; i < 300000; i++){
+      int p = i % 10;
+      double v = ldexp((double)rand(), -(rand() % 60)) * ((i & 1)? -1 : 1);
+      // decimal ties and their neighbours
+      if(!(i % 3)) v = (rand() % 100000 + 0.5) / pow(10.0,p);
+      if(!sameFixed(v,p)) bad++;
+    }
+    if(bad){
+      errors++;
+      printf("*** Error: %d values differ from printf()\n",bad);
+    } else {
+      puts("+++ formatFixed() finished OK!");
+    }
+  }
+
+  printf("Test %d: Formatting into a BufferDump\n",++tests);
+  {
+    BufferDump b(64);
+    char big[300];
+    memset(big,'x',sizeof(big) - 1);
+    big[sizeof(big) - 1] = 0;
+    res = b.printf(&s,"%s|%d|",big,42);
+    if(res == ERR_NO_ERROR) res = b.printInt(-17);
+    if(res == ERR_NO_ERROR) res = b.printf(&s,"|");
+    if(res == ERR_NO_ERROR) res = b.printFixed(3.25,1);
+    // more digits than FORMAT_FIXED_MAX provides for
+    if(res == ERR_NO_ERROR) res = b.printFixed(-1e300,60);
+    if(res == ERR_NO_ERROR) res = b.printFixed(0.1,-1);
+    char expect[1000];
+    snprintf(expect,sizeof(expect),"%s|%d|%d|%.1f%.60f%f",big,42,-17,3.25,-1e300,0.1);
+    if((res == ERR_NO_ERROR) && ((b.get().byte_size() != strlen(expect)) ||
+				 memcmp(b.get().readPtr(),expect,strlen(expect))))
+      res = ERR_INT_DATA;
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: printf() failed 0x%.4x\n",(int)res);
+    } else {
+      puts("+++ BufferDump::printf() finished OK!");
+    }
+  }
+
   printf("\n%d tests completed with %d errors.\n",tests,errors);
   printf("Used version: %s\n",stream.VersionTag());
 
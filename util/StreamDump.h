@@ -9,6 +9,8 @@
  *
  * This defines the classes:
  *  StreamDump - Interface Class
+ *  FileDump - StreamDump on stdio
+ *  FdDump - StreamDump on a file descriptor
  *
  * This defines the values:
  *
@@ -20,6 +22,9 @@
 #include <mgrError.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <sys/uio.h>
 
 #if defined(putchar)
 #undef putchar
@@ -62,10 +67,41 @@ namespace mgr {
       for format string treatment, which uses the overloaded
       write() method for output. It should be quite generic
       and handy in all classes implementing StreamDump.
+
+      Formatted output is produced in a scratch buffer kept by
+      the stream, or directly in the destination, if the
+      implementation overloads reserve() and commit().
   */
 class StreamDump {
 protected:
-  virtual ~StreamDump() {}
+  char *scratch;       //!< Buffer for formatted output
+  size_t scratchSize;
+
+  StreamDump() : scratch(NULL), scratchSize(0) {}
+  //! The scratch buffer is not shared
+  StreamDump(const StreamDump&) : scratch(NULL), scratchSize(0) {}
+  StreamDump& operator=(const StreamDump&) { return *this; }
+  virtual ~StreamDump() { ::free(scratch); }
+
+  /*! \brief Room for formatted output
+      \param l Octets required
+      \retval l Octets available
+      \return Start of the room, NULL if out of memory
+
+      The default returns the scratch buffer.
+  */
+  virtual char *reserve(size_t& l);
+
+  /*! \brief Output text formatted into the room of reserve()
+      \param p Start of the text as returned by reserve()
+      \param l Octets of text
+      \return Error code as defined in mgrError.h
+
+      The default calls write().
+  */
+  virtual m_error_t commit(char *p, size_t l){
+    return write(p, &l);
+  }
 
 public:
   /*! \brief Write a data region to stream
@@ -76,6 +112,17 @@ public:
   */
   virtual m_error_t write(const void *data, size_t *s) = 0;
 
+  /*! \brief Write several data regions to stream
+      \param v Data regions in order of output
+      \param n Number of regions
+      \return Error code as defined in mgrError.h
+
+      The default calls write() for each region. Implementations
+      writing to a file descriptor pass all regions to the OS by
+      a single writev() call.
+  */
+  virtual m_error_t writev(const struct iovec *v, int n);
+
   /*! \brief Write a single character to stream
       \param data Address of the character
       \return Error code as defined in mgrError.h
@@ -115,12 +162,29 @@ public:
       thus would not require overloading.
   */
   virtual m_error_t printf(size_t *out, const char *fmt, ...);
+
+  //! printf() with a va_list
+  virtual m_error_t vprintf(size_t *out, const char *fmt, va_list args);
+
+  //! Same as printf("%lld") without parsing a format
+  m_error_t printInt(long long v);
+
+  //! Same as printf("%llu") without parsing a format
+  m_error_t printUInt(unsigned long long v);
+
+  //! Same as printf("%.*f") without parsing a format
+  m_error_t printFixed(double v, int prec = 6);
 };
 
   /*! \class FileDump
       \brief Implementation of StreamDump for ordinary files
   */
 class FileDump : public StreamDump {
+public:
+  enum {
+    WRITEV_MIN = 65536   //!< Octets of a writev(), which bypass the stdio buffer
+  };
+
 protected:
   FILE *f;   //!< glibc file handle
 
@@ -143,9 +207,15 @@ public:
   //! Overloaded to use fprintf()
   virtual m_error_t printf(size_t *out, const char *fmt, ...);
 
+  //! Overloaded to use vfprintf()
+  virtual m_error_t vprintf(size_t *out, const char *fmt, va_list args);
+
   //! Overloaded to use fwrite()
   virtual m_error_t write(const void *data, size_t *s);
 
+  //! fwrite() small batches, flush and writev() large ones
+  virtual m_error_t writev(const struct iovec *v, int n);
+
   //! fflush() essentially
   virtual m_error_t flush(void);
 
@@ -179,6 +249,61 @@ public:
   const char * VersionTag(void) const;
 };
 
+  /*! \class FdDump
+      \brief Implementation of StreamDump for file descriptors
+
+      FdDump does not buffer, but passes every call to write()
+      or writev() directly to the OS. It may be used on files,
+      pipes and sockets. Partial writes are continued, until
+      all data is written.
+  */
+class FdDump : public StreamDump {
+protected:
+  int fd;                    //!< File descriptor, -1 if closed
+  bool ownFd;                //!< fd is closed by close()
+
+private:
+  FdDump(const FdDump&);
+  FdDump& operator=(const FdDump&);
+
+public:
+  //! CTOR from open file descriptor
+  /*! \param f File descriptor
+      \param own close() closes f
+  */
+  FdDump(int f, bool own = false) : fd(f), ownFd(own) {}
+
+  //! CTOR creating or truncating the file name
+  FdDump(const char *name);
+
+  //! DTOR closing file
+  virtual ~FdDump(){ if(fd >= 0) close(); }
+
+  //! Interface to write()
+  virtual m_error_t write(const void *data, size_t *s);
+
+  //! Interface to writev()
+  virtual m_error_t writev(const struct iovec *v, int n);
+
+  virtual m_error_t putchar(const void *data){
+    size_t s = 1;
+    return write(data, &s);
+  }
+
+  //! Nothing is buffered
+  virtual m_error_t flush(void){
+    return (fd < 0)? ERR_PARAM_NULL : ERR_NO_ERROR;
+  }
+
+  virtual bool valid(void) const { return (fd >= 0); }
+
+  //! Close the file descriptor, if owned
+  virtual m_error_t close(void);
+
+  //! Version string
+  const char * VersionTag(void) const;
+};
+
 }; // namespace mgr
 
 #endif // _UTIL_STREAMDUMP_H_
@@ -0,0 +1,670 @@
+/*
+ *
+ * Universal Output Stream - File I/O by Linux io_uring
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *  UringQueue - minimal io_uring submission and completion queue
+ *  UringDump - StreamDump keeping several writes in flight
+ *  UringReader - file reader keeping several reads in flight
+ *
+ * This defines the values:
+ *
+ */
+
+#include "UringDump.h"
+#include "UringDump.tag"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if defined(__linux__) && defined(__has_include)
+# if __has_include(<linux/io_uring.h>)
+#  define UTIL_HAVE_URING 1
+# endif
+#endif
+
+#ifdef UTIL_HAVE_URING
+# include <linux/io_uring.h>
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <sys/uio.h>
+// IORING_OP_READ and IORING_OP_WRITE came with this feature
+# ifndef IORING_FEAT_RW_CUR_POS
+#  undef UTIL_HAVE_URING
+# endif
+#endif
+
+using namespace mgr;
+
+// largest request, the length of an sqe has 32 bits
+static const size_t MAX_REQUEST = 1 << 30;
+
+/*
+ * UringQueue
+ *
+ */
+
+/*! \param n Requests in flight at most
+
+    If io_uring is not available, valid() returns false.
+*/
+UringQueue::UringQueue(unsigned int n) :
+  ring(-1), Entries(0), sqMap(NULL), cqMap(NULL), sqeMap(NULL),
+  sqLen(0), cqLen(0), sqeLen(0) {
+#ifdef UTIL_HAVE_URING
+  struct io_uring_params p;
+  memset(&p,0,sizeof(p));
+  int r = ::syscall(__NR_io_uring_setup, (n)? n : 1, &p);
+  if(r < 0) return;
+  ring = r;
+  if(!(p.features & IORING_FEAT_RW_CUR_POS)){
+    release();
+    return;
+  }
+  sqLen = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+  cqLen = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  const bool single = (p.features & IORING_FEAT_SINGLE_MMAP);
+  if(single){
+    if(cqLen > sqLen) sqLen = cqLen;
+    cqLen = sqLen;
+  }
+  void *m = ::mmap(NULL, sqLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		   ring, IORING_OFF_SQ_RING);
+  if(m == MAP_FAILED){
+    release();
+    return;
+  }
+  sqMap = m;
+  if(single) cqMap = sqMap;
+  else {
+    m = ::mmap(NULL, cqLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	       ring, IORING_OFF_CQ_RING);
+    if(m == MAP_FAILED){
+      release();
+      return;
+    }
+    cqMap = m;
+  }
+  sqeLen = p.sq_entries * sizeof(struct io_uring_sqe);
+  m = ::mmap(NULL, sqeLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	     ring, IORING_OFF_SQES);
+  if(m == MAP_FAILED){
+    release();
+    return;
+  }
+  sqeMap = m;
+
+  unsigned char *sq = static_cast<unsigned char *>(sqMap);
+  sqHead = reinterpret_cast<unsigned int *>(sq + p.sq_off.head);
+  sqTail = reinterpret_cast<unsigned int *>(sq + p.sq_off.tail);
+  sqMask = reinterpret_cast<unsigned int *>(sq + p.sq_off.ring_mask);
+  sqArray = reinterpret_cast<unsigned int *>(sq + p.sq_off.array);
+  unsigned char *cq = static_cast<unsigned char *>(cqMap);
+  cqHead = reinterpret_cast<unsigned int *>(cq + p.cq_off.head);
+  cqTail = reinterpret_cast<unsigned int *>(cq + p.cq_off.tail);
+  cqMask = reinterpret_cast<unsigned int *>(cq + p.cq_off.ring_mask);
+  cqes = cq + p.cq_off.cqes;
+  Entries = p.sq_entries;
+#endif
+}
+
+void UringQueue::release(void){
+#ifdef UTIL_HAVE_URING
+  if(sqeMap) ::munmap(sqeMap, sqeLen);
+  if(cqMap && (cqMap != sqMap)) ::munmap(cqMap, cqLen);
+  if(sqMap) ::munmap(sqMap, sqLen);
+#endif
+  sqeMap = cqMap = sqMap = NULL;
+  if(ring >= 0) ::close(ring);
+  ring = -1;
+  Entries = 0;
+}
+
+/*! \param b Array of n buffers
+    \param n Number of buffers
+    \param l Octets per buffer
+    \return Error code as defined in mgrError.h
+
+    Registering pins the buffers and may exceed RLIMIT_MEMLOCK.
+*/
+m_error_t UringQueue::registerBuffers(unsigned char * const *b, size_t n, size_t l){
+  if(ring < 0) return ERR_INT_STATE;
+  if(!b || !n) return ERR_PARAM_NULL;
+#ifdef UTIL_HAVE_URING
+  std::vector<struct iovec> v(n);
+  for(size_t i = 0; i < n; i++){
+    v[i].iov_base = b[i];
+    v[i].iov_len = l;
+  }
+  if(::syscall(__NR_io_uring_register, ring, IORING_REGISTER_BUFFERS, &v[0], (unsigned int)n) < 0)
+    return ERR_MEM_AVAIL;
+  return ERR_NO_ERROR;
+#else
+  return ERR_INT_IMP;
+#endif
+}
+
+/*! \param op Operation
+    \param fd File descriptor
+    \param b Buffer, which must persist until completion
+    \param l Octets to transfer
+    \param at File offset
+    \param data Returned by complete()
+    \param index Registered buffer for WRITE_FIXED
+    \return Error code as defined in mgrError.h
+*/
+m_error_t UringQueue::submit(Ops op, int fd, const void *b, size_t l, off_t at,
+			     unsigned long long data, unsigned int index){
+  if(ring < 0) return ERR_INT_STATE;
+  if(l > MAX_REQUEST) return ERR_PARAM_RANG;
+#ifdef UTIL_HAVE_URING
+  // only this thread advances the tail
+  const unsigned int tail = *sqTail;
+  if(tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= Entries) return ERR_MEM_AVAIL;
+  const unsigned int idx = tail & *sqMask;
+  struct io_uring_sqe *sqe = static_cast<struct io_uring_sqe *>(sqeMap) + idx;
+  memset(sqe, 0, sizeof(*sqe));
+  switch(op){
+  case READ:
+    sqe->opcode = IORING_OP_READ;
+    break;
+  case WRITE:
+    sqe->opcode = IORING_OP_WRITE;
+    break;
+  case WRITE_FIXED:
+    sqe->opcode = IORING_OP_WRITE_FIXED;
+    sqe->buf_index = index;
+    break;
+  default:
+    return ERR_PARAM_OPT;
+  }
+  sqe->fd = fd;
+  sqe->off = at;
+  sqe->addr = (unsigned long long)(unsigned long)b;
+  sqe->len = (unsigned int)l;
+  sqe->user_data = data;
+  sqArray[idx] = idx;
+  __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+  for(;;){
+    if(::syscall(__NR_io_uring_enter, ring, 1, 0, 0, NULL, 0) >= 0) break;
+    if(errno != EINTR){
+      // the entry is published, a later enter would submit it
+      release();
+      return (op == READ)? ERR_FILE_READ : ERR_FILE_WRITE;
+    }
+  }
+  return ERR_NO_ERROR;
+#else
+  return ERR_INT_IMP;
+#endif
+}
+
+/*! \param data Receives the data passed to submit()
+    \param res Receives the octets transferred or -errno
+    \return Error code as defined in mgrError.h
+
+    Blocks, until a request completes. There must be a request in
+    flight.
+*/
+m_error_t UringQueue::complete(unsigned long long& data, long& res){
+  if(ring < 0) return ERR_INT_STATE;
+#ifdef UTIL_HAVE_URING
+  for(;;){
+    const unsigned int head = *cqHead;
+    if(head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)){
+      const struct io_uring_cqe *cqe =
+	static_cast<const struct io_uring_cqe *>(cqes) + (head & *cqMask);
+      data = cqe->user_data;
+      res = cqe->res;
+      __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+      return ERR_NO_ERROR;
+    }
+    if((::syscall(__NR_io_uring_enter, ring, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0) &&
+       (errno != EINTR)) return ERR_INT_STATE;
+  }
+#else
+  return ERR_INT_IMP;
+#endif
+}
+
+/*
+ * UringDump
+ *
+ */
+
+/*! \param name File to create or truncate
+    \param n Number of buffers, at least 2
+    \param s Octets per buffer, rounded up to ALIGN
+    \param uring Use io_uring, if available
+
+    If the file cannot be created, valid() returns false.
+*/
+UringDump::UringDump(const char *name, size_t n, size_t s, bool uring){
+  int f = (name)? ::open(name, O_WRONLY | O_CREAT | O_TRUNC, 0666) : -1;
+  init(f, true, n, s, uring);
+}
+
+/*! \param f Open file descriptor
+    \param n Number of buffers, at least 2
+    \param s Octets per buffer, rounded up to ALIGN
+    \param uring Use io_uring, if available and f is seekable
+*/
+UringDump::UringDump(int f, size_t n, size_t s, bool uring){
+  init(f, false, n, s, uring);
+}
+
+UringDump::~UringDump(){
+  if(fd >= 0) close();
+  if(queue) delete queue;
+  for(size_t i = 0; i < bufs.size(); i++) ::free(bufs[i]);
+}
+
+void UringDump::init(int f, bool own, size_t n, size_t s, bool uring){
+  fd = f;
+  ownFd = own;
+  queue = NULL;
+  fixed = false;
+  failed = ERR_NO_ERROR;
+  broken = false;
+  if(!s) s = DEFAULT_SIZE;
+  if(s > MAX_REQUEST) s = MAX_REQUEST;
+  size = (s + ALIGN - 1) & ~((size_t)ALIGN - 1);
+  inflight = cur = used = 0;
+  fillAt = 0;
+  seekable = false;
+  if(fd < 0) return;
+
+  fillAt = ::lseek(fd, 0, SEEK_CUR);
+  // pwrite() ignores the offset for O_APPEND
+  int fl = ::fcntl(fd, F_GETFL);
+  seekable = (fillAt >= 0) && (fl >= 0) && !(fl & O_APPEND);
+  if(!seekable) fillAt = 0;
+
+  if(n < 2) n = 2;
+  bufs.resize(n, NULL);
+  lens.resize(n, 0);
+  offs.resize(n, 0);
+  busy.resize(n, false);
+  for(size_t i = 0; i < n; i++){
+    void *p;
+    if(::posix_memalign(&p, ALIGN, size)){
+      failed = ERR_MEM_AVAIL;
+      if(ownFd) ::close(fd);
+      fd = -1;
+      return;
+    }
+    bufs[i] = static_cast<unsigned char *>(p);
+  }
+
+  if(!uring || !seekable) return;
+  queue = new UringQueue((unsigned int)n);
+  if(queue && !queue->valid()){
+    delete queue;
+    queue = NULL;
+  }
+  if(queue) fixed = (queue->registerBuffers(&bufs[0], n, size) == ERR_NO_ERROR);
+}
+
+// write synchronously
+m_error_t UringDump::writeOut(const unsigned char *d, size_t l, off_t at){
+  while(l){
+    ssize_t w = (seekable)? ::pwrite(fd, d, l, at) : ::write(fd, d, l);
+    if(w < 0){
+      if(errno == EINTR) continue;
+      return ERR_FILE_WRITE;
+    }
+    d += w;
+    l -= w;
+    at += w;
+  }
+  return ERR_NO_ERROR;
+}
+
+// close a failed ring, the buffers in flight stay busy for good
+m_error_t UringDump::abandon(m_error_t e){
+  if(failed == ERR_NO_ERROR) failed = e;
+  broken = true;
+  if(queue){
+    delete queue;
+    queue = NULL;
+  }
+  return failed;
+}
+
+// wait for one write to complete, errors of the write are sticky
+m_error_t UringDump::reap(void){
+  if(broken) return failed;
+  unsigned long long b;
+  long r;
+  m_error_t res = queue->complete(b, r);
+  if(res != ERR_NO_ERROR) return abandon(res);
+  busy[b] = false;
+  inflight--;
+  m_error_t wr = ERR_NO_ERROR;
+  if(r < 0) wr = ERR_FILE_WRITE;
+  else if((size_t)r < lens[b]) wr = writeOut(bufs[b] + r, lens[b] - r, offs[b] + r);
+  if((wr != ERR_NO_ERROR) && (failed == ERR_NO_ERROR)) failed = wr;
+  return ERR_NO_ERROR;
+}
+
+// submit the fill buffer
+m_error_t UringDump::handoff(void){
+  if(broken || !used) return failed;
+  m_error_t res = ERR_INT_STATE;
+  if(queue){
+    lens[cur] = used;
+    offs[cur] = fillAt;
+    res = queue->submit((fixed)? UringQueue::WRITE_FIXED : UringQueue::WRITE,
+			fd, bufs[cur], used, fillAt, cur, (unsigned int)cur);
+    if(res == ERR_NO_ERROR){
+      busy[cur] = true;
+      inflight++;
+    } else if(!queue->valid()){
+      // the ring is closed, but earlier writes may be in flight
+      return abandon(res);
+    }
+  }
+  if(res != ERR_NO_ERROR){
+    res = writeOut(bufs[cur], used, fillAt);
+    if((res != ERR_NO_ERROR) && (failed == ERR_NO_ERROR)) failed = res;
+  }
+  fillAt += used;
+  used = 0;
+  cur = (cur + 1) % bufs.size();
+  // only block, if the next buffer is still in flight
+  while(busy[cur])
+    if(reap() != ERR_NO_ERROR) break;
+  return failed;
+}
+
+/*! \param data Start of data region
+    \param s Length of data in region
+    \retval s Length of data actually copied
+    \return Error code as defined in mgrError.h
+*/
+m_error_t UringDump::write(const void *data, size_t *s){
+  if((fd < 0) || !data || !s) return ERR_PARAM_NULL;
+  if(broken){
+    *s = 0;
+    return failed;
+  }
+  const unsigned char *p = static_cast<const unsigned char *>(data);
+  size_t l = *s;
+  while(l){
+    size_t c = size - used;
+    if(c > l) c = l;
+    memcpy(bufs[cur] + used, p, c);
+    used += c;
+    p += c;
+    l -= c;
+    if(used == size){
+      m_error_t res = handoff();
+      if(res != ERR_NO_ERROR){
+	*s -= l;
+	return res;
+      }
+    }
+  }
+  return failed;
+}
+
+m_error_t UringDump::flush(void){
+  if(fd < 0) return ERR_PARAM_NULL;
+  handoff();
+  while(inflight && !broken)
+    if(reap() != ERR_NO_ERROR) break;
+  return failed;
+}
+
+m_error_t UringDump::close(void){
+  if(fd < 0) return ERR_PARAM_NULL;
+  m_error_t res = flush();
+  if(queue){
+    delete queue;
+    queue = NULL;
+  }
+  if(ownFd && ::close(fd) && (res == ERR_NO_ERROR)) res = ERR_FILE_CLOSE;
+  fd = -1;
+  return res;
+}
+
+const char * UringDump::VersionTag(void) const{
+  return _VERSION_;
+}
+
+/*
+ * UringReader
+ *
+ */
+
+// read synchronously up to the end of the file
+static m_error_t readOut(int fd, unsigned char *d, size_t l, off_t at, size_t& n){
+  n = 0;
+  while(l){
+    ssize_t r = ::pread(fd, d, l, at);
+    if(r < 0){
+      if(errno == EINTR) continue;
+      return ERR_FILE_READ;
+    }
+    if(!r) break;
+    d += r;
+    l -= r;
+    at += r;
+    n += r;
+  }
+  return ERR_NO_ERROR;
+}
+
+/*! \param name File to open
+    \param depth Requests in flight at most
+    \param ch Octets per request
+    \param uring Use io_uring, if available
+*/
+UringReader::UringReader(const char *name, size_t depth, size_t ch, bool uring){
+  int f = (name)? ::open(name, O_RDONLY) : -1;
+  init(f, true, depth, ch, uring);
+}
+
+UringReader::UringReader(int f, size_t depth, size_t ch, bool uring){
+  init(f, false, depth, ch, uring);
+}
+
+UringReader::~UringReader(){
+  if(fd >= 0) close();
+}
+
+void UringReader::init(int f, bool own, size_t depth, size_t ch, bool uring){
+  fd = f;
+  ownFd = own;
+  queue = NULL;
+  chunk = (ch)? ch : (size_t)DEFAULT_CHUNK;
+  if(chunk > MAX_REQUEST) chunk = MAX_REQUEST;
+  if((fd < 0) || !uring) return;
+  queue = new UringQueue((unsigned int)((depth)? depth : 1));
+  if(queue && !queue->valid()){
+    delete queue;
+    queue = NULL;
+  }
+}
+
+m_error_t UringReader::size(size_t& s) const {
+  if(fd < 0) return ERR_PARAM_NULL;
+  struct stat st;
+  if(::fstat(fd,&st) < 0) return ERR_FILE_STAT;
+  if(S_ISDIR(st.st_mode)) return ERR_FILE_ISDIR;
+  s = (size_t)st.st_size;
+  return ERR_NO_ERROR;
+}
+
+/*! \param d Buffer of at least l octets
+    \param l Octets to read
+    \param at File offset
+    \param got Receives the octets read
+    \return Error code as defined in mgrError.h
+
+    The region is split into requests of the chunk size. If got
+    is NULL, reaching the end of the file before l octets is an
+    error.
+*/
+m_error_t UringReader::read(void *d, size_t l, off_t at, size_t *got){
+  if((fd < 0) || !d) return ERR_PARAM_NULL;
+  unsigned char *p = static_cast<unsigned char *>(d);
+  size_t total = 0;
+  m_error_t res = ERR_NO_ERROR;
+  if(!queue){
+    res = readOut(fd, p, l, at, total);
+  } else {
+    const size_t nc = l / chunk + ((l % chunk)? 1 : 0);
+    std::vector<size_t> done(nc, 0);
+    size_t next = 0, inflight = 0;
+    for(;;){
+      while((res == ERR_NO_ERROR) && (next < nc) && (inflight < queue->entries())){
+	const size_t o = next * chunk;
+	const size_t c = (l - o < chunk)? l - o : chunk;
+	if(queue->submit(UringQueue::READ, fd, p + o, c, at + o, next) == ERR_NO_ERROR)
+	  inflight++;
+	else res = readOut(fd, p + o, c, at + o, done[next]);
+	next++;
+      }
+      if(!inflight) break;
+      unsigned long long k;
+      long r;
+      m_error_t e = queue->complete(k, r);
+      if(e != ERR_NO_ERROR){
+	// d must not be released with reads in flight
+	close();
+	return e;
+      }
+      inflight--;
+      const size_t o = k * chunk;
+      const size_t c = (l - o < chunk)? l - o : chunk;
+      if(r < 0){
+	if(res == ERR_NO_ERROR) res = ERR_FILE_READ;
+	continue;
+      }
+      done[k] = r;
+      if(r && ((size_t)r < c)){
+	size_t m;
+	e = readOut(fd, p + o + r, c - r, at + o + r, m);
+	done[k] += m;
+	if((e != ERR_NO_ERROR) && (res == ERR_NO_ERROR)) res = e;
+      }
+    }
+    for(size_t i = 0; i < nc; i++) total += done[i];
+  }
+  if(got) *got = total;
+  else if((res == ERR_NO_ERROR) && (total < l)) res = ERR_FILE_READ;
+  return res;
+}
+
+m_error_t UringReader::close(void){
+  if(fd < 0) return ERR_PARAM_NULL;
+  if(queue){
+    delete queue;
+    queue = NULL;
+  }
+  m_error_t res = ERR_NO_ERROR;
+  if(ownFd && ::close(fd)) res = ERR_FILE_CLOSE;
+  fd = -1;
+  return res;
+}
+
+
+/*
+ * The testsuite
+ *
+ ********************************************
+ *
+ */
+
+#ifdef TEST
+
+#include <stdio.h>
+
+int main(int argc, char *argv[]){
+  m_error_t res;
+  size_t tests, errors;
+
+  tests = errors = 0;
+
+  const size_t n = 3000017;
+  unsigned char *pat = (unsigned char *)malloc(n);
+  unsigned char *back = (unsigned char *)malloc(n + 100);
+  for(size_t i = 0; i < n; i++) pat[i] = (unsigned char)(i * 251 + (i >> 11));
+  char name[64];
+  snprintf(name,sizeof(name),"/tmp/test-UringDump-%d",(int)getpid());
+
+  for(int k = 0; k < 2; k++){
+    const bool uring = !k;
+    printf("Test %d: UringDump::write() %s\n",++tests,(uring)? "io_uring" : "pwrite");
+    {
+      UringDump d(name,3,65536,uring);
+      printf("??? io_uring used: %d\n",(int)d.uring());
+      res = (d.valid())? ERR_NO_ERROR : ERR_FILE_OPEN;
+      size_t at = 0, j = 0;
+      while((at < n) && (res == ERR_NO_ERROR)){
+	size_t s = 1 + (j++ * 104729) % 200003;
+	if(s > n - at) s = n - at;
+	res = d.write(pat + at, &s);
+	at += s;
+	if((j == 5) && (res == ERR_NO_ERROR)) res = d.flush();
+      }
+      if(res == ERR_NO_ERROR) res = d.close();
+    }
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: UringDump::write() failed 0x%.4x\n",(int)res);
+    } else {
+      puts("+++ UringDump::write() finished OK!");
+    }
+
+    printf("Test %d: UringReader::read() %s\n",++tests,(uring)? "io_uring" : "pread");
+    do {
+      if(res != ERR_NO_ERROR) break;
+      UringReader rd(name,4,100000,uring);
+      size_t s = 0, got = 0;
+      res = rd.size(s);
+      if(res != ERR_NO_ERROR) break;
+      if(s != n){
+	res = ERR_INT_DATA;
+	break;
+      }
+      res = rd.read(back,n,0);
+      if((res != ERR_NO_ERROR) || memcmp(back,pat,n)){
+	if(res == ERR_NO_ERROR) res = ERR_INT_DATA;
+	break;
+      }
+      // beyond the end of the file
+      res = rd.read(back,n,1000,&got);
+      if((res != ERR_NO_ERROR) || (got != n - 1000) || memcmp(back,pat + 1000,got) ||
+	 (rd.read(back,n,1000) != ERR_FILE_READ)){
+	if(res == ERR_NO_ERROR) res = ERR_INT_DATA;
+	break;
+      }
+    } while(0);
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: UringReader::read() failed 0x%.4x\n",(int)res);
+    } else {
+      puts("+++ UringReader::read() finished OK!");
+    }
+  }
+  unlink(name);
+  free(pat);
+  free(back);
+
+  UringDump d(-1);
+  printf("\n%d tests completed with %d errors.\n",tests,errors);
+  printf("Used version: %s\n",d.VersionTag());
+
+  return 0;
+}
+
+#endif // TEST
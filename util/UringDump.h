@@ -0,0 +1,213 @@
+/*
+ *
+ * Universal Output Stream - File I/O by Linux io_uring
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *  UringQueue - minimal io_uring submission and completion queue
+ *  UringDump - StreamDump keeping several writes in flight
+ *  UringReader - file reader keeping several reads in flight
+ *
+ * This defines the values:
+ *
+ */
+
+#ifndef _UTIL_URINGDUMP_H_
+# define _UTIL_URINGDUMP_H_
+
+#include <StreamDump.h>
+#include <sys/types.h>
+#include <vector>
+
+/*! \file UringDump.h
+    \brief File I/O by Linux io_uring
+
+    stdio has a single synchronous request outstanding. UringDump
+    and UringReader split the data into large requests and keep
+    several of them in flight by io_uring. The ring is set up by
+    raw system calls, so liburing is not required. If the kernel
+    or the platform does not support io_uring, both fall back to
+    pwrite() and pread().
+
+    \author Dr. Lars Hanke
+    \date 2006-2008
+*/
+
+namespace mgr {
+
+  /*! \class UringQueue
+      \brief Minimal io_uring submission and completion queue
+
+      Requests are submitted one at a time and completions are
+      identified by the data passed to submit(). The caller must
+      not have more requests in flight than entries().
+
+      If a queued request cannot be submitted, the ring is closed,
+      so that the request is never submitted later. valid() returns
+      false afterwards.
+  */
+class UringQueue {
+public:
+  //! Operations
+  enum Ops {
+    READ,
+    WRITE,
+    WRITE_FIXED              //!< Write from a registered buffer
+  };
+
+protected:
+  int ring;                  //!< io_uring descriptor, -1 if unsupported
+  unsigned int Entries;
+  void *sqMap, *cqMap, *sqeMap;
+  size_t sqLen, cqLen, sqeLen;
+  unsigned int *sqHead, *sqTail, *sqMask, *sqArray;
+  unsigned int *cqHead, *cqTail, *cqMask;
+  void *cqes;
+
+  void release(void);
+
+private:
+  UringQueue(const UringQueue&);
+  UringQueue& operator=(const UringQueue&);
+
+public:
+  UringQueue(unsigned int n);
+  ~UringQueue() { release(); }
+
+  //! Check, if io_uring is available
+  bool valid(void) const { return (ring >= 0); }
+  unsigned int entries(void) const { return Entries; }
+
+  //! Register buffers of l octets for WRITE_FIXED
+  m_error_t registerBuffers(unsigned char * const *b, size_t n, size_t l);
+  //! Queue and submit a request
+  m_error_t submit(Ops op, int fd, const void *b, size_t l, off_t at,
+		   unsigned long long data, unsigned int index = 0);
+  //! Wait for a completion
+  m_error_t complete(unsigned long long& data, long& res);
+};
+
+  /*! \class UringDump
+      \brief StreamDump keeping several writes in flight
+
+      The data written is copied into a ring of registered
+      buffers. A full buffer is submitted at once, and write() only
+      waits, when the buffer to fill next is still in flight. Short
+      writes are completed by pwrite().
+
+      If the ring fails, the buffers in flight may still be owned
+      by the kernel. The ring is closed, these buffers are never
+      reused, and write() does not accept further data.
+  */
+class UringDump : public StreamDump {
+public:
+  enum {
+    DEFAULT_BUFFERS = 8,
+    DEFAULT_SIZE = 1 << 20,  //!< Default octets per buffer
+    ALIGN = 4096             //!< Alignment of the buffers
+  };
+
+protected:
+  int fd;                    //!< File descriptor, -1 if closed
+  bool ownFd;                //!< fd is closed by close()
+  bool seekable;             //!< fd supports pwrite()
+  UringQueue *queue;         //!< NULL for pwrite()
+  bool fixed;                //!< Buffers are registered
+  m_error_t failed;          //!< First error of a write, sticky
+  bool broken;               //!< The ring failed with buffers in flight
+
+  size_t size;               //!< Octets per buffer
+  std::vector<unsigned char *> bufs;
+  std::vector<size_t> lens;  //!< Octets of buffers in flight
+  std::vector<off_t> offs;   //!< File offsets of buffers in flight
+  std::vector<bool> busy;    //!< Buffer is in flight
+  size_t inflight;
+  size_t cur;                //!< Buffer being filled
+  size_t used;               //!< Octets in the fill buffer
+  off_t fillAt;              //!< File offset of the fill buffer
+
+  void init(int f, bool own, size_t n, size_t s, bool uring);
+  m_error_t writeOut(const unsigned char *d, size_t l, off_t at);
+  m_error_t reap(void);
+  m_error_t handoff(void);
+  m_error_t abandon(m_error_t e);
+
+private:
+  UringDump(const UringDump&);
+  UringDump& operator=(const UringDump&);
+
+public:
+  //! Create or truncate the file name
+  UringDump(const char *name, size_t n = DEFAULT_BUFFERS,
+	    size_t s = DEFAULT_SIZE, bool uring = true);
+  //! Write to an open file descriptor, which is not closed
+  UringDump(int f, size_t n = DEFAULT_BUFFERS,
+	    size_t s = DEFAULT_SIZE, bool uring = true);
+  //! DTOR closing file
+  virtual ~UringDump();
+
+  //! Copy into the buffers
+  virtual m_error_t write(const void *data, size_t *s);
+  virtual m_error_t putchar(const void *data){
+    size_t s = 1;
+    return write(data, &s);
+  }
+  //! Wait, until everything written has been passed to the OS
+  virtual m_error_t flush(void);
+  //! Flush and close the file
+  virtual m_error_t close(void);
+  virtual bool valid(void) const { return (fd >= 0); }
+  //! Check, if io_uring is used
+  bool uring(void) const { return (queue != NULL); }
+
+  //! Version string
+  const char * VersionTag(void) const;
+};
+
+  /*! \class UringReader
+      \brief File reader keeping several reads in flight
+  */
+class UringReader {
+public:
+  enum {
+    DEFAULT_DEPTH = 8,
+    DEFAULT_CHUNK = 1 << 20  //!< Default octets per request
+  };
+
+protected:
+  int fd;                    //!< File descriptor, -1 if closed
+  bool ownFd;                //!< fd is closed by close()
+  UringQueue *queue;         //!< NULL for pread()
+  size_t chunk;
+
+  void init(int f, bool own, size_t depth, size_t ch, bool uring);
+
+private:
+  UringReader(const UringReader&);
+  UringReader& operator=(const UringReader&);
+
+public:
+  //! Open the file name read-only
+  UringReader(const char *name, size_t depth = DEFAULT_DEPTH,
+	      size_t ch = DEFAULT_CHUNK, bool uring = true);
+  //! Read from an open file descriptor, which is not closed
+  UringReader(int f, size_t depth = DEFAULT_DEPTH,
+	      size_t ch = DEFAULT_CHUNK, bool uring = true);
+  ~UringReader();
+
+  bool valid(void) const { return (fd >= 0); }
+  bool uring(void) const { return (queue != NULL); }
+  //! Size of the file
+  m_error_t size(size_t& s) const;
+  //! Read l octets at offset at into d
+  m_error_t read(void *d, size_t l, off_t at, size_t *got = NULL);
+  m_error_t close(void);
+};
+
+}; // namespace mgr
+
+#endif // _UTIL_URINGDUMP_H_
@@ -60,6 +60,39 @@ namespace meta {
   template< ssize_t I > struct Number {
     enum{ VALUE = I };
   };
+
+  // end marker of type lists
+  struct NullType {};
+
+  // type list of HEAD followed by the list TAIL
+  template< typename H, typename T > struct TypeList {
+    typedef H HEAD;
+    typedef T TAIL;
+  };
+
+  // type list from up to 16 types
+  template< typename T1 = NullType, typename T2 = NullType, typename T3 = NullType,
+	    typename T4 = NullType, typename T5 = NullType, typename T6 = NullType,
+	    typename T7 = NullType, typename T8 = NullType, typename T9 = NullType,
+	    typename T10 = NullType, typename T11 = NullType, typename T12 = NullType,
+	    typename T13 = NullType, typename T14 = NullType, typename T15 = NullType,
+	    typename T16 = NullType >
+  struct MakeTypeList {
+    typedef TypeList< T1, typename MakeTypeList< T2, T3, T4, T5, T6, T7, T8, T9, T10,
+						 T11, T12, T13, T14, T15, T16 >::RESULT > RESULT;
+  };
+  template<> struct MakeTypeList<> {
+    typedef NullType RESULT;
+  };
+
+  // number of types in a type list
+  template< typename L > struct Length;
+  template<> struct Length< NullType > {
+    enum{ VALUE = 0 };
+  };
+  template< typename H, typename T > struct Length< TypeList< H, T > > {
+    enum{ VALUE = 1 + Length< T >::VALUE };
+  };
 };
 
 #endif // _UTIL_MGR_META_H_
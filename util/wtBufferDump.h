@@ -26,6 +26,20 @@ class BufferDump : public StreamDump {
 protected:
   wtBuffer<char> buf;
 
+  //! Format directly behind the contents
+  virtual char *reserve(size_t& l){
+    const size_t old = buf.size();
+    if(buf.trunc(old + l, true) != ERR_NO_ERROR) return NULL;
+    l = buf.alloc_size() - old;
+    buf.accept(old);
+    return buf.writePtr() + old;
+  }
+  //! The text is already in place
+  virtual m_error_t commit(char *p, size_t l){
+    buf.accept(buf.size() + l);
+    return ERR_NO_ERROR;
+  }
+
 public:
   BufferDump(size_t chunk = 1024){
     buf.Chunk(chunk);
@@ -0,0 +1,531 @@
+/*
+ *
+ * Universal Output Stream - Pipeline of filter stages
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *  PipeStage - pass-through stage measuring the throughput
+ *  TeeStage - copy the stream to two StreamDump
+ *  ChecksumStage - CRC-32 of the stream
+ *  DeflateStage - zlib compression
+ *  RateStage - limit the octets per second
+ *  FrameStage - cut the stream into length prefixed blocks
+ *
+ * This defines the values:
+ *
+ */
+
+#include "StreamPipe.h"
+#include "StreamPipe.tag"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#ifdef XDR_HAVE_ZLIB
+# include <zlib.h>
+#endif
+
+using namespace mgr;
+
+static size_t iovSize(const struct iovec *v, int n){
+  size_t l = 0;
+  for(int i = 0; i < n; i++) l += v[i].iov_len;
+  return l;
+}
+
+/*
+ * PipeStage
+ *
+ */
+
+PipeStage::PipeStage(StreamDump *o) : out(o), inOctets(0), outOctets(0),
+				      started(-1.0), last(-1.0) {}
+
+double PipeStage::now(void){
+  struct timespec t;
+  ::clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+double PipeStage::rate(void) const {
+  const double t = seconds();
+  return (t > 0)? inOctets / t : 0.0;
+}
+
+m_error_t PipeStage::write(const void *data, size_t *s){
+  if(!out || !data || !s) return ERR_PARAM_NULL;
+  begin();
+  m_error_t err = out->write(data, s);
+  done(*s, *s);
+  return err;
+}
+
+m_error_t PipeStage::writev(const struct iovec *v, int n){
+  if(!out || (!v && n)) return ERR_PARAM_NULL;
+  const size_t l = iovSize(v, n);
+  begin();
+  m_error_t err = out->writev(v, n);
+  done(l, l);
+  return err;
+}
+
+m_error_t PipeStage::flush(void){
+  if(!out) return ERR_PARAM_NULL;
+  return out->flush();
+}
+
+m_error_t PipeStage::close(void){
+  if(!out) return ERR_PARAM_NULL;
+  return out->close();
+}
+
+const char * PipeStage::VersionTag(void) const {
+  return _VERSION_;
+}
+
+/*
+ * TeeStage
+ *
+ */
+
+m_error_t TeeStage::write(const void *data, size_t *s){
+  if(!out || !second || !data || !s) return ERR_PARAM_NULL;
+  size_t t = *s;
+  begin();
+  m_error_t err = out->write(data, s);
+  m_error_t err2 = second->write(data, &t);
+  done(*s, *s);
+  return (err != ERR_NO_ERROR)? err : err2;
+}
+
+m_error_t TeeStage::writev(const struct iovec *v, int n){
+  if(!out || !second || (!v && n)) return ERR_PARAM_NULL;
+  const size_t l = iovSize(v, n);
+  begin();
+  m_error_t err = out->writev(v, n);
+  m_error_t err2 = second->writev(v, n);
+  done(l, l);
+  return (err != ERR_NO_ERROR)? err : err2;
+}
+
+m_error_t TeeStage::flush(void){
+  if(!out || !second) return ERR_PARAM_NULL;
+  m_error_t err = out->flush();
+  m_error_t err2 = second->flush();
+  return (err != ERR_NO_ERROR)? err : err2;
+}
+
+m_error_t TeeStage::close(void){
+  if(!out || !second) return ERR_PARAM_NULL;
+  m_error_t err = out->close();
+  m_error_t err2 = second->close();
+  return (err != ERR_NO_ERROR)? err : err2;
+}
+
+/*
+ * ChecksumStage
+ *
+ */
+
+static struct CrcTable {
+  XDR::UInt t[256];
+
+  CrcTable(){
+    for(XDR::UInt n = 0; n < 256; n++){
+      XDR::UInt c = n;
+      for(int k = 0; k < 8; k++)
+	c = (c & 1)? 0xedb88320U ^ (c >> 1) : c >> 1;
+      t[n] = c;
+    }
+  }
+} crcTable;
+
+/*! \param c CRC-32 before complemented, i.e. 0xffffffff initially
+    \param d Data
+    \param l Octets of data
+    \return Updated CRC-32 before complemented
+*/
+XDR::UInt ChecksumStage::update(XDR::UInt c, const unsigned char *d, size_t l){
+  while(l--) c = crcTable.t[(c ^ *d++) & 0xff] ^ (c >> 8);
+  return c;
+}
+
+m_error_t ChecksumStage::write(const void *data, size_t *s){
+  if(!data || !s) return ERR_PARAM_NULL;
+  state = update(state, static_cast<const unsigned char *>(data), *s);
+  return PipeStage::write(data, s);
+}
+
+m_error_t ChecksumStage::writev(const struct iovec *v, int n){
+  if(!v && n) return ERR_PARAM_NULL;
+  for(int i = 0; i < n; i++)
+    state = update(state, static_cast<const unsigned char *>(v[i].iov_base),
+		   v[i].iov_len);
+  return PipeStage::writev(v, n);
+}
+
+/*
+ * DeflateStage
+ *
+ */
+
+DeflateStage::DeflateStage(StreamDump *o, int level) : PipeStage(o), zs(NULL),
+						       zbuf(NULL),
+						       failed(ERR_NO_ERROR) {
+#ifdef XDR_HAVE_ZLIB
+  z_stream *z = static_cast<z_stream *>(::calloc(1, sizeof(z_stream)));
+  zbuf = static_cast<unsigned char *>(::malloc(CHUNK));
+  if(!z || !zbuf || (::deflateInit(z, level) != Z_OK)){
+    ::free(z);
+    ::free(zbuf);
+    zbuf = NULL;
+    return;
+  }
+  zs = z;
+#endif
+}
+
+DeflateStage::~DeflateStage(){
+#ifdef XDR_HAVE_ZLIB
+  if(zs){
+    ::deflateEnd(static_cast<z_stream *>(zs));
+    ::free(zs);
+  }
+#endif
+  ::free(zbuf);
+}
+
+// compress l octets and pass on all output available
+m_error_t DeflateStage::deflateOut(const void *data, size_t l, int mode){
+#ifdef XDR_HAVE_ZLIB
+  z_stream *z = static_cast<z_stream *>(zs);
+  z->next_in = (Bytef *)data;
+  z->avail_in = l;
+  do {
+    z->next_out = zbuf;
+    z->avail_out = CHUNK;
+    if(::deflate(z, mode) == Z_STREAM_ERROR) return ERR_INT_STATE;
+    size_t have = CHUNK - z->avail_out;
+    if(have){
+      m_error_t err = out->write(zbuf, &have);
+      outOctets += have;
+      if(err != ERR_NO_ERROR) return err;
+    }
+  } while(!z->avail_out);
+  return ERR_NO_ERROR;
+#else
+  return ERR_INT_IMP;
+#endif
+}
+
+m_error_t DeflateStage::write(const void *data, size_t *s){
+  if(!zs || !out || !data || !s) return ERR_PARAM_NULL;
+  if(failed != ERR_NO_ERROR) return failed;
+  begin();
+#ifdef XDR_HAVE_ZLIB
+  failed = deflateOut(data, *s, Z_NO_FLUSH);
+#endif
+  done(*s, 0);
+  return failed;
+}
+
+m_error_t DeflateStage::flush(void){
+  if(!zs || !out) return ERR_PARAM_NULL;
+#ifdef XDR_HAVE_ZLIB
+  if(failed == ERR_NO_ERROR) failed = deflateOut(NULL, 0, Z_SYNC_FLUSH);
+#endif
+  if(failed != ERR_NO_ERROR) return failed;
+  return out->flush();
+}
+
+m_error_t DeflateStage::close(void){
+  if(!zs || !out) return ERR_PARAM_NULL;
+  m_error_t err = failed;
+#ifdef XDR_HAVE_ZLIB
+  if(err == ERR_NO_ERROR) err = deflateOut(NULL, 0, Z_FINISH);
+  ::deflateEnd(static_cast<z_stream *>(zs));
+#endif
+  ::free(zs);
+  zs = NULL;
+  m_error_t res = out->close();
+  return (err != ERR_NO_ERROR)? err : res;
+}
+
+/*
+ * RateStage
+ *
+ */
+
+// sleep, until the octets passed on are due
+void RateStage::pace(void){
+  if((limit <= 0) || (started < 0)) return;
+  double d = started + outOctets / limit - now();
+  if(d <= 0) return;
+  struct timespec t;
+  t.tv_sec = (time_t)d;
+  t.tv_nsec = (long)((d - t.tv_sec) * 1e9);
+  while(::nanosleep(&t, &t) && (errno == EINTR));
+  last = now();
+}
+
+m_error_t RateStage::write(const void *data, size_t *s){
+  m_error_t err = PipeStage::write(data, s);
+  pace();
+  return err;
+}
+
+m_error_t RateStage::writev(const struct iovec *v, int n){
+  m_error_t err = PipeStage::writev(v, n);
+  pace();
+  return err;
+}
+
+/*
+ * FrameStage
+ *
+ */
+
+/*! \param o Next stage
+    \param s Octets per block
+
+    If no buffer can be allocated, valid() returns false.
+*/
+FrameStage::FrameStage(StreamDump *o, size_t s) : PipeStage(o), size(s), used(0) {
+  buf = (s && (s <= 0xffffffffUL))? static_cast<unsigned char *>(::malloc(s)) : NULL;
+}
+
+FrameStage::~FrameStage(){
+  ::free(buf);
+}
+
+// pass on a single block
+m_error_t FrameStage::frame(const unsigned char *d, size_t l){
+  unsigned char hdr[4];
+  struct iovec v[2];
+  XDR::xdrWrite<XDR::UInt>(hdr, (XDR::UInt)l);
+  v[0].iov_base = hdr;
+  v[0].iov_len = sizeof(hdr);
+  v[1].iov_base = const_cast<unsigned char *>(d);
+  v[1].iov_len = l;
+  outOctets += sizeof(hdr) + l;
+  return out->writev(v, (l)? 2 : 1);
+}
+
+m_error_t FrameStage::write(const void *data, size_t *s){
+  if(!buf || !out || !data || !s) return ERR_PARAM_NULL;
+  const unsigned char *p = static_cast<const unsigned char *>(data);
+  size_t l = *s;
+  m_error_t err = ERR_NO_ERROR;
+  begin();
+  if(used){
+    size_t c = size - used;
+    if(c > l) c = l;
+    memcpy(buf + used, p, c);
+    used += c;
+    p += c;
+    l -= c;
+    if(used == size){
+      err = frame(buf, size);
+      used = 0;
+    }
+  }
+  // whole blocks are passed on from the region of the caller
+  while((err == ERR_NO_ERROR) && (l >= size)){
+    unsigned char hdr[BATCH][4];
+    struct iovec v[2 * BATCH];
+    int k = 0;
+    while((k < BATCH) && (l >= size)){
+      XDR::xdrWrite<XDR::UInt>(hdr[k], (XDR::UInt)size);
+      v[2 * k].iov_base = hdr[k];
+      v[2 * k].iov_len = sizeof(hdr[k]);
+      v[2 * k + 1].iov_base = const_cast<unsigned char *>(p);
+      v[2 * k + 1].iov_len = size;
+      p += size;
+      l -= size;
+      k++;
+    }
+    outOctets += k * (sizeof(hdr[0]) + size);
+    err = out->writev(v, 2 * k);
+  }
+  if((err == ERR_NO_ERROR) && l){
+    memcpy(buf, p, l);
+    used = l;
+  }
+  done(*s, 0);
+  return err;
+}
+
+m_error_t FrameStage::flush(void){
+  if(!buf || !out) return ERR_PARAM_NULL;
+  if(used){
+    m_error_t err = frame(buf, used);
+    used = 0;
+    if(err != ERR_NO_ERROR) return err;
+  }
+  return out->flush();
+}
+
+m_error_t FrameStage::close(void){
+  if(!buf || !out) return ERR_PARAM_NULL;
+  m_error_t err = ERR_NO_ERROR;
+  if(used) err = frame(buf, used);
+  used = 0;
+  if(err == ERR_NO_ERROR) err = frame(NULL, 0);
+  ::free(buf);
+  buf = NULL;
+  m_error_t res = out->close();
+  return (err != ERR_NO_ERROR)? err : res;
+}
+
+
+/*
+ * The testsuite
+ *
+ ********************************************
+ *
+ */
+
+#ifdef TEST
+
+#include <stdio.h>
+#include <wtBufferDump.h>
+
+// BufferDump::close() discards the data
+class KeepDump : public BufferDump {
+public:
+  virtual m_error_t close(void) { return ERR_NO_ERROR; }
+};
+
+// remove the framing and check the block sizes
+static m_error_t unframe(const wtBuffer<char>& b, size_t size, wtBuffer<char>& d){
+  const unsigned char *p = (const unsigned char *)b.readPtr();
+  size_t l = b.byte_size();
+  for(;;){
+    if(l < 4) return ERR_PARS_STX;
+    size_t n = XDR::xdrRead<XDR::UInt>(p);
+    p += 4;
+    l -= 4;
+    if(!n) break;
+    if((n > size) || (n > l)) return ERR_PARS_STX;
+    m_error_t res = d.append((const char *)p, n);
+    if(res != ERR_NO_ERROR) return res;
+    p += n;
+    l -= n;
+  }
+  return (l)? ERR_PARS_STX : ERR_NO_ERROR;
+}
+
+int main(int argc, char *argv[]){
+  m_error_t res;
+  size_t tests, errors;
+
+  tests = errors = 0;
+
+  const size_t n = 300007;
+  unsigned char *pat = (unsigned char *)malloc(n);
+  for(size_t i = 0; i < n; i++) pat[i] = (unsigned char)((i / 97) ^ (i % 13));
+
+  printf("Test %d: CRC-32\n",++tests);
+  {
+    BufferDump sink;
+    ChecksumStage crc(&sink);
+    size_t s = 9;
+    res = crc.write("123456789",&s);
+    if((res == ERR_NO_ERROR) && (crc.crc() != 0xcbf43926U)) res = ERR_INT_DATA;
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: CRC-32 0x%.8x failed 0x%.4x\n",crc.crc(),(int)res);
+    } else {
+      puts("+++ ChecksumStage::crc() finished OK!");
+    }
+  }
+
+#ifdef XDR_HAVE_ZLIB
+  printf("Test %d: Tee, checksum, compression and framing\n",++tests);
+  {
+    KeepDump copy, framed;
+    PipeStage meter(&framed);
+    FrameStage frame(&meter, 4096);
+    DeflateStage zip(&frame);
+    TeeStage tee(&copy, &zip);
+    ChecksumStage crc(&tee);
+    size_t at = 0, k = 0;
+    res = (crc.valid())? ERR_NO_ERROR : ERR_INT_IMP;
+    while((at < n) && (res == ERR_NO_ERROR)){
+      size_t s = 1 + (k++ * 7919) % 30011;
+      if(s > n - at) s = n - at;
+      if(k % 3){
+	res = crc.write(pat + at,&s);
+      } else {
+	// writev() passes the regions through the pipeline
+	struct iovec v[2];
+	v[0].iov_base = pat + at;
+	v[0].iov_len = s / 2;
+	v[1].iov_base = pat + at + s / 2;
+	v[1].iov_len = s - s / 2;
+	res = crc.writev(v,2);
+      }
+      at += s;
+      if((k == 7) && (res == ERR_NO_ERROR)) res = crc.flush();
+    }
+    // the statistics are kept after close()
+    if(res == ERR_NO_ERROR) res = crc.close();
+    if((res == ERR_NO_ERROR) &&
+       ((copy.get().byte_size() != n) || memcmp(copy.get().readPtr(),pat,n)))
+      res = ERR_INT_DATA;
+    if((res == ERR_NO_ERROR) &&
+       (crc.crc() != (ChecksumStage::update(0xffffffffU,pat,n) ^ 0xffffffffU)))
+      res = ERR_INT_DATA;
+    wtBuffer<char> z;
+    if(res == ERR_NO_ERROR) res = unframe(framed.get(),4096,z);
+    if(res == ERR_NO_ERROR){
+      uLongf ul = n;
+      unsigned char *u = (unsigned char *)malloc(n);
+      if((::uncompress(u,&ul,(const Bytef *)z.readPtr(),z.byte_size()) != Z_OK) ||
+	 (ul != n) || memcmp(u,pat,n))
+	res = ERR_INT_DATA;
+      free(u);
+    }
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: pipeline failed 0x%.4x\n",(int)res);
+    } else {
+      printf("??? %d octets compressed to %d, framed to %d\n",
+	     zip.octetsIn(),zip.octetsOut(),meter.octetsIn());
+      printf("??? %.0f octets per second\n",crc.rate());
+      puts("+++ StreamPipe finished OK!");
+    }
+  }
+#endif
+
+  printf("Test %d: Rate limit\n",++tests);
+  {
+    BufferDump sink;
+    RateStage rate(&sink, 1e6);
+    size_t s = 100000;
+    res = ERR_NO_ERROR;
+    for(int i = 0; (i < 3) && (res == ERR_NO_ERROR); i++) res = rate.write(pat,&s);
+    // the first block is due at once
+    if((res == ERR_NO_ERROR) && ((rate.seconds() < 0.29) || (rate.rate() > 1.05e6)))
+      res = ERR_INT_STATE;
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: %.3f seconds failed 0x%.4x\n",rate.seconds(),(int)res);
+    } else {
+      printf("+++ RateStage finished OK - %.3f seconds!\n",rate.seconds());
+    }
+  }
+  free(pat);
+
+  PipeStage d(NULL);
+  printf("\n%d tests completed with %d errors.\n",tests,errors);
+  printf("Used version: %s\n",d.VersionTag());
+
+  return 0;
+}
+
+#endif // TEST
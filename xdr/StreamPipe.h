@@ -0,0 +1,258 @@
+/*
+ *
+ * Universal Output Stream - Pipeline of filter stages
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *  PipeStage - pass-through stage measuring the throughput
+ *  TeeStage - copy the stream to two StreamDump
+ *  ChecksumStage - CRC-32 of the stream
+ *  DeflateStage - zlib compression
+ *  RateStage - limit the octets per second
+ *  FrameStage - cut the stream into length prefixed blocks
+ *
+ * This defines the values:
+ *
+ */
+
+#ifndef _XDR_STREAMPIPE_H_
+# define _XDR_STREAMPIPE_H_
+
+#include <StreamDump.h>
+#include <xdrOrder.h>
+#include <sys/types.h>
+
+/*! \file StreamPipe.h
+    \brief Pipeline of StreamDump filter stages
+
+    Each stage is a StreamDump writing to the next one, so stages
+    are chained like HexDump:
+
+    \code
+    FdDump file("run.z");
+    FrameStage frame(&file, 65536);
+    DeflateStage zip(&frame);
+    ChecksumStage crc(&zip);
+    tree.write(crc);
+    crc.close();
+    \endcode
+
+    Stages which do not change the data pass the region of the
+    caller on, so the data is not copied between stages. writev()
+    is forwarded as a whole. FrameStage sends its headers together
+    with the regions of the caller by writev() and only copies a
+    trailing partial block. DeflateStage necessarily produces new
+    data in its own buffer.
+
+    Stages do not own the StreamDump they write to. close() ends
+    the stage and closes the rest of the pipeline.
+
+    \author Dr. Lars Hanke
+    \date 2006-2008
+*/
+
+namespace mgr {
+
+  /*! \class PipeStage
+      \brief Pass-through stage measuring the throughput
+
+      PipeStage forwards everything unchanged. It is the base of
+      all stages and counts the octets received and passed on.
+      The time is taken from the first data received to the end
+      of the last call, so rate() includes the time spent in the
+      stages following.
+  */
+class PipeStage : public StreamDump {
+protected:
+  StreamDump *out;           //!< Next stage
+  size_t inOctets;           //!< Octets received
+  size_t outOctets;          //!< Octets passed on
+  double started;            //!< Time of the first data, <0 if none
+  double last;               //!< Time of the end of the last call
+
+  static double now(void);
+  //! Start the clock on the first data
+  inline void begin(void){
+    if(started < 0) started = last = now();
+  }
+  //! Account for a call
+  inline void done(size_t i, size_t o){
+    inOctets += i;
+    outOctets += o;
+    last = now();
+  }
+
+private:
+  PipeStage(const PipeStage&);
+  PipeStage& operator=(const PipeStage&);
+
+public:
+  PipeStage(StreamDump *o);
+  virtual ~PipeStage() {}
+
+  virtual m_error_t write(const void *data, size_t *s);
+  virtual m_error_t writev(const struct iovec *v, int n);
+  virtual m_error_t putchar(const void *data){
+    size_t s = 1;
+    return write(data, &s);
+  }
+  virtual m_error_t flush(void);
+  virtual m_error_t close(void);
+  virtual bool valid(void) const { return (out && out->valid()); }
+
+  //! Octets received
+  size_t octetsIn(void) const { return inOctets; }
+  //! Octets passed on
+  size_t octetsOut(void) const { return outOctets; }
+  //! Seconds from the first data to the end of the last call
+  double seconds(void) const {
+    return (started < 0)? 0.0 : last - started;
+  }
+  //! Octets received per second
+  double rate(void) const;
+
+  //! Version string
+  const char * VersionTag(void) const;
+};
+
+  /*! \class TeeStage
+      \brief Copy the stream to two StreamDump
+
+      Both get the region of the caller. The first error is
+      returned, but the second StreamDump is written anyway.
+  */
+class TeeStage : public PipeStage {
+protected:
+  StreamDump *second;
+
+public:
+  TeeStage(StreamDump *o, StreamDump *t) : PipeStage(o), second(t) {}
+
+  virtual m_error_t write(const void *data, size_t *s);
+  virtual m_error_t writev(const struct iovec *v, int n);
+  virtual m_error_t flush(void);
+  virtual m_error_t close(void);
+  virtual bool valid(void) const {
+    return (PipeStage::valid() && second && second->valid());
+  }
+};
+
+  /*! \class ChecksumStage
+      \brief CRC-32 of the stream
+
+      The CRC is the one of zlib, gzip and IEEE 802.3.
+  */
+class ChecksumStage : public PipeStage {
+protected:
+  XDR::UInt state;
+
+public:
+  ChecksumStage(StreamDump *o) : PipeStage(o), state(0xffffffffUL) {}
+
+  virtual m_error_t write(const void *data, size_t *s);
+  virtual m_error_t writev(const struct iovec *v, int n);
+
+  //! CRC-32 of the octets received
+  XDR::UInt crc(void) const { return state ^ 0xffffffffUL; }
+  //! Restart the CRC
+  void reset(void) { state = 0xffffffffUL; }
+
+  //! Update a CRC-32 by l octets
+  static XDR::UInt update(XDR::UInt c, const unsigned char *d, size_t l);
+};
+
+  /*! \class DeflateStage
+      \brief zlib compression
+
+      flush() ends the compressed data received so far on an
+      octet boundary by Z_SYNC_FLUSH. close() finishes the zlib
+      stream. If zlib was not found by configure, valid() returns
+      false.
+  */
+class DeflateStage : public PipeStage {
+public:
+  enum {
+    CHUNK = 65536            //!< Octets of compressed data passed on at once
+  };
+
+protected:
+  void *zs;                  //!< z_stream, NULL if unavailable
+  unsigned char *zbuf;
+  m_error_t failed;          //!< First error, sticky
+
+  m_error_t deflateOut(const void *data, size_t l, int mode);
+
+public:
+  //! Compress with level 0 to 9, -1 is the zlib default
+  DeflateStage(StreamDump *o, int level = -1);
+  virtual ~DeflateStage();
+
+  virtual m_error_t write(const void *data, size_t *s);
+  virtual m_error_t writev(const struct iovec *v, int n){
+    return StreamDump::writev(v, n);
+  }
+  virtual m_error_t flush(void);
+  virtual m_error_t close(void);
+  virtual bool valid(void) const { return (zs && PipeStage::valid()); }
+};
+
+  /*! \class RateStage
+      \brief Limit the octets per second
+
+      After passing data on, the stage sleeps until the average
+      rate since the first data does not exceed the limit.
+  */
+class RateStage : public PipeStage {
+protected:
+  double limit;              //!< Octets per second
+
+  void pace(void);
+
+public:
+  RateStage(StreamDump *o, double l) : PipeStage(o), limit(l) {}
+
+  virtual m_error_t write(const void *data, size_t *s);
+  virtual m_error_t writev(const struct iovec *v, int n);
+};
+
+  /*! \class FrameStage
+      \brief Cut the stream into length prefixed blocks
+
+      Each block is preceded by its length as XDR unsigned int.
+      All blocks but the last one of a flush() have size octets.
+      close() terminates the stream by a block of length 0.
+  */
+class FrameStage : public PipeStage {
+public:
+  enum {
+    BATCH = 32               //!< Blocks per writev()
+  };
+
+protected:
+  size_t size;               //!< Octets per block
+  unsigned char *buf;        //!< Partial block
+  size_t used;               //!< Octets in buf
+
+  m_error_t frame(const unsigned char *d, size_t l);
+
+public:
+  FrameStage(StreamDump *o, size_t s);
+  virtual ~FrameStage();
+
+  virtual m_error_t write(const void *data, size_t *s);
+  virtual m_error_t writev(const struct iovec *v, int n){
+    return StreamDump::writev(v, n);
+  }
+  //! Pass on the partial block
+  virtual m_error_t flush(void);
+  virtual m_error_t close(void);
+  virtual bool valid(void) const { return (buf && PipeStage::valid()); }
+};
+
+}; // namespace mgr
+
+#endif // _XDR_STREAMPIPE_H_
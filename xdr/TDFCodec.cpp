@@ -0,0 +1,354 @@
+/*
+ *
+ * Tagged Data File as an exchange standard for binary data,
+ * which draws on BER for tagging,
+ * on ASN.1 where applicable, and
+ * on RFC 1832 - Sun XDR for some storage formats
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *
+ * TDFCodec - filters and compression of array blocks
+ *
+ * This defines the values:
+ *
+ */
+
+#include "TDFCodec.h"
+#include "TDFCodec.tag"
+#include <stdlib.h>
+#include <string.h>
+#ifdef XDR_HAVE_ZLIB
+# include <zlib.h>
+#endif
+
+using namespace mgr;
+
+const char * TDFCodec::VersionTag(void) const {
+  return _VERSION_;
+}
+
+/*
+ * Element access in XDR byte order
+ *
+ */
+
+template< size_t W > static inline XDR::ULong load(const unsigned char *p){
+  XDR::ULong v = 0;
+  for(size_t k = 0; k < W; k++) v = (v << 8) | p[k];
+  return v;
+}
+
+template< size_t W > static inline void store(unsigned char *p, XDR::ULong v){
+  for(size_t k = W; k--; ){
+    p[k] = static_cast<unsigned char>(v);
+    v >>= 8;
+  }
+}
+
+// DELTA and SHUFFLE to n * W octets at t
+template< size_t W > static size_t filter(unsigned int enc, const unsigned char *s,
+					  size_t n, unsigned char *t){
+  XDR::ULong prev = 0;
+  for(size_t i = 0; i < n; i++, s += W){
+    const XDR::ULong u = load<W>(s);
+    const XDR::ULong v = (enc & TDFCodec::DELTA)? u - prev : u;
+    prev = u;
+    if(enc & TDFCodec::SHUFFLE){
+      for(size_t k = 0; k < W; k++)
+	t[k * n + i] = static_cast<unsigned char>(v >> (8 * (W - 1 - k)));
+    } else {
+      store<W>(t + i * W, v);
+    }
+  }
+  return n * W;
+}
+
+// DELTA and VARINT to t, returns the octets written
+template< size_t W > static size_t varint(unsigned int enc, const unsigned char *s,
+					  size_t n, unsigned char *t){
+  const int sh = 64 - 8 * W;
+  unsigned char *q = t;
+  XDR::ULong prev = 0;
+  for(size_t i = 0; i < n; i++, s += W){
+    const XDR::ULong u = load<W>(s);
+    const XDR::ULong v = (enc & TDFCodec::DELTA)? u - prev : u;
+    prev = u;
+    // sign extension of the W octets, then zig-zag
+    const XDR::Long sv = static_cast<XDR::Long>(v << sh) >> sh;
+    XDR::ULong z = (static_cast<XDR::ULong>(sv) << 1) ^ static_cast<XDR::ULong>(sv >> 63);
+    while(z >= 0x80){
+      *q++ = static_cast<unsigned char>(z | 0x80);
+      z >>= 7;
+    }
+    *q++ = static_cast<unsigned char>(z);
+  }
+  return q - t;
+}
+
+template< size_t W > static m_error_t unfilter(unsigned int enc, const unsigned char *t,
+					       size_t l, size_t n, unsigned char *d){
+  if(l != n * W) return ERR_PARS_STX;
+  XDR::ULong prev = 0;
+  for(size_t i = 0; i < n; i++, d += W){
+    XDR::ULong v;
+    if(enc & TDFCodec::SHUFFLE){
+      v = 0;
+      for(size_t k = 0; k < W; k++) v = (v << 8) | t[k * n + i];
+    } else {
+      v = load<W>(t + i * W);
+    }
+    // high octets of prev are dropped by store()
+    const XDR::ULong u = (enc & TDFCodec::DELTA)? prev + v : v;
+    prev = u;
+    store<W>(d, u);
+  }
+  return ERR_NO_ERROR;
+}
+
+template< size_t W > static m_error_t unvarint(unsigned int enc, const unsigned char *s,
+					       size_t l, size_t n, unsigned char *d){
+  const unsigned char *e = s + l;
+  XDR::ULong prev = 0;
+  for(size_t i = 0; i < n; i++, d += W){
+    XDR::ULong z = 0;
+    unsigned int shift = 0;
+    unsigned char c;
+    do {
+      if(s == e) return ERR_PARS_END;
+      if(shift >= 64) return ERR_PARS_STX;
+      c = *s++;
+      z |= static_cast<XDR::ULong>(c & 0x7f) << shift;
+      shift += 7;
+    } while(c & 0x80);
+    const XDR::ULong v = (z >> 1) ^ (~(z & 1) + 1);
+    const XDR::ULong u = (enc & TDFCodec::DELTA)? prev + v : v;
+    prev = u;
+    store<W>(d, u);
+  }
+  return (s == e)? ERR_NO_ERROR : ERR_PARS_STX;
+}
+
+template< size_t W > static size_t encodeW(unsigned int enc, const unsigned char *s,
+					   size_t n, unsigned char *t){
+  if(enc & TDFCodec::VARINT) return varint<W>(enc, s, n, t);
+  return filter<W>(enc, s, n, t);
+}
+
+template< size_t W > static m_error_t decodeW(unsigned int enc, const unsigned char *t,
+					      size_t l, size_t n, unsigned char *d){
+  if(enc & TDFCodec::VARINT) return unvarint<W>(enc, t, l, n, d);
+  return unfilter<W>(enc, t, l, n, d);
+}
+
+/*
+ * The TDFCodec Class
+ *
+ */
+
+/*! \param enc Combination of Encodings
+    \return Error code as defined in mgrError.h
+
+    ERR_PARAM_SEL is returned for unknown or contradicting steps,
+    ERR_INT_IMP for ZLIB, if zlib was not found by configure.
+*/
+m_error_t TDFCodec::check(unsigned int enc){
+  if(enc & ~(unsigned int)ALL) return ERR_PARAM_SEL;
+  if((enc & VARINT) && (enc & SHUFFLE)) return ERR_PARAM_SEL;
+#ifndef XDR_HAVE_ZLIB
+  if(enc & ZLIB) return ERR_INT_IMP;
+#endif
+  return ERR_NO_ERROR;
+}
+
+/*! \param enc Combination of Encodings
+    \param n Number of elements
+    \param w Size of an element in octets
+    \return Size of the buffer required by encode()
+*/
+size_t TDFCodec::bound(unsigned int enc, size_t n, size_t w){
+  // a varint carries 7 bits per octet
+  size_t b = (enc & VARINT)? n * ((8 * w + 6) / 7) : n * w;
+#ifdef XDR_HAVE_ZLIB
+  if(enc & ZLIB) b = compressBound(b);
+#endif
+  return b;
+}
+
+/*! \param enc Combination of Encodings
+    \param s n elements in XDR byte order
+    \param n Number of elements
+    \param w Size of an element in octets, 1, 2, 4, or 8
+    \param d Destination of at least bound(enc,n,w) octets
+    \param l Receives the size of the encoded block
+    \return Error code as defined in mgrError.h
+*/
+m_error_t TDFCodec::encode(unsigned int enc, const unsigned char *s, size_t n, size_t w,
+			   unsigned char *d, size_t& l){
+  m_error_t err = check(enc);
+  if(err != ERR_NO_ERROR) return err;
+  if(!s || !d) return ERR_PARAM_NULL;
+  if((w != 1) && (w != 2) && (w != 4) && (w != 8)) return ERR_PARAM_TYP;
+
+  unsigned char *t = d;
+  if(enc & ZLIB){
+    t = (unsigned char *)::malloc(bound(enc & ~ZLIB, n, w));
+    if(!t) return ERR_MEM_AVAIL;
+  }
+  switch(w){
+  case 1: l = encodeW<1>(enc, s, n, t); break;
+  case 2: l = encodeW<2>(enc, s, n, t); break;
+  case 4: l = encodeW<4>(enc, s, n, t); break;
+  default: l = encodeW<8>(enc, s, n, t); break;
+  }
+#ifdef XDR_HAVE_ZLIB
+  if(enc & ZLIB){
+    uLongf dl = compressBound(l);
+    // the filters do most of the work, so the fastest level is sufficient
+    int zerr = compress2(d, &dl, t, l, Z_BEST_SPEED);
+    ::free(t);
+    if(zerr != Z_OK) return (zerr == Z_MEM_ERROR)? ERR_MEM_AVAIL : ERR_INT_STATE;
+    l = dl;
+  }
+#endif
+  return ERR_NO_ERROR;
+}
+
+/*! \param enc Combination of Encodings
+    \param s Encoded block
+    \param l Size of the encoded block
+    \param n Number of elements
+    \param w Size of an element in octets, 1, 2, 4, or 8
+    \param d Destination of n * w octets in XDR byte order
+    \return Error code as defined in mgrError.h
+*/
+m_error_t TDFCodec::decode(unsigned int enc, const unsigned char *s, size_t l,
+			   size_t n, size_t w, unsigned char *d){
+  m_error_t err = check(enc);
+  if(err != ERR_NO_ERROR) return err;
+  if(!s || !d) return ERR_PARAM_NULL;
+  if((w != 1) && (w != 2) && (w != 4) && (w != 8)) return ERR_PARAM_TYP;
+
+  const unsigned char *t = s;
+  unsigned char *z = NULL;
+#ifdef XDR_HAVE_ZLIB
+  if(enc & ZLIB){
+    uLongf tl = bound(enc & ~ZLIB, n, w);
+    z = (unsigned char *)::malloc(tl ? tl : 1);
+    if(!z) return ERR_MEM_AVAIL;
+    int zerr = uncompress(z, &tl, s, l);
+    if(zerr != Z_OK){
+      ::free(z);
+      return (zerr == Z_MEM_ERROR)? ERR_MEM_AVAIL : ERR_PARS_STX;
+    }
+    t = z;
+    l = tl;
+  }
+#endif
+  switch(w){
+  case 1: err = decodeW<1>(enc, t, l, n, d); break;
+  case 2: err = decodeW<2>(enc, t, l, n, d); break;
+  case 4: err = decodeW<4>(enc, t, l, n, d); break;
+  default: err = decodeW<8>(enc, t, l, n, d); break;
+  }
+  if(z) ::free(z);
+  return err;
+}
+
+#ifdef TEST
+
+#include <stdio.h>
+#include <math.h>
+
+int main(int argc, char *argv[]){
+  m_error_t res;
+  size_t tests, errors;
+  const size_t n = 4096;
+
+  tests = errors = 0;
+
+  // slowly varying channels in XDR byte order
+  XDR::Short vs[n];
+  XDR::Int vi[n];
+  XDR::Double vd[n];
+  XDR::UChar vc[n];
+  for(size_t i = 0; i < n; i++){
+    vc[i] = static_cast<XDR::UChar>(128 + 100 * sin(i * 0.02));
+    vs[i] = static_cast<XDR::Short>(1000 * sin(i * 0.01));
+    vi[i] = static_cast<XDR::Int>(100000 + 5000 * sin(i * 0.003) + (i % 7));
+    vd[i] = 20.0 + 0.001 * i;
+  }
+  XDR::xdrWriteArray(vs, n);
+  XDR::xdrWriteArray(vi, n);
+  XDR::xdrWriteArray(vd, n);
+  const unsigned char *src[4] = {
+    (const unsigned char *)vc, (const unsigned char *)vs, 
+    (const unsigned char *)vi, (const unsigned char *)vd
+  };
+  const size_t width[4] = {1, 2, 4, 8};
+
+  printf("Test %d: Round trip of all encodings\n",++tests);
+  res = ERR_NO_ERROR;
+  for(unsigned int enc = 0; enc <= TDFCodec::ALL; enc++){
+    if(TDFCodec::check(enc) != ERR_NO_ERROR) continue;
+    for(int c = 0; (c < 4) && (res == ERR_NO_ERROR); c++){
+      const size_t w = width[c];
+      unsigned char *e = (unsigned char *)malloc(TDFCodec::bound(enc,n,w));
+      unsigned char *d = (unsigned char *)malloc(n * w);
+      size_t l = 0;
+      res = TDFCodec::encode(enc,src[c],n,w,e,l);
+      if(res == ERR_NO_ERROR) res = TDFCodec::decode(enc,e,l,n,w,d);
+      if((res == ERR_NO_ERROR) && memcmp(d,src[c],n * w)) res = ERR_INT_DATA;
+      if(res != ERR_NO_ERROR){
+	printf("*** Error: encoding 0x%x width %u\n",enc,(unsigned int)w);
+      } else {
+	printf("??? encoding 0x%x width %u: %u -> %u octets\n",enc,(unsigned int)w,
+	       (unsigned int)(n * w),(unsigned int)l);
+      }
+      free(e);
+      free(d);
+    }
+  }
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: round trip failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ Round trip finished OK!");
+  }
+
+  printf("Test %d: Invalid encodings and blocks\n",++tests);
+  do {
+    res = ERR_INT_DATA;
+    if(TDFCodec::check(TDFCodec::VARINT | TDFCodec::SHUFFLE) != ERR_PARAM_SEL) break;
+    if(TDFCodec::check(0x10) != ERR_PARAM_SEL) break;
+    unsigned char e[16], d[16];
+    size_t l = 0;
+    if(TDFCodec::encode(TDFCodec::DELTA,src[1],3,3,e,l) != ERR_PARAM_TYP) break;
+    if(TDFCodec::encode(TDFCodec::VARINT,src[2],2,4,e,l) != ERR_NO_ERROR) break;
+    // truncated, trailing and overlong varints
+    if(TDFCodec::decode(TDFCodec::VARINT,e,l-1,2,4,d) != ERR_PARS_END) break;
+    if(TDFCodec::decode(TDFCodec::VARINT,e,l,1,4,d) != ERR_PARS_STX) break;
+    memset(e,0xff,sizeof(e));
+    if(TDFCodec::decode(TDFCodec::VARINT,e,sizeof(e),1,8,d) != ERR_PARS_STX) break;
+    if(TDFCodec::decode(TDFCodec::SHUFFLE,e,7,2,4,d) != ERR_PARS_STX) break;
+    res = ERR_NO_ERROR;
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: invalid encodings failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ Invalid encodings finished OK!");
+  }
+
+  TDFCodec codec;
+  printf("\n%d tests completed with %d errors.\n",tests,errors);
+  printf("Used version: %s\n",codec.VersionTag());
+
+  return 0;
+}
+
+#endif // TEST
@@ -0,0 +1,91 @@
+/*
+ *
+ * Tagged Data File as an exchange standard for binary data,
+ * which draws on BER for tagging,
+ * on ASN.1 where applicable, and
+ * on RFC 1832 - Sun XDR for some storage formats
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *
+ * TDFCodec - filters and compression of array blocks
+ *
+ * This defines the values:
+ *
+ */
+
+#ifndef _XDR_TDFCODEC_H_
+# define _XDR_TDFCODEC_H_
+
+#include <xdrOrder.h>
+#include <mgrError.h>
+#include <stddef.h>
+
+/*! \file TDFCodec.h
+    \brief Encodings of TDArray blocks
+
+    An encoding is a combination of the following steps applied
+    to a block of n elements of w = 1, 2, 4, or 8 octets in XDR byte
+    order, i.e. big-endian:
+
+    - DELTA: each element is replaced by its difference to the
+      previous one modulo 2^(8w). Floating point elements are
+      subtracted as integers, so the filter is lossless.
+    - VARINT: elements are coded as zig-zag LEB128 varints, such
+      that small positive and negative values take few octets.
+    - SHUFFLE: the octets are transposed, i.e. first all most
+      significant octets, then the next ones. Slowly varying
+      values leave long runs for the compressor.
+    - ZLIB: the result is compressed by zlib, if configure found it.
+
+    VARINT and SHUFFLE exclude each other. Blocks are independent,
+    so they can be decoded in parallel.
+
+    \author Dr. Lars Hanke
+    \date 2006-2008
+*/
+
+namespace mgr {
+
+/*! \class TDFCodec
+    \brief Filters and compression of array blocks
+*/
+class TDFCodec {
+public:
+  //! Encoding steps, which may be combined
+  enum Encodings {
+    RAW = 0x00,       //!< Plain XDR
+    DELTA = 0x01,     //!< Difference to the previous element
+    VARINT = 0x02,    //!< Zig-zag LEB128 varints
+    SHUFFLE = 0x04,   //!< Octet transposition
+    ZLIB = 0x08,      //!< zlib compression
+    ALL = 0x0f
+  };
+  enum {
+    DEFAULT_BLOCK = 65536    //!< Default number of elements per block
+  };
+
+  //! Check, whether an encoding is valid and supported
+  static m_error_t check(unsigned int enc);
+
+  //! Maximum size of an encoded block
+  static size_t bound(unsigned int enc, size_t n, size_t w);
+
+  //! Encode a block of n elements of w octets
+  static m_error_t encode(unsigned int enc, const unsigned char *s, size_t n, size_t w,
+			  unsigned char *d, size_t& l);
+
+  //! Decode a block of n elements of w octets
+  static m_error_t decode(unsigned int enc, const unsigned char *s, size_t l,
+			  size_t n, size_t w, unsigned char *d);
+
+  const char *VersionTag(void) const;
+};
+
+}; // namespace mgr
+
+#endif // _XDR_TDFCODEC_H_
@@ -0,0 +1,596 @@
+/*
+ *
+ * Tagged Data File as an exchange standard for binary data,
+ * which draws on BER for tagging,
+ * on ASN.1 where applicable, and
+ * on RFC 1832 - Sun XDR for some storage formats
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *
+ * TDFTable - columnar table item with row groups
+ *
+ * This defines the values:
+ *
+ */
+
+#include "TDFTable.h"
+#include "TDFTable.tag"
+#include <string.h>
+
+using namespace mgr;
+
+const char * TDFTable::VersionTag(void) const {
+  return _VERSION_;
+}
+
+/*
+ * Statistics
+ *
+ */
+
+// NaN are ignored, a chunk of NaN only yields NaN
+template< typename X > static void range(const unsigned char *s, size_t n,
+					 unsigned char *mn, unsigned char *mx){
+  X lo = XDR::xdrRead<X>(s), hi = lo;
+  for(size_t i = 1; i < n; i++){
+    s += sizeof(X);
+    const X v = XDR::xdrRead<X>(s);
+    if(v != v) continue;
+    if((v < lo) || (lo != lo)) lo = v;
+    if((v > hi) || (hi != hi)) hi = v;
+  }
+  XDR::xdrWrite<X>(mn, lo);
+  XDR::xdrWrite<X>(mx, hi);
+}
+
+static m_error_t range(TDFTable::Types t, const unsigned char *s, size_t n,
+		       unsigned char *mn, unsigned char *mx){
+  switch(t){
+  case TDFTable::INT16: range<XDR::Short>(s,n,mn,mx); break;
+  case TDFTable::INT32: range<XDR::Int>(s,n,mn,mx); break;
+  case TDFTable::INT64: range<XDR::Long>(s,n,mn,mx); break;
+  case TDFTable::UINT8: range<XDR::UChar>(s,n,mn,mx); break;
+  case TDFTable::UINT16: range<XDR::UShort>(s,n,mn,mx); break;
+  case TDFTable::UINT32: range<XDR::UInt>(s,n,mn,mx); break;
+  case TDFTable::UINT64: range<XDR::ULong>(s,n,mn,mx); break;
+  case TDFTable::FLOAT: range<XDR::Float>(s,n,mn,mx); break;
+  case TDFTable::DOUBLE: range<XDR::Double>(s,n,mn,mx); break;
+  default: return ERR_PARAM_TYP;
+  }
+  return ERR_NO_ERROR;
+}
+
+/*
+ * The TDFTable Class
+ *
+ */
+
+size_t TDFTable::width(unsigned int t){
+  switch(t){
+  case UINT8: return 1;
+  case INT16:
+  case UINT16: return 2;
+  case INT32:
+  case UINT32:
+  case FLOAT: return 4;
+  case INT64:
+  case UINT64:
+  case DOUBLE: return 8;
+  }
+  return 0;
+}
+
+/*! \param group Rows per group written by writeTag() */
+TDFTable::TDFTable(size_t group) :
+  TDFItem((size_t)TaggedDataFile::TABLE,
+	  BerContentTag::BER_CONSTRUCTED,
+	  BerContentTag::BER_APPLICATION),
+  Rows(0), GroupRows(group ? group : (size_t)DEFAULT_GROUP) {}
+
+TDFTable::~TDFTable() {}
+
+void TDFTable::clear(void){
+  Columns.clear();
+  Groups.clear();
+  Rows = 0;
+}
+
+/*! \param name Name of the column
+    \param t Type of the values
+    \param col If not NULL receives the number of the column
+    \return Error code as defined in mgrError.h
+*/
+m_error_t TDFTable::addColumn(const char *name, Types t, size_t *col){
+  if(!name) return ERR_PARAM_NULL;
+  // readTag() could not read longer names back
+  if(strlen(name) > MAX_NAME) return ERR_PARAM_RANG;
+  if(!width(t)) return ERR_PARAM_TYP;
+  size_t c;
+  if(column(name, c) == ERR_NO_ERROR) return ERR_PARAM_UNIQ;
+  Columns.push_back(Column());
+  Columns.back().name = name;
+  Columns.back().type = t;
+  if(col) *col = Columns.size() - 1;
+  return ERR_NO_ERROR;
+}
+
+/*! \param name Name of the column
+    \param col Receives the number of the column
+    \return Error code as defined in mgrError.h, ERR_PARAM_KEY if not found
+*/
+m_error_t TDFTable::column(const char *name, size_t& col) const {
+  if(!name) return ERR_PARAM_NULL;
+  for(size_t c = 0; c < Columns.size(); c++){
+    if(Columns[c].name == name){
+      col = c;
+      return ERR_NO_ERROR;
+    }
+  }
+  return ERR_PARAM_KEY;
+}
+
+/*! \param g Row group
+    \param col Column
+    \param min Receives the minimum
+    \param max Receives the maximum
+    \return Error code as defined in mgrError.h
+
+    Values of 64 bit integer columns may be rounded.
+*/
+m_error_t TDFTable::stats(size_t g, size_t col, double& min, double& max) const {
+  if((g >= Groups.size()) || (col >= Columns.size())) return ERR_PARAM_RANG;
+  const Chunk& c = Groups[g].chunks[col];
+  m_error_t res = decode(Columns[col].type, &min, c.min, 1);
+  if(res == ERR_NO_ERROR) res = decode(Columns[col].type, &max, c.max, 1);
+  return res;
+}
+
+/*! \param col Column
+    \param lo Lower bound of the values looked for
+    \param hi Upper bound of the values looked for
+    \param g Receives the groups, which may contain such values
+    \return Error code as defined in mgrError.h
+
+    A group is skipped, only if its statistics prove that it does
+    not hold any value in [lo, hi].
+*/
+m_error_t TDFTable::select(size_t col, double lo, double hi, std::vector<size_t>& g) const {
+  if(col >= Columns.size()) return ERR_PARAM_RANG;
+  g.clear();
+  for(size_t i = 0; i < Groups.size(); i++){
+    double mn, mx;
+    m_error_t res = stats(i, col, mn, mx);
+    if(res != ERR_NO_ERROR) return res;
+    // NaN statistics do not exclude anything
+    if((mx < lo) || (mn > hi)) continue;
+    g.push_back(i);
+  }
+  return ERR_NO_ERROR;
+}
+
+/*! \param tr Tree with the group as current
+    \param c Column to write
+    \param first First row of the group
+    \param n Rows of the group
+    \return Error code as defined in mgrError.h
+*/
+m_error_t TDFTable::chunkWrite(BerTree *tr, const Column& c, size_t first, size_t n) const {
+  const size_t w = width(c.type);
+  const unsigned char *s = &c.values[first * w];
+  BerTag *tg = new BerTag((size_t)CHUNK, BerContentTag::BER_CONSTRUCTED,
+			  BerContentTag::BER_CONTEXT);
+  if(!tg) return ERR_MEM_AVAIL;
+  tr->appendChild(tg,true);
+
+  BerTag *mn = new BerTag((size_t)MIN, BerContentTag::BER_PRIMITIVE,
+			  BerContentTag::BER_CONTEXT);
+  if(!mn) return ERR_MEM_AVAIL;
+  tr->appendChild(mn);
+  BerTag *mx = new BerTag((size_t)MAX, BerContentTag::BER_PRIMITIVE,
+			  BerContentTag::BER_CONTEXT);
+  if(!mx) return ERR_MEM_AVAIL;
+  tr->appendChild(mx);
+  unsigned char *pmn = mn->allocate(w);
+  unsigned char *pmx = mx->allocate(w);
+  if(!pmn || !pmx) return ERR_MEM_AVAIL;
+  m_error_t res = range(c.type, s, n, pmn, pmx);
+  if(res != ERR_NO_ERROR) return res;
+
+  tg = new BerTag((int)ASN1IO::ASN1_SEQ,
+		  BerContentTag::BER_PRIMITIVE,
+		  BerContentTag::BER_UNIVERSAL);
+  if(!tg) return ERR_MEM_AVAIL;
+  tr->appendChild(tg);
+  unsigned char *d = tg->allocate(n * w);
+  if(!d) return ERR_MEM_AVAIL;
+  memcpy(d, s, n * w);
+  tr->parent();
+  return ERR_NO_ERROR;
+}
+
+BerTree *TDFTable::writeTag(m_error_t *err) const {
+  if(err) *err = ERR_MEM_AVAIL;
+  BerTag *tg = new BerTag(Tag);
+  if(!tg) return NULL;
+
+  BerTree *tr = new BerTree(tg);
+  if(!tr){
+    delete tg;
+    return NULL;
+  }
+  // delete node upon deletion of BerTree
+  tr->iteratorOnly(false);
+  tr->root();
+
+  m_error_t ierr = ERR_NO_ERROR;
+  do {
+    size_t rows = 0;
+    for(size_t c = 0; c < Columns.size(); c++){
+      const size_t n = Columns[c].values.size() / width(Columns[c].type);
+      if(!c) rows = n;
+      else if(n != rows) ierr = ERR_PARAM_LEN;
+    }
+    if(ierr != ERR_NO_ERROR) break;
+
+    ierr = ERR_MEM_AVAIL;
+    tg = asn.writeIntPacked<size_t>(rows);
+    if(!tg) break;
+    tr->appendChild(tg);
+    tg = asn.writeIntPacked<size_t>(GroupRows);
+    if(!tg) break;
+    tr->appendChild(tg);
+
+    // schema
+    tg = new BerTag((int)ASN1IO::ASN1_SEQ, BerContentTag::BER_CONSTRUCTED,
+		    BerContentTag::BER_UNIVERSAL);
+    if(!tg) break;
+    tr->appendChild(tg,true);
+    ierr = ERR_NO_ERROR;
+    for(size_t c = 0; (c < Columns.size()) && (ierr == ERR_NO_ERROR); c++){
+      ierr = ERR_MEM_AVAIL;
+      tg = new BerTag((int)ASN1IO::ASN1_SEQ, BerContentTag::BER_CONSTRUCTED,
+		      BerContentTag::BER_UNIVERSAL);
+      if(!tg) break;
+      tr->appendChild(tg,true);
+      tg = asn.writePrintableString(Columns[c].name.c_str(), &ierr);
+      if(!tg) break;
+      if(ierr != ERR_NO_ERROR){
+	delete tg;
+	break;
+      }
+      tr->appendChild(tg);
+      ierr = ERR_MEM_AVAIL;
+      tg = asn.writeIntPacked<unsigned int>(Columns[c].type);
+      if(!tg) break;
+      tr->appendChild(tg);
+      tr->parent();
+      ierr = ERR_NO_ERROR;
+    }
+    if(ierr != ERR_NO_ERROR) break;
+    tr->parent();
+
+    // row groups
+    for(size_t first = 0; (first < rows) && (ierr == ERR_NO_ERROR); first += GroupRows){
+      const size_t n = (rows - first < GroupRows)? rows - first : GroupRows;
+      BerTag *g = new BerTag((size_t)GROUP, BerContentTag::BER_CONSTRUCTED,
+			     BerContentTag::BER_CONTEXT);
+      if(!g){
+	ierr = ERR_MEM_AVAIL;
+	break;
+      }
+      tr->appendChild(g,true);
+      for(size_t c = 0; (c < Columns.size()) && (ierr == ERR_NO_ERROR); c++)
+	ierr = chunkWrite(tr, Columns[c], first, n);
+      tr->parent();
+    }
+  } while(0);
+  if(ierr != ERR_NO_ERROR){
+    delete tr;
+    tr = NULL;
+  }
+
+  if(err) *err = ierr;
+  return tr;
+}
+
+/*! \param t Table tag
+    \return Error code as defined in mgrError.h
+
+    The chunks refer to the contents of t, which must persist as
+    long as values are read.
+*/
+m_error_t TDFTable::readTag(const BerTag& t){
+  if(!tTable::isEqual(t.tag().readPtr())) return ERR_PARAM_TYP;
+  clear();
+
+  BerTree tr(const_cast<BerTag *>(&t));
+  // this justifies the const_cast<>
+  tr.iteratorOnly(true);
+  m_error_t res = ERR_NO_ERROR;
+  do {
+    const BerTag *tg = tr.child();
+    if(!tg){
+      res = ERR_PARAM_UDEF;
+      break;
+    }
+    size_t rows;
+    res = asn.readInt<size_t>(*tg,rows);
+    if(res != ERR_NO_ERROR) break;
+    tg = tr.next();
+    if(!tg){
+      res = ERR_PARAM_UDEF;
+      break;
+    }
+    res = asn.readInt<size_t>(*tg,GroupRows);
+    if(res != ERR_NO_ERROR) break;
+    if(!GroupRows){
+      res = ERR_PARS_STX;
+      break;
+    }
+
+    // schema
+    if(!tr.next()){
+      res = ERR_PARAM_UDEF;
+      break;
+    }
+    if(tr.child()){
+      do {
+	char name[MAX_NAME + 1];
+	unsigned int type;
+	tg = tr.child();
+	if(!tg){
+	  res = ERR_PARAM_UDEF;
+	  break;
+	}
+	res = asn.readPrintableString(*tg,name,sizeof(name));
+	if(res != ERR_NO_ERROR) break;
+	tg = tr.next();
+	if(!tg){
+	  res = ERR_PARAM_UDEF;
+	  break;
+	}
+	res = asn.readInt<unsigned int>(*tg,type);
+	if(res != ERR_NO_ERROR) break;
+	tr.parent();
+	res = addColumn(name,static_cast<Types>(type));
+      } while((res == ERR_NO_ERROR) && tr.next());
+      if(res != ERR_NO_ERROR) break;
+      tr.parent();
+    }
+
+    // row groups
+    size_t first = 0;
+    while((res == ERR_NO_ERROR) && (tg = tr.next())){
+      if(!tGroup::isEqual(tg->tag().readPtr()) || (first >= rows)){
+	res = ERR_PARS_STX;
+	break;
+      }
+      Groups.push_back(Group());
+      Group& g = Groups.back();
+      g.first = first;
+      g.rows = (rows - first < GroupRows)? rows - first : GroupRows;
+      first += g.rows;
+      tg = tr.child();
+      const bool in = (tg != NULL);
+      for(size_t c = 0; c < Columns.size(); c++, tg = tr.next()){
+	const size_t w = width(Columns[c].type);
+	Chunk k;
+	if(!tg || !tChunk::isEqual(tg->tag().readPtr())){
+	  res = ERR_PARS_STX;
+	  break;
+	}
+	const BerTag *mn = tr.child();
+	const BerTag *mx = tr.next();
+	const BerTag *d = tr.next();
+	tr.parent();
+	if(!mn || !mx || !d || !tMin::isEqual(mn->tag().readPtr()) ||
+	   !tMax::isEqual(mx->tag().readPtr()) || (mn->c_size() != w) ||
+	   (mx->c_size() != w) || (d->c_size() != g.rows * w)){
+	  res = ERR_PARS_STX;
+	  break;
+	}
+	k.min = mn->content().readPtr();
+	k.max = mx->content().readPtr();
+	k.data = d->content().readPtr();
+	g.chunks.push_back(k);
+      }
+      if(res != ERR_NO_ERROR) break;
+      // more chunks than columns
+      if(tg && Columns.size()){
+	res = ERR_PARS_STX;
+	break;
+      }
+      if(in) tr.parent();
+    }
+    if((res == ERR_NO_ERROR) && (first != rows)) res = ERR_PARS_STX;
+    if(res == ERR_NO_ERROR) Rows = rows;
+  } while(0);
+
+  if(res != ERR_NO_ERROR) clear();
+  return res;
+}
+
+m_error_t TDFTable::dump(FILE *f, const char *prefix) const {
+  if(!f) return ERR_PARAM_NULL;
+  if(!prefix) prefix = "";
+  if(0 > fprintf(f,"%sTable of %u rows in %u groups\n",prefix,
+		 (unsigned int)Rows,(unsigned int)Groups.size())) return ERR_FILE_WRITE;
+  for(size_t c = 0; c < Columns.size(); c++){
+    if(0 > fprintf(f,"%s%u: %s type %d\n",prefix,(unsigned int)c,
+		   Columns[c].name.c_str(),(int)Columns[c].type)) return ERR_FILE_WRITE;
+    for(size_t g = 0; g < Groups.size(); g++){
+      double mn, mx;
+      if(stats(g,c,mn,mx) != ERR_NO_ERROR) continue;
+      if(0 > fprintf(f,"%s  group %u: [%lf, %lf]\n",prefix,(unsigned int)g,mn,mx))
+	return ERR_FILE_WRITE;
+    }
+  }
+  return ERR_NO_ERROR;
+}
+
+#ifdef TEST
+
+#include <stdio.h>
+#include <unistd.h>
+
+int main(int argc, char *argv[]){
+  m_error_t res;
+  size_t tests, errors;
+
+  tests = errors = 0;
+
+  const size_t n = 1000;
+  double *ts = new double[n];
+  int *counts = new int[n];
+  unsigned short *adc = new unsigned short[n];
+  for(size_t i = 0; i < n; i++){
+    ts[i] = i * 0.001;
+    counts[i] = (int)(i % 97) - 40;
+    adc[i] = (unsigned short)(60000 - i * 3);
+  }
+
+  printf("Test %d: Write a table\n",++tests);
+  char path[64];
+  snprintf(path,sizeof(path),"/tmp/test-TDFTable-%d.tdf",(int)getpid());
+  do {
+    TDFTable tab(128);
+    size_t ct, cc, ca;
+    res = tab.addColumn("time",TDFTable::DOUBLE,&ct);
+    if(res == ERR_NO_ERROR) res = tab.addColumn("counts",TDFTable::INT32,&cc);
+    if(res == ERR_NO_ERROR) res = tab.addColumn("adc",TDFTable::UINT16,&ca);
+    if(res != ERR_NO_ERROR) break;
+    if(tab.addColumn("time",TDFTable::FLOAT) != ERR_PARAM_UNIQ){
+      res = ERR_INT_DATA;
+      break;
+    }
+    std::string lng(TDFTable::MAX_NAME + 1,'x');
+    if((tab.addColumn(lng.c_str(),TDFTable::FLOAT) != ERR_PARAM_RANG) ||
+       (tab.type(tab.columns()) != TDFTable::INVALID) || tab.name(tab.columns())){
+      res = ERR_INT_DATA;
+      break;
+    }
+    // columns may be filled piecewise
+    res = tab.append(ct,ts,n/2);
+    if(res == ERR_NO_ERROR) res = tab.append(ct,ts + n/2,n - n/2);
+    if(res == ERR_NO_ERROR) res = tab.append(cc,counts,n);
+    if(res == ERR_NO_ERROR) res = tab.append(ca,adc,n-1);
+    if(res != ERR_NO_ERROR) break;
+    m_error_t xerr;
+    BerTree *tr = tab.writeTag(&xerr);
+    if(tr || (xerr != ERR_PARAM_LEN)){
+      if(tr) delete tr;
+      res = ERR_INT_DATA;
+      break;
+    }
+    res = tab.append(ca,adc + n-1,1);
+    if(res != ERR_NO_ERROR) break;
+
+    TaggedDataFile tdf;
+    TDFDataHeader hdr("Table","Test");
+    res = tdf.addItem(hdr);
+    if(res == ERR_NO_ERROR) res = tdf.addItem(tab);
+    if(res != ERR_NO_ERROR) break;
+    FileDump f(path);
+    res = tdf.write(f,true);
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: writing the table failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ Writing the table finished OK!");
+  }
+
+  printf("Test %d: Project and select\n",++tests);
+  do {
+    if(res != ERR_NO_ERROR) break;
+    TaggedDataFile rd;
+    res = rd.open(path);
+    if(res != ERR_NO_ERROR) break;
+    TDFTable tab;
+    res = rd.fetchItem(tab);
+    if(res != ERR_NO_ERROR) break;
+    tab.dump(stdout,"??? ");
+    size_t ct, ca;
+    if((tab.rows() != n) || (tab.groups() != 8) || (tab.groupRows(7) != n - 7 * 128) ||
+       (tab.column("time",ct) != ERR_NO_ERROR) || (tab.column("adc",ca) != ERR_NO_ERROR) ||
+       (tab.column("none",ct) != ERR_PARAM_KEY) || (tab.type(ca) != TDFTable::UINT16)){
+      res = ERR_INT_DATA;
+      break;
+    }
+    // time within [0.3, 0.4] is in groups 2 and 3 only
+    std::vector<size_t> sel;
+    res = tab.select(ct,0.3,0.4,sel);
+    if(res != ERR_NO_ERROR) break;
+    if((sel.size() != 2) || (sel[0] != 2) || (sel[1] != 3)){
+      res = ERR_INT_DATA;
+      break;
+    }
+    double t[128];
+    unsigned int a[128];
+    for(size_t k = 0; (k < sel.size()) && (res == ERR_NO_ERROR); k++){
+      const size_t g = sel[k];
+      res = tab.read(g,ct,t);
+      if(res == ERR_NO_ERROR) res = tab.read(g,ca,a);
+      for(size_t i = 0; (i < tab.groupRows(g)) && (res == ERR_NO_ERROR); i++){
+	const size_t r = tab.groupStart(g) + i;
+	if((t[i] != ts[r]) || (a[i] != adc[r])) res = ERR_INT_DATA;
+      }
+    }
+    if(res != ERR_NO_ERROR) break;
+    double mn, mx;
+    res = tab.stats(0,ca,mn,mx);
+    if((res == ERR_NO_ERROR) && ((mx != 60000) || (mn != 60000 - 127 * 3)))
+      res = ERR_INT_DATA;
+    if(res != ERR_NO_ERROR) break;
+    long long *cl = new long long[n];
+    res = tab.readColumn(1,cl);
+    for(size_t i = 0; (i < n) && (res == ERR_NO_ERROR); i++)
+      if(cl[i] != counts[i]) res = ERR_INT_DATA;
+    delete[] cl;
+  } while(0);
+  unlink(path);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: projection failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ Projection finished OK!");
+  }
+
+  printf("Test %d: Empty table\n",++tests);
+  do {
+    TDFTable tab;
+    res = tab.addColumn("x",TDFTable::FLOAT);
+    if(res != ERR_NO_ERROR) break;
+    BerTree *tr = tab.writeTag(&res);
+    if(!tr) break;
+    TDFTable rt;
+    res = rt.readTag(*tr->root());
+    if((res == ERR_NO_ERROR) && ((rt.rows() != 0) || (rt.groups() != 0) ||
+				 (rt.columns() != 1) || strcmp(rt.name(0),"x")))
+      res = ERR_INT_DATA;
+    delete tr;
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: empty table failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ Empty table finished OK!");
+  }
+
+  delete[] ts;
+  delete[] counts;
+  delete[] adc;
+
+  TDFTable tab;
+  printf("\n%d tests completed with %d errors.\n",tests,errors);
+  printf("Used version: %s\n",tab.VersionTag());
+
+  return 0;
+}
+
+#endif // TEST
@@ -0,0 +1,251 @@
+/*
+ *
+ * Tagged Data File as an exchange standard for binary data,
+ * which draws on BER for tagging,
+ * on ASN.1 where applicable, and
+ * on RFC 1832 - Sun XDR for some storage formats
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *
+ * TDFTable - columnar table item with row groups
+ *
+ * This defines the values:
+ *
+ */
+
+#ifndef _XDR_TDFTABLE_H_
+# define _XDR_TDFTABLE_H_
+
+#include <TaggedDataFile.h>
+#include <string>
+#include <vector>
+
+/*! \file TDFTable.h
+    \brief Columnar table item of a TaggedDataFile
+
+    A TDFTable stores named and typed columns of equal length. The
+    rows are split into row groups of a fixed number of rows. Each
+    group holds one chunk per column with the values in XDR and
+    their minimum and maximum:
+
+    \verbatim
+    [APPLICATION 24] {
+      INTEGER rows,
+      INTEGER rows per group,
+      SEQUENCE { SEQUENCE { PrintableString name, INTEGER type } ... },
+      [4] { [5] { [0] min, [1] max, data } ... } ...
+    }
+    \endverbatim
+
+    After readTag() the chunks refer into the file image. Reading a
+    column of a group only accesses its chunk, so a scan touches
+    the projected columns of the groups selected by their
+    statistics only.
+
+    \author Dr. Lars Hanke
+    \date 2006-2008
+*/
+
+namespace mgr {
+
+/*! \class TDFTable
+    \brief Columnar table item with row groups and statistics
+*/
+class TDFTable : public TDFItem {
+public:
+  //! Column types
+  enum Types {
+    INVALID = 0,             //!< type() of a column not present
+    INT16 = 1,
+    INT32 = 2,
+    INT64 = 3,
+    UINT8 = 4,
+    UINT16 = 5,
+    UINT32 = 6,
+    UINT64 = 7,
+    FLOAT = 8,
+    DOUBLE = 9
+  };
+  enum TableTags {
+    GROUP = 0x04,
+    CHUNK = 0x05,
+    MIN = 0x00,
+    MAX = 0x01
+  };
+  enum {
+    DEFAULT_GROUP = 65536,   //!< Default number of rows per group
+    MAX_NAME = 255           //!< Longest column name in octets
+  };
+
+  typedef BerContentTag::TagString<(int)TaggedDataFile::TABLE,
+    BerContentTag::BER_CONSTRUCTED, BerContentTag::BER_APPLICATION> tTable;
+  typedef BerContentTag::TagString<(int)GROUP,
+    BerContentTag::BER_CONSTRUCTED, BerContentTag::BER_CONTEXT> tGroup;
+  typedef BerContentTag::TagString<(int)CHUNK,
+    BerContentTag::BER_CONSTRUCTED, BerContentTag::BER_CONTEXT> tChunk;
+  typedef BerContentTag::TagString<(int)MIN,
+    BerContentTag::BER_PRIMITIVE, BerContentTag::BER_CONTEXT> tMin;
+  typedef BerContentTag::TagString<(int)MAX,
+    BerContentTag::BER_PRIMITIVE, BerContentTag::BER_CONTEXT> tMax;
+
+  //! Octets of a value of type t, 0 if unknown
+  static size_t width(unsigned int t);
+
+protected:
+  //! Column of a group read by readTag()
+  struct Chunk {
+    const unsigned char *data;   //!< XDR values
+    const unsigned char *min;    //!< XDR minimum
+    const unsigned char *max;    //!< XDR maximum
+  };
+  //! Row group read by readTag()
+  struct Group {
+    size_t first;                //!< First row
+    size_t rows;                 //!< Number of rows
+    std::vector<Chunk> chunks;   //!< One per column
+  };
+  struct Column {
+    std::string name;
+    Types type;
+    std::vector<unsigned char> values;   //!< XDR values to write
+  };
+
+  std::vector<Column> Columns;
+  std::vector<Group> Groups;
+  size_t Rows;
+  size_t GroupRows;
+
+  template<typename X, typename T>
+  static void decode(T *d, const unsigned char *s, size_t n){
+    for(size_t i = 0; i < n; i++, s += sizeof(X))
+      d[i] = static_cast<T>(XDR::xdrRead<X>(s));
+  }
+  template<typename T>
+  static m_error_t decode(Types t, T *d, const unsigned char *s, size_t n){
+    switch(t){
+    case INT16: decode<XDR::Short>(d,s,n); break;
+    case INT32: decode<XDR::Int>(d,s,n); break;
+    case INT64: decode<XDR::Long>(d,s,n); break;
+    case UINT8: decode<XDR::UChar>(d,s,n); break;
+    case UINT16: decode<XDR::UShort>(d,s,n); break;
+    case UINT32: decode<XDR::UInt>(d,s,n); break;
+    case UINT64: decode<XDR::ULong>(d,s,n); break;
+    case FLOAT: decode<XDR::Float>(d,s,n); break;
+    case DOUBLE: decode<XDR::Double>(d,s,n); break;
+    default: return ERR_PARAM_TYP;
+    }
+    return ERR_NO_ERROR;
+  }
+
+  template<typename X, typename T>
+  static void encode(unsigned char *d, const T *s, size_t n){
+    for(size_t i = 0; i < n; i++, d += sizeof(X))
+      XDR::xdrWrite<X>(d, static_cast<X>(s[i]));
+  }
+  template<typename T>
+  static m_error_t encode(Types t, unsigned char *d, const T *s, size_t n){
+    switch(t){
+    case INT16: encode<XDR::Short>(d,s,n); break;
+    case INT32: encode<XDR::Int>(d,s,n); break;
+    case INT64: encode<XDR::Long>(d,s,n); break;
+    case UINT8: encode<XDR::UChar>(d,s,n); break;
+    case UINT16: encode<XDR::UShort>(d,s,n); break;
+    case UINT32: encode<XDR::UInt>(d,s,n); break;
+    case UINT64: encode<XDR::ULong>(d,s,n); break;
+    case FLOAT: encode<XDR::Float>(d,s,n); break;
+    case DOUBLE: encode<XDR::Double>(d,s,n); break;
+    default: return ERR_PARAM_TYP;
+    }
+    return ERR_NO_ERROR;
+  }
+
+  m_error_t chunkWrite(BerTree *tr, const Column& c, size_t first, size_t n) const;
+
+public:
+  TDFTable(size_t group = DEFAULT_GROUP);
+  virtual ~TDFTable();
+
+  //! Add a column, returns its number in col
+  /*! Names longer than MAX_NAME are rejected by ERR_PARAM_RANG. */
+  m_error_t addColumn(const char *name, Types t, size_t *col = NULL);
+  //! Append n values to a column
+  template<typename T>
+  m_error_t append(size_t col, const T *d, size_t n){
+    if(!d) return ERR_PARAM_NULL;
+    if(col >= Columns.size()) return ERR_PARAM_RANG;
+    Column& c = Columns[col];
+    const size_t w = width(c.type);
+    const size_t at = c.values.size();
+    c.values.resize(at + n * w);
+    if(!n) return ERR_NO_ERROR;
+    return encode(c.type, &c.values[at], d, n);
+  }
+  //! Discard columns and rows
+  void clear(void);
+
+  //! Number of columns
+  size_t columns(void) const {
+    return Columns.size();
+  }
+  //! Look up a column by name
+  m_error_t column(const char *name, size_t& col) const;
+  const char *name(size_t col) const {
+    return (col < Columns.size())? Columns[col].name.c_str() : NULL;
+  }
+  Types type(size_t col) const {
+    return (col < Columns.size())? Columns[col].type : INVALID;
+  }
+
+  //! Number of rows read by readTag()
+  size_t rows(void) const {
+    return Rows;
+  }
+  //! Number of row groups read by readTag()
+  size_t groups(void) const {
+    return Groups.size();
+  }
+  //! Rows of a group
+  size_t groupRows(size_t g) const {
+    return (g < Groups.size())? Groups[g].rows : 0;
+  }
+  //! First row of a group
+  size_t groupStart(size_t g) const {
+    return (g < Groups.size())? Groups[g].first : 0;
+  }
+
+  //! Statistics of a column in a group
+  m_error_t stats(size_t g, size_t col, double& min, double& max) const;
+  //! Groups, whose column values may lie in [lo, hi]
+  m_error_t select(size_t col, double lo, double hi, std::vector<size_t>& g) const;
+
+  //! Convert the values of a column in a group
+  template<typename T>
+  m_error_t read(size_t g, size_t col, T *d) const {
+    if(!d) return ERR_PARAM_NULL;
+    if((g >= Groups.size()) || (col >= Columns.size())) return ERR_PARAM_RANG;
+    return decode(Columns[col].type, d, Groups[g].chunks[col].data, Groups[g].rows);
+  }
+  //! Convert an entire column
+  template<typename T>
+  m_error_t readColumn(size_t col, T *d) const {
+    m_error_t res = ERR_NO_ERROR;
+    for(size_t g = 0; (g < Groups.size()) && (res == ERR_NO_ERROR); g++)
+      res = read(g, col, d + Groups[g].first);
+    return res;
+  }
+
+  virtual BerTree *writeTag(m_error_t *err = NULL) const;
+  virtual m_error_t readTag(const BerTag& t);
+  virtual m_error_t dump(FILE *f = stdout, const char *prefix = NULL) const;
+
+  const char *VersionTag(void) const;
+};
+
+}; // namespace mgr
+
+#endif // _XDR_TDFTABLE_H_
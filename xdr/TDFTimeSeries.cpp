@@ -0,0 +1,622 @@
+/*
+ *
+ * Tagged Data File as an exchange standard for binary data,
+ * which draws on BER for tagging,
+ * on ASN.1 where applicable, and
+ * on RFC 1832 - Sun XDR for some storage formats
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *
+ * TDFTimeSeries - time stamped samples with a block index
+ *
+ * This defines the values:
+ *
+ */
+
+#include "TDFTimeSeries.h"
+#include "TDFTimeSeries.tag"
+#include <algorithm>
+#include <string.h>
+
+using namespace mgr;
+
+const char * TDFTimeSeries::VersionTag(void) const {
+  return _VERSION_;
+}
+
+/*
+ * Channels
+ *
+ */
+
+template< class A > static _TDArray *readArray(const BerTag& t, m_error_t& res){
+  A *a = new A;
+  if(!a){
+    res = ERR_MEM_AVAIL;
+    return NULL;
+  }
+  res = a->readTag(t);
+  if(res != ERR_NO_ERROR){
+    delete a;
+    return NULL;
+  }
+  return a;
+}
+
+// create the array type matching tag and record size of t,
+// encoded arrays are rejected by ERR_PARAM_TYP on their stored width as well
+static _TDArray *readChannel(const BerTag& t, m_error_t& res){
+  _TDArray *a = NULL;
+  res = ERR_PARAM_TYP;
+  switch(t.tag().Number()){
+  case TaggedDataFile::INT_ARRAY:
+    a = readArray<TDIntArray>(t,res);
+    if(!a && (res == ERR_PARAM_TYP)) a = readArray<TDShortArray>(t,res);
+    if(!a && (res == ERR_PARAM_TYP)) a = readArray<TDLongArray>(t,res);
+    break;
+  case TaggedDataFile::UINT_ARRAY:
+    a = readArray<TDUIntArray>(t,res);
+    if(!a && (res == ERR_PARAM_TYP)) a = readArray<TDUShortArray>(t,res);
+    if(!a && (res == ERR_PARAM_TYP)) a = readArray<TDUCharArray>(t,res);
+    if(!a && (res == ERR_PARAM_TYP)) a = readArray<TDULongArray>(t,res);
+    break;
+  case TaggedDataFile::DOUBLE_ARRAY:
+    a = readArray<TDDoubleArray>(t,res);
+    break;
+  case TaggedDataFile::FLOAT_ARRAY:
+    a = readArray<TDFloatArray>(t,res);
+    break;
+  case TaggedDataFile::COMPLEX_ARRAY:
+    a = readArray<TDDoubleComplexArray>(t,res);
+    if(!a && (res == ERR_PARAM_TYP)) a = readArray<TDFloatComplexArray>(t,res);
+    break;
+  }
+  return a;
+}
+
+/*
+ * The TDFTimeSeries Class
+ *
+ */
+
+/*! \param block Time stamps per block written by writeTag() */
+TDFTimeSeries::TDFTimeSeries(size_t block) :
+  TDFItem((size_t)TaggedDataFile::TIME_SERIES,
+	  BerContentTag::BER_CONSTRUCTED,
+	  BerContentTag::BER_APPLICATION),
+  Encoding(TDFCodec::DELTA | TDFCodec::VARINT),
+  Block(block ? block : (size_t)DEFAULT_BLOCK),
+  Samples(0), Index(NULL) {}
+
+TDFTimeSeries::~TDFTimeSeries() {
+  clear();
+}
+
+void TDFTimeSeries::clearRead(void){
+  for(size_t k = 0; k < Channels.size(); k++) delete Channels[k];
+  Channels.clear();
+  Src.clear();
+  Len.clear();
+  Index = NULL;
+  Samples = 0;
+}
+
+void TDFTimeSeries::clear(void){
+  clearRead();
+  for(size_t k = 0; k < Pending.size(); k++) delete Pending[k];
+  Pending.clear();
+  PendingSize.clear();
+  Times.clear();
+}
+
+/*! \param e Combination of TDFCodec::Encodings
+    \return Error code as defined in mgrError.h
+*/
+m_error_t TDFTimeSeries::encoding(unsigned int e){
+  m_error_t res = TDFCodec::check(e);
+  if(res == ERR_NO_ERROR) Encoding = e;
+  return res;
+}
+
+/*! \param t Time stamps in nanoseconds since the epoch
+    \param n Number of time stamps
+    \return Error code as defined in mgrError.h
+
+    The time stamps must not decrease, else ERR_PARAM_RANG is
+    returned.
+*/
+m_error_t TDFTimeSeries::times(const XDR::Long *t, size_t n){
+  if(!t && n) return ERR_PARAM_NULL;
+  for(size_t i = 1; i < n; i++)
+    if(t[i] < t[i-1]) return ERR_PARAM_RANG;
+  Times.assign(t, t + n);
+  return ERR_NO_ERROR;
+}
+
+/*! \param a Array with one element per time stamp
+    \return Error code as defined in mgrError.h
+
+    The array is serialized immediately, i.e. it may be discarded
+    afterwards.
+*/
+m_error_t TDFTimeSeries::addChannel(const _TDArray& a){
+  m_error_t res;
+  BerTree *tr = a.writeTag(&res);
+  if(res != ERR_NO_ERROR) return res;
+  if(!tr) return ERR_PARAM_NULL;
+  Pending.push_back(tr);
+  PendingSize.push_back(a.elements());
+  return ERR_NO_ERROR;
+}
+
+BerTree *TDFTimeSeries::writeTag(m_error_t *err) const {
+  if(err) *err = ERR_MEM_AVAIL;
+  BerTag *tg = new BerTag(Tag);
+  if(!tg) return NULL;
+
+  BerTree *tr = new BerTree(tg);
+  if(!tr){
+    delete tg;
+    return NULL;
+  }
+  // delete node upon deletion of BerTree
+  tr->iteratorOnly(false);
+  tr->root();
+
+  const size_t n = Times.size();
+  const size_t nb = n / Block + ((n % Block)? 1 : 0);
+  m_error_t ierr = ERR_NO_ERROR;
+  do {
+    for(size_t k = 0; k < PendingSize.size(); k++)
+      if(PendingSize[k] != n) ierr = ERR_PARAM_LEN;
+    if(ierr != ERR_NO_ERROR) break;
+
+    ierr = ERR_MEM_AVAIL;
+    tg = asn.writeIntPacked<size_t>(n);
+    if(!tg) break;
+    tr->appendChild(tg);
+    tg = asn.writeIntPacked<size_t>(Block);
+    if(!tg) break;
+    tr->appendChild(tg);
+    tg = asn.writeIntPacked<unsigned int>(Encoding);
+    if(!tg) break;
+    tr->appendChild(tg);
+
+    tg = new BerTag((size_t)INDEX, BerContentTag::BER_PRIMITIVE,
+		    BerContentTag::BER_CONTEXT);
+    if(!tg) break;
+    tr->appendChild(tg);
+    if(nb){
+      unsigned char *p = tg->allocate(nb * ENTRY_SIZE);
+      if(!p) break;
+      for(size_t b = 0; b < nb; b++, p += ENTRY_SIZE){
+	const size_t e = ((b + 1) * Block < n)? (b + 1) * Block : n;
+	XDR::xdrWrite<XDR::Long>(p, Times[b * Block]);
+	XDR::xdrWrite<XDR::Long>(p + 8, Times[e - 1]);
+      }
+    }
+
+    tg = new BerTag((size_t)BLOCKS, BerContentTag::BER_CONSTRUCTED,
+		    BerContentTag::BER_CONTEXT);
+    if(!tg) break;
+    tr->appendChild(tg,true);
+    ierr = ERR_NO_ERROR;
+    std::vector<XDR::Long> x(nb ? Block : 0);
+    for(size_t b = 0; (b < nb) && (ierr == ERR_NO_ERROR); b++){
+      const size_t first = b * Block;
+      const size_t c = (n - first < Block)? n - first : Block;
+      ierr = ERR_MEM_AVAIL;
+      XDR::xdrWriteArray(&x[0], &Times[first], c);
+      tg = new BerTag((size_t)_TDArray::BLOCK, BerContentTag::BER_PRIMITIVE,
+		      BerContentTag::BER_CONTEXT);
+      if(!tg) break;
+      tr->appendChild(tg);
+      unsigned char *p = tg->allocate(TDFCodec::bound(Encoding, c, 8));
+      if(!p) break;
+      size_t l;
+      ierr = TDFCodec::encode(Encoding, (const unsigned char *)&x[0], c, 8, p, l);
+      if((ierr == ERR_NO_ERROR) && !tg->allocate(l)) ierr = ERR_MEM_AVAIL;
+    }
+    if(ierr != ERR_NO_ERROR) break;
+    tr->parent();
+
+    ierr = ERR_MEM_AVAIL;
+    tg = new BerTag((int)ASN1IO::ASN1_SEQ, BerContentTag::BER_CONSTRUCTED,
+		    BerContentTag::BER_UNIVERSAL);
+    if(!tg) break;
+    tr->appendChild(tg,true);
+    ierr = ERR_NO_ERROR;
+    for(size_t k = 0; (k < Pending.size()) && (ierr == ERR_NO_ERROR); k++){
+      BerTree ctr;
+      ierr = ctr.clone(*Pending[k]);
+      // transfer node ownership to tr
+      ctr.iteratorOnly(true);
+      if(ierr == ERR_NO_ERROR) tr->appendChild(ctr.root());
+    }
+    tr->parent();
+  } while(0);
+  if(ierr != ERR_NO_ERROR){
+    delete tr;
+    tr = NULL;
+  }
+
+  if(err) *err = ierr;
+  return tr;
+}
+
+/*! \param t Time series tag
+    \return Error code as defined in mgrError.h
+
+    The index and the blocks refer to the contents of t, which
+    must persist as long as time stamps are read.
+*/
+m_error_t TDFTimeSeries::readTag(const BerTag& t){
+  if(!tTimeSeries::isEqual(t.tag().readPtr())) return ERR_PARAM_TYP;
+  clearRead();
+
+  BerTree tr(const_cast<BerTag *>(&t));
+  // this justifies the const_cast<>
+  tr.iteratorOnly(true);
+  m_error_t res = ERR_NO_ERROR;
+  do {
+    size_t n, block;
+    unsigned int enc;
+    const BerTag *tg = tr.child();
+    if(!tg){
+      res = ERR_PARAM_UDEF;
+      break;
+    }
+    res = asn.readInt<size_t>(*tg,n);
+    if(res != ERR_NO_ERROR) break;
+    res = ERR_PARAM_UDEF;
+    if(!(tg = tr.next())) break;
+    res = asn.readInt<size_t>(*tg,block);
+    if(res != ERR_NO_ERROR) break;
+    res = ERR_PARAM_UDEF;
+    if(!(tg = tr.next())) break;
+    res = asn.readInt<unsigned int>(*tg,enc);
+    if(res != ERR_NO_ERROR) break;
+    res = TDFCodec::check(enc);
+    if(res != ERR_NO_ERROR) break;
+    if(!block){
+      res = ERR_PARS_STX;
+      break;
+    }
+    const size_t nb = n / block + ((n % block)? 1 : 0);
+
+    // index
+    tg = tr.next();
+    if(!tg || !tIndex::isEqual(tg->tag().readPtr()) || (tg->c_size() / ENTRY_SIZE != nb) ||
+       (tg->c_size() % ENTRY_SIZE)){
+      res = ERR_PARS_STX;
+      break;
+    }
+    Index = tg->content().readPtr();
+    for(size_t b = 0; b < nb; b++){
+      if((blockFirst(b) > blockLast(b)) || ((b + 1 < nb) && (blockLast(b) > blockFirst(b + 1)))){
+	res = ERR_PARS_STX;
+	break;
+      }
+    }
+    if(res != ERR_NO_ERROR) break;
+
+    // blocks
+    tg = tr.next();
+    if(!tg || !tBlocks::isEqual(tg->tag().readPtr())){
+      res = ERR_PARS_STX;
+      break;
+    }
+    if(tr.child()){
+      do {
+	tg = tr.current();
+	if(!_TDArray::tBlock::isEqual(tg->tag().readPtr())){
+	  res = ERR_PARS_STX;
+	  break;
+	}
+	Src.push_back(tg->content().readPtr());
+	Len.push_back(tg->c_size());
+      } while(tr.next());
+      tr.parent();
+    }
+    if(res != ERR_NO_ERROR) break;
+    if(Src.size() != nb){
+      res = ERR_PARS_STX;
+      break;
+    }
+
+    // channels
+    tg = tr.next();
+    if(!tg){
+      res = ERR_PARAM_UDEF;
+      break;
+    }
+    if(tr.child()){
+      do {
+	_TDArray *a = readChannel(*(tr.current()),res);
+	if(!a) break;
+	Channels.push_back(a);
+	if(a->elements() != n) res = ERR_PARS_STX;
+      } while((res == ERR_NO_ERROR) && tr.next());
+      tr.parent();
+    }
+    if(res != ERR_NO_ERROR) break;
+
+    Samples = n;
+    Block = block;
+    Encoding = enc;
+  } while(0);
+
+  if(res != ERR_NO_ERROR) clearRead();
+  return res;
+}
+
+/*! \param b Block
+    \param t Receives the time stamps of the block
+    \return Error code as defined in mgrError.h
+*/
+m_error_t TDFTimeSeries::decodeBlock(size_t b, std::vector<XDR::Long>& t) const {
+  const size_t first = b * Block;
+  const size_t n = (Samples - first < Block)? Samples - first : Block;
+  t.resize(n);
+  m_error_t res = TDFCodec::decode(Encoding, Src[b], Len[b], n, 8,
+				   reinterpret_cast<unsigned char *>(&t[0]));
+  if(res != ERR_NO_ERROR) return res;
+  XDR::xdrReadArray(&t[0], n);
+  return ERR_NO_ERROR;
+}
+
+/*! \param t0 Start of the interval
+    \param t1 End of the interval, included
+    \param first Receives the first sample with a time stamp not before t0
+    \param count Receives the number of samples up to t1
+    \return Error code as defined in mgrError.h
+
+    The blocks are found by binary search on the index. Only the
+    first and the last block overlapping the interval are decoded.
+*/
+m_error_t TDFTimeSeries::seek(XDR::Long t0, XDR::Long t1, size_t& first, size_t& count) const {
+  first = Samples;
+  count = 0;
+  if(t0 > t1) return ERR_PARAM_RANG;
+  const size_t nb = Src.size();
+
+  // first block ending not before t0
+  size_t lo = 0, hi = nb;
+  while(lo < hi){
+    const size_t mid = lo + (hi - lo) / 2;
+    if(blockLast(mid) < t0) lo = mid + 1; else hi = mid;
+  }
+  const size_t bs = lo;
+  if(bs == nb) return ERR_NO_ERROR;
+  // behind the last block starting not after t1
+  hi = nb;
+  while(lo < hi){
+    const size_t mid = lo + (hi - lo) / 2;
+    if(blockFirst(mid) <= t1) lo = mid + 1; else hi = mid;
+  }
+  const size_t be = lo;
+  first = bs * Block;
+  if(be == bs) return ERR_NO_ERROR;
+
+  std::vector<XDR::Long> t;
+  m_error_t res = decodeBlock(bs, t);
+  if(res != ERR_NO_ERROR) return res;
+  first = bs * Block + (std::lower_bound(t.begin(), t.end(), t0) - t.begin());
+  if(be - 1 != bs){
+    res = decodeBlock(be - 1, t);
+    if(res != ERR_NO_ERROR) return res;
+  }
+  const size_t end = (be - 1) * Block + (std::upper_bound(t.begin(), t.end(), t1) - t.begin());
+  count = (end > first)? end - first : 0;
+  return ERR_NO_ERROR;
+}
+
+/*! \param first First sample
+    \param count Number of samples
+    \param t Receives count time stamps
+    \return Error code as defined in mgrError.h
+
+    Only the blocks holding the samples requested are decoded.
+*/
+m_error_t TDFTimeSeries::time(size_t first, size_t count, XDR::Long *t) const {
+  if(!t) return ERR_PARAM_NULL;
+  if((first > Samples) || (count > Samples - first)) return ERR_PARAM_RANG;
+  std::vector<XDR::Long> d;
+  while(count){
+    const size_t b = first / Block;
+    m_error_t res = decodeBlock(b, d);
+    if(res != ERR_NO_ERROR) return res;
+    const size_t o = first - b * Block;
+    const size_t c = (d.size() - o < count)? d.size() - o : count;
+    memcpy(t, &d[o], c * sizeof(XDR::Long));
+    t += c;
+    first += c;
+    count -= c;
+  }
+  return ERR_NO_ERROR;
+}
+
+m_error_t TDFTimeSeries::dump(FILE *f, const char *prefix) const {
+  if(!f) return ERR_PARAM_NULL;
+  if(!prefix) prefix = "";
+  if(0 > fprintf(f,"%sTime series of %u samples in %u blocks, %u channels\n",prefix,
+		 (unsigned int)Samples,(unsigned int)Src.size(),
+		 (unsigned int)Channels.size())) return ERR_FILE_WRITE;
+  if(Src.size()){
+    if(0 > fprintf(f,"%s  from %lld to %lld ns\n",prefix,(long long)blockFirst(0),
+		   (long long)blockLast(Src.size() - 1))) return ERR_FILE_WRITE;
+  }
+  return ERR_NO_ERROR;
+}
+
+#ifdef TEST
+
+#include <stdio.h>
+#include <unistd.h>
+
+int main(int argc, char *argv[]){
+  m_error_t res;
+  size_t tests, errors;
+
+  tests = errors = 0;
+
+  // 1 kHz with a gap of one second after sample 6000
+  const size_t n = 10000;
+  const XDR::Long t0 = 1210000000LL * 1000000000LL;
+  XDR::Long *ts = new XDR::Long[n];
+  double *v = new double[n];
+  for(size_t i = 0; i < n; i++){
+    ts[i] = t0 + (XDR::Long)i * 1000000 + ((i >= 6000)? 1000000000LL : 0);
+    v[i] = i * 0.5;
+  }
+  char path[64];
+  snprintf(path,sizeof(path),"/tmp/test-TDFTimeSeries-%d.tdf",(int)getpid());
+
+  printf("Test %d: Write a time series\n",++tests);
+  do {
+    TDFTimeSeries ser(512);
+    XDR::Long bad[2] = { 2, 1 };
+    if(ser.times(bad,2) != ERR_PARAM_RANG){
+      res = ERR_INT_DATA;
+      break;
+    }
+    res = ser.times(ts,n);
+    if(res != ERR_NO_ERROR) break;
+    TDDoubleArray va(v,n);
+    TDDoubleArray short_ch(v,n-1);
+    res = ser.addChannel(va);
+    if(res != ERR_NO_ERROR) break;
+    TaggedDataFile tdf;
+    res = tdf.addItem(ser);
+    if(res != ERR_NO_ERROR) break;
+    FileDump f(path);
+    res = tdf.write(f,true);
+    if(res != ERR_NO_ERROR) break;
+    // channels must match the time stamps
+    res = ser.addChannel(short_ch);
+    if(res != ERR_NO_ERROR) break;
+    m_error_t xerr;
+    BerTree *tr = ser.writeTag(&xerr);
+    if(tr || (xerr != ERR_PARAM_LEN)){
+      if(tr) delete tr;
+      res = ERR_INT_DATA;
+    }
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: writing the time series failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ Writing the time series finished OK!");
+  }
+
+  printf("Test %d: seek() and time()\n",++tests);
+  do {
+    if(res != ERR_NO_ERROR) break;
+    TaggedDataFile rd;
+    res = rd.open(path);
+    if(res != ERR_NO_ERROR) break;
+    TDFTimeSeries ser;
+    res = rd.fetchItem(ser);
+    if(res != ERR_NO_ERROR) break;
+    ser.dump(stdout,"??? ");
+    const TDDoubleArray *va = dynamic_cast<const TDDoubleArray *>(ser.channel(0));
+    if((ser.size() != n) || (ser.blocks() != 20) || (ser.channels() != 1) || !va){
+      res = ERR_INT_DATA;
+      break;
+    }
+    size_t first, count;
+    // [1.5 ms, 3.2 ms]
+    res = ser.seek(t0 + 1500000, t0 + 3200000, first, count);
+    if(res != ERR_NO_ERROR) break;
+    if((first != 2) || (count != 2)){
+      res = ERR_INT_DATA;
+      break;
+    }
+    // across block boundaries
+    res = ser.seek(ts[1000], ts[2047], first, count);
+    if((res != ERR_NO_ERROR) || (first != 1000) || (count != 1048)){
+      res = ERR_INT_DATA;
+      break;
+    }
+    XDR::Long gt[1048];
+    double gv[1048];
+    res = ser.time(first,count,gt);
+    if(res == ERR_NO_ERROR) res = va->readRange(first,count,gv);
+    if(res != ERR_NO_ERROR) break;
+    for(size_t i = 0; i < count; i++)
+      if((gt[i] != ts[first + i]) || (gv[i] != v[first + i])) res = ERR_INT_DATA;
+    if(res != ERR_NO_ERROR) break;
+    // inside the gap, before and after all samples
+    if((ser.seek(ts[5999] + 1, ts[6000] - 1, first, count) != ERR_NO_ERROR) ||
+       (first != 6000) || (count != 0) ||
+       (ser.seek(0, t0 - 1, first, count) != ERR_NO_ERROR) || (first != 0) || (count != 0) ||
+       (ser.seek(ts[n-1] + 1, ts[n-1] + 2, first, count) != ERR_NO_ERROR) ||
+       (first != n) || (count != 0) ||
+       (ser.seek(0, ts[n-1], first, count) != ERR_NO_ERROR) || (first != 0) || (count != n) ||
+       (ser.seek(2, 1, first, count) != ERR_PARAM_RANG) ||
+       (ser.time(n-1, 2, gt) != ERR_PARAM_RANG))
+      res = ERR_INT_DATA;
+  } while(0);
+  unlink(path);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: seek() failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ seek() finished OK!");
+  }
+
+  printf("Test %d: Encoded channels of native widths\n",++tests);
+  do {
+    const size_t m = 1000;
+    short vs[m], gs[m];
+    long long vl[m], gl[m];
+    for(size_t i = 0; i < m; i++){
+      vs[i] = (short)(i * 3 - 1500);
+      vl[i] = (long long)i * 5000000000LL;
+    }
+    TDFTimeSeries ser(256);
+    TDShortArray sa(vs,m);
+    TDLongArray la(vl,m);
+    res = ser.times(ts,m);
+    if(res == ERR_NO_ERROR) res = sa.encoding(TDFCodec::DELTA | TDFCodec::VARINT);
+    if(res == ERR_NO_ERROR) res = la.encoding(TDFCodec::DELTA | TDFCodec::VARINT);
+    if(res == ERR_NO_ERROR) res = ser.addChannel(sa);
+    if(res == ERR_NO_ERROR) res = ser.addChannel(la);
+    if(res != ERR_NO_ERROR) break;
+    BerTree *tr = ser.writeTag(&res);
+    if(!tr) break;
+    TDFTimeSeries rd;
+    res = rd.readTag(*tr->root());
+    if(res == ERR_NO_ERROR){
+      // the array types are chosen by the stored element width
+      const TDShortArray *sr = dynamic_cast<const TDShortArray *>(rd.channel(0));
+      const TDLongArray *lr = dynamic_cast<const TDLongArray *>(rd.channel(1));
+      if((rd.channels() != 2) || !sr || !lr || (sr->readRange(0,m,gs) != ERR_NO_ERROR) ||
+	 (lr->readRange(0,m,gl) != ERR_NO_ERROR) || memcmp(gs,vs,sizeof(vs)) || memcmp(gl,vl,sizeof(vl)))
+	res = ERR_INT_DATA;
+    }
+    delete tr;
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: encoded channels failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ Encoded channels finished OK!");
+  }
+
+  delete[] ts;
+  delete[] v;
+
+  TDFTimeSeries ser;
+  printf("\n%d tests completed with %d errors.\n",tests,errors);
+  printf("Used version: %s\n",ser.VersionTag());
+
+  return 0;
+}
+
+#endif // TEST
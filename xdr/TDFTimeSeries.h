@@ -0,0 +1,157 @@
+/*
+ *
+ * Tagged Data File as an exchange standard for binary data,
+ * which draws on BER for tagging,
+ * on ASN.1 where applicable, and
+ * on RFC 1832 - Sun XDR for some storage formats
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *
+ * TDFTimeSeries - time stamped samples with a block index
+ *
+ * This defines the values:
+ *
+ */
+
+#ifndef _XDR_TDFTIMESERIES_H_
+# define _XDR_TDFTIMESERIES_H_
+
+#include <TaggedDataArrays.h>
+#include <vector>
+
+/*! \file TDFTimeSeries.h
+    \brief Time series item of a TaggedDataFile
+
+    A time series holds sorted time stamps as signed nanoseconds
+    since the epoch and any number of TDArray channels with one
+    element per time stamp:
+
+    \verbatim
+    [APPLICATION 25] {
+      INTEGER samples,
+      INTEGER samples per block,
+      INTEGER encoding,
+      [6] index,
+      [7] { [2] block ... },
+      SEQUENCE { channel ... }
+    }
+    \endverbatim
+
+    The time stamps are split into blocks, which are encoded by
+    TDFCodec, by default with DELTA and VARINT. The index holds
+    the first and last time stamp of each block as XDR hyper, so
+    seek() finds the blocks of an interval by binary search in the
+    file image and decodes at most two blocks. Channels should be
+    plain arrays, so that TDArray::readRange() only touches the
+    samples found.
+
+    \author Dr. Lars Hanke
+    \date 2006-2008
+*/
+
+namespace mgr {
+
+/*! \class TDFTimeSeries
+    \brief Time stamped samples with a block index
+*/
+class TDFTimeSeries : public TDFItem {
+public:
+  enum SeriesTags {
+    INDEX = 0x06,
+    BLOCKS = 0x07
+  };
+  enum {
+    DEFAULT_BLOCK = 4096,    //!< Default number of time stamps per block
+    ENTRY_SIZE = 16          //!< Octets per block in the index
+  };
+
+  typedef BerContentTag::TagString<(int)TaggedDataFile::TIME_SERIES,
+    BerContentTag::BER_CONSTRUCTED, BerContentTag::BER_APPLICATION> tTimeSeries;
+  typedef BerContentTag::TagString<(int)INDEX,
+    BerContentTag::BER_PRIMITIVE, BerContentTag::BER_CONTEXT> tIndex;
+  typedef BerContentTag::TagString<(int)BLOCKS,
+    BerContentTag::BER_CONSTRUCTED, BerContentTag::BER_CONTEXT> tBlocks;
+
+protected:
+  unsigned int Encoding;
+  size_t Block;
+  size_t Samples;
+
+  // written
+  std::vector<XDR::Long> Times;
+  std::vector<BerTree *> Pending;      // channel trees to write
+  std::vector<size_t> PendingSize;     // elements of each channel
+
+  // read
+  const unsigned char *Index;          // ENTRY_SIZE octets per block
+  std::vector<const unsigned char *> Src;
+  std::vector<size_t> Len;
+  std::vector<_TDArray *> Channels;
+
+  inline XDR::Long blockFirst(size_t b) const {
+    return XDR::xdrRead<XDR::Long>(Index + b * ENTRY_SIZE);
+  }
+  inline XDR::Long blockLast(size_t b) const {
+    return XDR::xdrRead<XDR::Long>(Index + b * ENTRY_SIZE + 8);
+  }
+  m_error_t decodeBlock(size_t b, std::vector<XDR::Long>& t) const;
+  void clearRead(void);
+
+private:
+  TDFTimeSeries(const TDFTimeSeries&);
+  TDFTimeSeries& operator=(const TDFTimeSeries&);
+
+public:
+  TDFTimeSeries(size_t block = DEFAULT_BLOCK);
+  virtual ~TDFTimeSeries();
+
+  //! Encoding of the time stamp blocks
+  m_error_t encoding(unsigned int e);
+  unsigned int encoding(void) const {
+    return Encoding;
+  }
+
+  //! Set the sorted time stamps to write
+  m_error_t times(const XDR::Long *t, size_t n);
+  //! Add a channel with one element per time stamp
+  m_error_t addChannel(const _TDArray& a);
+  //! Discard everything written or read
+  void clear(void);
+
+  //! Number of time stamps read
+  size_t size(void) const {
+    return Samples;
+  }
+  //! Number of blocks read
+  size_t blocks(void) const {
+    return Src.size();
+  }
+  //! Number of channels read
+  size_t channels(void) const {
+    return Channels.size();
+  }
+  //! Channel read, e.g. dynamic_cast to TDDoubleArray
+  const _TDArray *channel(size_t k) const {
+    return (k < Channels.size())? Channels[k] : NULL;
+  }
+
+  //! Samples with time stamps in [t0, t1]
+  m_error_t seek(XDR::Long t0, XDR::Long t1, size_t& first, size_t& count) const;
+  //! Decode count time stamps starting at sample first
+  m_error_t time(size_t first, size_t count, XDR::Long *t) const;
+
+  virtual BerTree *writeTag(m_error_t *err = NULL) const;
+  virtual m_error_t readTag(const BerTag& t);
+  virtual m_error_t dump(FILE *f = stdout, const char *prefix = NULL) const;
+
+  const char *VersionTag(void) const;
+};
+
+}; // namespace mgr
+
+#endif // _XDR_TDFTIMESERIES_H_
@@ -0,0 +1,521 @@
+/*
+ *
+ * Tagged Data File as an exchange standard for binary data,
+ * which draws on BER for tagging,
+ * on ASN.1 where applicable, and
+ * on RFC 1832 - Sun XDR for some storage formats
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *
+ * TDFWriter - streaming append-only writer of a TaggedDataFile
+ *
+ * This defines the values:
+ *
+ */
+
+#include "TDFWriter.h"
+#include "TDFWriter.tag"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace mgr;
+
+const char * TDFWriter::VersionTag(void) const {
+  return _VERSION_;
+}
+
+/*! \param path Name of the file, which is created or truncated
+    \param idx Append a TDFIndex of the top-level items on close()
+    \param ch Size of the buffers
+    \param bg Write full buffers by a background thread
+*/
+TDFWriter::TDFWriter(const char *path, bool idx, size_t ch, bool bg) {
+  if(!path) mgrThrow(ERR_PARAM_NULL);
+  int f = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(f < 0) mgrThrow(ERR_FILE_OPEN);
+  m_error_t res = init(f,true,idx,ch,bg);
+  if(res != ERR_NO_ERROR){
+    ::close(f);
+    mgrThrow(res);
+  }
+}
+
+/*! \param f Open file descriptor, written from its current offset
+    \param idx Append a TDFIndex of the top-level items on close()
+    \param ch Size of the buffers
+    \param bg Write full buffers by a background thread
+
+    Scopes need a file, which is seekable and not opened with
+    O_APPEND. close() leaves the offset of f behind the data
+    written.
+*/
+TDFWriter::TDFWriter(int f, bool idx, size_t ch, bool bg) {
+  if(f < 0) mgrThrow(ERR_PARAM_RANG);
+  m_error_t res = init(f,false,idx,ch,bg);
+  if(res != ERR_NO_ERROR) mgrThrow(res);
+}
+
+TDFWriter::~TDFWriter() {
+  close();
+  if(fill) ::free(fill);
+  if(drain) ::free(drain);
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&lock);
+}
+
+m_error_t TDFWriter::init(int f, bool own, bool idx, size_t ch, bool bg){
+  pthread_mutex_init(&lock,NULL);
+  pthread_cond_init(&cond,NULL);
+  fd = f;
+  ownFd = own;
+  failed = ERR_NO_ERROR;
+  chunk = (ch)? ch : (size_t)DEFAULT_CHUNK;
+  used = fillAt = drainLen = drainAt = 0;
+  drain = NULL;
+  background = stop = false;
+  withIndex = idx;
+
+  base = ::lseek(fd, 0, SEEK_CUR);
+  // pwrite() ignores the offset for O_APPEND
+  int fl = ::fcntl(fd, F_GETFL);
+  seekable = (base >= 0) && (fl >= 0) && !(fl & O_APPEND);
+  if(!seekable) base = 0;
+
+  fill = (unsigned char *)::malloc(chunk);
+  if(fill && bg) drain = (unsigned char *)::malloc(chunk);
+  if(!fill || (bg && !drain)){
+    // the CTOR throws, so the DTOR does not clean up
+    if(fill) ::free(fill);
+    fill = NULL;
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&lock);
+    return ERR_MEM_AVAIL;
+  }
+  // without a thread the writer stays synchronous
+  if(bg) background = !pthread_create(&thread, NULL, worker, this);
+  return ERR_NO_ERROR;
+}
+
+void *TDFWriter::worker(void *arg){
+  static_cast<TDFWriter *>(arg)->run();
+  return NULL;
+}
+
+void TDFWriter::run(void){
+  pthread_mutex_lock(&lock);
+  for(;;){
+    while(!drainLen && !stop) pthread_cond_wait(&cond,&lock);
+    if(!drainLen) break;
+    // drain is not touched by the producer, until drainLen is reset
+    pthread_mutex_unlock(&lock);
+    m_error_t res = writeOut(drain,drainLen,drainAt);
+    pthread_mutex_lock(&lock);
+    if((res != ERR_NO_ERROR) && (failed == ERR_NO_ERROR)) failed = res;
+    drainLen = 0;
+    pthread_cond_broadcast(&cond);
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+m_error_t TDFWriter::writeOut(const unsigned char *d, size_t l, size_t at){
+  while(l){
+    ssize_t w = (seekable)? ::pwrite(fd, d, l, base + (off_t)at) : ::write(fd, d, l);
+    if(w < 0){
+      if(errno == EINTR) continue;
+      return ERR_FILE_WRITE;
+    }
+    d += w;
+    l -= w;
+    at += w;
+  }
+  return ERR_NO_ERROR;
+}
+
+// pass the fill buffer on for writing
+m_error_t TDFWriter::handoff(void){
+  if(!used) return failed;
+  m_error_t res;
+  if(!background){
+    res = writeOut(fill,used,fillAt);
+    fillAt += used;
+    used = 0;
+    if(res != ERR_NO_ERROR) failed = res;
+    return res;
+  }
+  pthread_mutex_lock(&lock);
+  while(drainLen) pthread_cond_wait(&cond,&lock);
+  unsigned char *t = drain;
+  drain = fill;
+  fill = t;
+  drainLen = used;
+  drainAt = fillAt;
+  fillAt += used;
+  used = 0;
+  res = failed;
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&lock);
+  return res;
+}
+
+// wait for the background thread to finish the drain buffer
+m_error_t TDFWriter::settle(void){
+  if(!background) return failed;
+  pthread_mutex_lock(&lock);
+  while(drainLen) pthread_cond_wait(&cond,&lock);
+  m_error_t res = failed;
+  pthread_mutex_unlock(&lock);
+  return res;
+}
+
+// overwrite l octets at output offset at, which were written before
+m_error_t TDFWriter::patch(size_t at, const unsigned char *d, size_t l){
+  // octets already passed on
+  size_t k = (at < fillAt)? fillAt - at : 0;
+  if(k > l) k = l;
+  if(k < l) memcpy(fill + (at + k - fillAt), d + k, l - k);
+  if(!k) return ERR_NO_ERROR;
+  if(!seekable) return ERR_PARAM_SEL;
+  m_error_t res = settle();
+  if(res != ERR_NO_ERROR) return res;
+  res = writeOut(d,k,at);
+  if(res != ERR_NO_ERROR) failed = res;
+  return res;
+}
+
+// record a top-level item in the index
+m_error_t TDFWriter::item(const BerContentTag& t, size_t start){
+  if(!withIndex || !scopes.empty()) return ERR_NO_ERROR;
+  return index.add(t, start, tell() - start);
+}
+
+m_error_t TDFWriter::write(const void *data, size_t *s){
+  if(!data || !s) return ERR_PARAM_NULL;
+  if(fd < 0) return ERR_FILE_CLOSE;
+  if(failed != ERR_NO_ERROR) return failed;
+  const unsigned char *d = (const unsigned char *)data;
+  size_t l = *s;
+  while(l){
+    if(!used && !background && (l >= chunk)){
+      // large blocks bypass the buffer
+      m_error_t res = writeOut(d,l,fillAt);
+      if(res != ERR_NO_ERROR) return failed = res;
+      fillAt += l;
+      break;
+    }
+    size_t n = chunk - used;
+    if(n > l) n = l;
+    memcpy(fill + used, d, n);
+    used += n;
+    d += n;
+    l -= n;
+    if(used == chunk){
+      m_error_t res = handoff();
+      if(res != ERR_NO_ERROR) return res;
+    }
+  }
+  return ERR_NO_ERROR;
+}
+
+m_error_t TDFWriter::putchar(const void *data){
+  size_t s = 1;
+  return write(data,&s);
+}
+
+/*! \return Error code as defined in mgrError.h
+
+    Returns, when all data added has been passed to the OS. Open
+    scopes still have their length fields to be patched.
+*/
+m_error_t TDFWriter::flush(void){
+  m_error_t res = handoff();
+  if(res != ERR_NO_ERROR) return res;
+  return settle();
+}
+
+/*! \param t Tag of the scope, which must be constructed
+    \return Error code as defined in mgrError.h
+
+    ERR_PARAM_SEL is returned, if the file is not seekable.
+*/
+m_error_t TDFWriter::openScope(const BerContentTag& t){
+  if(t.Type() != BerContentTag::BER_CONSTRUCTED) return ERR_PARAM_OPT;
+  if(!seekable) return ERR_PARAM_SEL;
+  Scope sc;
+  sc.number = t.Number();
+  sc.type = t.Type();
+  sc.cls = t.Class();
+  sc.start = tell();
+
+  size_t s = t.byte_size();
+  m_error_t res = write(t.readPtr(),&s);
+  if(res != ERR_NO_ERROR) return res;
+  // long form of 8 octets to be patched by closeScope()
+  unsigned char len[LENGTH_SIZE];
+  memset(len,0,LENGTH_SIZE);
+  len[0] = 0x80 | (LENGTH_SIZE - 1);
+  s = LENGTH_SIZE;
+  res = write(len,&s);
+  if(res != ERR_NO_ERROR) return res;
+  sc.content = tell();
+  scopes.push_back(sc);
+  return ERR_NO_ERROR;
+}
+
+/*! \return Error code as defined in mgrError.h
+
+    ERR_INT_SEQ is returned, if there is no open scope.
+*/
+m_error_t TDFWriter::closeScope(void){
+  if(scopes.empty()) return ERR_INT_SEQ;
+  const Scope sc = scopes.back();
+  scopes.pop_back();
+
+  size_t l = tell() - sc.content;
+  unsigned char len[LENGTH_SIZE];
+  len[0] = 0x80 | (LENGTH_SIZE - 1);
+  for(int i = LENGTH_SIZE - 1; i > 0; i--){
+    len[i] = (unsigned char)(l & 0xff);
+    l >>= 8;
+  }
+  m_error_t res = patch(sc.content - LENGTH_SIZE, len, LENGTH_SIZE);
+  if(res != ERR_NO_ERROR) return res;
+  return item(BerContentTag(sc.number,sc.type,sc.cls), sc.start);
+}
+
+/*! \param it Item to write
+    \return Error code as defined in mgrError.h
+*/
+m_error_t TDFWriter::addItem(const TDFItem& it){
+  m_error_t res;
+  BerTree *itr = it.writeTag(&res);
+  if(res != ERR_NO_ERROR) return res;
+  if(!itr) return ERR_PARAM_NULL;
+  res = addTag(*itr);
+  delete itr;
+  return res;
+}
+
+/*! \param tr Tree to write including the siblings of its root
+    \return Error code as defined in mgrError.h
+*/
+m_error_t TDFWriter::addTag(BerTree& tr){
+  if(failed != ERR_NO_ERROR) return failed;
+  BerTag *c = tr.root();
+  if(!c) return ERR_PARAM_NULL;
+  size_t start = tell();
+  m_error_t res = tr.write(*this,true);
+  if(res != ERR_NO_ERROR) return res;
+  if(!withIndex || !scopes.empty()) return ERR_NO_ERROR;
+  for(; c; c = static_cast<BerTag *>(c->getNext())){
+    res = index.add(c->tag(), start, c->size());
+    if(res != ERR_NO_ERROR) return res;
+    start += c->size();
+  }
+  return ERR_NO_ERROR;
+}
+
+/*! \return Error code as defined in mgrError.h
+
+    Closes all open scopes, appends the index, if requested,
+    and writes all data. A file opened by the writer is closed.
+*/
+m_error_t TDFWriter::close(void){
+  if(fd < 0) return ERR_NO_ERROR;
+  m_error_t res = ERR_NO_ERROR;
+  while(!scopes.empty() && (res == ERR_NO_ERROR)) res = closeScope();
+  scopes.clear();
+  if((res == ERR_NO_ERROR) && withIndex) res = index.write(*this, tell());
+  index.clear();
+  m_error_t err = flush();
+  if(res == ERR_NO_ERROR) res = err;
+
+  if(background){
+    pthread_mutex_lock(&lock);
+    stop = true;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&lock);
+    pthread_join(thread,NULL);
+    background = false;
+  }
+  if(ownFd){
+    if((::close(fd) < 0) && (res == ERR_NO_ERROR)) res = ERR_FILE_CLOSE;
+  } else if(seekable){
+    ::lseek(fd, base + (off_t)tell(), SEEK_SET);
+  }
+  fd = -1;
+  return res;
+}
+
+#ifdef TEST
+
+#include <stdio.h>
+#include <TaggedDataArrays.h>
+
+static const size_t items = 5, n = 100;
+
+static void sample(double *d, size_t k){
+  for(size_t i = 0; i < n; i++) d[i] = k * 1000.0 + i * 0.5;
+}
+
+static m_error_t produce(TDFWriter& w){
+  double d[n];
+  int v[n];
+  for(size_t i = 0; i < n; i++) v[i] = (int)i - 50;
+  const BerContentTag scope(3, BerContentTag::BER_CONSTRUCTED, BerContentTag::BER_PRIVATE);
+
+  m_error_t res = w.addItem(TDIntArray(v,n));
+  if(res == ERR_NO_ERROR) res = w.openScope(scope);
+  for(size_t k = 0; (k < items) && (res == ERR_NO_ERROR); k++){
+    sample(d,k);
+    res = w.addItem(TDDoubleArray(d,n));
+  }
+  // nested scope
+  if(res == ERR_NO_ERROR) res = w.openScope(scope);
+  if(res == ERR_NO_ERROR) res = w.addItem(TDIntArray(v,n/2));
+  if(res == ERR_NO_ERROR) res = w.closeScope();
+  if(res == ERR_NO_ERROR) res = w.closeScope();
+  if(res == ERR_NO_ERROR) res = w.addItem(TDIntArray(v+1,n-1));
+  if(res == ERR_NO_ERROR) res = w.close();
+  return res;
+}
+
+static m_error_t verify(const char *path){
+  TaggedDataFile rd;
+  m_error_t res = rd.open(path);
+  if(res != ERR_NO_ERROR) return res;
+  if(!rd.indexed()) return ERR_INT_STATE;
+
+  int v[n];
+  TDIntArray ia;
+  res = rd.fetchItem(ia,2);
+  if(res != ERR_NO_ERROR) return res;
+  if((ia.size() != n - 1) || (ia.get(v) != ERR_NO_ERROR) || (v[0] != -49))
+    return ERR_INT_DATA;
+
+  const BerContentTag scope(3, BerContentTag::BER_CONSTRUCTED, BerContentTag::BER_PRIVATE);
+  res = rd.enterScope(scope);
+  if(res != ERR_NO_ERROR) return res;
+  double d[n], e[n];
+  for(size_t k = 0; k < items; k++){
+    TDDoubleArray da;
+    res = rd.readItem(da,1,false);
+    if(!rd.readOk(res)) return res;
+    if((da.size() != n) || (da.get(d) != ERR_NO_ERROR)) return ERR_PARAM_LEN;
+    sample(e,k);
+    if(memcmp(d,e,sizeof(d))) return ERR_INT_DATA;
+  }
+  res = rd.enterScope(scope,1,false);
+  if(res != ERR_NO_ERROR) return res;
+  res = rd.readItem(ia,1,false);
+  if(!rd.readOk(res)) return res;
+  if(ia.size() != n/2) return ERR_PARAM_LEN;
+  return ERR_NO_ERROR;
+}
+
+int main(int argc, char *argv[]){
+  m_error_t res;
+  size_t tests, errors;
+  char path[64];
+  snprintf(path,sizeof(path),"/tmp/test-TDFWriter-%d.tdf",(int)getpid());
+
+  tests = errors = 0;
+
+  try{
+    printf("Test %d: Synchronous writer patching lengths on disk\n",++tests);
+    {
+      TDFWriter w(path,true,64);
+      res = produce(w);
+    }
+    if(res == ERR_NO_ERROR) res = verify(path);
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: synchronous TDFWriter failed 0x%.4x\n",(int)res);
+    } else {
+      puts("+++ Synchronous TDFWriter finished OK!");
+    }
+
+    printf("Test %d: Background writer\n",++tests);
+    {
+      TDFWriter w(path,true,256,true);
+      res = produce(w);
+    }
+    if(res == ERR_NO_ERROR) res = verify(path);
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: background TDFWriter failed 0x%.4x\n",(int)res);
+    } else {
+      puts("+++ Background TDFWriter finished OK!");
+    }
+    unlink(path);
+
+    printf("Test %d: Writer on a pipe\n",++tests);
+    do {
+      int p[2];
+      if(pipe(p) < 0){
+	res = ERR_FILE_OPEN;
+	break;
+      }
+      int v[10] = {0,1,2,3,4,5,6,7,8,9};
+      {
+	TDFWriter w(p[1]);
+	const BerContentTag scope(3, BerContentTag::BER_CONSTRUCTED, BerContentTag::BER_PRIVATE);
+	if(w.openScope(scope) != ERR_PARAM_SEL) res = ERR_INT_DATA;
+	else res = w.addItem(TDIntArray(v,10));
+	if(res == ERR_NO_ERROR) res = w.close();
+      }
+      ::close(p[1]);
+      unsigned char buf[256];
+      ssize_t l = (res == ERR_NO_ERROR)? ::read(p[0],buf,sizeof(buf)) : 0;
+      ::close(p[0]);
+      if(res != ERR_NO_ERROR) break;
+      TaggedDataFile rd;
+      res = rd.read(buf,(size_t)l);
+      if(res != ERR_NO_ERROR) break;
+      TDIntArray ia;
+      res = rd.fetchItem(ia);
+      if(res != ERR_NO_ERROR) break;
+      int g[10];
+      if((ia.size() != 10) || (ia.get(g) != ERR_NO_ERROR) || memcmp(g,v,sizeof(v)))
+	res = ERR_INT_DATA;
+    } while(0);
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: TDFWriter on a pipe failed 0x%.4x\n",(int)res);
+    } else {
+      puts("+++ TDFWriter on a pipe finished OK!");
+    }
+
+    printf("Test %d: Failing initialization\n",++tests);
+    res = ERR_INT_STATE;
+    try{
+      TDFWriter w(1,false,~(size_t)0 >> 1,true);
+    }
+    catch(Exception& e){
+      res = (e.getCause() == ERR_MEM_AVAIL)? ERR_NO_ERROR : e.getCause();
+    }
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: failing TDFWriter initialization 0x%.4x\n",(int)res);
+    } else {
+      puts("+++ Failing TDFWriter initialization finished OK!");
+    }
+
+    printf("\n%d tests completed with %d errors.\n",tests,errors);
+    printf("Used version: %s\n",_VERSION_);
+  }
+  catch(Exception& e){
+    printf("*** Caught mgr::Exception: %s\n",e.what());
+  }
+
+  return 0;
+}
+
+#endif // TEST
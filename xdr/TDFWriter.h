@@ -0,0 +1,163 @@
+/*
+ *
+ * Tagged Data File as an exchange standard for binary data,
+ * which draws on BER for tagging,
+ * on ASN.1 where applicable, and
+ * on RFC 1832 - Sun XDR for some storage formats
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *
+ * TDFWriter - streaming append-only writer of a TaggedDataFile
+ *
+ * This defines the values:
+ *
+ */
+
+#ifndef _XDR_TDFWRITER_H_
+# define _XDR_TDFWRITER_H_
+
+#include <TaggedDataFile.h>
+#include <StreamDump.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <vector>
+
+/*! \file TDFWriter.h
+    \brief Streaming writer of a TaggedDataFile
+
+    TaggedDataFile collects all items in memory before write()
+    serializes the tree. TDFWriter instead writes items to the
+    file as they are added. Memory is bounded by two buffers of
+    chunk octets each and, if requested, by the TDFIndex entries
+    of 32 octets per top-level item.
+
+    \code
+    TDFWriter w("run.tdf", true);
+    w.openScope(scopeTag);
+    for(...) w.addItem(TDDoubleArray(samples, n));
+    w.closeScope();
+    w.close();
+    \endcode
+
+    The length of a scope is not known before it is closed. The
+    writer reserves a length field of 8 octets in long form and
+    patches it, when the scope is closed. Such files are valid BER,
+    but not DER. Since the patch needs a seekable file, scopes are
+    rejected on pipes and sockets, where only top-level items can
+    be streamed.
+
+    With background set, a thread writes the full buffer, while
+    the next one is filled.
+
+    \author Dr. Lars Hanke
+    \date 2006-2008
+*/
+
+namespace mgr {
+
+/*! \class TDFWriter
+    \brief Streaming append-only writer of a TaggedDataFile
+*/
+class TDFWriter : public StreamDump {
+public:
+  enum {
+    DEFAULT_CHUNK = 1 << 20,  //!< Default buffer size
+    LENGTH_SIZE = 9           //!< Octets of the length field of a scope
+  };
+
+protected:
+  //! Open scope
+  struct Scope {
+    size_t number;                     //!< Tag number
+    BerContentTag::BerTagType type;    //!< Tag type
+    BerContentTag::BerTagClass cls;    //!< Tag class
+    size_t start;                      //!< Offset of the tag
+    size_t content;                    //!< Offset of the contents
+  };
+
+  int fd;                   //!< File written
+  bool ownFd;               //!< fd is closed by close()
+  bool seekable;            //!< fd supports pwrite()
+  off_t base;               //!< File offset of the first octet written
+  m_error_t failed;         //!< First error of a write, sticky
+
+  size_t chunk;             //!< Size of the buffers
+  unsigned char *fill;      //!< Buffer being filled
+  size_t used;              //!< Octets in fill
+  size_t fillAt;            //!< Offset of fill[0] in the output
+  unsigned char *drain;     //!< Buffer being written by the thread
+  size_t drainLen;          //!< Octets in drain, 0 if idle
+  size_t drainAt;           //!< Offset of drain[0] in the output
+
+  bool background;          //!< The thread is running
+  bool stop;                //!< Ask the thread to terminate
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+
+  std::vector<Scope> scopes;
+  bool withIndex;
+  TDFIndex index;
+
+  m_error_t init(int f, bool own, bool idx, size_t ch, bool bg);
+  m_error_t writeOut(const unsigned char *d, size_t l, size_t at);
+  m_error_t handoff(void);
+  m_error_t settle(void);
+  m_error_t patch(size_t at, const unsigned char *d, size_t l);
+  m_error_t item(const BerContentTag& t, size_t start);
+  static void *worker(void *arg);
+  void run(void);
+
+private:
+  TDFWriter(const TDFWriter&);
+  TDFWriter& operator=(const TDFWriter&);
+
+public:
+  //! Create or truncate the file path
+  TDFWriter(const char *path, bool idx = false,
+	    size_t ch = DEFAULT_CHUNK, bool bg = false);
+  //! Write to an open file descriptor, which is not closed
+  TDFWriter(int f, bool idx = false,
+	    size_t ch = DEFAULT_CHUNK, bool bg = false);
+  virtual ~TDFWriter();
+
+  //! Open a constructed scope
+  m_error_t openScope(const BerContentTag& t);
+  //! Close the innermost scope patching its length
+  m_error_t closeScope(void);
+  //! Number of open scopes
+  inline size_t depth(void) const {
+    return scopes.size();
+  }
+  //! Octets written so far
+  inline size_t tell(void) const {
+    return fillAt + used;
+  }
+
+  //! Write an item
+  m_error_t addItem(const TDFItem& it);
+  //! Write a BerTree starting from its root
+  m_error_t addTag(BerTree& tr);
+
+  // StreamDump interface
+  virtual m_error_t write(const void *data, size_t *s);
+  virtual m_error_t putchar(const void *data);
+  //! Pass the buffered data to the OS
+  virtual m_error_t flush(void);
+  //! Close all scopes, append the index and close the file
+  virtual m_error_t close(void);
+  virtual bool valid(void) const {
+    return (fd >= 0) && (failed == ERR_NO_ERROR);
+  }
+
+  const char *VersionTag(void) const;
+};
+
+}; // namespace mgr
+
+#endif // _XDR_TDFWRITER_H_
@@ -30,6 +30,12 @@
 
 #include "TaggedDataArrays.h"
 #include "TaggedDataArrays.tag"
+#include <FastFormat.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <vector>
 
 using namespace mgr;
 
@@ -48,6 +54,21 @@ const unsigned char _TDArray::bDoubleArray[tDoubleArray::SIZE] = {
   BerContentTag::BER_CONSTRUCTED, BerContentTag::BER_APPLICATION >::VALUE
 };
 
+const unsigned char _TDArray::bFloatArray[tFloatArray::SIZE] = {
+  BerContentTag::TagByte<(int)TaggedDataFile::FLOAT_ARRAY, 0,
+  BerContentTag::BER_CONSTRUCTED, BerContentTag::BER_APPLICATION >::VALUE
+};
+
+const unsigned char _TDArray::bUIntArray[tUIntArray::SIZE] = {
+  BerContentTag::TagByte<(int)TaggedDataFile::UINT_ARRAY, 0,
+  BerContentTag::BER_CONSTRUCTED, BerContentTag::BER_APPLICATION >::VALUE
+};
+
+const unsigned char _TDArray::bComplexArray[tComplexArray::SIZE] = {
+  BerContentTag::TagByte<(int)TaggedDataFile::COMPLEX_ARRAY, 0,
+  BerContentTag::BER_CONSTRUCTED, BerContentTag::BER_APPLICATION >::VALUE
+};
+
 BerTree *_TDArray::arrayCoreWrite(const BerContentTag& mtag, 
 				  const _wtBuffer& c,  
 				  m_error_t& err) const {
@@ -76,16 +97,23 @@ BerTree *_TDArray::arrayCoreWrite(const BerContentTag& mtag,
       break;
     }
     st->insertChild(tia);
-    tia = new BerTag((int)ASN1IO::ASN1_SEQ,
-		     BerContentTag::BER_PRIMITIVE, 
-		     BerContentTag::BER_UNIVERSAL);
-    if(!tia){
-      err = ERR_MEM_AVAIL;
-      break;
-    }
-    err = tia->content(c);
-    st->appendChild(tia,true);
     tia = NULL;
+    if((Encoding != TDFCodec::RAW) && c.byte_size()){
+      err = blocksWrite(st, c);
+    } else {
+      tia = new BerTag((int)ASN1IO::ASN1_SEQ,
+		       BerContentTag::BER_PRIMITIVE, 
+		       BerContentTag::BER_UNIVERSAL);
+      if(!tia){
+	err = ERR_MEM_AVAIL;
+	break;
+      }
+      err = tia->content(c);
+      st->appendChild(tia,true);
+      tia = NULL;
+    }
+    if((err == ERR_NO_ERROR) && !Shape.empty())
+      err = shapeWrite(st, c.byte_size() / c.rec_size());
   } while(0);
   if(err != ERR_NO_ERROR){
     if(tia) delete tia;
@@ -106,6 +134,8 @@ m_error_t _TDArray::arrayCoreRead(const BerContentTag& mtag,
   BerTree at(const_cast<BerTag *>(arry));
   at.iteratorOnly(true);
 
+  Shape.clear();
+  Stride.clear();
   arry = at.child();
   if(!arry){
     // empty array
@@ -119,6 +149,18 @@ m_error_t _TDArray::arrayCoreRead(const BerContentTag& mtag,
 
   arry = at.next();
   if(!arry) return ERR_PARAM_UDEF;
+  if(tEncoded::isEqual(arry->tag().readPtr())){
+    res = blocksRead(at, num, c);
+    if(res != ERR_NO_ERROR) return res;
+    at.parent();
+    return shapeRead(at.next(), num);
+  }
+
+  if(!num){
+    if(arry->c_size()) return ERR_PARAM_LEN;
+    c.free();
+    return shapeRead(at.next(), num);
+  }
 
   size_t rec = arry->c_size() / num;
   if(arry->c_size() % num) return ERR_PARAM_LEN;
@@ -129,8 +171,298 @@ m_error_t _TDArray::arrayCoreRead(const BerContentTag& mtag,
     return ERR_PARAM_TYP;
   }
   
+  Encoding = TDFCodec::RAW;
   // c is a _wtBuffer here, i.e. size in replace is bytes not records
-  return c.replace(arry->content().readPtr(), num * rec);
+  res = c.replace(arry->content().readPtr(), num * rec);
+  if(res != ERR_NO_ERROR) return res;
+  return shapeRead(at.next(), num);
+}
+
+/*
+ * N-D arrays
+ *
+ */
+
+/*! \param rank Number of dimensions, 0 for a plain array
+    \param dims rank dimensions, the first one varying slowest
+    \param strides rank distances of neighbouring elements in each
+    dimension, NULL for a dense row-major layout
+    \return Error code as defined in mgrError.h
+
+    The strides count elements, i.e. a complex number is one element.
+    Whether the shape fits the array is checked by writeTag().
+*/
+m_error_t _TDArray::shape(size_t rank, const size_t *dims, const size_t *strides){
+  if(rank && !dims) return ERR_PARAM_NULL;
+  Shape.assign(dims, dims + rank);
+  Stride.resize(rank);
+  size_t s = 1;
+  for(size_t k = rank; k--; ){
+    Stride[k] = (strides)? strides[k] : s;
+    s *= dims[k];
+  }
+  return ERR_NO_ERROR;
+}
+
+// number of elements addressed by the shape
+static size_t shapeExtent(const std::vector<size_t>& dims,
+			  const std::vector<size_t>& strides){
+  size_t e = 0;
+  for(size_t k = 0; k < dims.size(); k++){
+    if(!dims[k]) return 0;
+    e += (dims[k] - 1) * strides[k];
+  }
+  return e + 1;
+}
+
+/*! \param st Tree of the array
+    \param num Number of records
+    \return Error code as defined in mgrError.h
+
+    Appends the shape to the children of the array. Readers unaware
+    of it still find the element count and the data first.
+*/
+m_error_t _TDArray::shapeWrite(BerTree *st, size_t num) const {
+  if(shapeExtent(Shape, Stride) > num / Components) return ERR_PARAM_LEN;
+
+  st->root();
+  BerTag *t = new BerTag((size_t)SHAPE, BerContentTag::BER_CONSTRUCTED,
+			 BerContentTag::BER_CONTEXT);
+  if(!t) return ERR_MEM_AVAIL;
+  st->appendChild(t,true);
+  for(int v = 0; v < 2; v++){
+    const std::vector<size_t>& val = (v)? Stride : Shape;
+    t = new BerTag((int)ASN1IO::ASN1_SEQ, BerContentTag::BER_CONSTRUCTED,
+		   BerContentTag::BER_UNIVERSAL);
+    if(!t) return ERR_MEM_AVAIL;
+    st->appendChild(t,true);
+    for(size_t k = 0; k < val.size(); k++){
+      t = asn.writeIntPacked<size_t>(val[k]);
+      if(!t) return ERR_MEM_AVAIL;
+      st->appendChild(t);
+    }
+    st->parent();
+  }
+  return ERR_NO_ERROR;
+}
+
+/*! \param t Tag following the data, NULL if there is none
+    \param num Number of records
+    \return Error code as defined in mgrError.h
+*/
+m_error_t _TDArray::shapeRead(const BerTag *t, size_t num){
+  Shape.clear();
+  Stride.clear();
+  // ignore unknown extensions
+  if(!t || !tShape::isEqual(t->tag().readPtr())) return ERR_NO_ERROR;
+
+  BerTree at(const_cast<BerTag *>(t));
+  at.iteratorOnly(true);
+  m_error_t res = ERR_NO_ERROR;
+  for(int v = 0; (v < 2) && (res == ERR_NO_ERROR); v++){
+    std::vector<size_t>& val = (v)? Stride : Shape;
+    if(!((v)? at.next() : at.child())) return ERR_PARAM_UDEF;
+    const BerTag *i = at.child();
+    if(!i) continue;
+    for(; i && (res == ERR_NO_ERROR); i = at.next()){
+      size_t x = 0;
+      res = asn.readInt<size_t>(*i,x);
+      if(res == ERR_NO_ERROR) val.push_back(x);
+    }
+    at.parent();
+  }
+  if((res == ERR_NO_ERROR) && ((Shape.size() != Stride.size()) ||
+			       (shapeExtent(Shape, Stride) > num / Components)))
+    res = ERR_PARS_STX;
+  if(res != ERR_NO_ERROR){
+    Shape.clear();
+    Stride.clear();
+  }
+  return res;
+}
+
+/*
+ * Encoded arrays
+ *
+ */
+
+/*! \param st Tree of the array with the element count as current
+    \param c Elements in XDR byte order
+    \return Error code as defined in mgrError.h
+
+    Appends the encoded form of c. Each block is encoded into a buffer
+    of TDFCodec::bound() octets, which is truncated afterwards.
+*/
+m_error_t _TDArray::blocksWrite(BerTree *st, const _wtBuffer& c) const {
+  const size_t w = c.rec_size();
+  const size_t num = c.byte_size() / w;
+  const unsigned char *d = static_cast<const unsigned char *>(c.rawPtr());
+  if(!d) return ERR_INT_STATE;
+
+  BerTag *t = new BerTag((size_t)ENCODED, BerContentTag::BER_CONSTRUCTED,
+			 BerContentTag::BER_CONTEXT);
+  if(!t) return ERR_MEM_AVAIL;
+  st->appendChild(t,true);
+  t = asn.writeIntPacked<size_t>(Encoding);
+  if(!t) return ERR_MEM_AVAIL;
+  st->appendChild(t);
+  t = asn.writeIntPacked<size_t>(Block);
+  if(!t) return ERR_MEM_AVAIL;
+  st->appendChild(t);
+  t = asn.writeIntPacked<size_t>(w);
+  if(!t) return ERR_MEM_AVAIL;
+  st->appendChild(t);
+
+  for(size_t i = 0; i < num; i += Block){
+    const size_t n = (num - i < Block)? num - i : Block;
+    t = new BerTag((size_t)BLOCK, BerContentTag::BER_PRIMITIVE,
+		   BerContentTag::BER_CONTEXT);
+    if(!t) return ERR_MEM_AVAIL;
+    st->appendChild(t);
+    unsigned char *b = t->allocate(TDFCodec::bound(Encoding, n, w));
+    if(!b) return ERR_MEM_AVAIL;
+    size_t l;
+    m_error_t err = TDFCodec::encode(Encoding, d + i * w, n, w, b, l);
+    if(err != ERR_NO_ERROR) return err;
+    if(!t->allocate(l)) return ERR_MEM_AVAIL;
+  }
+  return ERR_NO_ERROR;
+}
+
+//! Encoded blocks decoded by one thread
+struct TDFDecodeJob {
+  unsigned int encoding;              //!< TDFCodec::Encodings
+  size_t width;                       //!< Octets per element
+  const unsigned char * const *src;   //!< Encoded blocks
+  const size_t *len;                  //!< Size of each encoded block
+  size_t block;                       //!< Elements per block
+  size_t num;                         //!< Elements of the entire array
+  size_t first;                       //!< First block to decode
+  size_t last;                        //!< Block behind the last one
+  unsigned char *dst;                 //!< Start of the decoded array
+  m_error_t error;                    //!< Result
+};
+
+static void *decodeWorker(void *arg){
+  TDFDecodeJob *job = static_cast<TDFDecodeJob *>(arg);
+  job->error = ERR_NO_ERROR;
+  for(size_t i = job->first; (i < job->last) && (job->error == ERR_NO_ERROR); i++){
+    const size_t at = i * job->block;
+    const size_t n = (job->num - at < job->block)? job->num - at : job->block;
+    job->error = TDFCodec::decode(job->encoding, job->src[i], job->len[i],
+				  n, job->width, job->dst + at * job->width);
+  }
+  return NULL;
+}
+
+/*! \param at Tree of the array with the encoded tag as current
+    \param num Number of elements
+    \param c Receives the decoded elements
+    \return Error code as defined in mgrError.h
+
+    The blocks are independent, so Decoders threads decode
+    contiguous ranges of blocks concurrently. Unlike plain arrays
+    the result is a copy, which does not refer to the file image.
+*/
+m_error_t _TDArray::blocksRead(BerTree& at, size_t num, _wtBuffer& c){
+  const size_t w = c.rec_size();
+  size_t enc, block;
+
+  const BerTag *t = at.child();
+  if(!t) return ERR_PARAM_UDEF;
+  m_error_t res = asn.readInt<size_t>(*t,enc);
+  if(res != ERR_NO_ERROR) return res;
+  t = at.next();
+  if(!t) return ERR_PARAM_UDEF;
+  res = asn.readInt<size_t>(*t,block);
+  if(res != ERR_NO_ERROR) return res;
+  res = TDFCodec::check(enc);
+  if(res != ERR_NO_ERROR) return res;
+  if(!block || (num > ((size_t)-1) / w)) return ERR_PARAM_LEN;
+
+  t = at.next();
+  if(t && !tBlock::isEqual(t->tag().readPtr())){
+    // the element width is checked like the record size of plain arrays
+    size_t width;
+    res = asn.readInt<size_t>(*t,width);
+    if(res != ERR_NO_ERROR) return res;
+    if(width != w) return ERR_PARAM_TYP;
+    t = at.next();
+  }
+
+  std::vector<const unsigned char *> src;
+  std::vector<size_t> len;
+  for(; t; t = at.next()){
+    if(!tBlock::isEqual(t->tag().readPtr())) return ERR_PARS_STX;
+    src.push_back(t->content().readPtr());
+    len.push_back(t->c_size());
+  }
+  const size_t blocks = num / block + ((num % block)? 1 : 0);
+  if(src.size() != blocks) return ERR_PARS_STX;
+
+  res = c.allocate(num * w);
+  if(res != ERR_NO_ERROR) return res;
+  // freshly allocated, so the buffer is not shared
+  unsigned char *d = static_cast<unsigned char *>(const_cast<void *>(c.rawPtr()));
+
+  unsigned int threads = Decoders;
+  if(!threads){
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = (cpus > 0) ? static_cast<unsigned int>(cpus) : 1;
+  }
+  if(threads > blocks) threads = blocks;
+  if(!threads) threads = 1;
+
+  std::vector<TDFDecodeJob> job(threads);
+  for(unsigned int i = 0; i < threads; i++){
+    job[i].encoding = enc;
+    job[i].width = w;
+    job[i].src = &src[0];
+    job[i].len = &len[0];
+    job[i].block = block;
+    job[i].num = num;
+    job[i].first = (blocks * i) / threads;
+    job[i].last = (blocks * (i+1)) / threads;
+    job[i].dst = d;
+    job[i].error = ERR_NO_ERROR;
+  }
+
+  std::vector<pthread_t> tid(threads);
+  std::vector<bool> started(threads,false);
+  for(unsigned int i = 1; i < threads; i++){
+    started[i] = !pthread_create(&tid[i],NULL,decodeWorker,&job[i]);
+    // run it here, if no thread is available
+    if(!started[i]) decodeWorker(&job[i]);
+  }
+  decodeWorker(&job[0]);
+  for(unsigned int i = 0; i < threads; i++){
+    if(started[i]) pthread_join(tid[i],NULL);
+    if(res == ERR_NO_ERROR) res = job[i].error;
+  }
+
+  if(res != ERR_NO_ERROR){
+    c.free();
+    return res;
+  }
+  Encoding = enc;
+  Block = block;
+  return ERR_NO_ERROR;
+}
+
+/*! \param e Combination of TDFCodec::Encodings
+    \param block Number of elements per block
+    \return Error code as defined in mgrError.h
+
+    Selects the encoding used by writeTag(). TDFCodec::RAW
+    writes the plain XDR array readable by older versions.
+*/
+m_error_t _TDArray::encoding(unsigned int e, size_t block){
+  m_error_t res = TDFCodec::check(e);
+  if(res != ERR_NO_ERROR) return res;
+  if(!block) return ERR_PARAM_RANG;
+  Encoding = e;
+  Block = block;
+  return ERR_NO_ERROR;
 }
 
 const char * _TDArray::VersionTag(void) const {
@@ -152,68 +484,173 @@ BerTree *_TDArray::writeTagCore(const BerContentTag& mtag,
 }
 
 /*
- * Integer Implementation
+ * Text output of the elements
  *
  */
 
-namespace mgr {
+// fprintf() per element dominates the dump of large arrays, so the
+// lines are formatted by FastFormat.h and written in large pieces
+class DumpText {
+  enum { SIZE = 16384 };
+  FILE *f;
+  const char *prefix;
+  size_t pl;
+  char b[SIZE];
+  size_t used;
+  bool failed;
 
-template<>
-m_error_t TDIntArray::dump(FILE *f, const char *prefix) const {
+  inline char *room(size_t l){
+    if(SIZE - used < l) flush();
+    return b + used;
+  }
+  inline void flush(void){
+    if(used && (1 != fwrite(b,used,1,f))) failed = true;
+    used = 0;
+  }
+
+public:
+  DumpText(FILE *o, const char *p) : f(o), prefix((p)? p : ""), used(0), failed(false) {
+    pl = strlen(prefix);
+  }
+
+  //! Start a line with prefix and index
+  inline void index(size_t i){
+    if(pl > SIZE / 2){
+      flush();
+      if(1 != fwrite(prefix,pl,1,f)) failed = true;
+    } else {
+      memcpy(room(pl),prefix,pl);
+      used += pl;
+    }
+    char *p = formatUInt(room(FORMAT_INT_MAX + 2),i);
+    *p++ = ':';
+    *p++ = ' ';
+    used = p - b;
+  }
+  inline void value(long long v){
+    used = formatInt(room(FORMAT_INT_MAX),v) - b;
+  }
+  inline void value(unsigned long long v){
+    used = formatUInt(room(FORMAT_INT_MAX),v) - b;
+  }
+  //! Same as "%lf", or "%+lf" if sign is set
+  inline void value(double v, bool sign = false){
+    char *p = room(FORMAT_FIXED_MAX + 1);
+    if(sign && (copysign(1.0,v) > 0)) *p++ = '+';
+    used = formatFixed(p,v) - b;
+  }
+  inline void text(const char *t, size_t l){
+    memcpy(room(l),t,l);
+    used += l;
+  }
+  inline bool ok(void) const { return !failed; }
+  inline m_error_t finish(void){
+    flush();
+    return (failed)? ERR_FILE_WRITE : ERR_NO_ERROR;
+  }
+};
+
+template<typename BASE, typename V>
+static m_error_t dumpArray(FILE *f, const char *prefix, const wtBuffer<BASE>& A){
   if(!f) return ERR_PARAM_NULL;
   if(!A.size()){
     if(0 > fprintf(f,"%s(empty)\n",prefix)) return ERR_FILE_WRITE;
     return ERR_NO_ERROR;
   }
-  const XDR::Int *d = A.readPtr();
-  for(size_t i=0;i<A.size();i++,d++){
-    int v = XDR::xdrRead<XDR::Int>(d);
-    if(0 > fprintf(f,"%s%d: %d\n",prefix,i,v)) return ERR_FILE_WRITE;
+  DumpText t(f,prefix);
+  const BASE *d = A.readPtr();
+  for(size_t i=0;(i<A.size()) && t.ok();i++,d++){
+    t.index(i);
+    t.value((V)XDR::xdrRead<BASE>(d));
+    t.text("\n",1);
   }
-  return ERR_NO_ERROR;
+  return t.finish();
 }
 
-/*
- * Short Implemetation
- *
- */
+namespace mgr {
+
+template<>
+m_error_t TDIntArray::dump(FILE *f, const char *prefix) const {
+  return dumpArray<XDR::Int, long long>(f,prefix,A);
+}
 
 template<>
 m_error_t TDShortArray::dump(FILE *f, const char *prefix) const {
-  if(!f) return ERR_PARAM_NULL;
-  if(!A.size()){
-    if(0 > fprintf(f,"%s(empty)\n",prefix)) return ERR_FILE_WRITE;
-    return ERR_NO_ERROR;
-  }
-  const XDR::Short *d = A.readPtr();
-  for(size_t i=0;i<A.size();i++,d++){
-    int v = XDR::xdrRead<XDR::Short>(d);
-    if(0 > fprintf(f,"%s%d: %d\n",prefix,i,v)) return ERR_FILE_WRITE;
-  }
-  return ERR_NO_ERROR;
+  return dumpArray<XDR::Short, long long>(f,prefix,A);
 }
 
+template<>
+m_error_t TDDoubleArray::dump(FILE *f, const char *prefix) const {
+  return dumpArray<XDR::Double, double>(f,prefix,A);
+}
+
+template<>
+m_error_t TDLongArray::dump(FILE *f, const char *prefix) const {
+  return dumpArray<XDR::Long, long long>(f,prefix,A);
+}
+
+template<>
+m_error_t TDUCharArray::dump(FILE *f, const char *prefix) const {
+  return dumpArray<XDR::UChar, unsigned long long>(f,prefix,A);
+}
+
+template<>
+m_error_t TDUShortArray::dump(FILE *f, const char *prefix) const {
+  return dumpArray<XDR::UShort, unsigned long long>(f,prefix,A);
+}
+
+template<>
+m_error_t TDUIntArray::dump(FILE *f, const char *prefix) const {
+  return dumpArray<XDR::UInt, unsigned long long>(f,prefix,A);
+}
+
+template<>
+m_error_t TDULongArray::dump(FILE *f, const char *prefix) const {
+  return dumpArray<XDR::ULong, unsigned long long>(f,prefix,A);
+}
+
+template<>
+m_error_t TDFloatArray::dump(FILE *f, const char *prefix) const {
+  return dumpArray<XDR::Float, double>(f,prefix,A);
+}
+
+// the parts of complex arrays
+template<>
+m_error_t TDArray<XDR::Double, TaggedDataFile::COMPLEX_ARRAY>::dump(FILE *f, const char *prefix) const {
+  return dumpArray<XDR::Double, double>(f,prefix,A);
+}
+
+template<>
+m_error_t TDArray<XDR::Float, TaggedDataFile::COMPLEX_ARRAY>::dump(FILE *f, const char *prefix) const {
+  return dumpArray<XDR::Float, double>(f,prefix,A);
+}
 
 /*
- * Double Implementation
+ * Complex Implementation
  *
  */
 
-template<>
-m_error_t TDDoubleArray::dump(FILE *f, const char *prefix) const {
+template<typename BASE>
+m_error_t TDComplexArray<BASE>::dump(FILE *f, const char *prefix) const {
   if(!f) return ERR_PARAM_NULL;
-  if(!A.size()){
+  if(!this->A.size()){
     if(0 > fprintf(f,"%s(empty)\n",prefix)) return ERR_FILE_WRITE;
     return ERR_NO_ERROR;
   }
-  const XDR::Double *d = A.readPtr();
-  for(size_t i=0;i<A.size();i++,d++){
-    double v = XDR::xdrRead<XDR::Double>(d);
-    if(0 > fprintf(f,"%s%d: %lf\n",prefix,i,v)) return ERR_FILE_WRITE;
+  DumpText t(f,prefix);
+  const BASE *d = this->A.readPtr();
+  for(size_t i=0;(i<this->A.size()/2) && t.ok();i++,d+=2){
+    t.index(i);
+    t.value((double)XDR::xdrRead<BASE>(d));
+    t.value((double)XDR::xdrRead<BASE>(d+1),true);
+    t.text("i\n",2);
   }
-  return ERR_NO_ERROR;
+  return t.finish();
 }
 
+template class TDComplexArray<XDR::Double>;
+template class TDComplexArray<XDR::Float>;
+
 } // namespace mgr for template specilization
 
 /*
@@ -228,6 +665,9 @@ m_error_t TDDoubleArray::dump(FILE *f, const char *prefix) const {
 #include <stdio.h>
 #include <HexDump.h>
 #include <wtBufferDump.h>
+#include <string.h>
+#include <unistd.h>
+#include <UringDump.h>
 
 int main(int argc, char *argv[]){
   m_error_t res;
@@ -322,7 +762,549 @@ int main(int argc, char *argv[]){
       puts("+++ TDDoubleArray::readTag() finished OK!");
     }
 
-        
+
+    printf("Test %d: Bulk import() and get()\n",++tests);
+    do {
+      const size_t n = 1000;
+      double bd[n], gd[n];
+      float gf[n];
+      short bs[n];
+      long gl[n];
+      for(size_t i = 0; i < n; i++){
+	bd[i] = i * 0.5 - 100.0;
+	bs[i] = static_cast<short>(i * 37 - 5000);
+      }
+      TDDoubleArray barr(bd,n);
+      TDIntArray iarr3(bs,n);
+      if((barr.size() != n) || (iarr3.size() != n)){
+	res = ERR_PARAM_LEN;
+	break;
+      }
+      res = barr.get(gd);
+      if(res != ERR_NO_ERROR) break;
+      res = barr.get(gf);
+      if(res != ERR_NO_ERROR) break;
+      res = iarr3.get(gl);
+      if(res != ERR_NO_ERROR) break;
+      for(size_t i = 0; i < n; i++){
+	if((gd[i] != bd[i]) || (gf[i] != static_cast<float>(bd[i])) || (gl[i] != bs[i])){
+	  printf("*** Error: element %u differs\n",(unsigned int)i);
+	  res = ERR_INT_DATA;
+	  break;
+	}
+      }
+    } while(0);
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: bulk import() and get() failed 0x%.4x\n",(int)res);
+    } else {
+      puts("+++ Bulk import() and get() finished OK!");
+    }
+
+    printf("Test %d: xdrView of a TDDoubleArray\n",++tests);
+    do {
+      const size_t n = 5000;
+      double *vd = new double[n];
+      double s = 0;
+      for(size_t i = 0; i < n; i++){
+	vd[i] = (i * 7919) % 1000 - 300.5;
+	s += vd[i];
+      }
+      TDDoubleArray varr(vd,n);
+      xdrView<XDR::Double> v = varr.view();
+      double vmin, vmax;
+      if((v.size() != n) || (v.min(vmin) != ERR_NO_ERROR) || (v.max(vmax) != ERR_NO_ERROR) ||
+	 (vmin != -300.5) || (vmax != 698.5) || (v.sum<double>() != s)){
+	res = ERR_INT_DATA;
+      }
+      size_t k = 0;
+      for(xdrView<XDR::Double>::iterator i = v.begin(); i != v.end(); ++i, k++){
+	if(*i != vd[k]) res = ERR_INT_DATA;
+      }
+      if((k != n) || (v.end() - v.begin() != (ptrdiff_t)n) || (v.begin()[17] != vd[17]) ||
+	 (v[n-1] != vd[n-1])){
+	res = ERR_INT_DATA;
+      }
+      double w[10];
+      if((v.decode(n-4,w,10) != 4) || (w[3] != vd[n-1]) || (v.at(n,w[0]) != ERR_PARAM_RANG))
+	res = ERR_INT_DATA;
+      double ss = 0;
+      for(size_t i = 10; i < 30; i++) ss += vd[i];
+      if((v.sub(10,20).sum<double>() != ss) || (v.sub(n-5,10).size() != 5))
+	res = ERR_INT_DATA;
+      delete[] vd;
+    } while(0);
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: xdrView failed 0x%.4x\n",(int)res);
+    } else {
+      puts("+++ xdrView finished OK!");
+    }
+
+    printf("Test %d: TaggedDataFile index and fetchItem()\n",++tests);
+    do {
+      const size_t items = 50, n = 100;
+      int vi[n], gi[n];
+      double vd[n], gd[n];
+      TaggedDataFile tdf;
+      TDFDataHeader hdr("Index","Test");
+      res = tdf.addItem(hdr);
+      for(size_t k = 0; (k < items) && (res == ERR_NO_ERROR); k++){
+	for(size_t i = 0; i < n; i++){
+	  vi[i] = (int)(k * n + i);
+	  vd[i] = k + i * 0.25;
+	}
+	TDIntArray ia(vi,n);
+	TDDoubleArray da(vd,n);
+	res = tdf.addItem(ia);
+	if(res == ERR_NO_ERROR) res = tdf.addItem(da);
+      }
+      if(res != ERR_NO_ERROR) break;
+      BufferDump plain, indexed;
+      res = tdf.write(plain);
+      if(res != ERR_NO_ERROR) break;
+      res = tdf.write(indexed,true);
+      if(res != ERR_NO_ERROR) break;
+      if(indexed.get().byte_size() <= plain.get().byte_size() + TDFIndex::LOCATOR_SIZE){
+	res = ERR_INT_DATA;
+	break;
+      }
+
+      TaggedDataFile rd;
+      res = rd.open(indexed.get().readPtr(), indexed.get().byte_size());
+      if(res != ERR_NO_ERROR) break;
+      if(!rd.indexed()){
+	res = ERR_INT_STATE;
+	break;
+      }
+      const size_t pick[4] = {1, 17, 33, items};
+      for(size_t j = 0; (j < 4) && (res == ERR_NO_ERROR); j++){
+	const size_t k = pick[j] - 1;
+	TDIntArray ia;
+	TDDoubleArray da;
+	res = rd.fetchItem(ia,pick[j]);
+	if(res == ERR_NO_ERROR) res = rd.fetchItem(da,pick[j]);
+	if(res != ERR_NO_ERROR) break;
+	if((ia.size() != n) || (da.size() != n) || 
+	   (ia.get(gi) != ERR_NO_ERROR) || (da.get(gd) != ERR_NO_ERROR)){
+	  res = ERR_PARAM_LEN;
+	  break;
+	}
+	for(size_t i = 0; i < n; i++){
+	  if((gi[i] != (int)(k * n + i)) || (gd[i] != k + i * 0.25)) res = ERR_INT_DATA;
+	}
+      }
+      if(res != ERR_NO_ERROR) break;
+      TDIntArray ia;
+      if(rd.fetchItem(ia,items+1) != ERR_PARAM_END){
+	res = ERR_INT_DATA;
+	break;
+      }
+      // scopes are parsed on demand
+      res = rd.enterScope(ia.tag(),items);
+      if(res != ERR_NO_ERROR) break;
+
+      // files without index are read as before
+      TaggedDataFile pl;
+      res = pl.open(plain.get().readPtr(), plain.get().byte_size());
+      if(res != ERR_NO_ERROR) break;
+      if(pl.indexed()){
+	res = ERR_INT_STATE;
+	break;
+      }
+      TDDoubleArray da;
+      res = pl.fetchItem(da,2);
+      if(res != ERR_NO_ERROR) break;
+      if((da.get(gd) != ERR_NO_ERROR) || (gd[n-1] != 1 + (n-1) * 0.25)){
+	res = ERR_INT_DATA;
+	break;
+      }
+    } while(0);
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: TaggedDataFile index failed 0x%.4x\n",(int)res);
+    } else {
+      puts("+++ TaggedDataFile index finished OK!");
+    }
+
+    printf("Test %d: TaggedDataFile::open() of a mapped file\n",++tests);
+    do {
+      const size_t items = 8, n = 1000;
+      int vi[n], gi[n];
+      char path[64];
+      snprintf(path,sizeof(path),"/tmp/test-TaggedDataArrays-%d.tdf",(int)getpid());
+      for(int idx = 0; (idx < 2) && (res == ERR_NO_ERROR); idx++){
+	TaggedDataFile tdf;
+	for(size_t k = 0; (k < items) && (res == ERR_NO_ERROR); k++){
+	  for(size_t i = 0; i < n; i++) vi[i] = (int)(k * n + i) - 500;
+	  TDIntArray ia(vi,n);
+	  res = tdf.addItem(ia);
+	}
+	if(res != ERR_NO_ERROR) break;
+	{
+	  FileDump f(path);
+	  res = tdf.write(f,(idx != 0));
+	}
+	if(res != ERR_NO_ERROR) break;
+
+	TaggedDataFile rd;
+	res = rd.open(path);
+	if(res != ERR_NO_ERROR) break;
+	if(!rd.mapping() || (rd.indexed() != (idx != 0))){
+	  res = ERR_INT_STATE;
+	  break;
+	}
+	const unsigned char *m = (const unsigned char *)rd.mapping();
+	TDIntArray ia;
+	res = rd.fetchItem(ia,items-1);
+	if(res != ERR_NO_ERROR) break;
+	// no copy of the payload
+	const unsigned char *p = (const unsigned char *)ia.payload().readPtr();
+	if((p < m) || (p + n * sizeof(XDR::Int) > m + rd.mappedSize()) || 
+	   ia.payload().isWriteable()){
+	  res = ERR_INT_DATA;
+	  break;
+	}
+	res = ia.get(gi);
+	if(res != ERR_NO_ERROR) break;
+	for(size_t i = 0; i < n; i++)
+	  if(gi[i] != (int)((items - 2) * n + i) - 500) res = ERR_INT_DATA;
+	rd.reset();
+	if(rd.mapping()) res = ERR_INT_STATE;
+      }
+      unlink(path);
+      if(res != ERR_NO_ERROR) break;
+      TaggedDataFile rd;
+      if(rd.open(path) != ERR_FILE_OPEN) res = ERR_INT_DATA;
+    } while(0);
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: mapped TaggedDataFile failed 0x%.4x\n",(int)res);
+    } else {
+      puts("+++ Mapped TaggedDataFile finished OK!");
+    }
+
+    printf("Test %d: TaggedDataFile::load() against open()\n",++tests);
+    do {
+      const size_t items = 6, n = 3000;
+      int vi[n], gl[n], go[n];
+      char path[64];
+      snprintf(path,sizeof(path),"/tmp/test-TaggedDataArrays-%d.tdf",(int)getpid());
+      TaggedDataFile tdf;
+      for(size_t k = 0; (k < items) && (res == ERR_NO_ERROR); k++){
+	for(size_t i = 0; i < n; i++) vi[i] = (int)(k * 7919 + i * i);
+	TDIntArray ia(vi,n);
+	res = tdf.addItem(ia);
+      }
+      if(res != ERR_NO_ERROR) break;
+      {
+	// small buffers keep several writes in flight
+	UringDump f(path,4,4096);
+	res = tdf.write(f,true);
+	if(res == ERR_NO_ERROR) res = f.close();
+      }
+      if(res != ERR_NO_ERROR) break;
+
+      TaggedDataFile ld, op;
+      res = ld.load(path);
+      if(res == ERR_NO_ERROR) res = op.open(path);
+      unlink(path);
+      if(res != ERR_NO_ERROR) break;
+      if(ld.mapping() || !op.mapping() || !ld.indexed() || !op.indexed()){
+	res = ERR_INT_STATE;
+	break;
+      }
+      for(size_t k = 0; (k < items) && (res == ERR_NO_ERROR); k++){
+	TDIntArray la, oa;
+	res = ld.fetchItem(la,k+1);
+	if(res == ERR_NO_ERROR) res = op.fetchItem(oa,k+1);
+	if(res != ERR_NO_ERROR) break;
+	if((la.size() != n) || (oa.size() != n) ||
+	   (la.get(gl) != ERR_NO_ERROR) || (oa.get(go) != ERR_NO_ERROR) ||
+	   memcmp(gl,go,sizeof(gl))){
+	  res = ERR_INT_DATA;
+	  break;
+	}
+	for(size_t i = 0; i < n; i++)
+	  if(gl[i] != (int)(k * 7919 + i * i)) res = ERR_INT_DATA;
+      }
+      if(res != ERR_NO_ERROR) break;
+      TaggedDataFile rd;
+      if(rd.load(path) != ERR_FILE_OPEN) res = ERR_INT_DATA;
+    } while(0);
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: TaggedDataFile::load() failed 0x%.4x\n",(int)res);
+    } else {
+      puts("+++ TaggedDataFile::load() finished OK!");
+    }
+
+    printf("Test %d: Encoded arrays\n",++tests);
+    do {
+      const size_t n = 20000;
+      double *vd = new double[n], *gd = new double[n];
+      int *vi = new int[n], *gi = new int[n];
+      for(size_t i = 0; i < n; i++){
+	vd[i] = 20.0 + 0.0005 * i;
+	vi[i] = 1000 + (int)(i / 3) - (int)(i % 5);
+      }
+      unsigned int denc = TDFCodec::DELTA | TDFCodec::SHUFFLE | TDFCodec::ZLIB;
+      if(TDFCodec::check(denc) != ERR_NO_ERROR) denc &= ~TDFCodec::ZLIB;
+      const unsigned int ienc = TDFCodec::DELTA | TDFCodec::VARINT;
+      char path[64];
+      snprintf(path,sizeof(path),"/tmp/test-TaggedDataArrays-%d.tdf",(int)getpid());
+      size_t fsize[2];
+      res = ERR_NO_ERROR;
+      for(int enc = 0; (enc < 2) && (res == ERR_NO_ERROR); enc++){
+	TaggedDataFile tdf;
+	TDDoubleArray da(vd,n);
+	TDIntArray ia(vi,n);
+	if(enc){
+	  if((da.encoding(TDFCodec::VARINT | TDFCodec::SHUFFLE) != ERR_PARAM_SEL) ||
+	     (da.encoding(denc,0) != ERR_PARAM_RANG)){
+	    res = ERR_INT_DATA;
+	    break;
+	  }
+	  res = da.encoding(denc,1000);
+	  if(res == ERR_NO_ERROR) res = ia.encoding(ienc,3000);
+	  if(res != ERR_NO_ERROR) break;
+	}
+	res = tdf.addItem(da);
+	if(res == ERR_NO_ERROR) res = tdf.addItem(ia);
+	if(res != ERR_NO_ERROR) break;
+	{
+	  FileDump f(path);
+	  res = tdf.write(f,true);
+	}
+	if(res != ERR_NO_ERROR) break;
+
+	TaggedDataFile rd;
+	res = rd.open(path);
+	if(res != ERR_NO_ERROR) break;
+	fsize[enc] = rd.mappedSize();
+	TDDoubleArray dr;
+	TDIntArray ir;
+	dr.decoders(0);
+	res = rd.fetchItem(dr);
+	if(res == ERR_NO_ERROR) res = rd.fetchItem(ir);
+	if(res != ERR_NO_ERROR) break;
+	if((dr.size() != n) || (ir.size() != n) ||
+	   (dr.encoding() != (enc ? denc : 0)) || (ir.encoding() != (enc ? ienc : 0))){
+	  res = ERR_INT_DATA;
+	  break;
+	}
+	dr.get(gd);
+	ir.get(gi);
+	if(memcmp(gd,vd,n * sizeof(double)) || memcmp(gi,vi,n * sizeof(int)))
+	  res = ERR_INT_DATA;
+      }
+      unlink(path);
+      delete[] vd;
+      delete[] gd;
+      delete[] vi;
+      delete[] gi;
+      if(res != ERR_NO_ERROR) break;
+      printf("??? plain %u octets, encoded %u octets\n",
+	     (unsigned int)fsize[0],(unsigned int)fsize[1]);
+      if(fsize[1] >= fsize[0] / 2) res = ERR_INT_DATA;
+    } while(0);
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: encoded arrays failed 0x%.4x\n",(int)res);
+    } else {
+      puts("+++ Encoded arrays finished OK!");
+    }
+
+    printf("Test %d: Native widths, complex and N-D arrays\n",++tests);
+    do {
+      const size_t n = 120;
+      float vf[n], gf[n];
+      long long vl[n], gl[n];
+      unsigned char vc[n], gc[n];
+      unsigned short vu[n], gu[n];
+      unsigned int vw[n], gw[n];
+      std::complex<double> vz[n], gz[n];
+      for(size_t i = 0; i < n; i++){
+	vf[i] = 0.5f * i - 7.25f;
+	vl[i] = (1LL << 40) * (long long)i - 3;
+	vc[i] = (unsigned char)(i * 2);
+	vu[i] = (unsigned short)(65535 - i * 7);
+	vw[i] = 0x80000000u + i;
+	vz[i] = std::complex<double>(i, -0.5 * i);
+      }
+      const size_t dims[3] = {4, 5, 6};
+      // column-major 10 x 12 image
+      const size_t idims[2] = {10, 12}, istrides[2] = {1, 10};
+
+      TaggedDataFile tdf;
+      TDFloatArray fa(vf,n);
+      TDLongArray la(vl,n);
+      TDUCharArray ca(vc,n);
+      TDUShortArray ua(vu,n);
+      TDUIntArray wa(vw,n);
+      TDDoubleComplexArray za(vz,n);
+      TDUShortArray img(vu,n);
+      res = fa.shape(3,dims);
+      if(res == ERR_NO_ERROR) res = img.shape(2,idims,istrides);
+      if(res == ERR_NO_ERROR) res = img.encoding(TDFCodec::DELTA | TDFCodec::SHUFFLE, 50);
+      if(res != ERR_NO_ERROR) break;
+      // a shape beyond the data is rejected on write
+      TDUCharArray bad(vc,10);
+      bad.shape(2,idims);
+      m_error_t xerr;
+      BerTree *btr = bad.writeTag(&xerr);
+      if(btr || (xerr != ERR_PARAM_LEN)){
+	if(btr) delete btr;
+	res = ERR_INT_DATA;
+	break;
+      }
+      const TDFItem *items[7] = { &fa, &la, &ca, &ua, &wa, &za, &img };
+      for(size_t k = 0; (k < 7) && (res == ERR_NO_ERROR); k++)
+	res = tdf.addItem(*items[k]);
+      if(res != ERR_NO_ERROR) break;
+      char path[64];
+      snprintf(path,sizeof(path),"/tmp/test-TaggedDataArrays-%d.tdf",(int)getpid());
+      {
+	FileDump f(path);
+	res = tdf.write(f,true);
+      }
+      if(res != ERR_NO_ERROR) break;
+
+      TaggedDataFile rd;
+      res = rd.open(path);
+      unlink(path);
+      if(res != ERR_NO_ERROR) break;
+      TDFloatArray fr;
+      TDLongArray lr;
+      TDUCharArray cr;
+      TDUShortArray ur, ir;
+      TDUIntArray wr;
+      TDDoubleComplexArray zr;
+      if((rd.fetchItem(fr) != ERR_NO_ERROR) || (rd.fetchItem(lr) != ERR_NO_ERROR) ||
+	 (rd.fetchItem(cr,1) != ERR_NO_ERROR) || (rd.fetchItem(ur,2) != ERR_NO_ERROR) ||
+	 (rd.fetchItem(wr,3) != ERR_NO_ERROR) || (rd.fetchItem(ir,4) != ERR_NO_ERROR) ||
+	 (rd.fetchItem(zr) != ERR_NO_ERROR)){
+	res = ERR_INT_STATE;
+	break;
+      }
+      // stored in the native width
+      if((fr.payload().byte_size() != n * 4) || (cr.payload().byte_size() != n) ||
+	 (ur.payload().byte_size() != n * 2) || (zr.size() != n)){
+	res = ERR_INT_DATA;
+	break;
+      }
+      fr.get(gf);
+      lr.get(gl);
+      cr.get(gc);
+      ur.get(gu);
+      wr.get(gw);
+      zr.get(gz);
+      for(size_t i = 0; i < n; i++)
+	if((gf[i] != vf[i]) || (gl[i] != vl[i]) || (gc[i] != vc[i]) ||
+	   (gu[i] != vu[i]) || (gw[i] != vw[i]) || (gz[i] != vz[i])) res = ERR_INT_DATA;
+      if(res != ERR_NO_ERROR) break;
+      // shapes
+      const size_t at[3] = {2, 3, 4}, iat[2] = {7, 9};
+      if((fr.rank() != 3) || (fr.dim(2) != 6) || (fr.stride(0) != 30) ||
+	 (fr.offset(at) != 2 * 30 + 3 * 6 + 4) || (lr.rank() != 0) ||
+	 (ir.rank() != 2) || (ir.stride(1) != 10) || (ir.offset(iat) != 97) ||
+	 (ir.encoding() != (TDFCodec::DELTA | TDFCodec::SHUFFLE))){
+	res = ERR_INT_DATA;
+	break;
+      }
+      ir.get(gu);
+      if(memcmp(gu,vu,sizeof(vu))){
+	res = ERR_INT_DATA;
+	break;
+      }
+      // widths do not convert implicitly
+      TDUIntArray xr;
+      if(rd.fetchItem(xr,2) != ERR_PARAM_TYP) res = ERR_INT_DATA;
+    } while(0);
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: native arrays failed 0x%.4x\n",(int)res);
+    } else {
+      puts("+++ Native arrays finished OK!");
+    }
+
+    printf("Test %d: Element width of encoded arrays\n",++tests);
+    do {
+      const long long vl[4] = { 5000000000LL, -1, 7, 5000000001LL };
+      long long gl[4];
+      TDLongArray la(vl,4);
+      res = la.encoding(TDFCodec::VARINT);
+      if(res != ERR_NO_ERROR) break;
+      BerTree *lt = la.writeTag(&res);
+      if(!lt) break;
+      TDIntArray ir;
+      TDLongArray lr;
+      if(ir.readTag(lt->root()) != ERR_PARAM_TYP) res = ERR_INT_DATA;
+      else if((res = lr.readTag(lt->root())) == ERR_NO_ERROR){
+	lr.get(gl);
+	if((lr.size() != 4) || memcmp(gl,vl,sizeof(vl))) res = ERR_INT_DATA;
+      }
+      delete lt;
+    } while(0);
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: element width of encoded arrays failed 0x%.4x\n",(int)res);
+    } else {
+      puts("+++ Element width of encoded arrays finished OK!");
+    }
+
+    printf("Test %d: readRange() of a mapped array\n",++tests);
+    do {
+      const size_t n = 200000, w = 100;
+      double *vd = new double[n];
+      std::complex<float> vz[w], gz[w];
+      for(size_t i = 0; i < n; i++) vd[i] = i * 0.125;
+      for(size_t i = 0; i < w; i++) vz[i] = std::complex<float>(i, 1.0f);
+      char path[64];
+      snprintf(path,sizeof(path),"/tmp/test-TaggedDataArrays-%d.tdf",(int)getpid());
+      {
+	TaggedDataFile tdf;
+	TDDoubleArray da(vd,n);
+	TDFloatComplexArray za(vz,w);
+	res = tdf.addItem(da);
+	if(res == ERR_NO_ERROR) res = tdf.addItem(za);
+	FileDump f(path);
+	if(res == ERR_NO_ERROR) res = tdf.write(f,true);
+      }
+      delete[] vd;
+      if(res != ERR_NO_ERROR){
+	unlink(path);
+	break;
+      }
+      TaggedDataFile rd;
+      res = rd.open(path);
+      unlink(path);
+      if(res != ERR_NO_ERROR) break;
+      TDDoubleArray da;
+      TDFloatComplexArray za;
+      res = rd.fetchItem(da);
+      if(res == ERR_NO_ERROR) res = rd.fetchItem(za);
+      if(res != ERR_NO_ERROR) break;
+      double gd[w];
+      res = da.readRange(150000,w,gd);
+      if(res != ERR_NO_ERROR) break;
+      for(size_t i = 0; i < w; i++)
+	if(gd[i] != (150000 + i) * 0.125) res = ERR_INT_DATA;
+      float gf[2];
+      if((da.readRange(n-1,2,gd) != ERR_PARAM_RANG) ||
+	 (da.readRange(n,0,gd) != ERR_NO_ERROR) ||
+	 (da.readRange(n-2,2,gf) != ERR_NO_ERROR) || (gf[1] != (float)((n-1) * 0.125)) ||
+	 (za.readRange(10,w-10,gz) != ERR_NO_ERROR) || (gz[0] != vz[10]) ||
+	 (gz[w-11] != vz[w-1]) || (za.readRange(w,1,gz) != ERR_PARAM_RANG))
+	res = ERR_INT_DATA;
+    } while(0);
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: readRange() failed 0x%.4x\n",(int)res);
+    } else {
+      puts("+++ readRange() finished OK!");
+    }
+
     printf("\n%d tests completed with %d errors.\n",tests,errors);
     printf("Used version: %s\n",iarr.VersionTag());
 
@@ -22,6 +22,10 @@
 # define _XDR_TAGGEDDATAARRAYS_H_
 
 #include <TaggedDataFile.h>
+#include <TDFCodec.h>
+#include <xdrView.h>
+#include <complex>
+#include <vector>
 
 namespace mgr {
 
@@ -38,12 +42,47 @@ public:
     BerContentTag::BER_CONSTRUCTED, 
     BerContentTag::BER_APPLICATION> tDoubleArray;
   static const unsigned char bDoubleArray[tDoubleArray::SIZE];
+  typedef BerContentTag::TagString<(int)TaggedDataFile::FLOAT_ARRAY,
+    BerContentTag::BER_CONSTRUCTED, BerContentTag::BER_APPLICATION> tFloatArray;
+  static const unsigned char bFloatArray[tFloatArray::SIZE];
+  typedef BerContentTag::TagString<(int)TaggedDataFile::UINT_ARRAY,
+    BerContentTag::BER_CONSTRUCTED, BerContentTag::BER_APPLICATION> tUIntArray;
+  static const unsigned char bUIntArray[tUIntArray::SIZE];
+  typedef BerContentTag::TagString<(int)TaggedDataFile::COMPLEX_ARRAY,
+    BerContentTag::BER_CONSTRUCTED, BerContentTag::BER_APPLICATION> tComplexArray;
+  static const unsigned char bComplexArray[tComplexArray::SIZE];
+
+  // encoded arrays: [1] { INTEGER encoding, INTEGER block, INTEGER width, [2] block ... }
+  // width is the octets per element, it is missing in files of older versions
+  enum EncodingTags {
+    ENCODED = 0x01,
+    BLOCK = 0x02,
+    SHAPE = 0x03
+  };
+  typedef BerContentTag::TagString<(int)ENCODED,
+    BerContentTag::BER_CONSTRUCTED, BerContentTag::BER_CONTEXT> tEncoded;
+  typedef BerContentTag::TagString<(int)BLOCK,
+    BerContentTag::BER_PRIMITIVE, BerContentTag::BER_CONTEXT> tBlock;
+  // N-D arrays append: [3] { SEQUENCE OF INTEGER dims, SEQUENCE OF INTEGER strides }
+  typedef BerContentTag::TagString<(int)SHAPE,
+    BerContentTag::BER_CONSTRUCTED, BerContentTag::BER_CONTEXT> tShape;
 
 protected:
+  unsigned int Encoding;   // TDFCodec::Encodings used by writeTag()
+  size_t Block;            // elements per encoded block
+  unsigned int Decoders;   // threads for decoding, 0 for all CPUs
+  unsigned int Components; // records per element, 2 for complex
+  std::vector<size_t> Shape;   // dimensions, empty for a plain array
+  std::vector<size_t> Stride;  // elements between neighbours in each dimension
+
   // array core
   BerTree *arrayCoreWrite(const BerContentTag& mtag, const _wtBuffer& c, m_error_t& err) const;
   m_error_t arrayCoreRead(const BerContentTag& mtag, const BerTag *arry, 
 			    _wtBuffer& c);
+  m_error_t blocksWrite(BerTree *st, const _wtBuffer& c) const;
+  m_error_t blocksRead(BerTree& at, size_t num, _wtBuffer& c);
+  m_error_t shapeWrite(BerTree *st, size_t num) const;
+  m_error_t shapeRead(const BerTag *t, size_t num);
 
   BerTree *writeTagCore(const BerContentTag& mtag, 
 			const _wtBuffer& A, m_error_t *err) const;
@@ -53,13 +92,45 @@ public:
   _TDArray(TaggedDataFile::AppTags tag) : 
     TDFItem((size_t)tag, 
 	    BerContentTag::BER_CONSTRUCTED, 
-	    BerContentTag::BER_APPLICATION) {}
+	    BerContentTag::BER_APPLICATION),
+    Encoding(TDFCodec::RAW), Block(TDFCodec::DEFAULT_BLOCK), Decoders(1),
+    Components(1) {}
   virtual ~_TDArray() {}
   const char *VersionTag(void) const;
 
+  // select the encoding of writeTag(), readTag() sets the one found
+  m_error_t encoding(unsigned int e, size_t block = TDFCodec::DEFAULT_BLOCK);
+  unsigned int encoding(void) const {
+    return Encoding;
+  }
+  // threads decoding the blocks in readTag(), 0 for all CPUs
+  void decoders(unsigned int n){
+    Decoders = n;
+  }
+
+  // N-D layout, row-major if no strides are given, rank 0 for plain arrays
+  m_error_t shape(size_t rank, const size_t *dims, const size_t *strides = NULL);
+  size_t rank(void) const {
+    return Shape.size();
+  }
+  size_t dim(size_t k) const {
+    return (k < Shape.size())? Shape[k] : 0;
+  }
+  size_t stride(size_t k) const {
+    return (k < Stride.size())? Stride[k] : 0;
+  }
+  // element index of the rank() indices given
+  size_t offset(const size_t *idx) const {
+    size_t o = 0;
+    for(size_t k = 0; k < Shape.size(); k++) o += idx[k] * Stride[k];
+    return o;
+  }
+
   virtual BerTree *writeTag(m_error_t *err = NULL) const = 0;
   virtual m_error_t readTag(const BerTag& t) = 0;
   virtual m_error_t dump(FILE *f = stdout, const char *prefix = NULL) const = 0;  
+  // number of elements, a complex number counts once
+  virtual size_t elements(void) const = 0;
 
 };
 
@@ -75,6 +146,35 @@ class TDArray : public _TDArray {
 protected:
   wtBuffer<BASE> A;
 
+  // elements converted at once for a differing native type
+  enum { CHUNK = 256 };
+
+  // the non-template overloads are preferred for OUT == BASE
+  static inline void toXdr(BASE *b, const BASE *d, size_t s){
+    XDR::xdrWriteArray(b, d, s);
+  }
+  template<typename OUT>
+  static inline void toXdr(BASE *b, const OUT *d, size_t s){
+    for(size_t i=0;i<s;i++) b[i] = static_cast<BASE>(d[i]);
+    XDR::xdrWriteArray(b, s);
+  }
+
+  static inline void fromXdr(BASE *d, const BASE *b, size_t s){
+    XDR::xdrReadArray(d, b, s);
+  }
+  template<typename OUT>
+  static inline void fromXdr(OUT *d, const BASE *b, size_t s){
+    BASE t[CHUNK];
+    while(s){
+      size_t c = (s < (size_t)CHUNK) ? s : (size_t)CHUNK;
+      XDR::xdrReadArray(t, b, c);
+      for(size_t i=0;i<c;i++) d[i] = static_cast<OUT>(t[i]);
+      d += c;
+      b += c;
+      s -= c;
+    }
+  }
+
 public:
   template<typename OUT>
   m_error_t import(const OUT *d, const size_t& s){
@@ -83,11 +183,7 @@ public:
     if(res != ERR_NO_ERROR) return res;    
     BASE *b = A.writePtr();
     if(b){
-      for(size_t i=0;i<s;i++){
-	// GCC automagically selects the correct template function
-	// ASN1IO inherits xdrIO
-	XDR::xdrWrite(b++, static_cast<BASE>(*d++));
-      }
+      toXdr(b, d, s);
     } else res = ERR_INT_STATE;
     return res;
   }
@@ -97,9 +193,19 @@ public:
     if(!d) return ERR_PARAM_NULL;
     const BASE *b = A.readPtr();
     if(!b) return ERR_INT_STATE;
-    for(size_t i=0; i<A.size(); i++){
-      *d++ = static_cast<OUT>(XDR::xdrRead<BASE>(b++));
-    }
+    fromXdr(d, b, A.size());
+    return ERR_NO_ERROR;
+  }
+
+  // convert count elements starting at offset, no others are accessed
+  template<typename OUT>
+  m_error_t readRange(size_t offset, size_t count, OUT *d) const {
+    if(!d) return ERR_PARAM_NULL;
+    if((offset > A.size()) || (count > A.size() - offset)) return ERR_PARAM_RANG;
+    if(!count) return ERR_NO_ERROR;
+    const BASE *b = A.readPtr();
+    if(!b) return ERR_INT_STATE;
+    fromXdr(d, b + offset, count);
     return ERR_NO_ERROR;
   }
 
@@ -112,9 +218,23 @@ public:
 
   virtual ~TDArray() {}
 
-  size_t size(void){
+  size_t size(void) const {
     return A.size();
   }
+  virtual size_t elements(void) const {
+    return A.size() / Components;
+  }
+
+  // XDR coded elements, after readTag() a referral into the file image
+  // unless the array was encoded
+  const wtBuffer<BASE>& payload(void) const {
+    return A;
+  }
+
+  // read-only view decoding on access, invalid after import() or readTag()
+  xdrView<BASE> view(void) const {
+    return xdrView<BASE>(A.readPtr(), A.size());
+  }
 
   virtual BerTree *writeTag(m_error_t *err = NULL) const {
     return writeTagCore(Tag, A, err);
@@ -130,9 +250,80 @@ public:
   virtual m_error_t dump(FILE *f = stdout, const char *prefix = NULL) const;
 };
 
+/*
+ * Complex arrays:
+ *
+ * BASE: Storage type of real and imaginary part
+ *
+ * The parts are stored interleaved, i.e. as array of 2 * size()
+ * records, which is the memory layout of std::complex.
+ *
+ */
+template<typename BASE>
+class TDComplexArray : public TDArray<BASE, TaggedDataFile::COMPLEX_ARRAY> {
+protected:
+  typedef TDArray<BASE, TaggedDataFile::COMPLEX_ARRAY> Parts;
+
+public:
+  template<typename OUT>
+  m_error_t import(const std::complex<OUT> *d, const size_t& s){
+    return Parts::import(reinterpret_cast<const OUT *>(d), 2 * s);
+  }
+
+  template<typename OUT>
+  m_error_t get(std::complex<OUT> *d){
+    return Parts::get(reinterpret_cast<OUT *>(d));
+  }
+
+  template<typename OUT>
+  m_error_t readRange(size_t offset, size_t count, std::complex<OUT> *d) const {
+    if((offset > size()) || (count > size() - offset)) return ERR_PARAM_RANG;
+    return Parts::readRange(2 * offset, 2 * count, reinterpret_cast<OUT *>(d));
+  }
+
+  TDComplexArray() {
+    this->Components = 2;
+  }
+  template<typename OUT>
+  TDComplexArray(const std::complex<OUT> *d, const size_t& s){
+    this->Components = 2;
+    m_error_t res = import(d,s);
+    if(res != ERR_NO_ERROR) mgrThrow(res);
+  }
+
+  virtual ~TDComplexArray() {}
+
+  size_t size(void) const {
+    return this->A.size() / 2;
+  }
+
+  virtual m_error_t readTag(const BerTag& arry){
+    m_error_t res = Parts::readTag(arry);
+    if((res == ERR_NO_ERROR) && (this->A.size() % 2)){
+      this->A.free();
+      res = ERR_PARAM_LEN;
+    }
+    return res;
+  }
+  m_error_t readTag(const BerTag* arry){
+    if(!arry) return ERR_PARAM_NULL;
+    return readTag(*arry);
+  }
+
+  virtual m_error_t dump(FILE *f = stdout, const char *prefix = NULL) const;
+};
+
 typedef TDArray<XDR::Int, TaggedDataFile::INT_ARRAY> TDIntArray;
 typedef TDArray<XDR::Short, TaggedDataFile::INT_ARRAY> TDShortArray;
+typedef TDArray<XDR::Long, TaggedDataFile::INT_ARRAY> TDLongArray;
+typedef TDArray<XDR::UChar, TaggedDataFile::UINT_ARRAY> TDUCharArray;
+typedef TDArray<XDR::UShort, TaggedDataFile::UINT_ARRAY> TDUShortArray;
+typedef TDArray<XDR::UInt, TaggedDataFile::UINT_ARRAY> TDUIntArray;
+typedef TDArray<XDR::ULong, TaggedDataFile::UINT_ARRAY> TDULongArray;
 typedef TDArray<XDR::Double, TaggedDataFile::DOUBLE_ARRAY> TDDoubleArray;
+typedef TDArray<XDR::Float, TaggedDataFile::FLOAT_ARRAY> TDFloatArray;
+typedef TDComplexArray<XDR::Double> TDDoubleComplexArray;
+typedef TDComplexArray<XDR::Float> TDFloatComplexArray;
 
 }; // namespace mgr
 
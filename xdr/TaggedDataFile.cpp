@@ -13,6 +13,7 @@
  * This defines the classes:
  *
  * TaggedDataFile - class for organisation of data into scopes
+ * TDFIndex       - footer index of the top-level items
  *
  * This defines the values:
  *
@@ -20,6 +21,13 @@
 
 #include "TaggedDataFile.h"
 #include "TaggedDataFile.tag"
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <UringDump.h>
 
 #define DEBUG_MARK 1
 #define DEBUG_DUMP 2
@@ -42,8 +50,190 @@ const char * TaggedDataFile::VersionTag(void) const {
   return _VERSION_;
 }
 
+const unsigned char TaggedDataFile::bIndex[tIndex::SIZE] = {
+  BerContentTag::TagByte<(int)TaggedDataFile::INDEX, 0,
+  BerContentTag::BER_PRIMITIVE, BerContentTag::BER_APPLICATION >::VALUE
+};
+
+const unsigned char TaggedDataFile::bLocator[tLocator::SIZE] = {
+  BerContentTag::TagByte<(int)TaggedDataFile::LOCATOR, 0,
+  BerContentTag::BER_PRIMITIVE, BerContentTag::BER_APPLICATION >::VALUE
+};
+
+/*
+ * BerTree::freeNode() only clears nodes, since nodes may be shared
+ * between trees. The subtree of a single item parsed by fetchItem()
+ * is private, so its nodes are deleted.
+ */
+class TDFItemTree : public BerTree {
+public:
+  virtual ~TDFItemTree() { clear(); }
+  virtual void freeNode(HTreeNode *n) const {
+    BerTree::freeNode(n);
+    delete static_cast<BerTag *>(n);
+  }
+};
+
+/*
+ * The TDFIndex Class
+ *
+ */
+
+static bool indexLess(const TDFIndex::Entry& a, const TDFIndex::Entry& b){
+  if(a.ident != b.ident) return (a.ident < b.ident);
+  return (a.number < b.number);
+}
+
+/*! \param t Tag of the item
+    \param offset Offset of the item from the start of the file
+    \param length Size of the item including tag and length field
+    \return Error code as defined in mgrError.h
+*/
+m_error_t TDFIndex::add(const BerContentTag& t, size_t offset, size_t length){
+  Entry e;
+  e.number = (XDR::UInt)t.Number();
+  e.ident = ident(t);
+  e.ordinal = 0;
+  e.reserved = 0;
+  e.offset = offset;
+  e.length = length;
+  entries.push_back(e);
+  return ERR_NO_ERROR;
+}
+
+/*! \param s Stream to write to
+    \param at Offset of the index from the start of the file
+    \return Error code as defined in mgrError.h
+
+    The entries are sorted by tag keeping the order of items with
+    the same tag, which defines the ordinals.
+*/
+m_error_t TDFIndex::write(StreamDump& s, size_t at){
+  std::stable_sort(entries.begin(), entries.end(), indexLess);
+  for(size_t i = 0; i < entries.size(); i++){
+    entries[i].ordinal = (i && !indexLess(entries[i-1],entries[i]))? 
+      entries[i-1].ordinal + 1 : 1;
+  }
+
+  BerTag idx((int)TaggedDataFile::INDEX,
+	     BerContentTag::BER_PRIMITIVE, 
+	     BerContentTag::BER_APPLICATION);
+  unsigned char *p = idx.allocate(4 + entries.size() * ENTRY_SIZE);
+  if(!p) return ERR_MEM_AVAIL;
+  XDR::xdrWrite<XDR::UInt>(p, (XDR::UInt)entries.size());
+  p += 4;
+  for(size_t i = 0; i < entries.size(); i++, p += ENTRY_SIZE)
+    xdrStruct<Fields>::encode(p, entries[i]);
+  m_error_t err = idx.write(s);
+  if(err != ERR_NO_ERROR) return err;
+
+  BerTag loc((int)TaggedDataFile::LOCATOR,
+	     BerContentTag::BER_PRIMITIVE, 
+	     BerContentTag::BER_APPLICATION);
+  p = loc.allocate(8);
+  if(!p) return ERR_MEM_AVAIL;
+  XDR::xdrWrite<XDR::ULong>(p, (XDR::ULong)at);
+  return loc.write(s);
+}
+
+/*! \param d File image
+    \param l Size of the file image
+    \param at Receives the offset of the index, i.e. the size of the items
+    \return Error code as defined in mgrError.h
+
+    ERR_PARAM_END indicates a file without index. The entries are
+    referenced in d, which must persist while the index is used.
+*/
+m_error_t TDFIndex::read(const unsigned char *d, size_t l, size_t& at){
+  clear();
+  if(!d) return ERR_PARAM_NULL;
+  if(l < LOCATOR_SIZE) return ERR_PARAM_END;
+  const unsigned char *loc = d + l - LOCATOR_SIZE;
+  if(!TaggedDataFile::tLocator::isEqual(loc) || (loc[1] != 8)) return ERR_PARAM_END;
+  l -= LOCATOR_SIZE;
+  XDR::ULong o = XDR::xdrRead<XDR::ULong>(loc + 2);
+  if(o >= l) return ERR_PARS_STX;
+  
+  const unsigned char *idx = d + o;
+  BerHeader h;
+  m_error_t err = BerTag::readHeader(idx, l - o, h);
+  if(err != ERR_NO_ERROR) return ERR_PARS_STX;
+  if(!TaggedDataFile::tIndex::isEqual(idx) || (h.size() != l - o) || (h.length < 4))
+    return ERR_PARS_STX;
+  idx += h.head();
+  XDR::UInt n = XDR::xdrRead<XDR::UInt>(idx);
+  if((h.length - 4) / ENTRY_SIZE != n || (h.length - 4) % ENTRY_SIZE)
+    return ERR_PARS_STX;
+
+  table = idx + 4;
+  count = n;
+  at = o;
+  return ERR_NO_ERROR;
+}
+
+/*! \param t Tag of the item
+    \param ordinal 1-based ordinal among the top-level items with tag t
+    \param offset Receives the offset of the item in the file image
+    \param length Receives the size of the item
+    \return Error code as defined in mgrError.h
+
+    The entries are searched in place. ERR_PARAM_END is returned,
+    if there is no such item.
+*/
+m_error_t TDFIndex::find(const BerContentTag& t, size_t ordinal,
+			 size_t& offset, size_t& length) const {
+  if(!table) return ERR_PARAM_NULL;
+  if(ordinal < 1) ordinal = 1;
+  const XDR::UInt id = ident(t);
+  const size_t num = t.Number();
+  size_t lo = 0, hi = count;
+  while(lo < hi){
+    const size_t mid = lo + (hi - lo) / 2;
+    const unsigned char *p = table + mid * ENTRY_SIZE;
+    const XDR::UInt eid = XDR::xdrRead<XDR::UInt>(p + 4);
+    const XDR::UInt enu = XDR::xdrRead<XDR::UInt>(p);
+    const XDR::UInt eor = XDR::xdrRead<XDR::UInt>(p + 8);
+    bool less;
+    if(eid != id) less = (eid < id);
+    else if(enu != num) less = (enu < num);
+    else if(eor != ordinal) less = (eor < ordinal);
+    else {
+      offset = XDR::xdrRead<XDR::ULong>(p + 16);
+      length = XDR::xdrRead<XDR::ULong>(p + 24);
+      return ERR_NO_ERROR;
+    }
+    if(less) lo = mid + 1;
+    else hi = mid;
+  }
+  return ERR_PARAM_END;
+}
+
+/*
+ * The TaggedDataFile Class
+ *
+ */
+
+m_error_t TaggedDataFile::parse(void){
+  if(!data || !dataLen || !ber.isEmpty()) return ERR_NO_ERROR;
+  return ber.replace(data,dataLen,false);
+}
+
+void TaggedDataFile::unmap(void){
+  if(!map) return;
+  // the tree and the index refer to the mapping
+  ber.clear();
+  index.clear();
+  data = NULL;
+  dataLen = 0;
+  ::munmap(map,mapLen);
+  map = NULL;
+  mapLen = 0;
+}
+
 m_error_t TaggedDataFile::openScope(const BerContentTag& t){
   if(t.Type() != BerContentTag::BER_CONSTRUCTED) return ERR_PARAM_OPT;
+  m_error_t err = parse();
+  if(err != ERR_NO_ERROR) return err;
   BerTag *nt = new BerTag(t);
   if(!nt) return ERR_PARAM_NULL;
 #if DEBUG_CHECK(DUMP)
@@ -65,6 +255,8 @@ const BerContentTag* TaggedDataFile::closeScope(){
 }
 
 m_error_t TaggedDataFile::addTag(BerTag *t){  
+  m_error_t err = parse();
+  if(err != ERR_NO_ERROR) return err;
   if(newScope){
     ber.insertChild(t,true);
     newScope = false;
@@ -82,13 +274,132 @@ m_error_t TaggedDataFile::addTag(const BerTree& tr){
   return addTag(ctr.root());
 }
   
-m_error_t TaggedDataFile::write(StreamDump& s) {  
+/*! \param s Stream to write to
+    \param withIndex Append a TDFIndex of the top-level items
+    \return Error code as defined in mgrError.h
+*/
+m_error_t TaggedDataFile::write(StreamDump& s, bool withIndex) {  
+  m_error_t err = parse();
+  if(err != ERR_NO_ERROR) return err;
   ber.root();
-  return ber.write(s,true);
+  err = ber.write(s,true);
+  if((err != ERR_NO_ERROR) || !withIndex) return err;
+
+  TDFIndex idx;
+  size_t at = 0;
+  for(BerTag *c = ber.root(); c; c = static_cast<BerTag *>(c->getNext())){
+    err = idx.add(c->tag(), at, c->size());
+    if(err != ERR_NO_ERROR) return err;
+    at += c->size();
+  }
+  return idx.write(s, at);
+}
+
+/*! \param b File image
+    \param s Size of the file image
+    \return Error code as defined in mgrError.h
+
+    If the file has a TDFIndex, the image is referenced rather
+    than parsed. It is parsed on first access to the scopes, while
+    fetchItem() only decodes the item requested. Files without
+    index are parsed at once. In either case the nodes refer to
+    b, which must persist while this is used.
+*/
+m_error_t TaggedDataFile::open(const void *b, const size_t& s){
+  reset();
+  if(!b) return ERR_PARAM_NULL;
+  const unsigned char *d = (const unsigned char *)b;
+  size_t at = 0;
+  m_error_t err = index.read(d,s,at);
+  if(err == ERR_PARAM_END) return ber.replace(d,s,false);
+  if(err != ERR_NO_ERROR) return err;
+  data = d;
+  dataLen = at;
+  return ERR_NO_ERROR;
+}
+
+/*! \param path Name of the file
+    \return Error code as defined in mgrError.h
+
+    The file is mapped read-only and opened by open(const void *,
+    const size_t&). Items read refer to the mapping, which is
+    released by reset() or the DTOR. Pages are only read from
+    the file as they are accessed.
+*/
+m_error_t TaggedDataFile::open(const char *path){
+  reset();
+  if(!path) return ERR_PARAM_NULL;
+  int fd = ::open(path, O_RDONLY);
+  if(fd < 0) return ERR_FILE_OPEN;
+  struct stat st;
+  if(::fstat(fd,&st) < 0){
+    ::close(fd);
+    return ERR_FILE_STAT;
+  }
+  if(S_ISDIR(st.st_mode)){
+    ::close(fd);
+    return ERR_FILE_ISDIR;
+  }
+  if(!st.st_size){
+    ::close(fd);
+    return ERR_NO_ERROR;
+  }
+  const size_t s = (size_t)st.st_size;
+  void *m = ::mmap(NULL, s, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if(m == MAP_FAILED) return ERR_FILE_READ;
+
+  m_error_t err = open(m,s);
+  if(err != ERR_NO_ERROR){
+    reset();
+    ::munmap(m,s);
+    return err;
+  }
+  map = m;
+  mapLen = s;
+  // an index makes accesses random, otherwise the tree is parsed
+  ::madvise(m, s, (data)? MADV_RANDOM : MADV_SEQUENTIAL);
+  return ERR_NO_ERROR;
+}
+
+/*! \param path Name of the file
+    \return Error code as defined in mgrError.h
+
+    Unlike open(const char *) the file is read at once with
+    several large reads in flight, which suits fast storage better
+    than faulting in the pages of a mapping. The image is released
+    by reset() or the DTOR.
+*/
+m_error_t TaggedDataFile::load(const char *path){
+  reset();
+  if(!path) return ERR_PARAM_NULL;
+  UringReader rd(path);
+  if(!rd.valid()) return ERR_FILE_OPEN;
+  size_t s;
+  m_error_t err = rd.size(s);
+  if(err != ERR_NO_ERROR) return err;
+  if(!s) return ERR_NO_ERROR;
+  wtBuffer<unsigned char> img;
+  if(img.trunc(s) != ERR_NO_ERROR) return ERR_MEM_AVAIL;
+  unsigned char *d = img.writePtr();
+  if(!d) return ERR_MEM_AVAIL;
+  err = rd.read(d,s,0);
+  if(err != ERR_NO_ERROR) return err;
+
+  err = open(img.readPtr(),s);
+  if(err != ERR_NO_ERROR){
+    reset();
+    return err;
+  }
+  // refers to the same memory
+  image = img;
+  return ERR_NO_ERROR;
 }
 
 m_error_t TaggedDataFile::enterScope(const BerContentTag& t, size_t offset, bool absolute){
   newScope = false;
+  m_error_t err = parse();
+  if(err != ERR_NO_ERROR) return err;
   BerTag *c = (absolute)? ber.firstSibling() : ber.current();
   if(!c) return ERR_PARAM_NULL;
   if(offset < 1) offset = 1;
@@ -109,6 +420,7 @@ m_error_t TaggedDataFile::enterScope(const BerContentTag& t, size_t offset, bool
 }
 
 BerTree *TaggedDataFile::getScope(void){
+  if(parse() != ERR_NO_ERROR) return NULL;
   BerTag *c = ber.firstSibling();
   if(!c) return NULL;
   BerTree *t = new BerTree(c);
@@ -149,6 +461,32 @@ m_error_t TaggedDataFile::readItem(TDFItem& it, size_t offset, bool absolute){
   return res;
 }
 
+/*! \param it Item to read, selected by it.tag()
+    \param ordinal 1-based ordinal among the top-level items with this tag
+    \return Error code as defined in mgrError.h
+
+    With a TDFIndex only the item requested is decoded from the
+    file image. Otherwise the item is searched by readItem().
+    ERR_PARAM_END is returned, if there is no such item.
+*/
+m_error_t TaggedDataFile::fetchItem(TDFItem& it, size_t ordinal){
+  m_error_t res;
+  if(!data){
+    res = readItem(it,ordinal,true);
+    return (readOk(res))? ERR_NO_ERROR : res;
+  }
+  size_t off, len;
+  res = index.find(it.tag(),ordinal,off,len);
+  if(res != ERR_NO_ERROR) return res;
+  if((off > dataLen) || (len > dataLen - off)) return ERR_PARS_STX;
+
+  TDFItemTree tr;
+  res = tr.replace(data + off,len,false);
+  if(res != ERR_NO_ERROR) return res;
+  if(!tr.root() || tr.trailer()) return ERR_PARS_STX;
+  return it.readTag(*(tr.root()));
+}
+
 /*
  * TDFItem helpers
  *
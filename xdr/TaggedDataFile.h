@@ -13,6 +13,7 @@
  * This defines the classes:
  *
  * TaggedDataFile - class for organisation of data into scopes
+ * TDFIndex       - footer index of the top-level items
  *
  * This defines the values:
  *
@@ -23,6 +24,8 @@
 
 #include <BerTree.h>
 #include <asn1IO.h>
+#include <xdrStruct.h>
+#include <vector>
 
 namespace mgr {
 
@@ -49,14 +52,96 @@ public:
   }
 };
 
+/*! \class TDFIndex
+    \brief Footer index of the top-level items of a TaggedDataFile
+
+    The index follows the top-level items as a primitive
+    [APPLICATION 5] tag. Its content is an XDR unsigned count
+    followed by count entries of 32 octets each. The entries are
+    sorted by tag and ordinal, so that a reader can locate an
+    item by binary search directly in the file image without
+    decoding the table.
+
+    The file ends in a [APPLICATION 6] locator of fixed size
+    holding the offset of the index as XDR unsigned hyper.
+    Readers unaware of the index skip both tags as unknown
+    top-level items.
+*/
+class TDFIndex {
+public:
+  //! Index entry
+  struct Entry {
+    XDR::UInt number;      //!< Tag number
+    XDR::UInt ident;       //!< Tag class << 1 | tag type
+    XDR::UInt ordinal;     //!< 1-based ordinal among the items of the same tag
+    XDR::UInt reserved;    //!< Always 0
+    XDR::ULong offset;     //!< Offset of the item in the file
+    XDR::ULong length;     //!< Size of the item including tag and length field
+  };
+  typedef meta::MakeTypeList< XDR_FIELD(Entry, XDR::UInt, number),
+			      XDR_FIELD(Entry, XDR::UInt, ident),
+			      XDR_FIELD(Entry, XDR::UInt, ordinal),
+			      XDR_FIELD(Entry, XDR::UInt, reserved),
+			      XDR_FIELD(Entry, XDR::ULong, offset),
+			      XDR_FIELD(Entry, XDR::ULong, length) >::RESULT Fields;
+  enum {
+    ENTRY_SIZE = xdrStruct<Fields>::SIZE,   //!< Octets per entry
+    LOCATOR_SIZE = 10                       //!< Octets of the locator tag
+  };
+
+protected:
+  std::vector<Entry> entries;         //!< Entries collected for writing
+  const unsigned char *table;         //!< Entries in the file image read
+  size_t count;                       //!< Number of entries in table
+
+  static inline XDR::UInt ident(const BerContentTag& t){
+    return ((XDR::UInt)t.Class() << 1) | (XDR::UInt)t.Type();
+  }
+
+public:
+  TDFIndex() : table(NULL), count(0) {};
+
+  //! Discard all entries
+  inline void clear(void){
+    entries.clear();
+    table = NULL;
+    count = 0;
+  }
+
+  //! Number of entries
+  inline size_t size(void) const {
+    return (table)? count : entries.size();
+  }
+
+  //! Record a top-level item
+  m_error_t add(const BerContentTag& t, size_t offset, size_t length);
+
+  //! Write index and locator, the index starting at file offset at
+  m_error_t write(StreamDump& s, size_t at);
+
+  //! Locate the index in a file image, at receives its offset
+  m_error_t read(const unsigned char *d, size_t l, size_t& at);
+
+  //! Find an item in the index read
+  m_error_t find(const BerContentTag& t, size_t ordinal,
+		 size_t& offset, size_t& length) const;
+};
+
 class TaggedDataFile {
 public:
   // class application
   enum DataTags {
     VOID = 0x00,
     HEADER = 0x04,
-    INT_ARRAY = 0x10, 
-    DOUBLE_ARRAY = 0x11
+    INDEX = 0x05,
+    LOCATOR = 0x06,
+    INT_ARRAY = 0x10,       // signed, width given by the record size
+    DOUBLE_ARRAY = 0x11,
+    FLOAT_ARRAY = 0x12,
+    UINT_ARRAY = 0x13,      // unsigned, width given by the record size
+    COMPLEX_ARRAY = 0x14,   // pairs of real and imaginary part
+    TABLE = 0x18,           // columns in row groups, see TDFTable
+    TIME_SERIES = 0x19      // time stamps and arrays, see TDFTimeSeries
   };
   typedef enum DataTags AppTags;
 
@@ -70,18 +155,49 @@ public:
   typedef BerContentTag::TagString<(int)DOUBLE_ARRAY,
     BerContentTag::BER_CONSTRUCTED, BerContentTag::BER_APPLICATION> tDoubleArray;
   static const unsigned char bDoubleArray[tDoubleArray::SIZE];
+  typedef BerContentTag::TagString<(int)INDEX,
+    BerContentTag::BER_PRIMITIVE, BerContentTag::BER_APPLICATION> tIndex;
+  static const unsigned char bIndex[tIndex::SIZE];
+  typedef BerContentTag::TagString<(int)LOCATOR,
+    BerContentTag::BER_PRIMITIVE, BerContentTag::BER_APPLICATION> tLocator;
+  static const unsigned char bLocator[tLocator::SIZE];
 
 protected:
   ASN1IO asn;
   BerTree ber;
   bool newScope;
+  TDFIndex index;
+  // file image of open(), parsed on demand
+  const unsigned char *data;
+  size_t dataLen;
+  // file mapped by open(const char *)
+  void *map;
+  size_t mapLen;
+  // file read by load()
+  wtBuffer<unsigned char> image;
+
+  // parse the file image of open()
+  m_error_t parse(void);
+  // release the file mapping
+  void unmap(void);
+
+private:
+  // the file mapping cannot be shared
+  TaggedDataFile(const TaggedDataFile&);
+  TaggedDataFile& operator=(const TaggedDataFile&);
   
 public:
-  TaggedDataFile() : newScope(false) {};
+  TaggedDataFile() : newScope(false), data(NULL), dataLen(0), map(NULL), mapLen(0) {};
+  ~TaggedDataFile() { unmap(); }
 
   void reset(void){
     ber.clear();
     newScope = false;
+    index.clear();
+    data = NULL;
+    dataLen = 0;
+    unmap();
+    image.free();
   }
   
 
@@ -100,6 +216,8 @@ public:
   // Item Interface
   m_error_t addItem(const TDFItem& it);
   m_error_t readItem(TDFItem& it, size_t offset = 0, bool absolute = true);
+  // Read the top-level item of tag it.tag() by ordinal using the index
+  m_error_t fetchItem(TDFItem& it, size_t ordinal = 1);
   inline bool readOk(m_error_t& e){
     return ((e == ERR_NO_ERROR) || (e == ERR_CANCEL));
   }
@@ -117,8 +235,24 @@ public:
   BerTree *getScope(void);
 
   // Serialize
-  m_error_t write(StreamDump& s);
+  m_error_t write(StreamDump& s, bool withIndex = false);
+  // Refer to a file image, which must persist while this is used
+  m_error_t open(const void *b, const size_t& s);
+  // Map a file read-only and refer to it
+  m_error_t open(const char *path);
+  // Read a file into memory by UringReader and refer to it
+  m_error_t load(const char *path);
+  inline const void *mapping(void) const {
+    return map;
+  }
+  inline size_t mappedSize(void) const {
+    return mapLen;
+  }
+  inline bool indexed(void) const {
+    return (data != NULL);
+  }
   inline m_error_t read(const void *b, const size_t& s){
+    reset();
     return ber.replace((const unsigned char *)b,s,true);
   }
 
@@ -22,6 +22,7 @@
 #include "asn1IO.tag"
 
 #include <string.h>
+#include <vector>
 
 #define DEBUG_MARK 1
 #define DEBUG_DUMP 2
@@ -81,6 +82,10 @@ const unsigned char ASN1IO::asn1_utc[utcTag::SIZE] = {
   BerContentTag::TagByte<(int)ASN1_UTC_TIME, 0,
   BerContentTag::BER_PRIMITIVE, BerContentTag::BER_UNIVERSAL >::VALUE };
 
+const unsigned char ASN1IO::asn1_gen[genTag::SIZE] = {
+  BerContentTag::TagByte<(int)ASN1_GENERALIZED_TIME, 0,
+  BerContentTag::BER_PRIMITIVE, BerContentTag::BER_UNIVERSAL >::VALUE };
+
 
 const char * ASN1IO::VersionTag(void) const {
   return _VERSION_;
@@ -319,6 +324,475 @@ BerTag *ASN1IO::writeUTC(const struct tm *tm, m_error_t *err) const {
   return tag;
 }
 
+/*
+ * Zero-copy strings
+ *
+ */
+
+// X.680 character classes, PRINTABLE implies IA5
+enum { CC_IA5 = 1, CC_PRINTABLE = 2 };
+static const unsigned char charClass[256] = {
+#define I CC_IA5
+#define P (CC_IA5 | CC_PRINTABLE)
+  I,I,I,I,I,I,I,I, I,I,I,I,I,I,I,I, I,I,I,I,I,I,I,I, I,I,I,I,I,I,I,I,
+  // space to /
+  P,I,I,I,I,I,I,P, P,P,I,P,P,P,P,P,
+  // 0 to ?
+  P,P,P,P,P,P,P,P, P,P,P,I,I,P,I,P,
+  // @ to _
+  I,P,P,P,P,P,P,P, P,P,P,P,P,P,P,P, P,P,P,P,P,P,P,P, P,P,P,I,I,I,I,I,
+  // ` to DEL
+  I,P,P,P,P,P,P,P, P,P,P,P,P,P,P,P, P,P,P,P,P,P,P,P, P,P,P,I,I,I,I,I
+#undef P
+#undef I
+};
+
+// true, if all characters belong to class cc
+static inline bool checkClass(const unsigned char *c, size_t l, unsigned char cc){
+  unsigned char r = cc;
+  for(size_t i = 0; i < l; i++) r &= charClass[c[i]];
+  return r != 0;
+}
+
+static m_error_t viewString(const BerTag& tag, const char *& s, size_t& l, unsigned char cc){
+  l = tag.c_size();
+  s = reinterpret_cast<const char *>(tag.content().readPtr());
+  if(!l) return ERR_NO_ERROR;
+  if(!s) return ERR_PARAM_UDEF;
+  return checkClass(tag.content().readPtr(), l, cc)? ERR_NO_ERROR : ERR_PARAM_RANG;
+}
+
+static BerTag *referString(const unsigned char *tg, size_t tl, const char *s, size_t l,
+			   m_error_t *err){
+  if(err) *err = ERR_PARAM_NULL;
+  if(!s && l) return NULL;
+  if(err) *err = ERR_MEM_AVAIL;
+  BerTag *tag = new BerTag(tg, tl);
+  if(!tag) return tag;
+  m_error_t res = tag->content(reinterpret_cast<const unsigned char *>(s), l);
+  if(res != ERR_NO_ERROR){
+    delete tag;
+    tag = NULL;
+  }
+  if(err) *err = res;
+  return tag;
+}
+
+/*! \param tag PrintableString tag
+    \param s Receives a pointer into the content of tag
+    \param l Receives the length of s
+    \return Error code as defined in mgrError.h
+
+    s is not terminated and valid as long as the content of tag.
+    If characters outside the PrintableString set are found,
+    ERR_PARAM_RANG is returned, but s and l are valid anyway.
+*/
+m_error_t ASN1IO::viewPrintableString(const BerTag& tag, const char *& s, size_t& l) const {
+  if(!printTag::isEqual(tag.tag().readPtr())) return ERR_PARAM_TYP;
+  return viewString(tag, s, l, CC_PRINTABLE);
+}
+
+/*! \param tag IA5String tag
+    \param s Receives a pointer into the content of tag
+    \param l Receives the length of s
+    \return Error code as defined in mgrError.h
+
+    See viewPrintableString().
+*/
+m_error_t ASN1IO::viewIA5String(const BerTag& tag, const char *& s, size_t& l) const {
+  if(!ia5Tag::isEqual(tag.tag().readPtr())) return ERR_PARAM_TYP;
+  return viewString(tag, s, l, CC_IA5);
+}
+
+/*! \param s String, need not be terminated
+    \param l Length of s
+    \param err Receives the error code as defined in mgrError.h
+    \return New tag referring to s
+
+    The content is not copied, i.e. s must persist as long as the
+    tag and any copies of it. Like writePrintableString() the
+    characters are not checked.
+*/
+BerTag *ASN1IO::referPrintableString(const char *s, size_t l, m_error_t *err) const {
+  return referString(asn1_print, printTag::SIZE, s, l, err);
+}
+
+/*! \param s String, need not be terminated
+    \param l Length of s
+    \param err Receives the error code as defined in mgrError.h
+    \return New tag referring to s
+
+    See referPrintableString(). Characters beyond 7 bits are
+    rejected with ERR_PARAM_RANG.
+*/
+BerTag *ASN1IO::referIA5String(const char *s, size_t l, m_error_t *err) const {
+  if(s && !checkClass(reinterpret_cast<const unsigned char *>(s), l, CC_IA5)){
+    if(err) *err = ERR_PARAM_RANG;
+    return NULL;
+  }
+  return referString(asn1_ia5, ia5Tag::SIZE, s, l, err);
+}
+
+/*
+ * Bulk time conversion
+ *
+ * Calendar arithmetic after H. Hinnant's days_from_civil(), so
+ * neither sprintf() nor mktime() are needed per value.
+ *
+ */
+
+static inline long long daysFromCivil(long long y, unsigned int m, unsigned int d){
+  y -= (m <= 2);
+  const long long era = ((y >= 0)? y : y - 399) / 400;
+  const unsigned int yoe = (unsigned int)(y - era * 400);
+  const unsigned int doy = (153 * ((m > 2)? m - 3 : m + 9) + 2) / 5 + d - 1;
+  const unsigned int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (long long)doe - 719468;
+}
+
+static inline void civilFromDays(long long z, long long& y, unsigned int& m, unsigned int& d){
+  z += 719468;
+  const long long era = ((z >= 0)? z : z - 146096) / 146097;
+  const unsigned int doe = (unsigned int)(z - era * 146097);
+  const unsigned int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const unsigned int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const unsigned int mp = (5 * doy + 2) / 153;
+  d = doy - (153 * mp + 2) / 5 + 1;
+  m = (mp < 10)? mp + 3 : mp - 9;
+  y = (long long)yoe + era * 400 + (m <= 2);
+}
+
+static inline bool isLeap(long long y){
+  return !(y % 4) && ((y % 100) || !(y % 400));
+}
+
+static inline unsigned int monthDays(long long y, unsigned int m){
+  static const unsigned char md[12] = { 31,28,31,30,31,30,31,31,30,31,30,31 };
+  return (m == 2 && isLeap(y))? 29 : md[m-1];
+}
+
+static inline void put2(char *d, unsigned int v){
+  d[0] = '0' + v / 10;
+  d[1] = '0' + v % 10;
+}
+
+static inline int get2(const char *s){
+  const unsigned int h = (unsigned char)s[0] - '0';
+  const unsigned int l = (unsigned char)s[1] - '0';
+  if((h > 9) || (l > 9)) return -1;
+  return h * 10 + l;
+}
+
+// YYYYMMDDhhmm, returns the length or 0 if the year is out of range
+static size_t formatCivil(char *d, long long s){
+  long long days = s / 86400;
+  long long sec = s % 86400;
+  if(sec < 0){
+    sec += 86400;
+    days--;
+  }
+  long long y;
+  unsigned int m, dd;
+  civilFromDays(days, y, m, dd);
+  if((y < 0) || (y > 9999)) return 0;
+  put2(d, (unsigned int)(y / 100));
+  put2(d + 2, (unsigned int)(y % 100));
+  put2(d + 4, m);
+  put2(d + 6, dd);
+  put2(d + 8, (unsigned int)(sec / 3600));
+  put2(d + 10, (unsigned int)(sec / 60 % 60));
+  return 12;
+}
+
+// Z or +hhmm east of UTC
+static size_t formatOffset(char *d, long off){
+  if(!off){
+    *d = 'Z';
+    return 1;
+  }
+  if(off < 0){
+    *d = '-';
+    off = -off;
+  } else *d = '+';
+  off /= 60;
+  put2(d + 1, (unsigned int)(off / 60));
+  put2(d + 3, (unsigned int)(off % 60));
+  return 5;
+}
+
+// YYYYMMDDhh[mm[ss]], seconds only if sec is given
+static m_error_t parseCivil(const char *&s, size_t& l, long long& t, bool sec){
+  if(l < 10) return ERR_PARAM_LEN;
+  const int yh = get2(s), yl = get2(s + 2), m = get2(s + 4);
+  const int d = get2(s + 6), h = get2(s + 8);
+  if((yh < 0) || (yl < 0) || (m < 0) || (d < 0) || (h < 0)) return ERR_PARAM_RANG;
+  const long long y = yh * 100 + yl;
+  if((m < 1) || (m > 12) || (d < 1) || ((unsigned int)d > monthDays(y, m)) || (h > 23))
+    return ERR_PARAM_RANG;
+  t = daysFromCivil(y, m, d) * 86400 + h * 3600;
+  s += 10;
+  l -= 10;
+  // minutes and seconds are optional
+  int v;
+  if((l >= 2) && ((v = get2(s)) >= 0)){
+    if(v > 59) return ERR_PARAM_RANG;
+    t += v * 60;
+    s += 2;
+    l -= 2;
+    if(sec && (l >= 2) && ((v = get2(s)) >= 0)){
+      // leap second
+      if(v > 60) return ERR_PARAM_RANG;
+      t += v;
+      s += 2;
+      l -= 2;
+    }
+  }
+  return ERR_NO_ERROR;
+}
+
+// Z or +hh[mm] east of UTC
+static m_error_t parseOffset(const char *s, size_t l, long long& off){
+  if(!l) return ERR_PARAM_OPT;
+  off = 0;
+  switch(*s){
+  case 'Z':
+    return (l == 1)? ERR_NO_ERROR : ERR_PARAM_LEN;
+  case '+':
+  case '-':
+    break;
+  default:
+    return ERR_PARAM_OPT;
+  }
+  if((l != 3) && (l != 5)) return ERR_PARAM_LEN;
+  const int h = get2(s + 1);
+  const int m = (l == 5)? get2(s + 3) : 0;
+  if((h < 0) || (h > 23) || (m < 0) || (m > 59)) return ERR_PARAM_RANG;
+  off = (h * 60 + m) * 60;
+  if(*s == '-') off = -off;
+  return ERR_NO_ERROR;
+}
+
+long ASN1IO::ZoneCache::probe(time_t t){
+  struct tm tm;
+  if(!localtime_r(&t,&tm)) return 0;
+  return gmtoff(&tm);
+}
+
+/*! The offset is looked up by localtime_r(), whenever t leaves the
+    interval of the last lookup. Within WINDOW of t the transitions
+    are located by bisection, so that a sorted series costs a few
+    dozen lookups per transition. Two transitions closer than
+    WINDOW may be missed.
+*/
+long ASN1IO::ZoneCache::offset(time_t t){
+  if(Valid && (t >= Lo) && (t <= Hi)) return Off;
+  Off = probe(t);
+  Valid = true;
+  time_t ok = t, bad = t + WINDOW;
+  if(probe(bad) == Off) ok = bad;
+  else while(bad - ok > 1){
+    const time_t mid = ok + (bad - ok) / 2;
+    if(probe(mid) == Off) ok = mid; else bad = mid;
+  }
+  Hi = ok;
+  ok = t;
+  bad = t - WINDOW;
+  if(probe(bad) == Off) ok = bad;
+  else while(ok - bad > 1){
+    const time_t mid = ok - (ok - bad) / 2;
+    if(probe(mid) == Off) ok = mid; else bad = mid;
+  }
+  Lo = ok;
+  return Off;
+}
+
+/*! \param d Buffer of at least UTC_MAX octets
+    \param t Time
+    \param off Seconds east of UTC
+    \return Octets written, 0 if t cannot be represented
+
+    The format matches writeUTC(): YYYYMMDDhhmm followed by Z or
+    the offset.
+*/
+size_t ASN1IO::formatUTC(char *d, time_t t, long off){
+  size_t l = formatCivil(d, (long long)t + off);
+  if(!l) return 0;
+  return l + formatOffset(d + l, off);
+}
+
+m_error_t ASN1IO::parseUTC(const char *s, size_t l, time_t& t){
+  if(!s) return ERR_PARAM_NULL;
+  long long lt, off;
+  m_error_t res = parseCivil(s, l, lt, false);
+  if(res != ERR_NO_ERROR) return res;
+  res = parseOffset(s, l, off);
+  if(res != ERR_NO_ERROR) return res;
+  t = (time_t)(lt - off);
+  return ERR_NO_ERROR;
+}
+
+/*! \param tags Array of n UTCTime tags
+    \param n Number of tags
+    \param t Receives n times
+    \return Error code as defined in mgrError.h
+*/
+m_error_t ASN1IO::readUTC(const BerTag * const *tags, size_t n, time_t *t) const {
+  if(!tags || !t) return ERR_PARAM_NULL;
+  for(size_t i = 0; i < n; i++){
+    if(!tags[i]) return ERR_PARAM_NULL;
+    if(!utcTag::isEqual(tags[i]->tag().readPtr())) return ERR_PARAM_TYP;
+    const char *c = reinterpret_cast<const char *>(tags[i]->content().readPtr());
+    if(!c) return ERR_PARAM_UDEF;
+    m_error_t res = parseUTC(c, tags[i]->c_size(), t[i]);
+    if(res != ERR_NO_ERROR) return res;
+  }
+  return ERR_NO_ERROR;
+}
+
+// allocate a tag for each string, free all on failure
+static m_error_t bulkTags(const unsigned char *tag, size_t tl, const char *s,
+			  const size_t *l, size_t w, size_t n, BerTag **tags){
+  size_t i;
+  for(i = 0; i < n; i++, s += w){
+    tags[i] = new BerTag(tag, tl);
+    if(!tags[i]) break;
+    unsigned char *c = tags[i]->allocate(l[i]);
+    if(!c){
+      delete tags[i];
+      break;
+    }
+    memcpy(c, s, l[i]);
+  }
+  if(i == n) return ERR_NO_ERROR;
+  while(i) delete tags[--i];
+  for(i = 0; i < n; i++) tags[i] = NULL;
+  return ERR_MEM_AVAIL;
+}
+
+/*! \param t Array of n times
+    \param n Number of times
+    \param tags Receives n UTCTime tags to be deleted by the caller
+    \param utc Write UTC instead of local time
+    \return Error code as defined in mgrError.h
+
+    Local time offsets are cached per time zone transition, see
+    ZoneCache.
+*/
+m_error_t ASN1IO::writeUTC(const time_t *t, size_t n, BerTag **tags, bool utc) const {
+  if(!t || !tags) return ERR_PARAM_NULL;
+  std::vector<char> s(n * UTC_MAX);
+  std::vector<size_t> l(n);
+  ZoneCache zc;
+  for(size_t i = 0; i < n; i++){
+    l[i] = formatUTC(&s[i * UTC_MAX], t[i], utc ? 0 : zc.offset(t[i]));
+    if(!l[i]) return ERR_PARAM_RANG;
+  }
+  return bulkTags(asn1_utc, utcTag::SIZE, n ? &s[0] : NULL,
+		  n ? &l[0] : NULL, UTC_MAX, n, tags);
+}
+
+/*! \param d Buffer of at least GENERALIZED_MAX octets
+    \param ns Nanoseconds since the epoch
+    \param off Seconds east of UTC
+    \return Octets written, 0 if ns cannot be represented
+
+    The format is YYYYMMDDhhmmss with a fraction without trailing
+    zeros followed by Z or the offset.
+*/
+size_t ASN1IO::formatGeneralizedTime(char *d, XDR::Long ns, long off){
+  long long s = ns / 1000000000LL;
+  long long f = ns % 1000000000LL;
+  if(f < 0){
+    f += 1000000000LL;
+    s--;
+  }
+  s += off;
+  size_t l = formatCivil(d, s);
+  if(!l) return 0;
+  long long sec = s % 60;
+  if(sec < 0) sec += 60;
+  put2(d + l, (unsigned int)sec);
+  l += 2;
+  if(f){
+    d[l++] = '.';
+    unsigned int fd = 9;
+    while(!(f % 10)){
+      f /= 10;
+      fd--;
+    }
+    for(unsigned int k = fd; k > 0; k--, f /= 10)
+      d[l + k - 1] = '0' + (char)(f % 10);
+    l += fd;
+  }
+  return l + formatOffset(d + l, off);
+}
+
+m_error_t ASN1IO::parseGeneralizedTime(const char *s, size_t l, XDR::Long& ns){
+  if(!s) return ERR_PARAM_NULL;
+  long long lt, off, f = 0;
+  m_error_t res = parseCivil(s, l, lt, true);
+  if(res != ERR_NO_ERROR) return res;
+  if(l && ((*s == '.') || (*s == ','))){
+    s++;
+    l--;
+    unsigned int fd = 0;
+    for(; l && ((unsigned int)((unsigned char)*s - '0') <= 9); s++, l--, fd++)
+      // ignore digits below nanoseconds
+      if(fd < 9) f = f * 10 + (*s - '0');
+    if(!fd) return ERR_PARAM_RANG;
+    for(; fd < 9; fd++) f *= 10;
+  }
+  // local time without offset is ambiguous
+  res = parseOffset(s, l, off);
+  if(res != ERR_NO_ERROR) return res;
+  ns = (lt - off) * 1000000000LL + f;
+  return ERR_NO_ERROR;
+}
+
+/*! \param tags Array of n GeneralizedTime tags
+    \param n Number of tags
+    \param ns Receives n times as nanoseconds since the epoch
+    \return Error code as defined in mgrError.h
+*/
+m_error_t ASN1IO::readGeneralizedTime(const BerTag * const *tags, size_t n, XDR::Long *ns) const {
+  if(!tags || !ns) return ERR_PARAM_NULL;
+  for(size_t i = 0; i < n; i++){
+    if(!tags[i]) return ERR_PARAM_NULL;
+    if(!genTag::isEqual(tags[i]->tag().readPtr())) return ERR_PARAM_TYP;
+    const char *c = reinterpret_cast<const char *>(tags[i]->content().readPtr());
+    if(!c) return ERR_PARAM_UDEF;
+    m_error_t res = parseGeneralizedTime(c, tags[i]->c_size(), ns[i]);
+    if(res != ERR_NO_ERROR) return res;
+  }
+  return ERR_NO_ERROR;
+}
+
+/*! \param ns Array of n times as nanoseconds since the epoch
+    \param n Number of times
+    \param tags Receives n GeneralizedTime tags to be deleted by the caller
+    \param utc Write UTC instead of local time
+    \return Error code as defined in mgrError.h
+*/
+m_error_t ASN1IO::writeGeneralizedTime(const XDR::Long *ns, size_t n, BerTag **tags,
+				       bool utc) const {
+  if(!ns || !tags) return ERR_PARAM_NULL;
+  std::vector<char> s(n * GENERALIZED_MAX);
+  std::vector<size_t> l(n);
+  ZoneCache zc;
+  for(size_t i = 0; i < n; i++){
+    long off = 0;
+    if(!utc){
+      long long sec = ns[i] / 1000000000LL;
+      if(ns[i] % 1000000000LL < 0) sec--;
+      off = zc.offset((time_t)sec);
+    }
+    l[i] = formatGeneralizedTime(&s[i * GENERALIZED_MAX], ns[i], off);
+    if(!l[i]) return ERR_PARAM_RANG;
+  }
+  return bulkTags(asn1_gen, genTag::SIZE, n ? &s[0] : NULL, n ? &l[0] : NULL,
+		  GENERALIZED_MAX, n, tags);
+}
+
 
 /*
  * The testsuite
@@ -330,6 +804,7 @@ BerTag *ASN1IO::writeUTC(const struct tm *tm, m_error_t *err) const {
 #ifdef TEST
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <HexDump.h>
 #include <wtBufferDump.h>
 
@@ -472,6 +947,136 @@ int main(int argc, char *argv[]){
       puts("+++ ASN1IO::writePrintableString() finishedOK");
     }
 
+    printf("Test %d: bulk writeUTC()\n",++tests);
+    // CET with DST, 2008-03-30 01:00 UTC is a transition
+    setenv("TZ","CET-1CEST,M3.5.0,M10.5.0/3",1);
+    tzset();
+    const size_t nt = 64;
+    time_t tt[nt];
+    BerTag *tags[nt];
+    for(size_t i = 0; i < nt; i++)
+      tt[i] = 1206838800 - 4 * 3600 + (time_t)i * 457;
+    tt[nt-1] = 1225000000;
+    res = asn.writeUTC(tt,nt,tags);
+    for(size_t i = 0; (i < nt) && (res == ERR_NO_ERROR); i++){
+      BerTag *st = asn.writeUTC(tt[i],&res);
+      if(!st) break;
+      if((st->c_size() != tags[i]->c_size()) ||
+	 memcmp(st->content().readPtr(),tags[i]->content().readPtr(),st->c_size())){
+	res = ERR_INT_DATA;
+	st->dump(stdout,"??? ");
+	tags[i]->dump(stdout,"### ");
+      }
+      delete st;
+    }
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: bulk writeUTC() returned 0x%.4x\n",(int)res);
+    } else {
+      tags[0]->dump(stdout,"??? ");
+      puts("+++ ASN1IO::writeUTC() finished OK!");
+    }
+
+    printf("Test %d: bulk readUTC()\n",++tests);
+    if(res == ERR_NO_ERROR){
+      time_t rt[nt];
+      res = asn.readUTC(tags,nt,rt);
+      for(size_t i = 0; (i < nt) && (res == ERR_NO_ERROR); i++)
+	if(rt[i] != tt[i] - tt[i] % 60) res = ERR_INT_DATA;
+      for(size_t i = 0; i < nt; i++) delete tags[i];
+    }
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: bulk readUTC() returned 0x%.4x\n",(int)res);
+    } else {
+      puts("+++ ASN1IO::readUTC() finished OK!");
+    }
+
+    printf("Test %d: GeneralizedTime\n",++tests);
+    do {
+      char gs[ASN1IO::GENERALIZED_MAX];
+      size_t gl = ASN1IO::formatGeneralizedTime(gs,1234567890123456789LL,0);
+      if((gl != 25) || memcmp(gs,"20090213233130.123456789Z",gl)){
+	res = ERR_INT_DATA;
+	break;
+      }
+      gl = ASN1IO::formatGeneralizedTime(gs,-1500000000LL,3600);
+      if((gl != 21) || memcmp(gs,"19700101005958.5+0100",gl)){
+	res = ERR_INT_DATA;
+	break;
+      }
+      XDR::Long ns[4] = { 0, -1500000000LL, 1206838799999999999LL, 1234567890123456789LL };
+      XDR::Long rn[4];
+      BerTag *gt[4];
+      for(int local = 0; (local < 2) && (res == ERR_NO_ERROR); local++){
+	res = asn.writeGeneralizedTime(ns,4,gt,!local);
+	if(res != ERR_NO_ERROR) break;
+	res = asn.readGeneralizedTime(gt,4,rn);
+	for(size_t i = 0; (i < 4) && (res == ERR_NO_ERROR); i++)
+	  if(rn[i] != ns[i]) res = ERR_INT_DATA;
+	if(local) gt[2]->dump(stdout,"??? ");
+	for(size_t i = 0; i < 4; i++) delete gt[i];
+      }
+    } while(0);
+    if(res != ERR_NO_ERROR){
+      errors++;
+      printf("*** Error: GeneralizedTime returned 0x%.4x\n",(int)res);
+    } else {
+      puts("+++ ASN1IO::writeGeneralizedTime() finished OK!");
+    }
+
+    printf("Test %d: Malformed times\n",++tests);
+    {
+      time_t bt;
+      XDR::Long bn;
+      if((ASN1IO::parseUTC("200802301200Z",13,bt) != ERR_PARAM_RANG) ||
+	 (ASN1IO::parseUTC("2008022812",10,bt) != ERR_PARAM_OPT) ||
+	 (ASN1IO::parseUTC("200802281200+01",15,bt) != ERR_NO_ERROR) ||
+	 (bt != 1204196400) ||
+	 (ASN1IO::parseGeneralizedTime("20080228120000.Z",16,bn) != ERR_PARAM_RANG) ||
+	 (ASN1IO::parseGeneralizedTime("2008022812000a",14,bn) != ERR_PARAM_OPT) ||
+	 (ASN1IO::parseGeneralizedTime("20080228120000,1234567891Z",26,bn) != ERR_NO_ERROR) ||
+	 (bn != 1204200000123456789LL)){
+	errors++;
+	puts("*** Error: malformed times accepted");
+      } else {
+	puts("+++ Malformed times finished OK!");
+      }
+    }
+
+    printf("Test %d: Zero-copy strings\n",++tests);
+    {
+      char src[] = "Device 42 (rev. B)";
+      const char *vs = NULL;
+      size_t vl = 0;
+      m_error_t verr;
+      BerTag *pt = asn.referPrintableString(src,strlen(src),&res);
+      BerTag *it = asn.referIA5String("x\xe4",2,&verr);
+      if(!pt || (res != ERR_NO_ERROR) || it || (verr != ERR_PARAM_RANG)){
+	res = ERR_INT_DATA;
+      } else {
+	res = asn.viewPrintableString(*pt,vs,vl);
+	// content refers to src
+	if((res != ERR_NO_ERROR) || (vs != src) || (vl != strlen(src)) ||
+	   (asn.viewIA5String(*pt,vs,vl) != ERR_PARAM_TYP))
+	  res = ERR_INT_DATA;
+      }
+      if(pt) delete pt;
+      if(it) delete it;
+      if(res == ERR_NO_ERROR){
+	it = asn.writePrintableString("Hall\xf6le!",&res);
+	if(it && (asn.viewPrintableString(*it,vs,vl) != ERR_PARAM_RANG)) res = ERR_INT_DATA;
+	if(it && ((vl != 8) || memcmp(vs,"Hall\xf6le!",8))) res = ERR_INT_DATA;
+	if(it) delete it;
+      }
+      if(res != ERR_NO_ERROR){
+	errors++;
+	printf("*** Error: zero-copy strings returned 0x%.4x\n",(int)res);
+      } else {
+	puts("+++ ASN1IO::viewPrintableString() finished OK!");
+      }
+    }
+
     printf("\n%d tests completed with %d errors.\n",tests,errors);
     printf("Used version: %s\n",asn.VersionTag());
     
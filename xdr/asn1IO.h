@@ -49,7 +49,8 @@ public:
     ASN1_PRINTABLE_STRING = 0x13,
     ASN1_T61_STRING = 0x14,	
     ASN1_IA5_STRING = 0x16,		
-    ASN1_UTC_TIME = 0x17	
+    ASN1_UTC_TIME = 0x17,
+    ASN1_GENERALIZED_TIME = 0x18
   };
   typedef enum ASN1Tags ASN1Tag;
 
@@ -62,12 +63,43 @@ public:
     BerContentTag::BER_PRIMITIVE, BerContentTag::BER_UNIVERSAL> printTag;
   typedef BerContentTag::TagString<(int)ASN1_UTC_TIME,
     BerContentTag::BER_PRIMITIVE, BerContentTag::BER_UNIVERSAL> utcTag;
+  typedef BerContentTag::TagString<(int)ASN1_GENERALIZED_TIME,
+    BerContentTag::BER_PRIMITIVE, BerContentTag::BER_UNIVERSAL> genTag;
+
+  enum {
+    UTC_MAX = 17,            // YYYYMMDDhhmm+hhmm
+    GENERALIZED_MAX = 29     // YYYYMMDDhhmmss.fffffffff+hhmm
+  };
+
+  // Local UTC offset valid between time zone transitions
+  class ZoneCache {
+  protected:
+    time_t Lo, Hi;
+    long Off;
+    bool Valid;
+
+    static long probe(time_t t);
+
+  public:
+    enum {
+      WINDOW = 7 * 86400     // transitions are assumed further apart
+    };
+
+    ZoneCache() : Lo(0), Hi(0), Off(0), Valid(false) {}
+    // seconds east of UTC at t
+    long offset(time_t t);
+    // call after tzset()
+    void reset(void) {
+      Valid = false;
+    }
+  };
 
  protected:
   static const unsigned char asn1_int[intTag::SIZE];
   static const unsigned char asn1_ia5[ia5Tag::SIZE];
   static const unsigned char asn1_print[printTag::SIZE];
   static const unsigned char asn1_utc[utcTag::SIZE];
+  static const unsigned char asn1_gen[genTag::SIZE];
 
  public:
   template<typename T> m_error_t readInt(const BerTag& tag, T& val) const {
@@ -128,6 +160,12 @@ public:
   m_error_t readIA5String(const BerTag& tag, char *s, const size_t& l) const;
   BerTag *writeIA5String(const char *s, m_error_t *err = NULL) const;
 
+  // zero-copy access, the strings must outlive the tags
+  m_error_t viewPrintableString(const BerTag& tag, const char *& s, size_t& l) const;
+  BerTag *referPrintableString(const char *s, size_t l, m_error_t *err = NULL) const;
+  m_error_t viewIA5String(const BerTag& tag, const char *& s, size_t& l) const;
+  BerTag *referIA5String(const char *s, size_t l, m_error_t *err = NULL) const;
+
   m_error_t readUTC(const BerTag& tag, struct tm *tm);
   BerTag *writeUTC(const struct tm *tm = NULL, m_error_t *err = NULL) const;
   inline BerTag *writeUTC(const time_t& t, m_error_t *err = NULL) const {
@@ -136,6 +174,19 @@ public:
     return writeUTC(&ts, err);
   }
 
+  // bulk conversion without libc, local time unless utc
+  static size_t formatUTC(char *d, time_t t, long off);
+  static m_error_t parseUTC(const char *s, size_t l, time_t& t);
+  m_error_t readUTC(const BerTag * const *tags, size_t n, time_t *t) const;
+  m_error_t writeUTC(const time_t *t, size_t n, BerTag **tags, bool utc = false) const;
+
+  // nanoseconds since the epoch
+  static size_t formatGeneralizedTime(char *d, XDR::Long ns, long off);
+  static m_error_t parseGeneralizedTime(const char *s, size_t l, XDR::Long& ns);
+  m_error_t readGeneralizedTime(const BerTag * const *tags, size_t n, XDR::Long *ns) const;
+  m_error_t writeGeneralizedTime(const XDR::Long *ns, size_t n, BerTag **tags,
+				 bool utc = true) const;
+
   const char * VersionTag(void) const;
 };
 
@@ -0,0 +1,747 @@
+/*
+ *
+ * xdrCall - basic RPC framework
+ *
+ * (c) 2007 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *
+ * RPCConnection - record marking transport on a file descriptor
+ * RPCClient     - caller with pipelined calls
+ * RPCBroker     - dispatcher of calls to programs
+ *
+ * This defines the values:
+ *
+ */
+
+#include <xdrCall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "xdrCall.tag"
+
+#ifndef IOV_MAX
+# define IOV_MAX 16
+#endif
+
+using namespace mgr;
+
+/*
+ * RPCConnection
+ *
+ */
+
+const char *RPCConnection::VersionTag(void) const {
+  return _VERSION_;
+}
+
+RPCConnection::RPCConnection(int f, size_t b) :
+  fd( f ), inPos( 0 ), assembled( false ), maxRecord( 16 << 20 ),
+  enc( out ), record( 0 ), extLen( 0 ), batch( b ) {
+  out.Chunk(b);
+}
+
+size_t RPCConnection::pending(void) const {
+  size_t l = out.byte_size();
+  for(size_t i = 0; i < ext.size(); i++) l += ext[i].len;
+  return l;
+}
+
+xdrStream& RPCConnection::begin(void){
+  record = out.byte_size();
+  extLen = 0;
+  enc.seek(record);
+  // the record marking header is set by end()
+  enc.putUInt(0);
+  return enc;
+}
+
+m_error_t RPCConnection::attach(const void *d, size_t l){
+  if(!d && l) return ERR_PARAM_NULL;
+  if(l > MAX_FRAGMENT) return ERR_PARAM_LEN;
+  m_error_t err = enc.putUInt(static_cast<XDR::UInt>(l));
+  if(err != ERR_NO_ERROR) return err;
+  if(!l) return ERR_NO_ERROR;
+  Segment s;
+  s.at = enc.tell();
+  s.data = d;
+  s.len = l;
+  ext.push_back(s);
+  extLen += l;
+  const unsigned char zero[4] = { 0, 0, 0, 0 };
+  return enc.putOpaque(zero, xdrStream::pad(l) - l);
+}
+
+void RPCConnection::rewind(size_t at){
+  while(!ext.empty() && (ext.back().at >= at)){
+    extLen -= ext.back().len;
+    ext.pop_back();
+  }
+  out.trunc(at);
+  enc.seek(at);
+}
+
+m_error_t RPCConnection::end(void){
+  const size_t l = out.byte_size() - record - 4 + extLen;
+  if(l > MAX_FRAGMENT){
+    rewind(record);
+    return ERR_PARAM_LEN;
+  }
+  XDR::xdrWrite<XDR::UInt>(out.writePtr() + record,
+			   static_cast<XDR::UInt>(l | LAST_FRAGMENT));
+  extLen = 0;
+  if(pending() >= batch) return flush();
+  return ERR_NO_ERROR;
+}
+
+m_error_t RPCConnection::flush(void){
+  const size_t total = out.byte_size();
+  if(!total) return ERR_NO_ERROR;
+  const unsigned char *b = out.readPtr();
+
+  // interleave the batch with the attached payloads
+  std::vector<struct iovec> iov;
+  iov.reserve(2 * ext.size() + 1);
+  size_t at = 0;
+  for(size_t i = 0; i <= ext.size(); i++){
+    const size_t to = (i < ext.size()) ? ext[i].at : total;
+    if(to > at){
+      struct iovec v;
+      v.iov_base = const_cast<unsigned char *>(b + at);
+      v.iov_len = to - at;
+      iov.push_back(v);
+    }
+    if(i < ext.size()){
+      struct iovec v;
+      v.iov_base = const_cast<void *>(ext[i].data);
+      v.iov_len = ext[i].len;
+      iov.push_back(v);
+    }
+    at = to;
+  }
+
+  m_error_t err = ERR_NO_ERROR;
+  bool sock = true;
+  bool reading = true;
+  for(size_t i = 0; i < iov.size(); ){
+    const size_t n = (iov.size() - i < (size_t)IOV_MAX) ? iov.size() - i : (size_t)IOV_MAX;
+    ssize_t w;
+    if(sock){
+      // sendmsg() does not raise SIGPIPE on a closed peer
+      struct msghdr m;
+      memset(&m, 0, sizeof(m));
+      m.msg_iov = &iov[i];
+      m.msg_iovlen = n;
+      w = ::sendmsg(fd, &m, MSG_NOSIGNAL | MSG_DONTWAIT);
+      if((w < 0) && (errno == ENOTSOCK)){
+	sock = false;
+	continue;
+      }
+    } else {
+      w = ::writev(fd, &iov[i], n);
+    }
+    if(w < 0){
+      if(errno == EINTR) continue;
+      if((errno != EAGAIN) && (errno != EWOULDBLOCK)){
+	err = ERR_FILE_WRITE;
+	break;
+      }
+      // the peer may itself wait for us to read
+      struct pollfd p;
+      p.fd = fd;
+      p.events = reading ? (POLLOUT | POLLIN) : POLLOUT;
+      p.revents = 0;
+      if(::poll(&p, 1, -1) < 0){
+	if(errno == EINTR) continue;
+	err = ERR_FILE_WRITE;
+	break;
+      }
+      if(reading && (p.revents & POLLIN)){
+	err = drain();
+	if(err == ERR_CANCEL){
+	  reading = false;
+	  err = ERR_NO_ERROR;
+	}
+	if(err != ERR_NO_ERROR) break;
+      }
+      continue;
+    }
+    size_t s = static_cast<size_t>(w);
+    while((i < iov.size()) && (s >= iov[i].iov_len)){
+      s -= iov[i].iov_len;
+      i++;
+    }
+    if(s){
+      iov[i].iov_base = static_cast<char *>(iov[i].iov_base) + s;
+      iov[i].iov_len -= s;
+    }
+  }
+
+  ext.clear();
+  out.trunc(0);
+  enc.seek(0);
+  record = 0;
+  return err;
+}
+
+m_error_t RPCConnection::fill(size_t need){
+  // move the unconsumed octets to the front
+  size_t avail = in.byte_size() - inPos;
+  if(inPos){
+    if(avail) memmove(in.writePtr(), in.readPtr() + inPos, avail);
+    in.trunc(avail);
+    inPos = 0;
+  }
+  while(avail < need){
+    size_t want = need - avail;
+    if(want < READ_CHUNK) want = READ_CHUNK;
+    m_error_t err = in.trunc(avail + want, true);
+    if(err != ERR_NO_ERROR) return err;
+    ssize_t r = ::read(fd, in.writePtr() + avail, want);
+    if(r < 0){
+      in.trunc(avail);
+      if(errno == EINTR) continue;
+      return ERR_FILE_READ;
+    }
+    in.trunc(avail + r);
+    if(!r) return (avail || frag.byte_size()) ? ERR_PARS_END : ERR_FILE_END;
+    avail += r;
+  }
+  return ERR_NO_ERROR;
+}
+
+m_error_t RPCConnection::receive(const unsigned char *& d, size_t& l, bool block){
+  if(assembled){
+    frag.trunc(0);
+    assembled = false;
+  }
+  for(;;){
+    const size_t avail = in.byte_size() - inPos;
+    size_t need = 4;
+    if(avail >= 4){
+      const unsigned char *p = in.readPtr() + inPos;
+      const XDR::UInt h = XDR::xdrRead<XDR::UInt>(p);
+      const size_t fl = h & MAX_FRAGMENT;
+      if(fl + frag.byte_size() > maxRecord) return ERR_PARAM_LEN;
+      if(avail - 4 >= fl){
+	inPos += 4 + fl;
+	if((h & LAST_FRAGMENT) && !frag.byte_size()){
+	  d = p + 4;
+	  l = fl;
+	  return ERR_NO_ERROR;
+	}
+	m_error_t err = frag.append(p + 4, fl);
+	if(err != ERR_NO_ERROR) return err;
+	if(h & LAST_FRAGMENT){
+	  assembled = true;
+	  d = frag.readPtr();
+	  l = frag.byte_size();
+	  return ERR_NO_ERROR;
+	}
+	continue;
+      }
+      need += fl;
+    }
+    if(!block) return ERR_CANCEL;
+    m_error_t err = fill(need);
+    if(err != ERR_NO_ERROR) return err;
+  }
+}
+
+/*
+ * RPCClient
+ *
+ */
+
+RPCClient::RPCClient(int f, XDR::UInt program, XDR::UInt version, size_t b) :
+  RPCConnection(f, b), prog( program ), vers( version ) {
+  xid = static_cast<XDR::UInt>(time(NULL) ^ (getpid() << 16));
+}
+
+m_error_t RPCClient::send(XDR::UInt proc, const _RPCParameter& args, XDR::UInt& id,
+			  const void *payload, size_t l){
+  if(!payload && l) return ERR_PARAM_NULL;
+  do {
+    xid++;
+  } while(inflight.count(xid));
+  const XDR::UInt h[10] = { xid, RPC::CALL, RPC::VERSION, prog, vers, proc,
+			    RPC::AUTH_NONE, 0, RPC::AUTH_NONE, 0 };
+  xdrStream& s = begin();
+  m_error_t err = s.putArray(h, 10);
+  if(err == ERR_NO_ERROR) err = args.serialize(s);
+  if((err == ERR_NO_ERROR) && payload) err = attach(payload, l);
+  if(err != ERR_NO_ERROR){
+    rewind(record);
+    return err;
+  }
+  // the call is in flight, even if writing the batch failed
+  inflight.insert(xid);
+  id = xid;
+  return end();
+}
+
+m_error_t RPCClient::reply(const unsigned char *d, size_t l, _RPCParameter& res){
+  xdrStream r(d, l);
+  XDR::UInt h[3];
+  m_error_t err = r.getArray(h, 3);
+  if(err != ERR_NO_ERROR) return err;
+  if(h[2] == RPC::MSG_DENIED) return ERR_PARAM_LCK;
+  if(h[2] != RPC::MSG_ACCEPTED) return ERR_PARS_STX;
+  XDR::UInt flavor, stat;
+  const unsigned char *verf;
+  size_t vl;
+  if((err = r.getUInt(flavor)) != ERR_NO_ERROR) return err;
+  if((err = r.getBytes(verf, vl)) != ERR_NO_ERROR) return err;
+  if((err = r.getUInt(stat)) != ERR_NO_ERROR) return err;
+  switch(stat){
+  case RPC::SUCCESS:
+    return res.import(r);
+  case RPC::PROG_UNAVAIL:
+  case RPC::PROG_MISMATCH:
+  case RPC::PROC_UNAVAIL:
+    return ERR_PARAM_SEL;
+  case RPC::GARBAGE_ARGS:
+    return ERR_PARS_STX;
+  }
+  return ERR_INT_STATE;
+}
+
+m_error_t RPCClient::keep(const unsigned char *d, size_t l){
+  if(l < 8) return ERR_NO_ERROR;
+  const XDR::UInt x = XDR::xdrRead<XDR::UInt>(d);
+  if(XDR::xdrRead<XDR::UInt>(d + 4) != RPC::REPLY) return ERR_NO_ERROR;
+  if(!inflight.count(x) || replies.count(x)) return ERR_NO_ERROR;
+  return replies[x].append(d, l);
+}
+
+m_error_t RPCClient::drain(void){
+  // poll() reported data, so a single read() does not block
+  if(fill(in.byte_size() - inPos + 1) != ERR_NO_ERROR) return ERR_CANCEL;
+  for(;;){
+    const unsigned char *d;
+    size_t l;
+    m_error_t err = receive(d, l, false);
+    if(err == ERR_CANCEL) return ERR_NO_ERROR;
+    if(err != ERR_NO_ERROR) return err;
+    if((err = keep(d, l)) != ERR_NO_ERROR) return err;
+  }
+}
+
+m_error_t RPCClient::wait(XDR::UInt id, _RPCParameter& res){
+  if(!inflight.count(id)) return ERR_PARAM_RANG;
+  // flush() may receive the reply meanwhile
+  m_error_t err = replies.count(id) ? ERR_NO_ERROR : flush();
+  std::map<XDR::UInt, wtBuffer<unsigned char> >::iterator k = replies.find(id);
+  if(k != replies.end()){
+    inflight.erase(id);
+    err = reply(k->second.readPtr(), k->second.byte_size(), res);
+    replies.erase(k);
+    return err;
+  }
+  if(err != ERR_NO_ERROR) return err;
+  for(;;){
+    const unsigned char *d;
+    size_t l;
+    if((err = receive(d, l)) != ERR_NO_ERROR) return err;
+    if(l < 8) continue;
+    const XDR::UInt x = XDR::xdrRead<XDR::UInt>(d);
+    if(XDR::xdrRead<XDR::UInt>(d + 4) != RPC::REPLY) continue;
+    if(x == id){
+      inflight.erase(id);
+      return reply(d, l, res);
+    }
+    // keep replies to other calls in flight
+    if((err = keep(d, l)) != ERR_NO_ERROR) return err;
+  }
+}
+
+/*
+ * RPCBroker
+ *
+ */
+
+const char *RPCBroker::VersionTag(void) const {
+  return _VERSION_;
+}
+
+m_error_t RPCBroker::add(XDR::UInt prog, XDR::UInt vers, RPCProgram& p){
+  for(size_t i = 0; i < programs.size(); i++){
+    if((programs[i].prog == prog) && (programs[i].vers == vers)) return ERR_PARAM_UNIQ;
+  }
+  Entry e;
+  e.prog = prog;
+  e.vers = vers;
+  e.p = &p;
+  programs.push_back(e);
+  return ERR_NO_ERROR;
+}
+
+m_error_t RPCBroker::dispatch(RPCConnection& c, const unsigned char *d, size_t l){
+  xdrStream args(d, l);
+  XDR::UInt h[6];
+  // xid, message type, rpc version, program, version, procedure
+  if(args.getArray(h, 2) != ERR_NO_ERROR) return ERR_NO_ERROR;
+  if(h[1] != RPC::CALL) return ERR_NO_ERROR;
+  m_error_t err = args.getArray(h + 2, 4);
+
+  xdrStream& res = c.begin();
+  if((err == ERR_NO_ERROR) && (h[2] != RPC::VERSION)){
+    const XDR::UInt r[6] = { h[0], RPC::REPLY, RPC::MSG_DENIED, RPC::RPC_MISMATCH,
+			     RPC::VERSION, RPC::VERSION };
+    if((err = res.putArray(r, 6)) != ERR_NO_ERROR) return err;
+    return c.end();
+  }
+  const XDR::UInt r[5] = { h[0], RPC::REPLY, RPC::MSG_ACCEPTED, RPC::AUTH_NONE, 0 };
+  m_error_t e = res.putArray(r, 5);
+  if(e != ERR_NO_ERROR) return e;
+  const size_t stat = res.tell();
+
+  // credentials and verifier are not checked
+  for(int i = 0; (i < 2) && (err == ERR_NO_ERROR); i++){
+    XDR::UInt flavor;
+    const unsigned char *b;
+    size_t bl;
+    if((err = args.getUInt(flavor)) == ERR_NO_ERROR) err = args.getBytes(b, bl);
+  }
+  if(err != ERR_NO_ERROR){
+    if((err = res.putUInt(RPC::GARBAGE_ARGS)) != ERR_NO_ERROR) return err;
+    return c.end();
+  }
+
+  RPCProgram *p = NULL;
+  XDR::UInt low = ~(XDR::UInt)0, high = 0;
+  for(size_t i = 0; i < programs.size(); i++){
+    if(programs[i].prog != h[3]) continue;
+    if(programs[i].vers == h[4]) p = programs[i].p;
+    if(programs[i].vers < low) low = programs[i].vers;
+    if(programs[i].vers > high) high = programs[i].vers;
+  }
+  if(!p){
+    if(low > high){
+      err = res.putUInt(RPC::PROG_UNAVAIL);
+    } else {
+      const XDR::UInt m[3] = { RPC::PROG_MISMATCH, low, high };
+      err = res.putArray(m, 3);
+    }
+    if(err != ERR_NO_ERROR) return err;
+    return c.end();
+  }
+
+  if((err = res.putUInt(RPC::SUCCESS)) != ERR_NO_ERROR) return err;
+  err = p->call(h[5], args, res);
+  if(err != ERR_NO_ERROR){
+    c.rewind(stat);
+    XDR::UInt s = RPC::SYSTEM_ERR;
+    switch(err){
+    case ERR_PARAM_SEL:
+      s = RPC::PROC_UNAVAIL;
+      break;
+    case ERR_PARS_STX:
+    case ERR_PARS_END:
+    case ERR_PARAM_LEN:
+    case ERR_PARAM_RANG:
+      s = RPC::GARBAGE_ARGS;
+      break;
+    default:
+      break;
+    }
+    if((err = res.putUInt(s)) != ERR_NO_ERROR) return err;
+  }
+  return c.end();
+}
+
+m_error_t RPCBroker::serve(int fd, size_t batch){
+  RPCConnection c(fd, batch);
+  for(;;){
+    const unsigned char *d;
+    size_t l;
+    m_error_t err = c.receive(d, l, false);
+    if(err == ERR_CANCEL){
+      // answer the buffered calls before waiting for more
+      if((err = c.flush()) != ERR_NO_ERROR) return err;
+      err = c.receive(d, l);
+    }
+    if(err == ERR_FILE_END) return c.flush();
+    if(err != ERR_NO_ERROR) return err;
+    if((err = dispatch(c, d, l)) != ERR_NO_ERROR) return err;
+  }
+}
+
+#ifdef TEST
+
+#include <stdio.h>
+#include <pthread.h>
+
+// program of the test server
+class Calc : public RPCProgram {
+public:
+  enum { PROG = 0x20000123, VERS = 1 };
+  enum { NUL = 0, ADD = 1, CHECKSUM = 2, FAIL = 3 };
+
+  virtual m_error_t call(XDR::UInt proc, xdrStream& args, xdrStream& res){
+    m_error_t err;
+    switch(proc){
+    case NUL:
+      return ERR_NO_ERROR;
+    case ADD: {
+      XDR::Int a, b;
+      if((err = args.getInt(a)) != ERR_NO_ERROR) return err;
+      if((err = args.getInt(b)) != ERR_NO_ERROR) return err;
+      return res.putHyper((XDR::Long)a + b);
+    }
+    case CHECKSUM: {
+      XDR::UInt seed;
+      const unsigned char *d;
+      size_t l;
+      if((err = args.getUInt(seed)) != ERR_NO_ERROR) return err;
+      if((err = args.getBytes(d, l)) != ERR_NO_ERROR) return err;
+      XDR::ULong s = seed;
+      for(size_t i = 0; i < l; i++) s = s * 31 + d[i];
+      return res.putUHyper(s);
+    }
+    case FAIL:
+      return ERR_MEM_AVAIL;
+    }
+    return ERR_PARAM_SEL;
+  }
+};
+
+// arguments of ADD
+class AddArgs : public _RPCParameter {
+public:
+  XDR::Int a, b;
+  AddArgs(XDR::Int x, XDR::Int y) : a(x), b(y) { initialized = true; }
+  virtual m_error_t serialize(xdrStream& s) const {
+    m_error_t err = s.putInt(a);
+    if(err != ERR_NO_ERROR) return err;
+    return s.putInt(b);
+  }
+  virtual m_error_t import(xdrStream& s){
+    m_error_t err = s.getInt(a);
+    if(err != ERR_NO_ERROR) return err;
+    return s.getInt(b);
+  }
+};
+
+struct Server {
+  RPCBroker *broker;
+  int fd;
+  m_error_t res;
+};
+
+static void *serveThread(void *arg){
+  Server *s = static_cast<Server *>(arg);
+  s->res = s->broker->serve(s->fd);
+  return NULL;
+}
+
+int main(int argc, char *argv[]){
+  m_error_t res;
+  size_t tests, errors;
+
+  tests = errors = 0;
+
+  printf("Test %d: Record marking\n",++tests);
+  do {
+    int p[2];
+    if(pipe(p)){
+      res = ERR_FILE_OPEN;
+      break;
+    }
+    // one record of 3 fragments, one of a single fragment, a truncated one
+    const unsigned char raw[] = {
+      0x00, 0x00, 0x00, 0x04, 'a', 'b', 'c', 'd',
+      0x00, 0x00, 0x00, 0x00,
+      0x80, 0x00, 0x00, 0x04, 'e', 'f', 'g', 'h',
+      0x80, 0x00, 0x00, 0x04, 'i', 'j', 'k', 'l',
+      0x80, 0x00, 0x00, 0x08, 'm'
+    };
+    res = ERR_INT_DATA;
+    if(write(p[1], raw, sizeof(raw)) != (ssize_t)sizeof(raw)) break;
+    close(p[1]);
+    RPCConnection c(p[0]);
+    const unsigned char *d;
+    size_t l;
+    if((c.receive(d, l) != ERR_NO_ERROR) || (l != 8) || memcmp(d, "abcdefgh", 8)) break;
+    if((c.receive(d, l) != ERR_NO_ERROR) || (l != 4) || memcmp(d, "ijkl", 4)) break;
+    if(c.receive(d, l, false) != ERR_CANCEL) break;
+    if(c.receive(d, l) != ERR_PARS_END) break;
+    close(p[0]);
+    res = ERR_NO_ERROR;
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: record marking failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ Record marking finished OK!");
+  }
+
+  int sv[2];
+  if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv)){
+    puts("*** Error: socketpair() failed");
+    return 1;
+  }
+  Calc calc;
+  RPCBroker broker;
+  broker.add(Calc::PROG, Calc::VERS, calc);
+  Server server = { &broker, sv[1], ERR_INT_STATE };
+  pthread_t thread;
+  if(pthread_create(&thread, NULL, serveThread, &server)){
+    puts("*** Error: pthread_create() failed");
+    return 1;
+  }
+  RPCClient client(sv[0], Calc::PROG, Calc::VERS);
+
+  printf("Test %d: Single call\n",++tests);
+  do {
+    RPCVoid v;
+    RPCParameter<XDR::Long> sum;
+    if((res = client.call(Calc::NUL, v, v)) != ERR_NO_ERROR) break;
+    if((res = client.call(Calc::ADD, AddArgs(40, 2), sum)) != ERR_NO_ERROR) break;
+    if(sum.get() != 42) res = ERR_INT_DATA;
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: single call failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ Single call finished OK!");
+  }
+
+  printf("Test %d: Pipelined calls\n",++tests);
+  do {
+    const int N = 500;
+    XDR::UInt id[N];
+    for(int i = 0; i < N; i++){
+      if((res = client.send(Calc::ADD, AddArgs(i, -3 * i), id[i])) != ERR_NO_ERROR) break;
+    }
+    if(res != ERR_NO_ERROR) break;
+    // collect in reverse order, which keeps all other replies
+    for(int i = N - 1; i >= 0; i--){
+      RPCParameter<XDR::Long> sum;
+      if((res = client.wait(id[i], sum)) != ERR_NO_ERROR) break;
+      if(sum.get() != -2 * i){
+	res = ERR_INT_DATA;
+	break;
+      }
+    }
+    if((res == ERR_NO_ERROR) && client.outstanding()) res = ERR_INT_STATE;
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: pipelined calls failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ Pipelined calls finished OK!");
+  }
+
+  printf("Test %d: Calls exceeding the socket buffers\n",++tests);
+  do {
+    // neither side reads, before the other one blocks
+    const int N = 200000;
+    std::vector<XDR::UInt> id(N);
+    for(int i = 0; i < N; i++){
+      if((res = client.send(Calc::ADD, AddArgs(i, 1), id[i])) != ERR_NO_ERROR) break;
+    }
+    if(res != ERR_NO_ERROR) break;
+    for(int i = 0; i < N; i++){
+      RPCParameter<XDR::Long> sum;
+      if((res = client.wait(id[i], sum)) != ERR_NO_ERROR) break;
+      if(sum.get() != i + 1){
+	res = ERR_INT_DATA;
+	break;
+      }
+    }
+    if((res == ERR_NO_ERROR) && client.outstanding()) res = ERR_INT_STATE;
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: calls exceeding the socket buffers failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ Calls exceeding the socket buffers finished OK!");
+  }
+
+  printf("Test %d: Attached payloads\n",++tests);
+  do {
+    wtBuffer<unsigned char> P;
+    const size_t L = 200001;
+    P.trunc(L);
+    unsigned char *p = P.writePtr();
+    for(size_t i = 0; i < L; i++) p[i] = static_cast<unsigned char>(i * 7 + (i >> 9));
+    XDR::UInt id[3];
+    for(XDR::UInt k = 0; k < 3; k++){
+      if((res = client.send(Calc::CHECKSUM, RPCParameter<XDR::UInt>(k), id[k], p + k, L - k))
+	 != ERR_NO_ERROR) break;
+    }
+    if(res != ERR_NO_ERROR) break;
+    for(XDR::UInt k = 0; k < 3; k++){
+      RPCParameter<XDR::ULong> s;
+      if((res = client.wait(id[k], s)) != ERR_NO_ERROR) break;
+      XDR::ULong ref = k;
+      for(size_t i = k; i < L; i++) ref = ref * 31 + p[i];
+      if(s.get() != ref){
+	res = ERR_INT_DATA;
+	break;
+      }
+    }
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: attached payloads failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ Attached payloads finished OK!");
+  }
+
+  printf("Test %d: Rejected calls\n",++tests);
+  do {
+    RPCVoid v;
+    RPCParameter<XDR::Long> sum;
+    res = ERR_INT_DATA;
+    if(client.call(7, v, v) != ERR_PARAM_SEL) break;
+    if(client.call(Calc::ADD, v, sum) != ERR_PARS_STX) break;
+    if(client.call(Calc::FAIL, v, v) != ERR_INT_STATE) break;
+    if(client.wait(12345, v) != ERR_PARAM_RANG) break;
+    {
+      RPCClient other(sv[0], Calc::PROG, Calc::VERS + 1);
+      if(other.call(Calc::NUL, v, v) != ERR_PARAM_SEL) break;
+    }
+    {
+      RPCClient other(sv[0], Calc::PROG + 1, Calc::VERS);
+      if(other.call(Calc::NUL, v, v) != ERR_PARAM_SEL) break;
+    }
+    if(client.call(Calc::ADD, AddArgs(1, 1), sum) != ERR_NO_ERROR) break;
+    if(sum.get() != 2) break;
+    res = ERR_NO_ERROR;
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: rejected calls failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ Rejected calls finished OK!");
+  }
+
+  printf("Test %d: Shutdown\n",++tests);
+  shutdown(sv[0], SHUT_WR);
+  pthread_join(thread, NULL);
+  close(sv[0]);
+  close(sv[1]);
+  if(server.res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: serve() returned 0x%.4x\n",(int)server.res);
+  } else {
+    puts("+++ Shutdown finished OK!");
+  }
+
+  printf("\n%d tests completed with %d errors.\n",tests,errors);
+  printf("Used version: %s\n",broker.VersionTag());
+
+  return 0;
+}
+
+#endif // TEST
@@ -9,6 +9,13 @@
  *
  * This defines the classes:
  *
+ * _RPCParameter - interface of marshalled parameters
+ * RPCParameter  - parameter of a single XDR type
+ * RPCVoid       - empty parameter
+ * RPCConnection - record marking transport on a file descriptor
+ * RPCClient     - caller with pipelined calls
+ * RPCProgram    - interface of a served program
+ * RPCBroker     - dispatcher of calls to programs
  *
  * This defines the values:
  *
@@ -20,10 +27,10 @@
     RPC functionality is useful in a variety of fields. Starting
     with user the conventional RPC services such as NFS, through
     management of user interfaces, e.g. the signal / slot model of
-    Qt, convenient unit testing, to Web-Service technologies such 
+    Qt, convenient unit testing, to Web-Service technologies such
     as SOAP.
 
-    xdrCall was written with the last two use cases in mind, but 
+    xdrCall was written with the last two use cases in mind, but
     should be as well for any other RPC use. The more interesting
     question is rather, why yet another RPC layer?
 
@@ -38,24 +45,42 @@
     generic interface, where frontends for all established schemes
     and all you might invent can be easily attached.
 
+    The messages follow RFC 1831 with AUTH_NONE credentials and
+    record marking on stream transports, e.g. Unix domain sockets
+    or a socketpair(). A client may have many calls in flight on
+    one connection. Replies are matched by their xid and may be
+    collected in any order. Calls and replies are collected in a
+    batch and written by a single system call.
+
     \author Dr. Lars Hanke
-    \date 2007
+    \date 2007-2008
 */
 
 #ifndef _XDR_XDRCALL_H_
 # define _XDR_XDRCALL_H_
 
 #include <stdlib.h>
+#include <string.h>
+#include <set>
+#include <map>
+#include <vector>
 #include <mgrError.h>
-#include <Concepts.h>
-#include "xdrOrder.h"
+#include <wtBuffer.h>
+#include <xdrStream.h>
 
 namespace mgr {
 
-  class _RPCParameter : public sol::HTree::Node {
+  /*! \class _RPCParameter
+      \brief Interface of a marshalled parameter
+
+      Arguments and results of a call are encoded by serialize()
+      and decoded by import(). Structures with several members
+      implement both by encoding the members in order.
+  */
+  class _RPCParameter {
   protected:
     bool initialized;
-    const char *name;
+    char *name;
 
   public:
     _RPCParameter( const char * _name = NULL ) : initialized( false ) {
@@ -82,33 +107,314 @@ namespace mgr {
     }
 
     inline const char *Name() const { return name; }
-    inline const bool is_initialized() const { return initialized; }
-    
-    virtual mgr_error_t serialize(void *buffer, size_t length) = 0;
-    virtual mgr_error_t import(void *buffer, size_t length) = 0;
+    inline bool is_initialized() const { return initialized; }
 
+    //! Encode the parameter
+    virtual m_error_t serialize(xdrStream& s) const = 0;
+    //! Decode the parameter
+    virtual m_error_t import(xdrStream& s) = 0;
+
+  private:
+    _RPCParameter& operator=(const _RPCParameter&);
   };
 
-  template <class T> class RPCParameter : public class _RPCParameter {
+  // XDR coding of the types supported by RPCParameter
+  inline m_error_t xdrEncode(xdrStream& s, const XDR::Int& v){ return s.putInt(v); }
+  inline m_error_t xdrEncode(xdrStream& s, const XDR::UInt& v){ return s.putUInt(v); }
+  inline m_error_t xdrEncode(xdrStream& s, const XDR::Long& v){ return s.putHyper(v); }
+  inline m_error_t xdrEncode(xdrStream& s, const XDR::ULong& v){ return s.putUHyper(v); }
+  inline m_error_t xdrEncode(xdrStream& s, const XDR::Float& v){ return s.putFloat(v); }
+  inline m_error_t xdrEncode(xdrStream& s, const XDR::Double& v){ return s.putDouble(v); }
+  inline m_error_t xdrEncode(xdrStream& s, const bool& v){ return s.putBool(v); }
+
+  inline m_error_t xdrDecode(xdrStream& s, XDR::Int& v){ return s.getInt(v); }
+  inline m_error_t xdrDecode(xdrStream& s, XDR::UInt& v){ return s.getUInt(v); }
+  inline m_error_t xdrDecode(xdrStream& s, XDR::Long& v){ return s.getHyper(v); }
+  inline m_error_t xdrDecode(xdrStream& s, XDR::ULong& v){ return s.getUHyper(v); }
+  inline m_error_t xdrDecode(xdrStream& s, XDR::Float& v){ return s.getFloat(v); }
+  inline m_error_t xdrDecode(xdrStream& s, XDR::Double& v){ return s.getDouble(v); }
+  inline m_error_t xdrDecode(xdrStream& s, bool& v){ return s.getBool(v); }
+
+  /*! \class RPCParameter
+      \brief Parameter of a single XDR type
+
+      T may be any type, for which xdrEncode() and xdrDecode()
+      are overloaded.
+  */
+  template <class T> class RPCParameter : public _RPCParameter {
   protected:
     T value;
 
   public:
-    RPCParameter( const char * _name = NULL ) : _RPCParemeter(_name) {}
-    RPCParameter( T _v, const char * _name = NULL ) : _RPCParemeter(_name), value(_v) { initialized = true; }
+    RPCParameter( const char * _name = NULL ) : _RPCParameter(_name) {}
+    RPCParameter( T _v, const char * _name = NULL ) : _RPCParameter(_name), value(_v) { initialized = true; }
     RPCParameter( const RPCParameter& r) : _RPCParameter( r ), value(r.value) {}
-    virtual ~RPCParamter() {}    
+    virtual ~RPCParameter() {}
+
+    inline const T& get(void) const { return value; }
+    inline void set(const T& v){
+      value = v;
+      initialized = true;
+    }
+
+    virtual m_error_t serialize(xdrStream& s) const {
+      if(!initialized) return ERR_PARAM_UDEF;
+      return xdrEncode(s, value);
+    }
+    virtual m_error_t import(xdrStream& s){
+      m_error_t err = xdrDecode(s, value);
+      if(err == ERR_NO_ERROR) initialized = true;
+      return err;
+    }
+  };
+
+  //! Parameter of procedures without arguments or results
+  class RPCVoid : public _RPCParameter {
+  public:
+    RPCVoid() { initialized = true; }
+    virtual ~RPCVoid() {}
+    virtual m_error_t serialize(xdrStream& s) const { return ERR_NO_ERROR; }
+    virtual m_error_t import(xdrStream& s) { return ERR_NO_ERROR; }
+  };
+
+  /*! \class RPCConnection
+      \brief Record marking transport on a file descriptor
+
+      Records are received into an input buffer and handed out
+      without copying, unless they were sent in several fragments.
+
+      Outgoing records are encoded into a batch buffer. Large
+      opaque payloads may be attached by reference instead of being
+      copied. The batch is written by a single writev(), when it
+      exceeds its size or on flush(). Attached payloads must stay
+      valid until then.
+
+      Sockets are written without blocking. While the peer does
+      not accept more data, flush() waits for it by poll() and
+      passes incoming data to drain().
+
+      The file descriptor is not closed by the connection.
+  */
+  class RPCConnection {
+  public:
+    enum {
+      LAST_FRAGMENT = 0x80000000UL,  //!< Flag of the record marking header
+      MAX_FRAGMENT  = 0x7fffffffUL,  //!< Largest fragment
+      READ_CHUNK    = 65536          //!< Octets requested by each read()
+    };
+
+  protected:
+    //! Payload attached by reference
+    struct Segment {
+      size_t at;           //!< Offset in out, where the payload is inserted
+      const void *data;    //!< Payload
+      size_t len;          //!< Size of payload
+    };
+
+    int fd;
+    wtBuffer<unsigned char> in;    //!< received octets
+    size_t inPos;                  //!< first octet not yet consumed
+    wtBuffer<unsigned char> frag;  //!< record assembled from fragments
+    bool assembled;                //!< frag holds the last record handed out
+    size_t maxRecord;              //!< largest record accepted
+    wtBuffer<unsigned char> out;   //!< batch of encoded records
+    xdrStream enc;                 //!< encoder appending to out
+    std::vector<Segment> ext;      //!< attached payloads
+    size_t record;                 //!< start of the open record in out
+    size_t extLen;                 //!< attached payload of the open record
+    size_t batch;                  //!< size of out, which triggers flush()
+
+    m_error_t fill(size_t need);
+
+    //! Read while flush() waits for the peer to accept data
+    /*! Called, when data can be read without blocking. Records
+	handed out by receive() before may be invalidated.
+	\return ERR_CANCEL to stop reading until flush() returns
+    */
+    virtual m_error_t drain(void) { return ERR_CANCEL; }
+
+  private:
+    RPCConnection(const RPCConnection&);
+    RPCConnection& operator=(const RPCConnection&);
+
+  public:
+    //! Create a connection on an open file descriptor
+    /*! \param f File descriptor, e.g. a socket
+	\param b Size of the batch of outgoing records
+    */
+    RPCConnection(int f, size_t b = 16384);
+    virtual ~RPCConnection() {}
+
+    const char *VersionTag(void) const;
+
+    inline int Fd(void) const { return fd; }
 
-    virtual sol::Cloneable *clone() {
-      return new RPCParameter<T>(*this);      
+    //! Largest record accepted by receive()
+    inline size_t Limit(void) const { return maxRecord; }
+    inline void Limit(size_t l) { maxRecord = l; }
+
+    //! Octets in the batch, including attached payload
+    size_t pending(void) const;
+
+    //! Open a record
+    /*! \return Encoder appending to the record */
+    xdrStream& begin(void);
+
+    //! Attach an opaque<> payload by reference to the open record
+    m_error_t attach(const void *d, size_t l);
+
+    //! Drop the batch from position at, e.g. the entire open record
+    void rewind(size_t at);
+
+    //! Close the open record
+    /*! The batch is written, if it exceeds its size. */
+    m_error_t end(void);
+
+    //! Write the batch
+    m_error_t flush(void);
+
+    //! Get the next record
+    /*! \param d Start of the record, valid until the next call
+	\param l Size of the record
+	\param block Wait for data, if no complete record is buffered
+	\return ERR_CANCEL, if block is false and no complete record
+	is buffered, ERR_FILE_END at the end of the stream,
+	ERR_PARS_END, if the stream ends within a record,
+	ERR_PARAM_LEN, if the record exceeds Limit()
+    */
+    m_error_t receive(const unsigned char *& d, size_t& l, bool block = true);
+  };
+
+  //! Message constants of RFC 1831
+  namespace RPC {
+    enum Constants {
+      VERSION       = 2,
+      CALL          = 0,
+      REPLY         = 1,
+      MSG_ACCEPTED  = 0,
+      MSG_DENIED    = 1,
+      SUCCESS       = 0,
+      PROG_UNAVAIL  = 1,
+      PROG_MISMATCH = 2,
+      PROC_UNAVAIL  = 3,
+      GARBAGE_ARGS  = 4,
+      SYSTEM_ERR    = 5,
+      RPC_MISMATCH  = 0,
+      AUTH_NONE     = 0
+    };
+  };
+
+  /*! \class RPCClient
+      \brief Caller of the procedures of one program
+
+      send() queues a call and returns its xid. wait() writes
+      the queued calls and reads replies until the one requested
+      arrives. Replies to other calls in flight are kept until they
+      are waited for.
+
+      While the server does not accept more calls, since it
+      blocks on writing replies, the client reads and keeps these
+      replies. So any number of calls may be sent before waiting.
+  */
+  class RPCClient : public RPCConnection {
+  protected:
+    XDR::UInt prog;
+    XDR::UInt vers;
+    XDR::UInt xid;
+    std::set<XDR::UInt> inflight;
+    std::map<XDR::UInt, wtBuffer<unsigned char> > replies;
+
+    m_error_t reply(const unsigned char *d, size_t l, _RPCParameter& res);
+    m_error_t keep(const unsigned char *d, size_t l);
+    virtual m_error_t drain(void);
+
+  public:
+    RPCClient(int f, XDR::UInt program, XDR::UInt version, size_t b = 16384);
+    virtual ~RPCClient() {}
+
+    //! Queue a call
+    /*! \param proc Procedure number
+	\param args Arguments
+	\param id xid of the call
+	\param payload Optional opaque<> argument following args,
+	which is attached by reference
+	\param l Size of payload
+    */
+    m_error_t send(XDR::UInt proc, const _RPCParameter& args, XDR::UInt& id,
+		   const void *payload = NULL, size_t l = 0);
+
+    //! Wait for the reply of a call
+    /*! \param id xid returned by send()
+	\param res Results
+	\return ERR_PARAM_RANG, if the call is not in flight,
+	ERR_PARAM_SEL, if the program, version or procedure is not available,
+	ERR_PARS_STX, if the server could not decode the arguments,
+	ERR_PARAM_LCK, if the call was denied,
+	ERR_INT_STATE, if the procedure failed
+    */
+    m_error_t wait(XDR::UInt id, _RPCParameter& res);
+
+    //! Call and wait for the reply
+    inline m_error_t call(XDR::UInt proc, const _RPCParameter& args, _RPCParameter& res){
+      XDR::UInt id;
+      m_error_t err = send(proc, args, id);
+      if(err != ERR_NO_ERROR) return err;
+      return wait(id, res);
     }
 
+    //! Number of calls in flight
+    inline size_t outstanding(void) const { return inflight.size(); }
+  };
+
+  /*! \class RPCProgram
+      \brief Interface of a program served by RPCBroker
+  */
+  class RPCProgram {
+  public:
+    virtual ~RPCProgram() {}
+
+    //! Execute a procedure
+    /*! \param proc Procedure number
+	\param args Decoder of the arguments
+	\param res Encoder of the results
+	\return ERR_PARAM_SEL for unknown procedures, decoder errors for
+	malformed arguments. Any other error is reported as SYSTEM_ERR.
+    */
+    virtual m_error_t call(XDR::UInt proc, xdrStream& args, xdrStream& res) = 0;
   };
-  
 
+  /*! \class RPCBroker
+      \brief Dispatcher of calls to the registered programs
 
+      serve() answers the calls on a connection until it is closed.
+      Replies are batched, while more calls are buffered. Several
+      connections may be served by several threads, as long as no
+      programs are added meanwhile.
+  */
   class RPCBroker {
+  protected:
+    struct Entry {
+      XDR::UInt prog;
+      XDR::UInt vers;
+      RPCProgram *p;
+    };
+    std::vector<Entry> programs;
+
+    m_error_t dispatch(RPCConnection& c, const unsigned char *d, size_t l);
+
+  public:
+    RPCBroker() {}
+    virtual ~RPCBroker() {}
+
     const char * VersionTag(void) const;
+
+    //! Register a program
+    /*! \return ERR_PARAM_UNIQ, if the version is already registered */
+    m_error_t add(XDR::UInt prog, XDR::UInt vers, RPCProgram& p);
+
+    //! Answer all calls on a file descriptor
+    /*! \return ERR_NO_ERROR, when the peer closed the connection */
+    m_error_t serve(int fd, size_t batch = 16384);
   };
 
 }; // namespace mgr
@@ -19,10 +19,148 @@
 
 #include <xdrOrder.h>
 #include <string.h>
+#include <stdint.h>
 #include "xdrOrder.tag"
 
+#if (defined(__x86_64__) || defined(__i386__)) && \
+  (defined(__clang__) || (__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))
+# define XDR_X86_SIMD
+# include <immintrin.h>
+#endif
+
 using namespace mgr;
 
+/*
+ * Bulk byte order conversion
+ *
+ */
+
+#ifdef __GNUC__
+static inline uint16_t bswap(uint16_t v){ return __builtin_bswap16(v); }
+static inline uint32_t bswap(uint32_t v){ return __builtin_bswap32(v); }
+static inline uint64_t bswap(uint64_t v){ return __builtin_bswap64(v); }
+#else
+static inline uint16_t bswap(uint16_t v){
+  return (v >> 8) | (v << 8);
+}
+static inline uint32_t bswap(uint32_t v){
+  return (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+}
+static inline uint64_t bswap(uint64_t v){
+  return ((uint64_t)bswap((uint32_t)v) << 32) | bswap((uint32_t)(v >> 32));
+}
+#endif
+
+// U is the unsigned integer of the element size
+template< typename U >
+static void swapScalar(unsigned char *d, const unsigned char *s, size_t n){
+  for(size_t i = 0; i < n; i++, d += sizeof(U), s += sizeof(U)){
+    U v;
+    memcpy(&v, s, sizeof(U));
+    v = bswap(v);
+    memcpy(d, &v, sizeof(U));
+  }
+}
+
+// shuffle masks reversing 2, 4 and 8 octets, repeated for both AVX2 lanes
+static const unsigned char swapMask[3][32] = {
+  { 1,0, 3,2, 5,4, 7,6, 9,8, 11,10, 13,12, 15,14,
+    1,0, 3,2, 5,4, 7,6, 9,8, 11,10, 13,12, 15,14 },
+  { 3,2,1,0, 7,6,5,4, 11,10,9,8, 15,14,13,12,
+    3,2,1,0, 7,6,5,4, 11,10,9,8, 15,14,13,12 },
+  { 7,6,5,4,3,2,1,0, 15,14,13,12,11,10,9,8,
+    7,6,5,4,3,2,1,0, 15,14,13,12,11,10,9,8 }
+};
+
+// SIMD kernels convert whole vectors and return the number of octets done
+typedef size_t (*SwapKernel)(unsigned char *, const unsigned char *, size_t,
+			     const unsigned char *);
+
+#ifdef XDR_X86_SIMD
+
+__attribute__((target("ssse3")))
+static size_t swapSSSE3(unsigned char *d, const unsigned char *s, size_t l,
+			const unsigned char *mask){
+  const __m128i m = _mm_loadu_si128((const __m128i *)mask);
+  size_t i = 0;
+  for(;i + 16 <= l;i += 16){
+    __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+    _mm_storeu_si128((__m128i *)(d + i), _mm_shuffle_epi8(v, m));
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+static size_t swapAVX2(unsigned char *d, const unsigned char *s, size_t l,
+		       const unsigned char *mask){
+  const __m256i m = _mm256_loadu_si256((const __m256i *)mask);
+  size_t i = 0;
+  for(;i + 64 <= l;i += 64){
+    __m256i v0 = _mm256_loadu_si256((const __m256i *)(s + i));
+    __m256i v1 = _mm256_loadu_si256((const __m256i *)(s + i + 32));
+    _mm256_storeu_si256((__m256i *)(d + i), _mm256_shuffle_epi8(v0, m));
+    _mm256_storeu_si256((__m256i *)(d + i + 32), _mm256_shuffle_epi8(v1, m));
+  }
+  for(;i + 32 <= l;i += 32){
+    __m256i v = _mm256_loadu_si256((const __m256i *)(s + i));
+    _mm256_storeu_si256((__m256i *)(d + i), _mm256_shuffle_epi8(v, m));
+  }
+  return i;
+}
+
+static SwapKernel selectKernel(const char **name){
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2")){
+    *name = "avx2";
+    return swapAVX2;
+  }
+  if(__builtin_cpu_supports("ssse3")){
+    *name = "ssse3";
+    return swapSSSE3;
+  }
+  *name = "bswap";
+  return NULL;
+}
+
+#else
+
+static SwapKernel selectKernel(const char **name){
+  *name = "bswap";
+  return NULL;
+}
+
+#endif // XDR_X86_SIMD
+
+// selected once at load time
+static const char *kernelName = NULL;
+static const SwapKernel swapKernel = selectKernel(&kernelName);
+
+template< typename U >
+static inline void swapArray(void *dst, const void *src, size_t n,
+			     const unsigned char *mask){
+  unsigned char *d = static_cast<unsigned char *>(dst);
+  const unsigned char *s = static_cast<const unsigned char *>(src);
+  size_t done = 0;
+  if(swapKernel) done = swapKernel(d, s, n * sizeof(U), mask) / sizeof(U);
+  swapScalar<U>(d + done * sizeof(U), s + done * sizeof(U), n - done);
+}
+
+void XDR::swapArray2(void *dst, const void *src, size_t n){
+  swapArray<uint16_t>(dst, src, n, swapMask[0]);
+}
+
+void XDR::swapArray4(void *dst, const void *src, size_t n){
+  swapArray<uint32_t>(dst, src, n, swapMask[1]);
+}
+
+void XDR::swapArray8(void *dst, const void *src, size_t n){
+  swapArray<uint64_t>(dst, src, n, swapMask[2]);
+}
+
+const char *XDR::arrayKernel(void){
+  return kernelName;
+}
+
 const char * xdrIO::VersionTag(void) const {
   return _VERSION_;
 }
@@ -82,6 +220,81 @@ int main(int argc, char *argv[]){
     puts("+++ BerTag::check() finished OK!");
   }
 
+  printf("Test %d: Array kernels\n",++tests);
+  do {
+    unsigned char src[300], dst[300], ref[300];
+    SwapKernel kernels[3] = { NULL, NULL, NULL };
+    const char *names[3] = { "bswap", "ssse3", "avx2" };
+    size_t nk = 1;
+#ifdef XDR_X86_SIMD
+    if(__builtin_cpu_supports("ssse3")) kernels[nk++] = swapSSSE3;
+    if(__builtin_cpu_supports("avx2")){
+      kernels[nk] = swapAVX2;
+      names[nk++] = "avx2";
+    }
+#endif
+    for(size_t i = 0; i < sizeof(src); i++) src[i] = static_cast<unsigned char>(i * 37 + 11);
+    res = ERR_NO_ERROR;
+    for(size_t k = 0; (k < nk) && (res == ERR_NO_ERROR); k++){
+      for(size_t e = 0; e < 3; e++){
+	const size_t S = 2 << e;
+	for(size_t n = 0; n < 34; n++){
+	  for(size_t off = 0; off < 4; off++){
+	    const unsigned char *sp = src + off;
+	    // reference: byte reversal of each element
+	    for(size_t i = 0; i < n * S; i++) ref[i] = sp[(i / S) * S + S - 1 - i % S];
+	    for(int inplace = 0; inplace < 2; inplace++){
+	      unsigned char *dp = dst + (off ^ 1);
+	      if(inplace){
+		memcpy(dp,sp,n * S);
+		sp = dp;
+	      }
+	      size_t done = kernels[k] ? kernels[k](dp,sp,n * S,swapMask[e]) : 0;
+	      switch(S){
+	      case 2: swapScalar<uint16_t>(dp + done,sp + done,n - done / S); break;
+	      case 4: swapScalar<uint32_t>(dp + done,sp + done,n - done / S); break;
+	      case 8: swapScalar<uint64_t>(dp + done,sp + done,n - done / S); break;
+	      }
+	      sp = src + off;
+	      if(memcmp(dp,ref,n * S)){
+		printf("*** Error: %s size %u n %u offset %u%s\n",names[k],
+		       (unsigned int)S,(unsigned int)n,(unsigned int)off,
+		       inplace ? " in place" : "");
+		res = ERR_INT_DATA;
+	      }
+	    }
+	  }
+	}
+      }
+    }
+    if(res != ERR_NO_ERROR) break;
+
+    // typed interface against element-wise conversion
+    XDR::Double dv[37], dx[37];
+    XDR::Int iv[37], ix[37];
+    for(size_t i = 0; i < 37; i++){
+      dv[i] = i * 1.25 - 7.0;
+      iv[i] = static_cast<XDR::Int>(i * 0x01020304);
+    }
+    XDR::xdrWriteArray(dx,dv,37);
+    XDR::xdrWriteArray(ix,iv,37);
+    for(size_t i = 0; i < 37; i++){
+      if((xdr.readDouble(dx + i) != dv[i]) || (xdr.readInt(ix + i) != iv[i])){
+	res = ERR_INT_DATA;
+	break;
+      }
+    }
+    XDR::xdrReadArray(dx,37);
+    XDR::xdrReadArray(ix,ix,37);
+    if(memcmp(dx,dv,sizeof(dv)) || memcmp(ix,iv,sizeof(iv))) res = ERR_INT_DATA;
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: array kernels failed 0x%.4x\n",(int)res);
+  } else {
+    printf("+++ Array kernels (%s) finished OK!\n",XDR::arrayKernel());
+  }
+
   printf("\n%d tests completed with %d errors.\n",tests,errors);
   printf("Used version: %s\n",xdr.VersionTag());
 
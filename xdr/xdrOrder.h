@@ -21,6 +21,7 @@
 # define _XDR_XDRORDER_H_
 
 #include <unistd.h>
+#include <string.h>
 #include <machine/xdr.h>
 #include <mgrError.h>
 
@@ -60,6 +61,65 @@ namespace XDR {
 #endif
   }  
 
+  /*
+   * Bulk conversion of arrays
+   *
+   * The kernels reverse the byte order of n elements of 2, 4 or 8
+   * octets. Source and destination may be identical, but must not
+   * overlap otherwise. Neither needs to be aligned. On x86 the
+   * kernels use SSSE3 or AVX2 shuffles, if the CPU supports them.
+   */
+  void swapArray2(void *dst, const void *src, size_t n);
+  void swapArray4(void *dst, const void *src, size_t n);
+  void swapArray8(void *dst, const void *src, size_t n);
+
+  // name of the kernel selected at runtime
+  const char *arrayKernel(void);
+
+  template< size_t S > struct _ArrayOrder {
+    static inline void convert(void *dst, const void *src, size_t n) {
+      if(dst != src) memcpy(dst, src, n * S);
+    }
+  };
+
+#ifdef XDR_LITTLE_ENDIAN
+  template<> struct _ArrayOrder<2> {
+    static inline void convert(void *dst, const void *src, size_t n) {
+      swapArray2(dst, src, n);
+    }
+  };
+  template<> struct _ArrayOrder<4> {
+    static inline void convert(void *dst, const void *src, size_t n) {
+      swapArray4(dst, src, n);
+    }
+  };
+  template<> struct _ArrayOrder<8> {
+    static inline void convert(void *dst, const void *src, size_t n) {
+      swapArray8(dst, src, n);
+    }
+  };
+#endif
+
+  // read n elements from XDR coded memory
+  template< typename T > inline void xdrReadArray(T *d, const void *s, size_t n) {
+    _ArrayOrder<sizeof(T)>::convert(d, s, n);
+  }
+
+  // convert n elements from XDR to native order in place
+  template< typename T > inline void xdrReadArray(T *d, size_t n) {
+    _ArrayOrder<sizeof(T)>::convert(d, d, n);
+  }
+
+  // write n elements to XDR coded memory
+  template< typename T > inline void xdrWriteArray(void *d, const T *s, size_t n) {
+    _ArrayOrder<sizeof(T)>::convert(d, s, n);
+  }
+
+  // convert n elements from native to XDR order in place
+  template< typename T > inline void xdrWriteArray(T *d, size_t n) {
+    _ArrayOrder<sizeof(T)>::convert(d, d, n);
+  }
+
   // types XDR::(U)Type
 #define XDR_TYPE(P, T, N) \
   typedef P XDR_ ## T N
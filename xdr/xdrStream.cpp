@@ -0,0 +1,777 @@
+/*
+ *
+ * RFC 1832 - Sun XDR
+ * Encoder and decoder of XDR streams
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *
+ * xdrStream - cursor based XDR encoder and decoder
+ *
+ * This defines the values:
+ *
+ */
+
+#include <xdrStream.h>
+#include <string.h>
+#include <float.h>
+#include "xdrStream.tag"
+
+using namespace mgr;
+
+const char *xdrStream::VersionTag(void) const {
+  return _VERSION_;
+}
+
+/*
+ * Buffer management
+ *
+ */
+
+unsigned char *xdrStream::space(size_t l, m_error_t& err){
+  if(!buf){
+    err = ERR_PARAM_LCK;
+    return NULL;
+  }
+  size_t s = buf->byte_size();
+  // appending to a StreamDump target writes the collected data first
+  if(out && (pos == s) && pos && (pos + l > flushSize)){
+    err = flush();
+    if(err != ERR_NO_ERROR) return NULL;
+    s = 0;
+  }
+  if(l > ~(size_t)0 - pos){
+    err = ERR_PARAM_RANG;
+    return NULL;
+  }
+  if(pos + l > s){
+    // grow the allocation at least by the factor 2 to keep appending linear
+    const size_t c = buf->alloc_size();
+    if(pos + l > c){
+      size_t n = (c > ~(size_t)0 / 2) ? 0 : 2 * c;
+      if(n < pos + l) n = pos + l;
+      err = buf->trunc(n, true);
+      if(err != ERR_NO_ERROR) return NULL;
+    }
+    err = buf->trunc(pos + l, true);
+    if(err != ERR_NO_ERROR) return NULL;
+  }
+  unsigned char *p = buf->writePtr(err);
+  if(err != ERR_NO_ERROR) return NULL;
+  if(!p && l){
+    err = ERR_INT_STATE;
+    return NULL;
+  }
+  p += pos;
+  pos += l;
+  return p;
+}
+
+m_error_t xdrStream::reserve(size_t l){
+  if(!buf) return ERR_PARAM_LCK;
+  if(l > ~(size_t)0 - pos) return ERR_PARAM_RANG;
+  const size_t s = buf->byte_size();
+  if(pos + l <= buf->alloc_size()) return ERR_NO_ERROR;
+  // allocate and keep the old length, shrinking does not release memory
+  m_error_t err = buf->trunc(pos + l, true);
+  if(err != ERR_NO_ERROR) return err;
+  return buf->trunc(s, true);
+}
+
+m_error_t xdrStream::seek(size_t p){
+  const size_t l = buf ? buf->byte_size() : rdLen;
+  if(p > l) return ERR_PARAM_RANG;
+  pos = p;
+  return ERR_NO_ERROR;
+}
+
+m_error_t xdrStream::flush(void){
+  if(!out) return ERR_NO_ERROR;
+  size_t s = local.byte_size();
+  if(s){
+    const size_t l = s;
+    m_error_t err = out->write(local.readPtr(), &s);
+    if(err != ERR_NO_ERROR) return err;
+    if(s != l) return ERR_FILE_WRITE;
+  }
+  pos = 0;
+  return local.trunc(0);
+}
+
+/*
+ * Encoders
+ *
+ */
+
+m_error_t xdrStream::putInt(XDR::Int v){
+  m_error_t err;
+  unsigned char *p = space(4, err);
+  if(err != ERR_NO_ERROR) return err;
+  XDR::xdrWrite<XDR::Int>(p, v);
+  return ERR_NO_ERROR;
+}
+
+m_error_t xdrStream::putUInt(XDR::UInt v){
+  m_error_t err;
+  unsigned char *p = space(4, err);
+  if(err != ERR_NO_ERROR) return err;
+  XDR::xdrWrite<XDR::UInt>(p, v);
+  return ERR_NO_ERROR;
+}
+
+m_error_t xdrStream::putHyper(XDR::Long v){
+  m_error_t err;
+  unsigned char *p = space(8, err);
+  if(err != ERR_NO_ERROR) return err;
+  XDR::xdrWrite<XDR::Long>(p, v);
+  return ERR_NO_ERROR;
+}
+
+m_error_t xdrStream::putUHyper(XDR::ULong v){
+  m_error_t err;
+  unsigned char *p = space(8, err);
+  if(err != ERR_NO_ERROR) return err;
+  XDR::xdrWrite<XDR::ULong>(p, v);
+  return ERR_NO_ERROR;
+}
+
+m_error_t xdrStream::putFloat(XDR::Float v){
+  m_error_t err;
+  unsigned char *p = space(4, err);
+  if(err != ERR_NO_ERROR) return err;
+  XDR::xdrWrite<XDR::Float>(p, v);
+  return ERR_NO_ERROR;
+}
+
+m_error_t xdrStream::putDouble(XDR::Double v){
+  m_error_t err;
+  unsigned char *p = space(8, err);
+  if(err != ERR_NO_ERROR) return err;
+  XDR::xdrWrite<XDR::Double>(p, v);
+  return ERR_NO_ERROR;
+}
+
+/*
+ * The quadruple is the IEEE 754 binary128 format. The machine long double
+ * is converted, if it is binary128 itself or the x87 extended format.
+ * The x87 format carries the integer bit explicitly and only 63 bits
+ * of fraction, the exponent has the same bias.
+ *
+ */
+
+#if (LDBL_MANT_DIG == 113) || ((LDBL_MANT_DIG == 64) && defined(XDR_LITTLE_ENDIAN))
+# define XDR_HAVE_QUADRUPLE
+#endif
+
+#ifdef XDR_HAVE_QUADRUPLE
+static void quadEncode(unsigned char *p, long double v){
+#if LDBL_MANT_DIG == 113
+  unsigned char b[16];
+  memcpy(b, &v, 16);
+# ifdef XDR_LITTLE_ENDIAN
+  for(int i = 0; i < 16; i++) p[i] = b[15 - i];
+# else
+  memcpy(p, b, 16);
+# endif
+#else
+  unsigned char b[sizeof(long double)];
+  memcpy(b, &v, sizeof(b));
+  XDR::ULong sig;
+  memcpy(&sig, b, 8);
+  const XDR::ULong se = b[8] | ((XDR::ULong)b[9] << 8);
+  const XDR::ULong frac = sig & 0x7fffffffffffffffULL;
+  XDR::xdrWrite<XDR::ULong>(p, (se << 48) | (frac >> 15));
+  XDR::xdrWrite<XDR::ULong>(p + 8, frac << 49);
+#endif
+}
+
+static long double quadDecode(const unsigned char *p){
+  long double v = 0;
+#if LDBL_MANT_DIG == 113
+  unsigned char b[16];
+# ifdef XDR_LITTLE_ENDIAN
+  for(int i = 0; i < 16; i++) b[i] = p[15 - i];
+# else
+  memcpy(b, p, 16);
+# endif
+  memcpy(&v, b, 16);
+#else
+  unsigned char b[sizeof(long double)];
+  memset(b, 0, sizeof(b));
+  const XDR::ULong hi = XDR::xdrRead<XDR::ULong>(p);
+  const XDR::ULong lo = XDR::xdrRead<XDR::ULong>(p + 8);
+  const unsigned int se = static_cast<unsigned int>(hi >> 48);
+  // the fraction is truncated to the 63 bits of the x87 format
+  XDR::ULong sig = ((hi & 0xffffffffffffULL) << 15) | (lo >> 49);
+  if(se & 0x7fff) sig |= 0x8000000000000000ULL;
+  memcpy(b, &sig, 8);
+  b[8] = static_cast<unsigned char>(se);
+  b[9] = static_cast<unsigned char>(se >> 8);
+  memcpy(&v, b, sizeof(b));
+#endif
+  return v;
+}
+#endif // XDR_HAVE_QUADRUPLE
+
+m_error_t xdrStream::putQuadruple(long double v){
+#ifdef XDR_HAVE_QUADRUPLE
+  m_error_t err;
+  unsigned char *p = space(16, err);
+  if(err != ERR_NO_ERROR) return err;
+  quadEncode(p, v);
+  return ERR_NO_ERROR;
+#else
+  return ERR_INT_IMP;
+#endif
+}
+
+m_error_t xdrStream::putOpaque(const void *d, size_t l){
+  if(!d && l) return ERR_PARAM_NULL;
+  m_error_t err;
+  unsigned char *p = space(pad(l), err);
+  if(err != ERR_NO_ERROR) return err;
+  if(l) memcpy(p, d, l);
+  memset(p + l, 0, pad(l) - l);
+  return ERR_NO_ERROR;
+}
+
+m_error_t xdrStream::putBytes(const void *d, size_t l, size_t max){
+  if(l > max) return ERR_PARAM_RANG;
+  if(l > 0xffffffffUL) return ERR_PARAM_LEN;
+  if(!d && l) return ERR_PARAM_NULL;
+  m_error_t err;
+  unsigned char *p = space(sizeBytes(l), err);
+  if(err != ERR_NO_ERROR) return err;
+  XDR::xdrWrite<XDR::UInt>(p, static_cast<XDR::UInt>(l));
+  if(l) memcpy(p + 4, d, l);
+  memset(p + 4 + l, 0, pad(l) - l);
+  return ERR_NO_ERROR;
+}
+
+m_error_t xdrStream::putString(const char *s, size_t max){
+  if(!s) return ERR_PARAM_NULL;
+  return putBytes(s, strlen(s), max);
+}
+
+/*
+ * Decoders
+ *
+ */
+
+m_error_t xdrStream::getInt(XDR::Int& v){
+  m_error_t err;
+  const unsigned char *p = data(4, err);
+  if(err != ERR_NO_ERROR) return err;
+  v = XDR::xdrRead<XDR::Int>(p);
+  return ERR_NO_ERROR;
+}
+
+m_error_t xdrStream::getUInt(XDR::UInt& v){
+  m_error_t err;
+  const unsigned char *p = data(4, err);
+  if(err != ERR_NO_ERROR) return err;
+  v = XDR::xdrRead<XDR::UInt>(p);
+  return ERR_NO_ERROR;
+}
+
+m_error_t xdrStream::getEnum(int& v){
+  XDR::Int i;
+  m_error_t err = getInt(i);
+  if(err != ERR_NO_ERROR) return err;
+  v = i;
+  return ERR_NO_ERROR;
+}
+
+m_error_t xdrStream::getBool(bool& v){
+  XDR::Int i;
+  m_error_t err = getInt(i);
+  if(err != ERR_NO_ERROR) return err;
+  // RFC 1832 only knows FALSE = 0 and TRUE = 1
+  if((i != 0) && (i != 1)){
+    pos -= 4;
+    return ERR_PARAM_RANG;
+  }
+  v = (i == 1);
+  return ERR_NO_ERROR;
+}
+
+m_error_t xdrStream::getHyper(XDR::Long& v){
+  m_error_t err;
+  const unsigned char *p = data(8, err);
+  if(err != ERR_NO_ERROR) return err;
+  v = XDR::xdrRead<XDR::Long>(p);
+  return ERR_NO_ERROR;
+}
+
+m_error_t xdrStream::getUHyper(XDR::ULong& v){
+  m_error_t err;
+  const unsigned char *p = data(8, err);
+  if(err != ERR_NO_ERROR) return err;
+  v = XDR::xdrRead<XDR::ULong>(p);
+  return ERR_NO_ERROR;
+}
+
+m_error_t xdrStream::getFloat(XDR::Float& v){
+  m_error_t err;
+  const unsigned char *p = data(4, err);
+  if(err != ERR_NO_ERROR) return err;
+  v = XDR::xdrRead<XDR::Float>(p);
+  return ERR_NO_ERROR;
+}
+
+m_error_t xdrStream::getDouble(XDR::Double& v){
+  m_error_t err;
+  const unsigned char *p = data(8, err);
+  if(err != ERR_NO_ERROR) return err;
+  v = XDR::xdrRead<XDR::Double>(p);
+  return ERR_NO_ERROR;
+}
+
+m_error_t xdrStream::getQuadruple(long double& v){
+#ifdef XDR_HAVE_QUADRUPLE
+  m_error_t err;
+  const unsigned char *p = data(16, err);
+  if(err != ERR_NO_ERROR) return err;
+  v = quadDecode(p);
+  return ERR_NO_ERROR;
+#else
+  return ERR_INT_IMP;
+#endif
+}
+
+m_error_t xdrStream::getOpaque(void *d, size_t l){
+  if(!d && l) return ERR_PARAM_NULL;
+  m_error_t err;
+  const unsigned char *p = data(pad(l), err);
+  if(err != ERR_NO_ERROR) return err;
+  if(l) memcpy(d, p, l);
+  return ERR_NO_ERROR;
+}
+
+m_error_t xdrStream::getBytes(const unsigned char *& d, size_t& l){
+  const size_t start = pos;
+  XDR::UInt c;
+  m_error_t err = getUInt(c);
+  if(err != ERR_NO_ERROR) return err;
+  const unsigned char *p = data(pad(c), err);
+  if(err != ERR_NO_ERROR){
+    pos = start;
+    return err;
+  }
+  d = p;
+  l = c;
+  return ERR_NO_ERROR;
+}
+
+m_error_t xdrStream::getBytes(void *d, size_t& l, size_t max){
+  if(!d && max) return ERR_PARAM_NULL;
+  const size_t start = pos;
+  const unsigned char *p;
+  size_t c;
+  m_error_t err = getBytes(p, c);
+  if(err != ERR_NO_ERROR) return err;
+  if(c > max){
+    pos = start;
+    return ERR_PARAM_LEN;
+  }
+  if(c) memcpy(d, p, c);
+  l = c;
+  return ERR_NO_ERROR;
+}
+
+m_error_t xdrStream::getString(const char *& s, size_t& l){
+  const unsigned char *p;
+  m_error_t err = getBytes(p, l);
+  if(err != ERR_NO_ERROR) return err;
+  s = reinterpret_cast<const char *>(p);
+  return ERR_NO_ERROR;
+}
+
+m_error_t xdrStream::getString(char *s, size_t max){
+  if(!s) return ERR_PARAM_NULL;
+  if(!max) return ERR_PARAM_LEN;
+  size_t l;
+  m_error_t err = getBytes(s, l, max - 1);
+  if(err != ERR_NO_ERROR) return err;
+  s[l] = 0;
+  return ERR_NO_ERROR;
+}
+
+#ifdef TEST
+
+#include <stdio.h>
+#include <wtBufferDump.h>
+
+// record with members of mixed types
+struct Sample {
+  XDR::UInt channel;
+  bool valid;
+  XDR::Double time;
+  XDR::Short gain;
+  XDR::Int value[3];
+  unsigned char tag[5];
+};
+typedef meta::MakeTypeList< XDR_FIELD(Sample, XDR::UInt, channel),
+			    XDR_FIELD(Sample, bool, valid),
+			    XDR_FIELD(Sample, XDR::Double, time),
+			    XDR_FIELD(Sample, XDR::Short, gain),
+			    XDR_FIELD(Sample, XDR::Int[3], value),
+			    XDR_FIELD(Sample, unsigned char[5], tag) >::RESULT SampleFields;
+
+// record without padding, which is converted in bulk
+struct Point {
+  XDR::Float x, y, z;
+  XDR::Int id;
+};
+typedef meta::MakeTypeList< XDR_FIELD(Point, XDR::Float, x),
+			    XDR_FIELD(Point, XDR::Float, y),
+			    XDR_FIELD(Point, XDR::Float, z),
+			    XDR_FIELD(Point, XDR::Int, id) >::RESULT PointFields;
+
+int main(int argc, char *argv[]){
+  m_error_t res;
+  size_t tests, errors;
+
+  tests = errors = 0;
+
+  printf("Test %d: Encode all types\n",++tests);
+  wtBuffer<unsigned char> B;
+  const XDR::Double dv[3] = { 1.5, -2.25, 1e300 };
+  const XDR::Short sv[3] = { -1, 2, 0x1234 };
+  const unsigned char ref[] = {
+    0xff, 0xff, 0xff, 0xfe,                          // int -2
+    0xde, 0xad, 0xbe, 0xef,                          // unsigned int
+    0x00, 0x00, 0x00, 0x03,                          // enum 3
+    0x00, 0x00, 0x00, 0x01,                          // bool TRUE
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfd,  // hyper -3
+    0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,  // unsigned hyper
+    0x3f, 0xc0, 0x00, 0x00,                          // float 1.5
+    0xc0, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // double -2.25
+    0x40, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00,  // quadruple 3.0
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    'a', 'b', 'c', 0x00,                             // opaque[3]
+    0x00, 0x00, 0x00, 0x05, 'h', 'e', 'l', 'l',      // string<>
+    'o', 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00,                          // opaque<> empty
+    0x00, 0x00, 0x00, 0x03,                          // short[3] as int<>
+    0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x02,
+    0x00, 0x00, 0x12, 0x34
+  };
+  res = ERR_NO_ERROR;
+  do {
+    xdrStream x(B);
+    size_t s = xdrStream::sizeInt() * 4 + xdrStream::sizeHyper() * 2
+      + xdrStream::sizeInt() + xdrStream::sizeHyper() + xdrStream::sizeQuadruple()
+      + xdrStream::sizeOpaque(3) + xdrStream::sizeString(5) + xdrStream::sizeBytes(0)
+      + xdrStream::sizeVarArray<XDR::Short>(3);
+    if(s != sizeof(ref)){
+      printf("??? Size %u != %u\n",(unsigned int)s,(unsigned int)sizeof(ref));
+      res = ERR_INT_DATA;
+      break;
+    }
+    if((res = x.reserve(s)) != ERR_NO_ERROR) break;
+    const size_t cap = B.alloc_size();
+    size_t grown = 0;
+    if((res = x.putInt(-2)) != ERR_NO_ERROR) break;
+    if((res = x.putUInt(0xdeadbeef)) != ERR_NO_ERROR) break;
+    if((res = x.putEnum(3)) != ERR_NO_ERROR) break;
+    if((res = x.putBool(true)) != ERR_NO_ERROR) break;
+    if((res = x.putHyper(-3)) != ERR_NO_ERROR) break;
+    if((res = x.putUHyper(0x0123456789abcdefULL)) != ERR_NO_ERROR) break;
+    if((res = x.putFloat(1.5)) != ERR_NO_ERROR) break;
+    if((res = x.putDouble(-2.25)) != ERR_NO_ERROR) break;
+    if((res = x.putQuadruple(3.0L)) != ERR_NO_ERROR) break;
+    if((res = x.putOpaque("abc",3)) != ERR_NO_ERROR) break;
+    if((res = x.putString("hello")) != ERR_NO_ERROR) break;
+    if((res = x.putBytes(NULL,0)) != ERR_NO_ERROR) break;
+    if((res = x.putVarArray(sv,3)) != ERR_NO_ERROR) break;
+    if(B.alloc_size() != cap) grown++;
+    if(grown){
+      puts("??? Buffer was reallocated after reserve()");
+      res = ERR_INT_STATE;
+      break;
+    }
+    // appending grows the allocation geometrically
+    wtBuffer<unsigned char> G;
+    xdrStream g(G);
+    size_t last = G.alloc_size();
+    for(XDR::Int i = 0; i < 100000; i++){
+      if((res = g.putInt(i)) != ERR_NO_ERROR) break;
+      if(G.alloc_size() != last){
+	grown++;
+	last = G.alloc_size();
+      }
+    }
+    if(res != ERR_NO_ERROR) break;
+    if((G.byte_size() != 400000) || (grown > 32)){
+      printf("??? %u allocations for %u octets\n",(unsigned int)grown,
+	     (unsigned int)G.byte_size());
+      res = ERR_INT_STATE;
+      break;
+    }
+    if((x.tell() != sizeof(ref)) || (B.byte_size() != sizeof(ref))
+       || memcmp(B.readPtr(),ref,sizeof(ref))){
+      res = ERR_INT_DATA;
+      break;
+    }
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: encoding failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ Encoding finished OK!");
+  }
+
+  printf("Test %d: Decode all types\n",++tests);
+  res = ERR_NO_ERROR;
+  do {
+    xdrStream x(ref, sizeof(ref));
+    XDR::Int i;
+    XDR::UInt u;
+    int e;
+    bool b;
+    XDR::Long h;
+    XDR::ULong uh;
+    XDR::Float f;
+    XDR::Double d;
+    long double q;
+    char o[3];
+    char str[6];
+    unsigned char by[4];
+    size_t l = 99, n = 0;
+    XDR::Short sa[4];
+    res = ERR_INT_DATA;
+    if((ERR_NO_ERROR != x.getInt(i)) || (i != -2)) break;
+    if((ERR_NO_ERROR != x.getUInt(u)) || (u != 0xdeadbeef)) break;
+    if((ERR_NO_ERROR != x.getEnum(e)) || (e != 3)) break;
+    if((ERR_NO_ERROR != x.getBool(b)) || !b) break;
+    if((ERR_NO_ERROR != x.getHyper(h)) || (h != -3)) break;
+    if((ERR_NO_ERROR != x.getUHyper(uh)) || (uh != 0x0123456789abcdefULL)) break;
+    if((ERR_NO_ERROR != x.getFloat(f)) || (f != 1.5)) break;
+    if((ERR_NO_ERROR != x.getDouble(d)) || (d != -2.25)) break;
+    if((ERR_NO_ERROR != x.getQuadruple(q)) || (q != 3.0L)) break;
+    if((ERR_NO_ERROR != x.getOpaque(o,3)) || memcmp(o,"abc",3)) break;
+    if((ERR_NO_ERROR != x.getString(str,sizeof(str))) || strcmp(str,"hello")) break;
+    if((ERR_NO_ERROR != x.getBytes(by,l,sizeof(by))) || l) break;
+    if((ERR_NO_ERROR != x.getVarArray(sa,n,4)) || (n != 3)) break;
+    if(memcmp(sa,sv,sizeof(sv)) || x.remain()) break;
+    res = ERR_NO_ERROR;
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: decoding failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ Decoding finished OK!");
+  }
+
+  printf("Test %d: Round trip of arrays and quadruples\n",++tests);
+  res = ERR_NO_ERROR;
+  do {
+    wtBuffer<unsigned char> A;
+    xdrStream x(A);
+    XDR::Long hv[5] = { 0, -1, 1LL << 40, -(1LL << 62), 12345 };
+    const long double qv[5] = { 0.0L, -1.0L, 1.0L / 3.0L, 1e-4000L, -1e4000L };
+    if((res = x.putArray(dv,3)) != ERR_NO_ERROR) break;
+    if((res = x.putVarArray(hv,5,5)) != ERR_NO_ERROR) break;
+    for(int k = 0; k < 5; k++)
+      if((res = x.putQuadruple(qv[k])) != ERR_NO_ERROR) break;
+    if(res != ERR_NO_ERROR) break;
+    if((res = x.seek(0)) != ERR_NO_ERROR) break;
+    XDR::Double dr[3];
+    XDR::Long hr[5];
+    size_t n;
+    if((res = x.getArray(dr,3)) != ERR_NO_ERROR) break;
+    if((res = x.getVarArray(hr,n,5)) != ERR_NO_ERROR) break;
+    if(memcmp(dr,dv,sizeof(dv)) || (n != 5) || memcmp(hr,hv,sizeof(hv))){
+      res = ERR_INT_DATA;
+      break;
+    }
+    for(int k = 0; k < 5; k++){
+      long double q;
+      if((res = x.getQuadruple(q)) != ERR_NO_ERROR) break;
+      if(q != qv[k]){
+	printf("??? Quadruple %d: %Lg != %Lg\n",k,q,qv[k]);
+	res = ERR_INT_DATA;
+	break;
+      }
+    }
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: round trip failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ Round trip finished OK!");
+  }
+
+  printf("Test %d: Bounds and limits\n",++tests);
+  res = ERR_NO_ERROR;
+  do {
+    xdrStream x(ref, sizeof(ref) - 1);
+    XDR::Int i;
+    bool b;
+    char str[5];
+    size_t n;
+    XDR::Short sa[2];
+    // read-only memory
+    if(x.putInt(0) != ERR_PARAM_LCK){ res = ERR_INT_STATE; break; }
+    // TRUE and FALSE only
+    if(x.getBool(b) != ERR_PARAM_RANG || x.tell()){ res = ERR_INT_DATA; break; }
+    // string too long for the buffer keeps the cursor
+    if(x.seek(64) != ERR_NO_ERROR){ res = ERR_INT_STATE; break; }
+    if(x.getString(str,sizeof(str)) != ERR_PARAM_LEN || (x.tell() != 64)){
+      res = ERR_INT_DATA;
+      break;
+    }
+    // array too long for the buffer keeps the cursor
+    if(x.seek(80) != ERR_NO_ERROR){ res = ERR_INT_STATE; break; }
+    if(x.getVarArray(sa,n,2) != ERR_PARAM_LEN || (x.tell() != 80)){
+      res = ERR_INT_DATA;
+      break;
+    }
+    // truncated array
+    XDR::Short sb[3];
+    if(x.getVarArray(sb,n,3) != ERR_PARS_END || (x.tell() != 80)){
+      res = ERR_INT_DATA;
+      break;
+    }
+    if(x.seek(sizeof(ref)) != ERR_PARAM_RANG){ res = ERR_INT_DATA; break; }
+    if(x.seek(sizeof(ref) - 1) != ERR_NO_ERROR){ res = ERR_INT_STATE; break; }
+    if(x.getInt(i) != ERR_PARS_END){ res = ERR_INT_DATA; break; }
+    wtBuffer<unsigned char> A;
+    xdrStream y(A);
+    if(y.putString("hello",4) != ERR_PARAM_RANG || y.tell()){ res = ERR_INT_DATA; break; }
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: bounds failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ Bounds finished OK!");
+  }
+
+  printf("Test %d: Encode to a StreamDump\n",++tests);
+  res = ERR_NO_ERROR;
+  do {
+    BufferDump D;
+    {
+      xdrStream x(D, 16);
+      for(XDR::Int k = 0; k < 100; k++){
+	if((res = x.putInt(k)) != ERR_NO_ERROR) break;
+	if((res = x.putString(k & 1 ? "odd" : "even")) != ERR_NO_ERROR) break;
+      }
+      if(res != ERR_NO_ERROR) break;
+      XDR::Int i;
+      if(x.getInt(i) != ERR_INT_SEQ){ res = ERR_INT_STATE; break; }
+    }
+    const wtBuffer<char>& W = D.get();
+    xdrStream x(W.readPtr(), W.byte_size());
+    for(XDR::Int k = 0; k < 100; k++){
+      XDR::Int i;
+      const char *s;
+      size_t l;
+      if((res = x.getInt(i)) != ERR_NO_ERROR) break;
+      if((res = x.getString(s,l)) != ERR_NO_ERROR) break;
+      if((i != k) || (l != (k & 1 ? 3u : 4u)) || memcmp(s,k & 1 ? "odd" : "even",l)){
+	res = ERR_INT_DATA;
+	break;
+      }
+    }
+    if((res == ERR_NO_ERROR) && x.remain()) res = ERR_INT_DATA;
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: StreamDump failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ StreamDump finished OK!");
+  }
+
+  printf("Test %d: Structures from field lists\n",++tests);
+  res = ERR_NO_ERROR;
+  do {
+    if((meta::Length<SampleFields>::VALUE != 6) || (xdrStruct<SampleFields>::SIZE != 40)
+       || (xdrStruct<SampleFields>::WIDTH != 0) || (xdrStruct<PointFields>::WIDTH != 4)){
+      res = ERR_INT_COMP;
+      break;
+    }
+    Sample s[7], r[7];
+    Point pt[9], pr[9];
+    memset(r, 0, sizeof(r));
+    for(int i = 0; i < 7; i++){
+      s[i].channel = i;
+      s[i].valid = i & 1;
+      s[i].time = i * 0.125;
+      s[i].gain = -i;
+      for(int j = 0; j < 3; j++) s[i].value[j] = i * 100 + j;
+      memcpy(s[i].tag, "abcde", 5);
+    }
+    for(int i = 0; i < 9; i++){
+      pt[i].x = i;
+      pt[i].y = -i;
+      pt[i].z = i * 0.5f;
+      pt[i].id = i << 20;
+    }
+    if(!xdrStruct<PointFields>::flat(pt[0]) || xdrStruct<SampleFields>::flat(s[0])){
+      res = ERR_INT_COMP;
+      break;
+    }
+    // reference coded member by member
+    wtBuffer<unsigned char> A, R;
+    xdrStream a(A), m(R);
+    if((res = a.putStruct<SampleFields>(s[1])) != ERR_NO_ERROR) break;
+    if((res = a.putStructArray<SampleFields>(s, 7)) != ERR_NO_ERROR) break;
+    if((res = a.putStructArray<PointFields>(pt, 9)) != ERR_NO_ERROR) break;
+    for(int i = -1; i < 7; i++){
+      const Sample& c = s[i < 0 ? 1 : i];
+      m.putUInt(c.channel);
+      m.putBool(c.valid);
+      m.putDouble(c.time);
+      m.putInt(c.gain);
+      m.putArray(c.value, 3);
+      m.putOpaque(c.tag, 5);
+    }
+    for(int i = 0; i < 9; i++){
+      m.putFloat(pt[i].x);
+      m.putFloat(pt[i].y);
+      m.putFloat(pt[i].z);
+      m.putInt(pt[i].id);
+    }
+    if((A.byte_size() != R.byte_size()) || memcmp(A.readPtr(), R.readPtr(), A.byte_size())){
+      res = ERR_INT_DATA;
+      break;
+    }
+    a.seek(0);
+    if((res = a.getStruct<SampleFields>(r[0])) != ERR_NO_ERROR) break;
+    if((r[0].channel != 1) || !r[0].valid || (r[0].time != 0.125) || (r[0].gain != -1)
+       || (r[0].value[2] != 102) || memcmp(r[0].tag, "abcde", 5)){
+      res = ERR_INT_DATA;
+      break;
+    }
+    if((res = a.getStructArray<SampleFields>(r, 7)) != ERR_NO_ERROR) break;
+    if((res = a.getStructArray<PointFields>(pr, 9)) != ERR_NO_ERROR) break;
+    for(int i = 0; i < 7; i++){
+      if((r[i].channel != s[i].channel) || (r[i].valid != s[i].valid)
+	 || (r[i].time != s[i].time) || (r[i].gain != s[i].gain)
+	 || memcmp(r[i].value, s[i].value, sizeof(s[i].value))
+	 || memcmp(r[i].tag, s[i].tag, 5)) res = ERR_INT_DATA;
+    }
+    if(memcmp(pr, pt, sizeof(pt))) res = ERR_INT_DATA;
+    if(a.getStruct<PointFields>(pr[0]) != ERR_PARS_END) res = ERR_INT_STATE;
+  } while(0);
+  if(res != ERR_NO_ERROR){
+    errors++;
+    printf("*** Error: structures failed 0x%.4x\n",(int)res);
+  } else {
+    puts("+++ Structures finished OK!");
+  }
+
+  xdrStream x(ref, sizeof(ref));
+  printf("\n%d tests completed with %d errors.\n",tests,errors);
+  printf("Used version: %s\n",x.VersionTag());
+
+  return 0;
+}
+
+#endif // TEST
@@ -0,0 +1,332 @@
+/*
+ *
+ * RFC 1832 - Sun XDR
+ * Encoder and decoder of XDR streams
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *
+ * xdrStream - cursor based XDR encoder and decoder
+ *
+ * This defines the values:
+ *
+ */
+
+#ifndef _XDR_XDRSTREAM_H_
+# define _XDR_XDRSTREAM_H_
+
+#include <xdrOrder.h>
+#include <xdrStruct.h>
+#include <wtBuffer.h>
+#include <StreamDump.h>
+
+/*! \file xdrStream.h
+    \brief Encoding and decoding of XDR streams
+
+    xdrStream implements the data types of RFC 1832 on top of the
+    scalar conversions of xdrIO. The types map as follows:
+
+    - int, unsigned int, enum, bool: putInt(), putUInt(), putEnum(), putBool()
+    - hyper, unsigned hyper: putHyper(), putUHyper()
+    - float, double, quadruple: putFloat(), putDouble(), putQuadruple()
+    - fixed-length opaque: putOpaque()
+    - variable-length opaque: putBytes()
+    - string: putString()
+    - fixed-length array: putArray()
+    - variable-length array: putVarArray()
+    - structure: the members in order, or putStruct() with a
+      field list of xdrStruct.h
+    - discriminated union: putEnum() or putInt() for the discriminant,
+      followed by the selected arm
+    - void: nothing
+    - optional-data: putBool() followed by the data, if true
+
+    The get functions decode the same types. All items are padded
+    to multiples of 4 octets.
+
+    \author Dr. Lars Hanke
+    \date 2006-2008
+*/
+
+namespace mgr {
+
+/*! \class xdrStream
+    \brief Cursor based XDR encoder and decoder
+
+    The stream works on one of three targets:
+    - a wtBuffer, which can be encoded to and decoded from
+      starting at the cursor. Encoding beyond the end of the
+      buffer enlarges it.
+    - read-only memory, which can only be decoded.
+    - a StreamDump, which can only be encoded. The data is
+      collected in an internal buffer, which is written
+      to the StreamDump by flush() or when it exceeds its
+      chunk size.
+
+    Each put or get call checks the bounds once for the entire
+    item. If a call fails, the cursor is not moved. Decoding beyond
+    the end of the data returns ERR_PARS_END, encoding to read-only
+    memory ERR_PARAM_LCK.
+
+    Encoding beyond the allocated size of a buffer at least doubles
+    the allocation, so appending is linear. The size functions
+    compute the encoded size of items. Passing the sum to reserve()
+    allocates the buffer once for a message.
+*/
+class xdrStream : public xdrIO {
+protected:
+  wtBuffer<unsigned char> local;    //!< buffer for StreamDump targets
+  wtBuffer<unsigned char> *buf;     //!< buffer to encode to, NULL for read-only
+  const unsigned char *rd;          //!< memory to decode from
+  size_t rdLen;                     //!< size of memory to decode from
+  StreamDump *out;                  //!< StreamDump to flush to
+  size_t flushSize;                 //!< size of local, which triggers flush()
+  size_t pos;                       //!< cursor
+
+  //! Writeable space of l octets at the cursor
+  unsigned char *space(size_t l, m_error_t& err);
+
+  //! Convert array elements to XDR
+  template< typename T > static inline void encodeArray(unsigned char *p, const T *v,
+							size_t n) {
+    if((sizeof(T) == 4) || (sizeof(T) == 8)){
+      XDR::xdrWriteArray(p, v, n);
+    } else {
+      for(size_t i = 0; i < n; i++, p += 4)
+	XDR::xdrWrite<XDR::Int>(p, static_cast<XDR::Int>(v[i]));
+    }
+  }
+
+  //! Convert array elements from XDR
+  template< typename T > static inline void decodeArray(T *v, const unsigned char *p,
+							size_t n) {
+    if((sizeof(T) == 4) || (sizeof(T) == 8)){
+      XDR::xdrReadArray(v, p, n);
+    } else {
+      for(size_t i = 0; i < n; i++, p += 4)
+	v[i] = static_cast<T>(XDR::xdrRead<XDR::Int>(p));
+    }
+  }
+
+  //! Readable data of l octets at the cursor
+  inline const unsigned char *data(size_t l, m_error_t& err) {
+    if(out){
+      err = ERR_INT_SEQ;
+      return NULL;
+    }
+    if(buf){
+      rd = buf->readPtr();
+      rdLen = buf->byte_size();
+    }
+    if((pos > rdLen) || (l > rdLen - pos) || (l && !rd)){
+      err = ERR_PARS_END;
+      return NULL;
+    }
+    err = ERR_NO_ERROR;
+    const unsigned char *p = rd + pos;
+    pos += l;
+    return p;
+  }
+
+public:
+  //! Encode to and decode from a buffer
+  /*! \param b Buffer to work on
+      \param at Initial cursor
+  */
+  xdrStream(wtBuffer<unsigned char>& b, size_t at = 0) :
+    buf( &b ), rd( NULL ), rdLen( 0 ), out( NULL ), flushSize( 0 ), pos( at ) {}
+
+  //! Decode from memory
+  /*! \param d Start of XDR coded memory
+      \param l Size of XDR coded memory
+  */
+  xdrStream(const void *d, size_t l) :
+    buf( NULL ), rd( static_cast<const unsigned char *>(d) ), rdLen( d ? l : 0 ),
+    out( NULL ), flushSize( 0 ), pos( 0 ) {}
+
+  //! Encode to a StreamDump
+  /*! \param s StreamDump to write to
+      \param chunk Buffer size, which triggers writing to s
+  */
+  xdrStream(StreamDump& s, size_t chunk = 4096) :
+    buf( &local ), rd( NULL ), rdLen( 0 ), out( &s ), flushSize( chunk ), pos( 0 ) {
+    local.Chunk(chunk);
+  }
+
+  //! DTOR flushes to the StreamDump
+  virtual ~xdrStream() { flush(); }
+
+  const char *VersionTag(void) const;
+
+  //! Cursor position in octets
+  inline size_t tell(void) const { return pos; }
+
+  //! Set cursor position
+  /*! \return ERR_PARAM_RANG, if the position is beyond the data */
+  m_error_t seek(size_t p);
+
+  //! Octets left to decode
+  inline size_t remain(void) const {
+    size_t l = buf ? buf->byte_size() : rdLen;
+    return (pos < l) ? l - pos : 0;
+  }
+
+  //! Allocate space for l more octets at the cursor
+  m_error_t reserve(size_t l);
+
+  //! Write the encoded data to the StreamDump
+  m_error_t flush(void);
+
+  // sizes of encoded items
+  static inline size_t pad(size_t l) { return (l + 3) & ~(size_t)3; }
+  static inline size_t sizeInt(void) { return 4; }
+  static inline size_t sizeHyper(void) { return 8; }
+  static inline size_t sizeQuadruple(void) { return 16; }
+  static inline size_t sizeOpaque(size_t l) { return pad(l); }
+  static inline size_t sizeBytes(size_t l) { return 4 + pad(l); }
+  static inline size_t sizeString(size_t l) { return 4 + pad(l); }
+  template< typename T > static inline size_t sizeArray(size_t n) {
+    return n * ((sizeof(T) == 8) ? 8 : 4);
+  }
+  template< typename T > static inline size_t sizeVarArray(size_t n) {
+    return 4 + sizeArray<T>(n);
+  }
+
+  // encoders
+  m_error_t putInt(XDR::Int v);
+  m_error_t putUInt(XDR::UInt v);
+  inline m_error_t putEnum(int v) { return putInt(v); }
+  inline m_error_t putBool(bool v) { return putInt(v ? 1 : 0); }
+  m_error_t putHyper(XDR::Long v);
+  m_error_t putUHyper(XDR::ULong v);
+  m_error_t putFloat(XDR::Float v);
+  m_error_t putDouble(XDR::Double v);
+  m_error_t putQuadruple(long double v);
+  m_error_t putOpaque(const void *d, size_t l);
+  m_error_t putBytes(const void *d, size_t l, size_t max = ~(size_t)0);
+  m_error_t putString(const char *s, size_t max = ~(size_t)0);
+
+  //! Encode a fixed-length array
+  /*! Elements of 8 octets are encoded as hyper or double, all
+      others as 4 octet int, unsigned int or float.
+  */
+  template< typename T > m_error_t putArray(const T *v, size_t n) {
+    if(!v && n) return ERR_PARAM_NULL;
+    m_error_t err;
+    unsigned char *p = space(sizeArray<T>(n), err);
+    if(err != ERR_NO_ERROR) return err;
+    encodeArray(p, v, n);
+    return ERR_NO_ERROR;
+  }
+
+  //! Encode a variable-length array of at most max elements
+  template< typename T > m_error_t putVarArray(const T *v, size_t n,
+					       size_t max = ~(size_t)0) {
+    if(n > max) return ERR_PARAM_RANG;
+    if(!v && n) return ERR_PARAM_NULL;
+    m_error_t err;
+    unsigned char *p = space(sizeVarArray<T>(n), err);
+    if(err != ERR_NO_ERROR) return err;
+    XDR::xdrWrite<XDR::UInt>(p, static_cast<XDR::UInt>(n));
+    encodeArray(p + 4, v, n);
+    return ERR_NO_ERROR;
+  }
+
+  //! Encode a structure described by the field list L
+  template< typename L, typename S > m_error_t putStruct(const S& s) {
+    m_error_t err;
+    unsigned char *p = space(xdrStruct<L>::SIZE, err);
+    if(err != ERR_NO_ERROR) return err;
+    xdrStruct<L>::encode(p, s);
+    return ERR_NO_ERROR;
+  }
+
+  //! Encode a fixed-length array of structures described by the field list L
+  template< typename L, typename S > m_error_t putStructArray(const S *s, size_t n) {
+    if(!s && n) return ERR_PARAM_NULL;
+    if(n > ~(size_t)0 / xdrStruct<L>::SIZE) return ERR_PARAM_RANG;
+    m_error_t err;
+    unsigned char *p = space(n * xdrStruct<L>::SIZE, err);
+    if(err != ERR_NO_ERROR) return err;
+    xdrStruct<L>::encodeArray(p, s, n);
+    return ERR_NO_ERROR;
+  }
+
+  // decoders
+  m_error_t getInt(XDR::Int& v);
+  m_error_t getUInt(XDR::UInt& v);
+  m_error_t getEnum(int& v);
+  m_error_t getBool(bool& v);
+  m_error_t getHyper(XDR::Long& v);
+  m_error_t getUHyper(XDR::ULong& v);
+  m_error_t getFloat(XDR::Float& v);
+  m_error_t getDouble(XDR::Double& v);
+  m_error_t getQuadruple(long double& v);
+  m_error_t getOpaque(void *d, size_t l);
+  m_error_t getBytes(void *d, size_t& l, size_t max);
+  m_error_t getBytes(const unsigned char *& d, size_t& l);
+  m_error_t getString(char *s, size_t max);
+  m_error_t getString(const char *& s, size_t& l);
+
+  //! Decode a fixed-length array
+  template< typename T > m_error_t getArray(T *v, size_t n) {
+    if(!v && n) return ERR_PARAM_NULL;
+    m_error_t err;
+    const unsigned char *p = data(sizeArray<T>(n), err);
+    if(err != ERR_NO_ERROR) return err;
+    decodeArray(v, p, n);
+    return ERR_NO_ERROR;
+  }
+
+  //! Decode a structure described by the field list L
+  template< typename L, typename S > m_error_t getStruct(S& s) {
+    m_error_t err;
+    const unsigned char *p = data(xdrStruct<L>::SIZE, err);
+    if(err != ERR_NO_ERROR) return err;
+    xdrStruct<L>::decode(s, p);
+    return ERR_NO_ERROR;
+  }
+
+  //! Decode a fixed-length array of structures described by the field list L
+  template< typename L, typename S > m_error_t getStructArray(S *s, size_t n) {
+    if(!s && n) return ERR_PARAM_NULL;
+    if(n > ~(size_t)0 / xdrStruct<L>::SIZE) return ERR_PARS_END;
+    m_error_t err;
+    const unsigned char *p = data(n * xdrStruct<L>::SIZE, err);
+    if(err != ERR_NO_ERROR) return err;
+    xdrStruct<L>::decodeArray(s, p, n);
+    return ERR_NO_ERROR;
+  }
+
+  //! Decode a variable-length array
+  /*! \param v Array for at most max elements
+      \param n Number of elements decoded
+      \param max Capacity of v
+      \return ERR_PARAM_LEN, if the array has more than max elements
+  */
+  template< typename T > m_error_t getVarArray(T *v, size_t& n, size_t max) {
+    const size_t start = pos;
+    XDR::UInt c;
+    m_error_t err = getUInt(c);
+    if(err != ERR_NO_ERROR) return err;
+    if(c > max){
+      pos = start;
+      return ERR_PARAM_LEN;
+    }
+    err = getArray(v, c);
+    if(err != ERR_NO_ERROR){
+      pos = start;
+      return err;
+    }
+    n = c;
+    return ERR_NO_ERROR;
+  }
+};
+
+}; // namespace mgr
+
+#endif // _XDR_XDRSTREAM_H_
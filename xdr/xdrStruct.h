@@ -0,0 +1,232 @@
+/*
+ *
+ * RFC 1832 - Sun XDR
+ * Compile-time field lists for structures
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *
+ * xdrTraits - XDR coding of a member type
+ * xdrField  - member of a structure
+ * xdrStruct - XDR coding of a structure described by a list of xdrField
+ *
+ * This defines the values:
+ *
+ */
+
+#ifndef _XDR_XDRSTRUCT_H_
+# define _XDR_XDRSTRUCT_H_
+
+#include <xdrOrder.h>
+#include <mgrMeta.h>
+#include <string.h>
+
+/*! \file xdrStruct.h
+    \brief XDR coding of structures from a compile-time field list
+
+    The layout of a structure is described once as a meta::TypeList
+    of xdrField. xdrStruct generates encode() and decode() from
+    the list, which are inlined member by member:
+
+    \code
+    struct Sample {
+      XDR::UInt channel;
+      XDR::Double time;
+      XDR::Int value[4];
+    };
+    typedef meta::MakeTypeList< XDR_FIELD(Sample, XDR::UInt, channel),
+                                XDR_FIELD(Sample, XDR::Double, time),
+                                XDR_FIELD(Sample, XDR::Int[4], value) >::RESULT SampleFields;
+
+    unsigned char b[xdrStruct<SampleFields>::SIZE];
+    xdrStruct<SampleFields>::encode(b, sample);
+    \endcode
+
+    Members map to the XDR types by xdrTraits. Short and char
+    members are widened to 4 octets, arrays of char or unsigned
+    char are fixed-length opaque data.
+
+    If all members have the same size in memory and in XDR and the
+    structure has no padding, an array of structures is converted
+    by the bulk byte order kernels of xdrOrder.h.
+
+    \author Dr. Lars Hanke
+    \date 2006-2008
+*/
+
+namespace mgr {
+
+/*! \class xdrTraits
+    \brief XDR coding of a member type
+
+    SIZE is the size in XDR. WIDTH is the size of the type, if it
+    is the same in memory and in XDR and 0 otherwise.
+*/
+template< typename T > struct xdrTraits;
+
+#define XDR_SCALAR_TRAITS(T,X)						\
+  template<> struct xdrTraits< T > {					\
+    enum { SIZE = sizeof(X), WIDTH = (sizeof(T) == sizeof(X)) ? sizeof(X) : 0 }; \
+    static inline void write(unsigned char *p, const T& v){		\
+      XDR::xdrWrite< X >(p, static_cast< X >(v));			\
+    }									\
+    static inline void read(T& v, const unsigned char *p){		\
+      v = static_cast< T >(XDR::xdrRead< X >(p));			\
+    }									\
+  }
+
+XDR_SCALAR_TRAITS(XDR::Int, XDR::Int);
+XDR_SCALAR_TRAITS(XDR::UInt, XDR::UInt);
+XDR_SCALAR_TRAITS(XDR::Short, XDR::Int);
+XDR_SCALAR_TRAITS(XDR::UShort, XDR::UInt);
+XDR_SCALAR_TRAITS(XDR::Char, XDR::Int);
+XDR_SCALAR_TRAITS(XDR::UChar, XDR::UInt);
+XDR_SCALAR_TRAITS(XDR::Long, XDR::Long);
+XDR_SCALAR_TRAITS(XDR::ULong, XDR::ULong);
+XDR_SCALAR_TRAITS(XDR::Float, XDR::Float);
+XDR_SCALAR_TRAITS(XDR::Double, XDR::Double);
+
+#undef XDR_SCALAR_TRAITS
+
+template<> struct xdrTraits< bool > {
+  enum { SIZE = 4, WIDTH = 0 };
+  static inline void write(unsigned char *p, const bool& v){
+    XDR::xdrWrite< XDR::Int >(p, v ? 1 : 0);
+  }
+  static inline void read(bool& v, const unsigned char *p){
+    v = (XDR::xdrRead< XDR::Int >(p) != 0);
+  }
+};
+
+// fixed-length arrays
+template< typename T, size_t N > struct xdrTraits< T[N] > {
+  enum { SIZE = N * xdrTraits< T >::SIZE, WIDTH = xdrTraits< T >::WIDTH };
+  static inline void write(unsigned char *p, const T (&v)[N]){
+    if(WIDTH != 0){
+      XDR::xdrWriteArray(p, v, N);
+    } else {
+      for(size_t i = 0; i < N; i++) xdrTraits< T >::write(p + i * xdrTraits< T >::SIZE, v[i]);
+    }
+  }
+  static inline void read(T (&v)[N], const unsigned char *p){
+    if(WIDTH != 0){
+      XDR::xdrReadArray(v, p, N);
+    } else {
+      for(size_t i = 0; i < N; i++) xdrTraits< T >::read(v[i], p + i * xdrTraits< T >::SIZE);
+    }
+  }
+};
+
+// fixed-length opaque data
+template< typename C, size_t N > struct _xdrOpaqueTraits {
+  enum { SIZE = (N + 3) & ~3, WIDTH = 0 };
+  static inline void write(unsigned char *p, const C (&v)[N]){
+    memcpy(p, v, N);
+    for(size_t i = N; i < (size_t)SIZE; i++) p[i] = 0;
+  }
+  static inline void read(C (&v)[N], const unsigned char *p){
+    memcpy(v, p, N);
+  }
+};
+template< size_t N > struct xdrTraits< char[N] > : public _xdrOpaqueTraits< char, N > {};
+template< size_t N > struct xdrTraits< unsigned char[N] > :
+  public _xdrOpaqueTraits< unsigned char, N > {};
+
+/*! \class xdrField
+    \brief Member M of type T in structure S
+*/
+template< typename S, typename T, T S::*M > struct xdrField {
+  typedef S STRUCT;
+  typedef xdrTraits< T > Traits;
+  enum { SIZE = Traits::SIZE, WIDTH = Traits::WIDTH };
+
+  static inline void encode(unsigned char *p, const S& s){ Traits::write(p, s.*M); }
+  static inline void decode(S& s, const unsigned char *p){ Traits::read(s.*M, p); }
+
+  //! Offset of the member in s
+  static inline size_t offset(const S& s){
+    return reinterpret_cast<const char *>(&(s.*M)) - reinterpret_cast<const char *>(&s);
+  }
+};
+
+//! Type of the xdrField for member m of type T in structure S
+#define XDR_FIELD(S,T,m) mgr::xdrField< S, T, &S::m >
+
+/*! \class xdrStruct
+    \brief XDR coding of a structure described by the type list L of xdrField
+
+    SIZE is the size of the structure in XDR.
+*/
+template< typename L > struct xdrStruct;
+
+template<> struct xdrStruct< meta::NullType > {
+  enum { SIZE = 0, WIDTH = -1 };
+  template< typename S > static inline void encode(unsigned char *p, const S& s) {}
+  template< typename S > static inline void decode(S& s, const unsigned char *p) {}
+  template< typename S > static inline bool contiguous(const S& s, size_t at) { return true; }
+};
+
+template< typename H, typename T > struct xdrStruct< meta::TypeList< H, T > > {
+  typedef xdrStruct< T > Tail;
+  enum {
+    SIZE = H::SIZE + Tail::SIZE,
+    //! size of all members, if it is the same for all of them, otherwise 0
+    WIDTH = ((int)Tail::WIDTH == -1) ? (int)H::WIDTH :
+	    (((int)Tail::WIDTH == (int)H::WIDTH) ? (int)H::WIDTH : 0)
+  };
+
+  //! Encode s to SIZE octets at p
+  template< typename S > static inline void encode(unsigned char *p, const S& s){
+    H::encode(p, s);
+    Tail::encode(p + H::SIZE, s);
+  }
+
+  //! Decode s from SIZE octets at p
+  template< typename S > static inline void decode(S& s, const unsigned char *p){
+    H::decode(s, p);
+    Tail::decode(s, p + H::SIZE);
+  }
+
+  //! The members are at their XDR offsets starting from at
+  template< typename S > static inline bool contiguous(const S& s, size_t at){
+    return (H::offset(s) == at) && Tail::contiguous(s, at + H::SIZE);
+  }
+
+  //! The memory layout of S equals the XDR layout up to the byte order
+  /*! The result is constant for each S, so the compiler removes the
+      test together with the unused branch.
+  */
+  template< typename S > static inline bool flat(const S& s){
+    return (WIDTH > 0) && (sizeof(S) == (size_t)SIZE) && contiguous(s, 0);
+  }
+
+  //! Encode n structures to n * SIZE octets at p
+  template< typename S > static inline void encodeArray(unsigned char *p, const S *s, size_t n){
+    if(!n) return;
+    if(flat(*s)){
+      typedef typename meta::IF< (WIDTH == 8), XDR::ULong, XDR::UInt >::RESULT W;
+      XDR::xdrWriteArray(p, reinterpret_cast<const W *>(s), n * (SIZE / sizeof(W)));
+      return;
+    }
+    for(size_t i = 0; i < n; i++, p += SIZE) encode(p, s[i]);
+  }
+
+  //! Decode n structures from n * SIZE octets at p
+  template< typename S > static inline void decodeArray(S *s, const unsigned char *p, size_t n){
+    if(!n) return;
+    if(flat(*s)){
+      typedef typename meta::IF< (WIDTH == 8), XDR::ULong, XDR::UInt >::RESULT W;
+      XDR::xdrReadArray(reinterpret_cast<W *>(s), p, n * (SIZE / sizeof(W)));
+      return;
+    }
+    for(size_t i = 0; i < n; i++, p += SIZE) decode(s[i], p);
+  }
+};
+
+}; // namespace mgr
+
+#endif // _XDR_XDRSTRUCT_H_
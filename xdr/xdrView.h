@@ -0,0 +1,183 @@
+/*
+ *
+ * RFC 1832 - Sun XDR
+ * Zero-copy views of XDR coded arrays,
+ * elements are converted to machine native on access
+ *
+ * (c) 2006 AC - Microsystem Accessory Consult
+ * Dr. Lars Hanke
+ *
+ * $Id$
+ *
+ * This defines the classes:
+ *
+ * xdrView - read-only view decoding an XDR array on access
+ * xdrView::iterator - random access iterator over an xdrView
+ *
+ * This defines the values:
+ *
+ */
+
+#ifndef _XDR_XDRVIEW_H_
+# define _XDR_XDRVIEW_H_
+
+#include <xdrOrder.h>
+#include <stddef.h>
+#include <iterator>
+
+namespace mgr {
+
+/*! \class xdrView
+    \brief Read-only view of an XDR coded array
+
+    The view refers to n elements of type T in XDR order. Elements
+    are decoded, when they are accessed. Blocks of elements can be
+    decoded at once into a small buffer, which is how the reductions
+    run without a decoded copy of the entire array.
+
+    The view does not own the memory. It is invalid as soon as the
+    underlying buffer is changed or freed.
+*/
+template< typename T > class xdrView {
+public:
+  enum {
+    BLOCK = 4096 / sizeof(T)   //!< Elements decoded at once by the reductions
+  };
+
+  //! Iterator decoding on dereference
+  class iterator {
+  protected:
+    const unsigned char *p;
+
+  public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef ptrdiff_t difference_type;
+    typedef const T *pointer;
+    typedef T reference;
+
+    iterator(const unsigned char *c = NULL) : p(c) {}
+
+    inline T operator*(void) const { return XDR::xdrRead<T>(p); }
+    inline T operator[](difference_type i) const {
+      return XDR::xdrRead<T>(p + i * sizeof(T));
+    }
+
+    inline iterator& operator++(void) { p += sizeof(T); return *this; }
+    inline iterator operator++(int) { iterator i(*this); p += sizeof(T); return i; }
+    inline iterator& operator--(void) { p -= sizeof(T); return *this; }
+    inline iterator operator--(int) { iterator i(*this); p -= sizeof(T); return i; }
+    inline iterator& operator+=(difference_type i) { p += i * sizeof(T); return *this; }
+    inline iterator& operator-=(difference_type i) { p -= i * sizeof(T); return *this; }
+    inline iterator operator+(difference_type i) const { return iterator(p + i * sizeof(T)); }
+    inline iterator operator-(difference_type i) const { return iterator(p - i * sizeof(T)); }
+    inline difference_type operator-(const iterator& i) const {
+      return (p - i.p) / (difference_type)sizeof(T);
+    }
+
+    inline bool operator==(const iterator& i) const { return p == i.p; }
+    inline bool operator!=(const iterator& i) const { return p != i.p; }
+    inline bool operator<(const iterator& i) const { return p < i.p; }
+    inline bool operator>(const iterator& i) const { return p > i.p; }
+    inline bool operator<=(const iterator& i) const { return p <= i.p; }
+    inline bool operator>=(const iterator& i) const { return p >= i.p; }
+  };
+
+  typedef iterator const_iterator;
+
+protected:
+  const unsigned char *d;      //!< XDR coded elements
+  size_t n;                    //!< Number of elements
+
+public:
+  //! Create an empty view
+  xdrView() : d( NULL ), n( 0 ) {}
+
+  //! Create a view of n XDR coded elements at data
+  xdrView(const void *data, size_t count) :
+    d( static_cast<const unsigned char *>(data) ), n( data ? count : 0 ) {}
+
+  //! Number of elements
+  inline size_t size(void) const { return n; }
+
+  //! View has no elements
+  inline bool empty(void) const { return !n; }
+
+  //! Decode element i without range check
+  inline T operator[](size_t i) const { return XDR::xdrRead<T>(d + i * sizeof(T)); }
+
+  //! Decode element i
+  /*! \param i Index of element
+      \param v Decoded value
+      \return ERR_PARAM_RANG, if i is out of range
+  */
+  inline m_error_t at(size_t i, T& v) const {
+    if(i >= n) return ERR_PARAM_RANG;
+    v = operator[](i);
+    return ERR_NO_ERROR;
+  }
+
+  inline iterator begin(void) const { return iterator(d); }
+  inline iterator end(void) const { return iterator(d + n * sizeof(T)); }
+
+  //! Sub-view of count elements starting at first
+  /*! The sub-view is clipped to the range of this view. */
+  inline xdrView sub(size_t first, size_t count) const {
+    if(first > n) first = n;
+    if(count > n - first) count = n - first;
+    return xdrView(d + first * sizeof(T), count);
+  }
+
+  //! Decode a window of elements
+  /*! \param first Index of the first element
+      \param out Buffer for at least count elements
+      \param count Number of elements to decode
+      \return Number of elements decoded, which is less than count
+      at the end of the view
+  */
+  inline size_t decode(size_t first, T *out, size_t count) const {
+    if(first >= n) return 0;
+    if(count > n - first) count = n - first;
+    XDR::xdrReadArray(out, d + first * sizeof(T), count);
+    return count;
+  }
+
+  //! Minimum of all elements
+  /*! \return ERR_PARAM_LEN, if the view is empty */
+  m_error_t min(T& v) const {
+    if(!n) return ERR_PARAM_LEN;
+    T b[BLOCK];
+    v = operator[](0);
+    for(size_t i = 0, c; (c = decode(i, b, BLOCK)); i += c){
+      for(size_t j = 0; j < c; j++) if(b[j] < v) v = b[j];
+    }
+    return ERR_NO_ERROR;
+  }
+
+  //! Maximum of all elements
+  /*! \return ERR_PARAM_LEN, if the view is empty */
+  m_error_t max(T& v) const {
+    if(!n) return ERR_PARAM_LEN;
+    T b[BLOCK];
+    v = operator[](0);
+    for(size_t i = 0, c; (c = decode(i, b, BLOCK)); i += c){
+      for(size_t j = 0; j < c; j++) if(b[j] > v) v = b[j];
+    }
+    return ERR_NO_ERROR;
+  }
+
+  //! Sum of all elements accumulated in type S
+  /*! Choose S wide enough, e.g. long long for integer arrays. */
+  template< typename S > S sum(void) const {
+    T b[BLOCK];
+    S s = 0;
+    for(size_t i = 0, c; (c = decode(i, b, BLOCK)); i += c){
+      for(size_t j = 0; j < c; j++) s += b[j];
+    }
+    return s;
+  }
+};
+
+}; // namespace mgr
+
+#endif // _XDR_XDRVIEW_H_